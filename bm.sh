@@ -1,38 +1,20 @@
 #!/bin/bash
 set -e
 
-echo "🧹 Cleaning previous build..."
-rm -f ./build/tri
+# Heap profile of a full load. tri itself prints the peak RSS when the scene attaches and
+# when every asset is in; Massif shows what the peak is made of.
 
-echo "🛠️  Compiling GLSL shaders..."
-glslangValidator -V shaders/tri.vert.glsl -o shaders/tri.vert.spv
-glslangValidator -V shaders/grid.vert.glsl -o shaders/grid.vert.spv
-glslangValidator -V shaders/grid.frag.glsl -o shaders/grid.frag.spv
-glslangValidator -V shaders/tri.frag.glsl -o shaders/tri.frag.spv
+echo "🛠️  Building..."
+SKIP_RUN=1 ./build.sh
 
-echo "📁 Ensuring build directory exists..."
-mkdir -p build
+echo "📈 Running a headless load under Valgrind Massif..."
+# Headless waits for every asset before its first frame, so one frame covers the whole load
+valgrind --tool=massif --massif-out-file=massif.out \
+  ./build/tri --headless --warmup 0 --frames 1 --out /dev/null
 
-echo "📦 Compiling Nuklear (only if needed)..."
-if [ ! -f build/nuklear.o ]; then
-    gcc -c -o build/nuklear.o nuklear.c
-fi
-
-echo "🔧 Compiling main.c..."
-clang -c main.c -o build/main.o \
-  -Wpointer-arith -Wformat=2 -Wall -Wextra -Wshadow \
-  -ggdb -std=c99 -pedantic  \
-  -D_DEBUG -DVK_USE_PLATFORM_WAYLAND_KHR
-
-echo "🔗 Linking executable..."
-clang build/main.o build/nuklear.o -o build/tri \
-  -Wpointer-arith -Wformat=2 -Wall -Wextra -Wshadow \
-  -ggdb -std=c99 -pedantic  \
-  -D_DEBUG -DVK_USE_PLATFORM_WAYLAND_KHR \
-  -lvulkan -lm -lglfw -lpthread -ldl
+echo "📊 Peak snapshot:"
+ms_print massif.out | head -40
 
-echo "📈 Running with Valgrind Massif..."
-valgrind --tool=massif --massif-out-file=massif.out ./build/tri
-
-echo "📊 Opening Massif Visualizer..."
-massif-visualizer massif.out
+if command -v massif-visualizer > /dev/null; then
+    massif-visualizer massif.out
+fi
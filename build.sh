@@ -17,12 +17,20 @@ SHADERS=(
     "grid.frag"
     "tri.vert"
     "tri.frag"
+    "depth_only.vert"
+    "depth_mask.frag"
+    "shadow.vert"
     "compute_path_mask.comp"
+    "light_cull.comp"
     "particle.comp"
     "particle.vert"
     "particle.frag"
     "skybox.vert"
     "skybox.frag"
+    "bloom_downsample.comp"
+    "bloom_upsample.comp"
+    "tonemap.vert"
+    "tonemap.frag"
 )
 
 echo "Compiling GLSL shaders..."
@@ -37,6 +45,8 @@ for shader in "${SHADERS[@]}"; do
         exit 1
     fi
 done
+# Path mask fallback for devices without R8_UNORM storage images
+glslangValidator -V -DPATH_MASK_RGBA8 shaders/compute_path_mask.comp.glsl -o compiledshaders/compute_path_mask_rgba8.comp.spv
 
 echo "Compiling sources..."
 SRC_FILES=(
@@ -50,6 +60,29 @@ SRC_FILES=(
     src/initialise.c
     src/descriptors.c
     src/skybox.c
+    src/occlusion.c
+    src/clusters.c
+    src/drs.c
+    src/framestats.c
+    src/benchmark.c
+    src/headless.c
+    src/profiler.c
+    src/jobs.c
+    src/arena.c
+    src/pool.c
+    src/fileio.c
+    src/pak.c
+    src/assets.c
+    src/resources.c
+    src/deletion.c
+    src/materials.c
+    src/particlesim.c
+    src/particles.c
+    src/shadows.c
+    src/gputimer.c
+    src/bloom.c
+    src/rendergraph.c
+    src/rendergraph_vk.c
 )
 
 for src in "${SRC_FILES[@]}"; do
@@ -61,6 +94,12 @@ done
 echo "Linking final binary..."
 gcc build/*.o -o build/tri $CFLAGS $LDFLAGS
 
+# The archive is read instead of the loose files whenever it exists, so it is rebuilt with them
+# (a loose file edited after the last pack is still read from disk, with a warning)
+echo "Packing assets..."
+gcc src/packtool.c src/pak.c -o build/pack $CFLAGS
+./build/pack --lz4 data.pak data compiledshaders
+
 echo "Build complete."
 if [ "${SKIP_RUN:-0}" -ne 1 ]; then
     echo "Running ./build/tri"
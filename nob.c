@@ -27,6 +27,29 @@ int main(int argc, char **argv)
         SRC_FOLDER "initialise.c",
         SRC_FOLDER "descriptors.c",
         SRC_FOLDER "skybox.c",
+        SRC_FOLDER "occlusion.c",
+        SRC_FOLDER "clusters.c",
+        SRC_FOLDER "drs.c",
+        SRC_FOLDER "framestats.c",
+        SRC_FOLDER "benchmark.c",
+        SRC_FOLDER "headless.c",
+        SRC_FOLDER "profiler.c",
+        SRC_FOLDER "jobs.c",
+        SRC_FOLDER "arena.c",
+        SRC_FOLDER "pool.c",
+        SRC_FOLDER "fileio.c",
+        SRC_FOLDER "pak.c",
+        SRC_FOLDER "assets.c",
+        SRC_FOLDER "resources.c",
+        SRC_FOLDER "deletion.c",
+        SRC_FOLDER "materials.c",
+        SRC_FOLDER "particlesim.c",
+        SRC_FOLDER "particles.c",
+        SRC_FOLDER "shadows.c",
+        SRC_FOLDER "gputimer.c",
+        SRC_FOLDER "bloom.c",
+        SRC_FOLDER "rendergraph.c",
+        SRC_FOLDER "rendergraph_vk.c",
     };
 
     // Compile into one final binary
@@ -47,6 +70,13 @@ int main(int argc, char **argv)
 
     nob_log(NOB_INFO, "Build complete → %stri", BUILD_FOLDER);
 
+    // Pack tool for data.pak, see build.sh
+    nob_cc(&cmd);
+    nob_cc_flags(&cmd);
+    nob_cc_output(&cmd, BUILD_FOLDER "pack");
+    nob_cc_inputs(&cmd, SRC_FOLDER "packtool.c", SRC_FOLDER "pak.c");
+    if (!nob_cmd_run(&cmd)) return 1;
+
     return 0;
 }
 
@@ -0,0 +1,110 @@
+#version 450
+
+// Whole bloom downsample chain in one dispatch. Each workgroup owns a 64x64 tile of
+// bloom mip 0 (half the HDR resolution) and reduces it down to a single texel of mip 6,
+// keeping the intermediate levels in shared memory instead of going back to the image
+// between levels. Mip 0 is the thresholded scene, mip 1 uses a Karis average so single
+// very bright pixels don't flicker into big blobs.
+layout(local_size_x = 256) in;
+
+const uint BLOOM_MIP_COUNT = 7; // main.h
+
+layout(binding = 0) uniform sampler2D hdrColor;
+layout(binding = 1, rgba16f) uniform writeonly image2D bloomMips[BLOOM_MIP_COUNT];
+
+layout(push_constant) uniform Params {
+    vec4 threshold; // x: threshold, y: soft knee, zw: 1 / mip 0 size
+    vec2 uvScale;   // dynamic resolution: rendered part of the HDR target
+    ivec2 mip0Size;
+    uint mipCount;
+} pc;
+
+// One 32x32 level (mip 1) fits; later levels are packed at the front
+shared float tileR[1024];
+shared float tileG[1024];
+shared float tileB[1024];
+
+float luminance(vec3 c) {
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Quadratic soft threshold
+vec3 prefilter(vec3 c) {
+    float brightness = max(c.r, max(c.g, c.b));
+    float knee = pc.threshold.x * pc.threshold.y;
+    float soft = clamp(brightness - pc.threshold.x + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-4);
+    float contribution = max(soft, brightness - pc.threshold.x) / max(brightness, 1e-4);
+    return c * contribution;
+}
+
+// Storage image arrays are indexed with constants only, so no dynamic indexing feature is needed
+void storeMip(uint level, ivec2 texel, vec3 value) {
+    ivec2 size = max(pc.mip0Size >> level, ivec2(1));
+    if (level >= pc.mipCount || any(greaterThanEqual(texel, size)))
+        return;
+    vec4 v = vec4(value, 1.0);
+    switch (level) {
+    case 0: imageStore(bloomMips[0], texel, v); break;
+    case 1: imageStore(bloomMips[1], texel, v); break;
+    case 2: imageStore(bloomMips[2], texel, v); break;
+    case 3: imageStore(bloomMips[3], texel, v); break;
+    case 4: imageStore(bloomMips[4], texel, v); break;
+    case 5: imageStore(bloomMips[5], texel, v); break;
+    case 6: imageStore(bloomMips[6], texel, v); break;
+    }
+}
+
+void main() {
+    uint t = gl_LocalInvocationIndex;
+    ivec2 tile = ivec2(gl_WorkGroupID.xy);
+
+    // Mip 0 -> mip 1: every invocation does 4 of the 32x32 mip 1 texels
+    for (uint i = 0; i < 4; ++i) {
+        uint index = t + i * 256;
+        ivec2 p1 = ivec2(index % 32, index / 32);
+        vec3 sum = vec3(0.0);
+        float weightSum = 0.0;
+        for (int q = 0; q < 4; ++q) {
+            ivec2 p0 = tile * 64 + p1 * 2 + ivec2(q & 1, q >> 1);
+            // Bilinear tap at the center of a 2x2 HDR block (of the rendered part)
+            vec2 uv = (vec2(p0) + 0.5) * pc.threshold.zw * pc.uvScale;
+            vec3 c = prefilter(textureLod(hdrColor, uv, 0.0).rgb);
+            storeMip(0, p0, c);
+            float w = 1.0 / (1.0 + luminance(c));
+            sum += c * w;
+            weightSum += w;
+        }
+        vec3 c1 = sum / weightSum;
+        storeMip(1, tile * 32 + p1, c1);
+        tileR[index] = c1.r;
+        tileG[index] = c1.g;
+        tileB[index] = c1.b;
+    }
+    barrier();
+
+    // Mips 2..6, each level read from and written back to shared memory
+    uint width = 32;
+    for (uint level = 2; level < BLOOM_MIP_COUNT; ++level) {
+        uint outWidth = width / 2;
+        bool active = t < outWidth * outWidth;
+        uvec2 p = uvec2(t % outWidth, t / outWidth);
+        vec3 c = vec3(0.0);
+        if (active) {
+            for (uint q = 0; q < 4; ++q) {
+                uint src = (p.y * 2 + (q >> 1)) * width + p.x * 2 + (q & 1);
+                c += vec3(tileR[src], tileG[src], tileB[src]);
+            }
+            c *= 0.25;
+        }
+        barrier();
+        if (active) {
+            tileR[t] = c.r;
+            tileG[t] = c.g;
+            tileB[t] = c.b;
+            storeMip(level, tile * int(outWidth) + ivec2(p), c);
+        }
+        barrier();
+        width = outWidth;
+    }
+}
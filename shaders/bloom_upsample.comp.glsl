@@ -0,0 +1,38 @@
+#version 450
+
+// One step of the bloom upsample chain: mip N += tent(mip N + 1), dispatched from the
+// smallest mip towards mip 0. The whole image stays in GENERAL so mip N + 1 can be
+// sampled while mip N is written.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D bloomChain;
+layout(binding = 1, rgba16f) uniform image2D target;
+
+layout(push_constant) uniform Params {
+    vec2 texelSize; // 1 / size of the mip being upsampled (target's mip + 1)
+    float sourceMip;
+    float radius;   // tent radius in source texels
+} pc;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(target);
+    if (any(greaterThanEqual(texel, size)))
+        return;
+
+    // 3x3 tent over bilinear taps
+    vec2 uv = (vec2(texel) + 0.5) / vec2(size);
+    vec2 d = pc.texelSize * pc.radius;
+    vec3 up = textureLod(bloomChain, uv, pc.sourceMip).rgb * 4.0;
+    up += (textureLod(bloomChain, uv + vec2(-d.x, 0.0), pc.sourceMip).rgb +
+           textureLod(bloomChain, uv + vec2(d.x, 0.0), pc.sourceMip).rgb +
+           textureLod(bloomChain, uv + vec2(0.0, -d.y), pc.sourceMip).rgb +
+           textureLod(bloomChain, uv + vec2(0.0, d.y), pc.sourceMip).rgb) * 2.0;
+    up += textureLod(bloomChain, uv + vec2(-d.x, -d.y), pc.sourceMip).rgb +
+          textureLod(bloomChain, uv + vec2(d.x, -d.y), pc.sourceMip).rgb +
+          textureLod(bloomChain, uv + vec2(-d.x, d.y), pc.sourceMip).rgb +
+          textureLod(bloomChain, uv + vec2(d.x, d.y), pc.sourceMip).rgb;
+    up *= 1.0 / 16.0;
+
+    imageStore(target, texel, vec4(imageLoad(target, texel).rgb + up, 1.0));
+}
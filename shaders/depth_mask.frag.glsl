@@ -0,0 +1,25 @@
+#version 450
+
+// Depth prepass for alpha-masked materials: alpha test only, no lighting.
+// Uses the same coverage rule as tri.frag so the EQUAL pass sees matching depth.
+
+layout(location = 2) in vec2 fragTexCoord;
+
+layout(binding = 1) uniform sampler2D baseColorSampler;
+
+layout(binding = 4) uniform MaterialUBO {
+    vec4 baseColorFactor;   // rgba
+    vec4 emissiveFactor;    // rgb + pad
+    vec4 mr_ac_am;          // x: metallic, y: roughness, z: alphaCutoff, w: alphaMode (as float)
+    ivec4 hasFlags;         // x: hasBaseColor, y: hasMetallicRoughness, z: hasEmissive, w: unused
+} material;
+
+void main() {
+    vec2 flippedUV = vec2(fragTexCoord.x, 1.0 - fragTexCoord.y);
+
+    float alpha = material.baseColorFactor.a;
+    if (material.hasFlags.x == 1) {
+        alpha *= texture(baseColorSampler, flippedUV).a;
+    }
+    if (alpha < material.mr_ac_am.z) discard;
+}
@@ -0,0 +1,19 @@
+#version 450
+
+// Depth prepass for opaque materials: position-only stream, no fragment shader.
+// Must produce bit-identical positions to tri.vert so the main pass can use EQUAL.
+
+layout(location = 0) in vec3 inPosition;
+
+invariant gl_Position;
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 proj;
+    mat4 view;
+    mat4 model;
+} ubo;
+
+void main() {
+    vec4 worldPos = ubo.model * vec4(inPosition, 1.0);
+    gl_Position = ubo.proj * ubo.view * worldPos;
+}
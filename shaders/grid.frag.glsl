@@ -14,7 +14,7 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     vec3 cameraPos;
     uint numLights;
-    // Point lights array follows
+    // Cluster parameters follow
 } ubo;
 
 // Texture sampler for ground texture
@@ -14,7 +14,7 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     vec3 cameraPos;
     uint numLights;
-    // Point lights array follows but we don't need it in vertex shader
+    // Cluster parameters follow but we don't need them in vertex shader
 } ubo;
 
 vec3 unprojectPoint(float x, float y, float z, mat4 view, mat4 proj) {
@@ -0,0 +1,78 @@
+#version 450
+
+// Clustered light assignment, one workgroup per cluster (dispatch CLUSTER_GRID_X x Y x Z).
+// Each invocation tests a strided share of the lights against the cluster's view-space
+// AABB; the math matches clusterUpdateBounds / clusterAssignLights in clusters.c.
+layout(local_size_x = 64) in;
+
+struct Light {
+    vec4 positionRadius; // world position, influence radius
+    vec4 color;          // rgb * intensity
+};
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 proj;
+    mat4 view;
+    mat4 model;
+    vec3 cameraPos;
+    uint numLights;
+    vec4 clusterDepth;  // x: zNear, y: zFar, z: slice scale, w: slice bias
+    vec4 clusterScreen; // xy: framebuffer size, z: tan(fovY / 2), w: aspect
+} ubo;
+
+layout(std430, binding = 1) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, binding = 2) writeonly buffer ClusterCounts {
+    uint clusterCounts[];
+};
+
+layout(std430, binding = 3) writeonly buffer ClusterIndices {
+    uint clusterIndices[];
+};
+
+const uint CLUSTER_MAX_LIGHTS = 256; // clusters.h
+
+shared uint visibleCount;
+
+float sliceDepth(uint slice) {
+    return ubo.clusterDepth.x * pow(ubo.clusterDepth.y / ubo.clusterDepth.x, float(slice) / float(gl_NumWorkGroups.z));
+}
+
+void main() {
+    uvec3 grid = gl_NumWorkGroups;
+    uvec3 id = gl_WorkGroupID;
+    uint cluster = (id.z * grid.y + id.y) * grid.x + id.x;
+
+    if (gl_LocalInvocationIndex == 0)
+        visibleCount = 0;
+    barrier();
+
+    float dNear = sliceDepth(id.z);
+    float dFar = sliceDepth(id.z + 1);
+    float tanY = ubo.clusterScreen.z;
+    float tanX = tanY * ubo.clusterScreen.w;
+    // Tile rows count down from the top of the screen, view space +Y is up
+    float left = -1.0 + 2.0 * float(id.x) / float(grid.x);
+    float right = -1.0 + 2.0 * float(id.x + 1) / float(grid.x);
+    float top = 1.0 - 2.0 * float(id.y) / float(grid.y);
+    float bottom = 1.0 - 2.0 * float(id.y + 1) / float(grid.y);
+    vec3 aabbMin = vec3(min(left * tanX * dNear, left * tanX * dFar), min(bottom * tanY * dNear, bottom * tanY * dFar), -dFar);
+    vec3 aabbMax = vec3(max(right * tanX * dNear, right * tanX * dFar), max(top * tanY * dNear, top * tanY * dFar), -dNear);
+
+    for (uint i = gl_LocalInvocationIndex; i < ubo.numLights; i += gl_WorkGroupSize.x) {
+        vec4 light = lights[i].positionRadius;
+        vec3 center = (ubo.view * vec4(light.xyz, 1.0)).xyz;
+        vec3 d = max(max(aabbMin - center, center - aabbMax), 0.0);
+        if (dot(d, d) <= light.w * light.w) {
+            uint slot = atomicAdd(visibleCount, 1);
+            if (slot < CLUSTER_MAX_LIGHTS)
+                clusterIndices[cluster * CLUSTER_MAX_LIGHTS + slot] = i;
+        }
+    }
+
+    barrier();
+    if (gl_LocalInvocationIndex == 0)
+        clusterCounts[cluster] = min(visibleCount, CLUSTER_MAX_LIGHTS);
+}
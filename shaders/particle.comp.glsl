@@ -1,27 +1,244 @@
 #version 450
 
-layout (local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+// Every kernel of the particle step (see particlesim.h, which mirrors them on the CPU).
+// One pipeline per KERNEL value; prepare, scan_blocks and finalize run a single workgroup,
+// emit and simulate are dispatched indirectly with one thread per particle, scan and
+// scatter with one workgroup per PARTICLE_SCAN_BLOCK particles.
+layout(local_size_x = 256) in;
 
-layout (binding = 0) buffer Particles {
-    vec4 pos[];
-} particles;
+layout(constant_id = 0) const uint KERNEL = 0;
+const uint KERNEL_PREPARE = 0;
+const uint KERNEL_EMIT = 1;
+const uint KERNEL_SIMULATE = 2;
+const uint KERNEL_SCAN = 3;
+const uint KERNEL_SCAN_BLOCKS = 4;
+const uint KERNEL_SCATTER = 5;
+const uint KERNEL_FINALIZE = 6;
 
-layout (binding = 1) uniform Uniforms {
-    vec2 mouse_pos;
-    float delta_time;
-};
+const uint GROUP_SIZE = 256; // particlesim.h
+const uint SCAN_BLOCK = 512;
+const uint MAX_SCAN_BLOCKS = 4096;
 
-void main() {
-    uint index = gl_GlobalInvocationID.x;
+layout(binding = 0) buffer Counters {
+    uint emitDispatch[3];
+    uint emitCount;
+    uint simulateDispatch[3];
+    uint simulateCount;
+    uint scanDispatch[3];
+    uint deadCount;
+    uint aliveCount[2];
+    uint draw[4];
+} counters;
+
+layout(binding = 1) buffer DeadList { uint deadList[]; };
+layout(binding = 2) buffer AliveLists { uint aliveList[]; }; // two lists of capacity entries
+layout(binding = 3) buffer Flags { uint flags[]; };
+layout(binding = 4) buffer Scanned { uint scanned[]; };
+layout(binding = 5) buffer BlockSums { uint blockSums[]; };
+layout(binding = 6) buffer Positions { vec4 positions[]; };   // xyz, remaining life
+layout(binding = 7) buffer Velocities { vec4 velocities[]; }; // xyz, lifetime
+
+layout(push_constant) uniform Params {
+    vec4 emitter;     // xyz, spawn disc radius
+    vec4 gravityDrag; // xyz, linear drag per second
+    float speed;
+    float spread;
+    float lifeMin;
+    float lifeMax;
+    float groundY;
+    float bounce;
+    float dt;
+    uint emitRequest;
+    uint seed;
+    uint current;
+    uint capacity;
+} pc;
+
+shared uint sums[GROUP_SIZE];
+
+uint groupCount(uint threads, uint groupSize) {
+    return (threads + groupSize - 1) / groupSize;
+}
+
+// PCG hash
+uint hash(uint x) {
+    uint state = x * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random(inout uint state) {
+    state = hash(state);
+    return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+void emitOne(uint emitIndex, out vec4 position, out vec4 velocity) {
+    uint state = pc.seed ^ hash(emitIndex);
 
-    // Add some velocity and gravity
-    vec2 velocity = particles.pos[index].zw;
-    velocity.y -= 9.8 * delta_time; // Gravity
-    particles.pos[index].xy += velocity * delta_time;
+    float angle = random(state) * 6.28318531;
+    float radius = sqrt(random(state)) * pc.emitter.w;
+    position.xyz = vec3(pc.emitter.x + cos(angle) * radius, pc.emitter.y, pc.emitter.z + sin(angle) * radius);
+
+    float coneAngle = random(state) * 6.28318531;
+    float cone = sqrt(random(state)) * pc.spread;
+    float speed = pc.speed * (0.75 + 0.5 * random(state)) / sqrt(1.0 + cone * cone);
+    velocity.xyz = vec3(cos(coneAngle) * cone * speed, speed, sin(coneAngle) * cone * speed);
+
+    float life = pc.lifeMin + (pc.lifeMax - pc.lifeMin) * random(state);
+    position.w = life;
+    velocity.w = life;
+}
+
+bool integrate(inout vec4 position, inout vec4 velocity) {
+    float damping = max(1.0 - pc.gravityDrag.w * pc.dt, 0.0);
+    velocity.xyz = (velocity.xyz + pc.gravityDrag.xyz * pc.dt) * damping;
+    position.xyz += velocity.xyz * pc.dt;
+
+    if (position.y < pc.groundY) {
+        position.y = pc.groundY;
+        if (velocity.y < 0.0)
+            velocity.y = -velocity.y * pc.bounce;
+    }
+
+    position.w -= pc.dt;
+    return position.w > 0.0;
+}
+
+// Inclusive scan of one value per thread, returns the workgroup total
+uint scanWorkgroup(uint t, uint value) {
+    sums[t] = value;
+    barrier();
+    for (uint offset = 1; offset < GROUP_SIZE; offset <<= 1) {
+        uint add = t >= offset ? sums[t - offset] : 0;
+        barrier();
+        sums[t] += add;
+        barrier();
+    }
+    return sums[GROUP_SIZE - 1];
+}
 
-    // If particle is off-screen, reset it to the mouse position
-    if (particles.pos[index].y < -1.0) {
-        particles.pos[index].xy = mouse_pos;
-        particles.pos[index].zw = vec2(0.0, 0.0);
+void prepare() {
+    if (gl_GlobalInvocationID.x != 0)
+        return;
+    uint alive = counters.aliveCount[pc.current];
+    uint emit = min(pc.emitRequest, counters.deadCount);
+
+    // The emitted slots are deadList[deadCount .. deadCount + emit)
+    counters.deadCount -= emit;
+    counters.emitCount = emit;
+    counters.simulateCount = alive + emit;
+    counters.emitDispatch[0] = groupCount(emit, GROUP_SIZE);
+    counters.simulateDispatch[0] = groupCount(alive + emit, GROUP_SIZE);
+    counters.scanDispatch[0] = groupCount(alive + emit, SCAN_BLOCK);
+    for (uint i = 1; i < 3; ++i) {
+        counters.emitDispatch[i] = 1;
+        counters.simulateDispatch[i] = 1;
+        counters.scanDispatch[i] = 1;
+    }
+}
+
+void emit() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= counters.emitCount)
+        return;
+    uint index = deadList[counters.deadCount + i];
+    vec4 position, velocity;
+    emitOne(i, position, velocity);
+    positions[index] = position;
+    velocities[index] = velocity;
+    uint aliveBefore = counters.simulateCount - counters.emitCount;
+    aliveList[pc.current * pc.capacity + aliveBefore + i] = index;
+}
+
+void simulate() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= counters.simulateCount)
+        return;
+    uint index = aliveList[pc.current * pc.capacity + i];
+    vec4 position = positions[index];
+    vec4 velocity = velocities[index];
+    bool alive = integrate(position, velocity);
+    positions[index] = position;
+    velocities[index] = velocity;
+    flags[i] = alive ? 1 : 0;
+}
+
+// Exclusive scan of the flags inside one block, two per thread
+void scan() {
+    uint t = gl_LocalInvocationIndex;
+    uint count = counters.simulateCount;
+    uint i = gl_WorkGroupID.x * SCAN_BLOCK + t * 2;
+    uint a = i < count ? flags[i] : 0;
+    uint b = i + 1 < count ? flags[i + 1] : 0;
+    uint total = scanWorkgroup(t, a + b);
+    uint base = sums[t] - (a + b);
+    if (i < count)
+        scanned[i] = base;
+    if (i + 1 < count)
+        scanned[i + 1] = base + a;
+    if (t == 0)
+        blockSums[gl_WorkGroupID.x] = total;
+}
+
+// Exclusive scan of the block totals; MAX_SCAN_BLOCKS / GROUP_SIZE per thread
+void scanBlocks() {
+    const uint PER_THREAD = MAX_SCAN_BLOCKS / GROUP_SIZE;
+    uint t = gl_LocalInvocationIndex;
+    uint blockCount = counters.scanDispatch[0];
+    uint first = t * PER_THREAD;
+
+    uint local = 0;
+    for (uint b = first; b < first + PER_THREAD && b < blockCount; ++b)
+        local += blockSums[b];
+    uint total = scanWorkgroup(t, local);
+
+    uint running = sums[t] - local;
+    for (uint b = first; b < first + PER_THREAD && b < blockCount; ++b) {
+        uint sum = blockSums[b];
+        blockSums[b] = running;
+        running += sum;
+    }
+    if (t == 0)
+        counters.aliveCount[pc.current ^ 1] = total;
+}
+
+void scatter() {
+    uint count = counters.simulateCount;
+    uint deadBase = counters.deadCount;
+    uint blockOffset = blockSums[gl_WorkGroupID.x];
+    for (uint k = 0; k < 2; ++k) {
+        uint i = gl_WorkGroupID.x * SCAN_BLOCK + gl_LocalInvocationIndex * 2 + k;
+        if (i >= count)
+            return;
+        uint index = aliveList[pc.current * pc.capacity + i];
+        uint offset = scanned[i] + blockOffset;
+        if (flags[i] != 0)
+            aliveList[(pc.current ^ 1) * pc.capacity + offset] = index;
+        else
+            deadList[deadBase + (i - offset)] = index;
+    }
+}
+
+void finalize() {
+    if (gl_GlobalInvocationID.x != 0)
+        return;
+    uint survivors = counters.aliveCount[pc.current ^ 1];
+    counters.deadCount += counters.simulateCount - survivors;
+    counters.aliveCount[pc.current] = 0;
+    counters.draw[0] = 6;
+    counters.draw[1] = survivors;
+    counters.draw[2] = 0;
+    counters.draw[3] = 0;
+}
+
+void main() {
+    switch (KERNEL) {
+    case KERNEL_PREPARE: prepare(); break;
+    case KERNEL_EMIT: emit(); break;
+    case KERNEL_SIMULATE: simulate(); break;
+    case KERNEL_SCAN: scan(); break;
+    case KERNEL_SCAN_BLOCKS: scanBlocks(); break;
+    case KERNEL_SCATTER: scatter(); break;
+    case KERNEL_FINALIZE: finalize(); break;
     }
 }
@@ -1,7 +1,12 @@
 #version 450
 
+layout(location = 0) in vec2 fragCorner;
+layout(location = 1) in vec3 fragColor;
+
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(1.0, 1.0, 1.0, 1.0);
-}
\ No newline at end of file
+    // Round soft sprite, blended additively into the HDR target
+    float falloff = max(1.0 - dot(fragCorner, fragCorner), 0.0);
+    outColor = vec4(fragColor * falloff * falloff, 1.0);
+}
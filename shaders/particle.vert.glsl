@@ -1,8 +1,39 @@
 #version 450
 
-layout(location = 0) in vec4 inPosition;
+// Camera-facing quads, one instance per alive particle (instanceCount comes from
+// the finalize kernel through vkCmdDrawIndirect)
+layout(binding = 0) readonly buffer Positions { vec4 positions[]; };   // xyz, remaining life
+layout(binding = 1) readonly buffer Velocities { vec4 velocities[]; }; // xyz, lifetime
+layout(binding = 2) readonly buffer AliveLists { uint aliveList[]; };
+
+layout(push_constant) uniform Params {
+    mat4 viewProj;
+    vec4 cameraRight; // xyz, particle size
+    vec4 cameraUp;
+    vec4 color;       // rgb * intensity
+    uint aliveOffset; // start of the list the last step compacted into
+} pc;
+
+layout(location = 0) out vec2 fragCorner;
+layout(location = 1) out vec3 fragColor;
+
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
 
 void main() {
-    gl_Position = vec4(inPosition.xy, 0.0, 1.0);
-    gl_PointSize = 2.0;
-}
\ No newline at end of file
+    uint index = aliveList[pc.aliveOffset + gl_InstanceIndex];
+    vec4 position = positions[index];
+    vec4 velocity = velocities[index];
+
+    // Shrink and fade over the last part of the lifetime
+    float age = clamp(position.w / max(velocity.w, 1e-4), 0.0, 1.0);
+    float size = pc.cameraRight.w * sqrt(age);
+
+    vec2 corner = corners[gl_VertexIndex];
+    vec3 world = position.xyz + (pc.cameraRight.xyz * corner.x + pc.cameraUp.xyz * corner.y) * size;
+    gl_Position = pc.viewProj * vec4(world, 1.0);
+
+    fragCorner = corner;
+    fragColor = pc.color.rgb * mix(vec3(1.0, 0.35, 0.1), vec3(1.0), age) * age;
+}
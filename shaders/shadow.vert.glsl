@@ -0,0 +1,12 @@
+#version 450
+
+// Cascade depth: position-only stream, light view-projection per cascade
+layout(location = 0) in vec3 inPosition;
+
+layout(push_constant) uniform ShadowPush {
+    mat4 lightViewProj;
+} push;
+
+void main() {
+    gl_Position = push.lightViewProj * vec4(inPosition, 1.0);
+}
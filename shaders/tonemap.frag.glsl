@@ -0,0 +1,51 @@
+#version 450
+
+layout(location = 0) in vec2 fragUV;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform sampler2D hdrColor;
+layout(binding = 1) uniform sampler2D bloomChain;
+
+layout(push_constant) uniform Params {
+    float exposure;
+    float bloomIntensity; // 0 when bloom is off; the chain is not written then
+    vec2 uvScale;         // dynamic resolution: the scene covers this part of hdrColor
+    vec2 uvMax;           // keeps bilinear taps off the unrendered texels past it
+    float sharpness;      // 0 at native resolution
+} pc;
+
+// ACES filmic fit (Narkowicz 2015)
+vec3 aces(vec3 x) {
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+vec3 sampleScene(vec2 uv) {
+    return textureLod(hdrColor, min(uv, pc.uvMax), 0.0).rgb;
+}
+
+// Bilinear upscale plus a cross-shaped unsharp mask, clamped to the neighbourhood's range
+// so edges don't ring
+vec3 upscale(vec2 uv) {
+    vec3 c = sampleScene(uv);
+    if (pc.sharpness <= 0.0)
+        return c;
+    vec2 texel = 1.0 / vec2(textureSize(hdrColor, 0));
+    vec3 n = sampleScene(uv + vec2(0.0, -texel.y));
+    vec3 s = sampleScene(uv + vec2(0.0, texel.y));
+    vec3 w = sampleScene(uv + vec2(-texel.x, 0.0));
+    vec3 e = sampleScene(uv + vec2(texel.x, 0.0));
+    vec3 lo = min(c, min(min(n, s), min(w, e)));
+    vec3 hi = max(c, max(max(n, s), max(w, e)));
+    vec3 sharpened = c + (4.0 * c - n - s - w - e) * (0.25 * pc.sharpness);
+    return clamp(sharpened, lo, hi);
+}
+
+void main() {
+    vec3 color = upscale(fragUV * pc.uvScale);
+    if (pc.bloomIntensity > 0.0)
+        color += textureLod(bloomChain, fragUV, 0.0).rgb * pc.bloomIntensity;
+
+    // The swapchain is sRGB, so the hardware applies the transfer function on store
+    outColor = vec4(aces(color * pc.exposure), 1.0);
+}
@@ -7,9 +7,9 @@ layout(location = 3) in vec4 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
+struct Light {
+    vec4 positionRadius; // world position, influence radius
+    vec4 color;          // rgb * intensity
 };
 
 struct DirectionalLight {
@@ -23,7 +23,8 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     vec3 cameraPos;
     uint numLights;
-    PointLight lights[8];
+    vec4 clusterDepth;  // x: zNear, y: zFar, z: slice scale, w: slice bias
+    vec4 clusterScreen; // xy: framebuffer size, z: tan(fovY / 2), w: aspect
     DirectionalLight dirLight;
     // Stylized controls (std140: pack as scalars)
     int stylizedMode;            // 0=PBR, 1=Toon
@@ -34,6 +35,10 @@ layout(binding = 0) uniform UniformBufferObject {
     float toonWrap;              // light wrap
     float rimStrength;           // rim intensity
     float rimWidth;              // rim width exponent
+    // Directional shadow cascades
+    mat4 cascadeViewProj[4];
+    vec4 cascadeSplits;          // view-space far distance of each cascade
+    vec4 shadowParams;           // x: texel size, y: depth bias, w: enabled
 } ubo;
 
 layout(binding = 1) uniform sampler2D baseColorSampler;
@@ -47,6 +52,35 @@ layout(binding = 4) uniform MaterialUBO {
     ivec4 hasFlags;         // x: hasBaseColor, y: hasMetallicRoughness, z: hasEmissive, w: unused
 } material;
 
+// Clustered point lights, filled by light_cull.comp (or the CPU path in clusters.c)
+layout(std430, binding = 5) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, binding = 6) readonly buffer ClusterCounts {
+    uint clusterCounts[];
+};
+
+layout(std430, binding = 7) readonly buffer ClusterIndices {
+    uint clusterIndices[];
+};
+
+layout(binding = 8) uniform sampler2DArrayShadow shadowMap;
+
+// Must match clusters.h
+const uint CLUSTER_GRID_X = 16;
+const uint CLUSTER_GRID_Y = 9;
+const uint CLUSTER_GRID_Z = 24;
+const uint CLUSTER_MAX_LIGHTS = 256;
+
+// Material permutation baked into each pipeline (MeshPipelineKey.spec).
+// -1 keeps the runtime branch on the UBOs so one pipeline can serve every material.
+layout(constant_id = 0) const int SPEC_HAS_BASE_COLOR = -1;
+layout(constant_id = 1) const int SPEC_HAS_METALLIC_ROUGHNESS = -1;
+layout(constant_id = 2) const int SPEC_HAS_EMISSIVE = -1;
+layout(constant_id = 3) const int SPEC_ALPHA_MODE = -1;
+layout(constant_id = 4) const int SPEC_SHADING_MODEL = -1;
+
 const float PI = 3.14159265359;
 
 float distributionGGX(vec3 N, vec3 H, float roughness) {
@@ -80,6 +114,79 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
     return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
+uint clusterIndex(vec3 worldPos) {
+    float viewZ = -(ubo.view * vec4(worldPos, 1.0)).z;
+    float slice = floor(log(max(viewZ, ubo.clusterDepth.x)) * ubo.clusterDepth.z - ubo.clusterDepth.w);
+    uint z = uint(clamp(slice, 0.0, float(CLUSTER_GRID_Z - 1)));
+    uvec2 tile = uvec2(gl_FragCoord.xy / ubo.clusterScreen.xy * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+    tile = min(tile, uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    return (z * CLUSTER_GRID_Y + tile.y) * CLUSTER_GRID_X + tile.x;
+}
+
+// 3x3 PCF on top of the sampler's bilinear compare, in the nearest cascade covering the fragment
+float directionalShadow(vec3 worldPos) {
+    if (ubo.shadowParams.w == 0.0)
+        return 1.0;
+    float viewZ = -(ubo.view * vec4(worldPos, 1.0)).z;
+    if (viewZ > ubo.cascadeSplits[3])
+        return 1.0;
+    int cascade = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (viewZ > ubo.cascadeSplits[i])
+            cascade = i + 1;
+    }
+
+    vec4 shadowPos = ubo.cascadeViewProj[cascade] * vec4(worldPos, 1.0);
+    vec3 coord = shadowPos.xyz / shadowPos.w;
+    coord.xy = coord.xy * 0.5 + 0.5;
+    float texel = ubo.shadowParams.x;
+    float lit = 0.0;
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x)
+            lit += texture(shadowMap, vec4(coord.xy + vec2(x, y) * texel, float(cascade), coord.z - ubo.shadowParams.y));
+    }
+    return lit / 9.0;
+}
+
+// Diffuse + specular from one light; ambient and rim are added once by the caller
+vec3 shadeLight(int mode, vec3 N, vec3 V, vec3 L, vec3 radiance, vec3 albedo, float metallic, float roughness, vec3 F0) {
+    vec3 H = normalize(V + L);
+    float NdotL = max(dot(N, L), 0.0);
+    if (mode == 1) {
+        // Light wrap to avoid harsh terminator
+        float wrapNdotL = clamp((NdotL + ubo.toonWrap) / (1.0 + ubo.toonWrap), 0.0, 1.0);
+
+        // Soft quantization using smoothstep between bands
+        float steps = max(1.0, ubo.toonSteps);
+        float t = wrapNdotL * steps;
+        float base = floor(t) / steps;
+        float frac = t - floor(t);
+        float softness = clamp(ubo.toonShadowSoftness, 0.0, 1.0);
+        float q = mix(base, base + 1.0 / steps, smoothstep(0.5 - softness, 0.5 + softness, frac));
+        vec3 diffuse = albedo * q;
+
+        // Specular band with thresholding and control by roughness
+        float hdotn = max(dot(H, N), 0.0);
+        float specPow = mix(8.0, 128.0, 1.0 - clamp(roughness, 0.0, 1.0));
+        float specVal = pow(hdotn, specPow);
+        float specBand = smoothstep(0.6, 0.8, specVal) * ubo.toonSpecularStrength;
+
+        return (diffuse + specBand) * radiance;
+    }
+
+    // PBR
+    float NDF = distributionGGX(N, H, roughness);
+    float G = geometrySmith(N, V, L, roughness);
+    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
+    kD *= 1.0 - metallic;
+    vec3 numerator = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * NdotL + 0.0001;
+    vec3 spec = numerator / denominator;
+    return (kD * albedo / PI + spec) * radiance * NdotL;
+}
+
 void main() {
     vec2 flippedUV = vec2(fragTexCoord.x, 1.0 - fragTexCoord.y); // 👈 Flip Y
 
@@ -88,10 +195,13 @@ void main() {
     float roughness;
     float alpha = 1.0;
 
-    if (material.hasFlags.x == 1) {
-        vec4 texColor = texture(baseColorSampler, flippedUV);
-        if (texColor.a < 0.1) discard; // early discard for alpha cutout
-        vec4 bc = texColor;
+    bool hasBaseColor = SPEC_HAS_BASE_COLOR >= 0 ? SPEC_HAS_BASE_COLOR == 1 : material.hasFlags.x == 1;
+    bool hasMetallicRoughness = SPEC_HAS_METALLIC_ROUGHNESS >= 0 ? SPEC_HAS_METALLIC_ROUGHNESS == 1 : material.hasFlags.y == 1;
+    bool hasEmissive = SPEC_HAS_EMISSIVE >= 0 ? SPEC_HAS_EMISSIVE == 1 : material.hasFlags.z == 1;
+
+    if (hasBaseColor) {
+        // glTF OPAQUE ignores alpha; only MASK may discard (must match depth_mask.frag)
+        vec4 bc = texture(baseColorSampler, flippedUV);
         albedo = bc.rgb * material.baseColorFactor.rgb;
         alpha = bc.a * material.baseColorFactor.a;
     } else {
@@ -99,7 +209,7 @@ void main() {
         alpha = material.baseColorFactor.a;
     }
 
-    if (material.hasFlags.y == 1) {
+    if (hasMetallicRoughness) {
         vec4 metallicRoughness = texture(metallicRoughnessSampler, flippedUV);
         metallic = metallicRoughness.b * material.mr_ac_am.x;
         roughness = metallicRoughness.g * material.mr_ac_am.y;
@@ -108,7 +218,7 @@ void main() {
         roughness = material.mr_ac_am.y;
     }
 
-    int alphaMode = int(material.mr_ac_am.w);
+    int alphaMode = SPEC_ALPHA_MODE >= 0 ? SPEC_ALPHA_MODE : int(material.mr_ac_am.w);
     float alphaCutoff = material.mr_ac_am.z;
     if (alphaMode == 1 && alpha < alphaCutoff) discard;
 
@@ -118,63 +228,43 @@ void main() {
     vec3 F0 = vec3(0.04);
     F0 = mix(F0, albedo, metallic);
 
-    vec3 color = vec3(0.0);
     vec3 ambient = vec3(0.03) * albedo;
 
-    // Directional light only for now
-    vec3 L = normalize(-ubo.dirLight.direction.xyz);
-    vec3 H = normalize(V + L);
-    float NdotL = max(dot(N, L), 0.0);
-    vec3 radiance = ubo.dirLight.color.rgb;
+    int mode = SPEC_SHADING_MODEL >= 0 ? SPEC_SHADING_MODEL
+             : (ubo.stylizedMode >= 0 ? ubo.stylizedMode : material.hasFlags.w);
 
-    int mode = ubo.stylizedMode >= 0 ? ubo.stylizedMode : material.hasFlags.w;
-    if (mode == 1) {
-        // Light wrap to avoid harsh terminator
-        float wrapNdotL = clamp((NdotL + ubo.toonWrap) / (1.0 + ubo.toonWrap), 0.0, 1.0);
+    vec3 sunRadiance = ubo.dirLight.color.rgb * directionalShadow(fragWorldPos);
+    vec3 color = ambient + shadeLight(mode, N, V, normalize(-ubo.dirLight.direction.xyz), sunRadiance, albedo, metallic, roughness, F0);
 
-        // Soft quantization using smoothstep between bands
-        float steps = max(1.0, ubo.toonSteps);
-        float t = wrapNdotL * steps;
-        float base = floor(t) / steps;
-        float frac = t - floor(t);
-        float softness = clamp(ubo.toonShadowSoftness, 0.0, 1.0);
-        float q = mix(base, base + 1.0 / steps, smoothstep(0.5 - softness, 0.5 + softness, frac));
-        vec3 diffuse = albedo * q;
-
-        // Specular band with thresholding and control by roughness
-        float hdotn = max(dot(H, N), 0.0);
-        float specPow = mix(8.0, 128.0, 1.0 - clamp(roughness, 0.0, 1.0));
-        float specVal = pow(hdotn, specPow);
-        float specBand = smoothstep(0.6, 0.8, specVal) * ubo.toonSpecularStrength;
+    // Point lights: only the ones assigned to this fragment's cluster
+    uint cluster = clusterIndex(fragWorldPos);
+    uint lightCount = clusterCounts[cluster];
+    for (uint i = 0; i < lightCount; ++i) {
+        Light light = lights[clusterIndices[cluster * CLUSTER_MAX_LIGHTS + i]];
+        vec3 toLight = light.positionRadius.xyz - fragWorldPos;
+        float dist2 = dot(toLight, toLight);
+        float radius2 = light.positionRadius.w * light.positionRadius.w;
+        if (dist2 >= radius2)
+            continue;
+        // Inverse square with a window so the light reaches exactly zero at its radius
+        float window = clamp(1.0 - (dist2 * dist2) / (radius2 * radius2), 0.0, 1.0);
+        float attenuation = window * window / (dist2 + 1.0);
+        color += shadeLight(mode, N, V, toLight * inversesqrt(dist2), light.color.rgb * attenuation, albedo, metallic, roughness, F0);
+    }
 
+    if (mode == 1) {
         // Rim lighting using 1 - N·V
         float rim = 1.0 - max(dot(N, V), 0.0);
         float rimMask = pow(clamp(rim, 0.0, 1.0), max(0.1, ubo.rimWidth));
-        vec3 rimColor = albedo * rimMask * ubo.rimStrength;
-
-        color = ambient + (diffuse + specBand) * radiance + rimColor;
-    } else {
-        // PBR
-        float NDF = distributionGGX(N, H, roughness);
-        float G = geometrySmith(N, V, L, roughness);
-        vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
-        vec3 kS = F;
-        vec3 kD = vec3(1.0) - kS;
-        kD *= 1.0 - metallic;
-        vec3 numerator = NDF * G * F;
-        float denominator = 4.0 * max(dot(N, V), 0.0) * NdotL + 0.0001;
-        vec3 spec = numerator / denominator;
-        vec3 Lo = (kD * albedo / PI + spec) * radiance * NdotL;
-        color = ambient + Lo;
+        color += albedo * rimMask * ubo.rimStrength;
     }
 
-    if (material.hasFlags.z == 1) {
+    if (hasEmissive) {
         color += texture(emissiveSampler, flippedUV).rgb * material.emissiveFactor.rgb;
     } else {
         color += material.emissiveFactor.rgb;
     }
 
-    // Apply gamma correction for display
-    vec3 gammaColor = pow(clamp(color, 0.0, 1.0), vec3(1.0/2.2));
-    outColor = vec4(gammaColor, alpha);
+    // Linear HDR; exposure, tonemapping and the sRGB encode happen in tonemap.frag
+    outColor = vec4(color, alpha);
 }
@@ -10,10 +10,8 @@ layout(location = 1) out vec3 fragNormal;
 layout(location = 2) out vec2 fragTexCoord;
 layout(location = 3) out vec4 fragColor; // ✅ MUST MATCH!
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
+// Depth prepass (depth_only.vert) relies on identical positions for EQUAL testing
+invariant gl_Position;
 
 struct DirectionalLight {
     vec4 direction;
@@ -26,7 +24,8 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     vec3 cameraPos;
     uint numLights;
-    PointLight lights[8];
+    vec4 clusterDepth;
+    vec4 clusterScreen;
     DirectionalLight dirLight;
 } ubo;
 
@@ -0,0 +1,148 @@
+#include "arena.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ArenaBlock
+{
+	ArenaBlock* next;
+	size_t size; // usable bytes after the header
+	size_t used;
+	_Alignas(ARENA_ALIGNMENT) unsigned char data[];
+};
+
+static size_t alignUp(size_t size)
+{
+	return (size + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static ArenaBlock* newBlock(Arena* arena, size_t size)
+{
+	ArenaBlock* block = malloc(sizeof(ArenaBlock) + size);
+	if (!block)
+	{
+		fprintf(stderr, "Arena: out of memory allocating a %zu byte block\n", size);
+		abort();
+	}
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	arena->stats.blocks++;
+	return block;
+}
+
+void arenaInit(Arena* arena, size_t blockSize)
+{
+	memset(arena, 0, sizeof(*arena));
+	arena->blockSize = blockSize;
+}
+
+void arenaFree(Arena* arena)
+{
+	for (ArenaBlock* block = arena->head; block;)
+	{
+		ArenaBlock* next = block->next;
+		free(block);
+		block = next;
+	}
+	arena->head = NULL;
+	arena->stats.bytes = 0;
+}
+
+void arenaReset(Arena* arena)
+{
+	if (arena->head && arena->head->next)
+	{
+		size_t capacity = arenaCapacity(arena);
+		arenaFree(arena);
+		arena->head = newBlock(arena, capacity);
+	}
+	else if (arena->head)
+		arena->head->used = 0;
+	arena->stats.bytes = 0;
+}
+
+void* arenaAlloc(Arena* arena, size_t size)
+{
+	size = alignUp(size);
+	arena->stats.allocations++;
+	arena->stats.bytes += size;
+	if (arena->stats.bytes > arena->stats.peakBytes)
+		arena->stats.peakBytes = arena->stats.bytes;
+
+	ArenaBlock* head = arena->head;
+	if (head && size <= head->size - head->used)
+	{
+		void* result = head->data + head->used;
+		head->used += size;
+		return result;
+	}
+
+	size_t blockSize = arena->blockSize ? alignUp(arena->blockSize) : ARENA_DEFAULT_BLOCK_SIZE;
+	if (size > blockSize)
+	{
+		// Oversized requests get an exact block behind the head, which keeps serving small ones
+		ArenaBlock* block = newBlock(arena, size);
+		block->used = size;
+		if (head)
+		{
+			block->next = head->next;
+			head->next = block;
+		}
+		else
+			arena->head = block;
+		return block->data;
+	}
+
+	ArenaBlock* block = newBlock(arena, blockSize);
+	block->next = head;
+	block->used = size;
+	arena->head = block;
+	return block->data;
+}
+
+void* arenaCalloc(Arena* arena, size_t count, size_t size)
+{
+	if (size != 0 && count > SIZE_MAX / size)
+	{
+		fprintf(stderr, "Arena: %zu x %zu bytes overflows\n", count, size);
+		abort();
+	}
+	void* result = arenaAlloc(arena, count * size);
+	memset(result, 0, count * size);
+	return result;
+}
+
+char* arenaStrdup(Arena* arena, const char* string)
+{
+	size_t length = strlen(string) + 1;
+	char* copy = arenaAlloc(arena, length);
+	memcpy(copy, string, length);
+	return copy;
+}
+
+char* arenaPrintf(Arena* arena, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+	if (length < 0)
+		return arenaStrdup(arena, "");
+
+	char* result = arenaAlloc(arena, (size_t)length + 1);
+	va_start(args, format);
+	vsnprintf(result, (size_t)length + 1, format, args);
+	va_end(args);
+	return result;
+}
+
+size_t arenaCapacity(const Arena* arena)
+{
+	size_t capacity = 0;
+	for (const ArenaBlock* block = arena->head; block; block = block->next)
+		capacity += block->size;
+	return capacity;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// Linear (bump) allocator.
+// Allocations are carved from a chain of blocks and never freed one by one: everything goes
+// at once with arenaReset, which folds the chain into one block for the next round, or with
+// arenaFree.
+// Meant for memory with one owner and one lifetime, like a model import or a frame's
+// scratch. Not thread safe; each thread or job uses its own arena.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_ALIGNMENT 16             // every allocation, enough for any scalar or SIMD vector
+#define ARENA_DEFAULT_BLOCK_SIZE (64u << 10)
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct ArenaStats
+{
+	uint64_t allocations; // since the arena was created; resets don't clear it
+	uint64_t blocks;      // malloc calls behind those allocations
+	uint64_t bytes;       // handed out since the last reset
+	uint64_t peakBytes;   // most handed out between two resets
+} ArenaStats;
+
+// Zero-initialized is a valid empty arena with the default block size
+typedef struct Arena
+{
+	ArenaBlock* head; // the block allocations come from; older ones chain behind it
+	size_t blockSize; // 0 uses ARENA_DEFAULT_BLOCK_SIZE; larger requests get a block of their own
+	ArenaStats stats;
+} Arena;
+
+void arenaInit(Arena* arena, size_t blockSize);
+// Returns everything to the system
+void arenaFree(Arena* arena);
+// Forgets every allocation but keeps the memory, merged into one block, so a workload that
+// repeats stops calling malloc
+void arenaReset(Arena* arena);
+
+// Never NULL; running out of memory aborts. ARENA_ALIGNMENT aligned, zero sizes included.
+void* arenaAlloc(Arena* arena, size_t size);
+void* arenaCalloc(Arena* arena, size_t count, size_t size);
+char* arenaStrdup(Arena* arena, const char* string);
+// snprintf into the arena
+char* arenaPrintf(Arena* arena, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+// Bytes the arena holds from the system, used or not
+size_t arenaCapacity(const Arena* arena);
@@ -0,0 +1,300 @@
+#include "main.h"
+
+// Asset requests are decoded by one job each on the job system. Everything touching Vulkan
+// happens in assetsUpdate on the main thread, after the frame's fence wait: models attach the
+// scene, textures replace a material's placeholders, the cubemap replaces the flat sky.
+
+void assetsInit(Application* app)
+{
+	memset(&app->assets, 0, sizeof(app->assets));
+	app->assets.startMs = benchmarkNowMs();
+}
+
+static void decodeAssetJob(void* data, uint32_t begin, uint32_t end)
+{
+	(void)begin;
+	(void)end;
+	AssetRequest* request = data;
+	bool ok = false;
+	switch (request->kind)
+	{
+	case ASSET_MODEL:
+		ok = loadGltfModel(request->paths[0], &request->mesh, request->jobs, request->io);
+		break;
+	case ASSET_TEXTURE:
+		ok = decodeTextureImage(request->io, request->paths[0], &request->images[0]);
+		break;
+	case ASSET_CUBEMAP:
+		ok = decodeSkyboxFaces(request->io, request->paths, request->images);
+		break;
+	}
+	request->readyMs = benchmarkNowMs();
+	// Last write to the request; the main thread may take it over as soon as it sees this
+	atomic_store_explicit(&request->state, ok ? ASSET_READY : ASSET_FAILED, memory_order_release);
+}
+
+static AssetHandle submitRequest(Application* app, AssetRequest* request)
+{
+	AssetLoader* loader = &app->assets;
+	request->jobs = app->jobs;
+	request->io = app->io;
+	request->submitMs = benchmarkNowMs();
+	atomic_init(&request->state, ASSET_PENDING);
+	arrput(loader->requests, request);
+	loader->pending++;
+	jobsRun(app->jobs, decodeAssetJob, request, 1, &loader->inFlight);
+	return (AssetHandle)arrlen(loader->requests);
+}
+
+AssetHandle assetsLoadModel(Application* app, const char* path)
+{
+	AssetRequest* request = calloc(1, sizeof(AssetRequest));
+	request->kind = ASSET_MODEL;
+	request->paths[0] = path;
+	return submitRequest(app, request);
+}
+
+AssetHandle assetsLoadTexture(Application* app, const char* path, u32 material, MaterialTextureSlot slot)
+{
+	assert(material < app->assets.materialCount && "assetsPrepareMaterials must run first");
+	AssetRequest* request = calloc(1, sizeof(AssetRequest));
+	request->kind = ASSET_TEXTURE;
+	request->paths[0] = path;
+	request->material = material;
+	request->slot = slot;
+	app->assets.materialPending[material]++;
+	return submitRequest(app, request);
+}
+
+AssetHandle assetsLoadCubemap(Application* app, const char* const faces[6])
+{
+	AssetRequest* request = calloc(1, sizeof(AssetRequest));
+	request->kind = ASSET_CUBEMAP;
+	for (int i = 0; i < 6; ++i)
+		request->paths[i] = faces[i];
+	return submitRequest(app, request);
+}
+
+AssetState assetsState(const Application* app, AssetHandle handle)
+{
+	if (handle == 0 || handle > (AssetHandle)arrlen(app->assets.requests))
+		return ASSET_FAILED;
+	return atomic_load_explicit(&app->assets.requests[handle - 1]->state, memory_order_acquire);
+}
+
+void assetsPrepareMaterials(Application* app, u32 materialCount)
+{
+	AssetLoader* loader = &app->assets;
+	loader->materialCount = materialCount;
+	loader->stagedTextures = calloc(materialCount * MATERIAL_TEXTURE_SLOT_COUNT, sizeof(Texture));
+	loader->materialPending = calloc(materialCount, sizeof(u32));
+}
+
+static void destroyTexture(Application* app, Texture* texture)
+{
+	vkDestroySampler(app->device, texture->sampler, NULL);
+	vkDestroyImageView(app->device, texture->view, NULL);
+	vkDestroyImage(app->device, texture->image, NULL);
+	vkFreeMemory(app->device, texture->memory, NULL);
+	memset(texture, 0, sizeof(*texture));
+}
+
+// Swaps every texture of the material that has arrived in for its placeholder. The material's
+// current set may be bound by a frame in flight, so the new textures go into a fresh set.
+static void bindMaterialTextures(Application* app, u32 material)
+{
+	AssetLoader* loader = &app->assets;
+	MaterialHandle handle = app->mesh.materials[material].handle;
+	bool changed = false;
+	for (u32 slot = 0; slot < MATERIAL_TEXTURE_SLOT_COUNT; ++slot)
+	{
+		Texture* staged = &loader->stagedTextures[material * MATERIAL_TEXTURE_SLOT_COUNT + slot];
+		if (staged->image == VK_NULL_HANDLE)
+			continue; // no texture, or it failed to load
+		ImageHandle oldImage;
+		SamplerHandle oldSampler;
+		resourcesSetMaterialTexture(app, handle, (MaterialTextureSlot)slot, staged, &oldImage, &oldSampler);
+		deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_REGISTRY_IMAGE, .registryImage = oldImage});
+		deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_REGISTRY_SAMPLER, .registrySampler = oldSampler});
+		changed = true;
+	}
+	if (!changed)
+		return;
+
+	MaterialPool* materials = &app->resources.materials;
+	u32 index = resourcesMaterialIndex(app, handle);
+	VkDescriptorSet set = allocateDescriptorSet(app->device, app->descriptorPool, &app->descriptorSetLayout);
+	writeMaterialDescriptorSet(app, set, handle);
+	deferFreeDescriptorSet(app, app->descriptorPool, materials->descriptorSets[index]);
+	materials->descriptorSets[index] = set;
+	if (material == 0)
+		app->descriptorSet = set;
+}
+
+static void commitTexture(Application* app, AssetRequest* request, bool ok)
+{
+	static const VkFormat slotFormats[MATERIAL_TEXTURE_SLOT_COUNT] = {
+	    VK_FORMAT_R8G8B8A8_SRGB,
+	    VK_FORMAT_R8G8B8A8_UNORM,
+	    VK_FORMAT_R8G8B8A8_SRGB,
+	};
+	AssetLoader* loader = &app->assets;
+	u32 material = request->material;
+	if (ok)
+	{
+		Texture* staged = &loader->stagedTextures[material * MATERIAL_TEXTURE_SLOT_COUNT + request->slot];
+		u32 mipLevels;
+		uploadTextureImage(app, &request->images[0], staged, &mipLevels, slotFormats[request->slot]);
+		createTextureSampler(app, staged, mipLevels);
+	}
+	// A material switches over once, when the last of its textures is in
+	if (--loader->materialPending[material] == 0)
+		bindMaterialTextures(app, material);
+}
+
+static void freeDecodedImages(AssetRequest* request)
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		stbi_image_free(request->images[i].pixels);
+		request->images[i].pixels = NULL;
+	}
+}
+
+// Every texture request has been decoded, so nothing reads the material paths any more
+static void releaseMaterialPaths(Application* app)
+{
+	for (u32 i = 0; i < app->mesh.material_count; ++i)
+	{
+		app->mesh.materials[i].baseColorTexturePath = NULL;
+		app->mesh.materials[i].metallicRoughnessTexturePath = NULL;
+		app->mesh.materials[i].emissiveTexturePath = NULL;
+	}
+	app->mesh.texture_path = NULL;
+	arenaFree(&app->mesh.strings);
+}
+
+static void commitRequest(Application* app, AssetRequest* request, bool ok)
+{
+	AssetLoader* loader = &app->assets;
+	switch (request->kind)
+	{
+	case ASSET_MODEL:
+		if (ok)
+		{
+			attachScene(app, &request->mesh);
+			loader->sceneMs = benchmarkNowMs() - loader->startMs;
+			printf("Assets: scene ready after %.1f ms (decode %.1f ms)\n", loader->sceneMs, request->readyMs - request->submitMs);
+		}
+		else
+			fprintf(stderr, "Assets: %s failed to load, the scene stays empty\n", request->paths[0]);
+		break;
+	case ASSET_TEXTURE:
+		commitTexture(app, request, ok);
+		break;
+	case ASSET_CUBEMAP:
+		if (ok)
+			setSkyboxCubemap(app, request->images);
+		break;
+	}
+	freeDecodedImages(request);
+	if (ok)
+		atomic_store_explicit(&request->state, ASSET_COMMITTED, memory_order_relaxed);
+	else
+		loader->failed++;
+	request->handled = true;
+	loader->pending--;
+	if (loader->pending == 0)
+	{
+		loader->allMs = benchmarkNowMs() - loader->startMs;
+		printf("Assets: %u loaded after %.1f ms, %u failed, peak RSS %.1f MiB\n", (u32)arrlen(loader->requests), loader->allMs,
+		    loader->failed, (double)benchmarkPeakRssKb() / 1024.0);
+		fileioPrintStats(app->io, "File I/O");
+		releaseMaterialPaths(app);
+	}
+}
+
+// Commits whatever has finished decoding. Texture uploads stop once budgetMs is spent so a
+// burst of arrivals is spread over several frames; the model always goes through.
+static void commitReady(Application* app, double budgetMs)
+{
+	AssetLoader* loader = &app->assets;
+	double start = benchmarkNowMs();
+	// Committing the model queues texture requests, so the length is re-read every iteration
+	for (u32 i = loader->firstUnhandled; i < (u32)arrlen(loader->requests); ++i)
+	{
+		AssetRequest* request = loader->requests[i];
+		if (request->handled)
+		{
+			if (i == loader->firstUnhandled)
+				loader->firstUnhandled++;
+			continue;
+		}
+		AssetState state = atomic_load_explicit(&request->state, memory_order_acquire);
+		if (state == ASSET_PENDING)
+			continue;
+		if (request->kind == ASSET_TEXTURE && benchmarkNowMs() - start > budgetMs)
+			break;
+		commitRequest(app, request, state == ASSET_READY);
+		if (i == loader->firstUnhandled)
+			loader->firstUnhandled++;
+	}
+}
+
+void assetsUpdate(Application* app)
+{
+	AssetLoader* loader = &app->assets;
+
+	if (loader->pending == 0)
+		return;
+	// With a single worker nothing runs in the background, so the frame loop takes a job each frame
+	if (jobsWorkerCount(app->jobs) == 1)
+		jobsRunOne(app->jobs);
+	commitReady(app, ASSET_COMMIT_BUDGET_MS);
+}
+
+bool assetsWaitAll(Application* app)
+{
+	AssetLoader* loader = &app->assets;
+	while (loader->pending > 0)
+	{
+		jobsWait(app->jobs, &loader->inFlight);
+		commitReady(app, INFINITY);
+	}
+	return loader->failed == 0;
+}
+
+static void freeMeshData(Mesh* mesh)
+{
+	gltfSourceFree(mesh->source);
+	free(mesh->primitives);
+	free(mesh->materials);
+	arenaFree(&mesh->strings);
+	memset(mesh, 0, sizeof(*mesh));
+}
+
+// Runs before the scene's resources are destroyed: texture jobs still read material paths
+void assetsDestroy(Application* app)
+{
+	AssetLoader* loader = &app->assets;
+	if (app->jobs)
+		jobsWait(app->jobs, &loader->inFlight);
+
+	for (u32 i = 0; i < loader->materialCount * MATERIAL_TEXTURE_SLOT_COUNT; ++i)
+	{
+		if (loader->stagedTextures[i].image != VK_NULL_HANDLE)
+			destroyTexture(app, &loader->stagedTextures[i]);
+	}
+	free(loader->stagedTextures);
+	free(loader->materialPending);
+
+	for (u32 i = 0; i < (u32)arrlen(loader->requests); ++i)
+	{
+		AssetRequest* request = loader->requests[i];
+		freeDecodedImages(request);
+		freeMeshData(&request->mesh); // empty unless the scene was never attached
+		free(request);
+	}
+	arrfree(loader->requests);
+	memset(loader, 0, sizeof(*loader));
+}
@@ -0,0 +1,664 @@
+#define _POSIX_C_SOURCE 200809L
+#include "benchmark.h"
+#include "fileio.h"
+#include "jobs.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static void printUsage(const char* program)
+{
+	fprintf(stderr,
+	    "usage: %s [--headless] [--frames N] [--warmup N] [--size WxH] [--out PATH] [--bench-jobs] [--bench-io] [--no-uring]\n"
+	    "          [--pak PATH] [--no-pak] [--no-specialize] [--ab-specialize] [--check-particles N]\n"
+	    "  --headless  render offscreen along a fixed camera path and write a JSON report\n"
+	    "  --frames    measured frames (default %u)\n"
+	    "  --warmup    frames rendered before measuring (default %u)\n"
+	    "  --size      offscreen target size (default %ux%u)\n"
+	    "  --out       report path (default %s)\n"
+	    "  --bench-jobs  measure job system overhead and scaling, then exit\n"
+	    "  --bench-io    compare stdio, pread, io_uring and archive reads of everything under %s, then exit\n"
+	    "  --no-uring    read files with pread on the job system even where io_uring works\n"
+	    "  --pak         asset archive to read from (default %s)\n"
+	    "  --no-pak      read loose files even when the archive exists\n"
+	    "  --no-specialize  render with generic material pipelines instead of specialized variants\n"
+	    "  --ab-specialize  with --headless, render the frames specialized, then generic, and report the difference\n"
+	    "  --check-particles  with --headless, read back N GPU particle steps and compare them with the CPU reference first\n",
+	    program, BENCHMARK_DEFAULT_FRAMES, BENCHMARK_DEFAULT_WARMUP, BENCHMARK_DEFAULT_WIDTH,
+	    BENCHMARK_DEFAULT_HEIGHT, BENCHMARK_DEFAULT_OUTPUT, BENCHMARK_IO_DIRECTORY, PAK_DEFAULT_PATH);
+}
+
+static bool parseCount(const char* text, uint32_t* value)
+{
+	char* end;
+	unsigned long parsed = strtoul(text, &end, 10);
+	if (end == text || *end != '\0' || parsed > UINT32_MAX)
+		return false;
+	*value = (uint32_t)parsed;
+	return true;
+}
+
+bool benchmarkParseArgs(int argc, char** argv, BenchmarkConfig* config)
+{
+	*config = (BenchmarkConfig){
+	    .frames = BENCHMARK_DEFAULT_FRAMES,
+	    .warmupFrames = BENCHMARK_DEFAULT_WARMUP,
+	    .width = BENCHMARK_DEFAULT_WIDTH,
+	    .height = BENCHMARK_DEFAULT_HEIGHT,
+	    .outputPath = BENCHMARK_DEFAULT_OUTPUT,
+	    .pakPath = PAK_DEFAULT_PATH,
+	};
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+		bool ok = true;
+		if (strcmp(arg, "--headless") == 0)
+		{
+			config->headless = true;
+			continue;
+		}
+		else if (strcmp(arg, "--bench-jobs") == 0)
+		{
+			config->jobs = true;
+			continue;
+		}
+		else if (strcmp(arg, "--bench-io") == 0)
+		{
+			config->io = true;
+			continue;
+		}
+		else if (strcmp(arg, "--no-uring") == 0)
+		{
+			config->noUring = true;
+			continue;
+		}
+		else if (strcmp(arg, "--no-pak") == 0)
+		{
+			config->noPak = true;
+			continue;
+		}
+		else if (strcmp(arg, "--no-specialize") == 0)
+		{
+			config->noSpecialize = true;
+			continue;
+		}
+		else if (strcmp(arg, "--ab-specialize") == 0)
+		{
+			config->abSpecialize = true;
+			continue;
+		}
+		else if (strcmp(arg, "--frames") == 0)
+			ok = value && parseCount(value, &config->frames) && config->frames > 0;
+		else if (strcmp(arg, "--check-particles") == 0)
+			ok = value && parseCount(value, &config->checkParticles) && config->checkParticles > 0;
+		else if (strcmp(arg, "--warmup") == 0)
+			ok = value && parseCount(value, &config->warmupFrames);
+		else if (strcmp(arg, "--size") == 0)
+			ok = value && sscanf(value, "%ux%u", &config->width, &config->height) == 2 && config->width > 0 && config->height > 0;
+		else if (strcmp(arg, "--out") == 0)
+		{
+			ok = value != NULL;
+			config->outputPath = value;
+		}
+		else if (strcmp(arg, "--pak") == 0)
+		{
+			ok = value != NULL;
+			config->pakPath = value;
+		}
+		else
+			ok = false;
+
+		if (!ok)
+		{
+			fprintf(stderr, "bad argument: %s%s%s\n", arg, value ? " " : "", value ? value : "");
+			printUsage(argv[0]);
+			return false;
+		}
+		++i; // consumed the value
+	}
+	return true;
+}
+
+void benchmarkCameraPath(const float sceneMin[3], const float sceneMax[3], uint32_t frame, uint32_t frameCount,
+    float position[3], float target[3])
+{
+	float center[3], extent[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		center[c] = (sceneMin[c] + sceneMax[c]) * 0.5f;
+		extent[c] = sceneMax[c] - sceneMin[c];
+	}
+
+	// One loop over the whole run; the radius breathes so the camera also passes near the middle
+	const float twoPi = 6.28318531f;
+	float t = frameCount > 1 ? (float)frame / (float)frameCount : 0.0f;
+	float angle = t * twoPi;
+	float radius = 0.35f * (0.7f + 0.3f * cosf(2.0f * angle));
+	position[0] = center[0] + cosf(angle) * extent[0] * radius;
+	position[1] = sceneMin[1] + extent[1] * (0.2f + 0.1f * sinf(angle));
+	position[2] = center[2] + sinf(angle) * extent[2] * radius;
+
+	// Look at a point further along the loop, pulled toward the center
+	float ahead = angle + 0.6f;
+	target[0] = center[0] + cosf(ahead) * extent[0] * 0.2f;
+	target[1] = sceneMin[1] + extent[1] * 0.15f;
+	target[2] = center[2] + sinf(ahead) * extent[2] * 0.2f;
+}
+
+static int compareDouble(const void* a, const void* b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double* sorted, uint32_t count, double p)
+{
+	uint32_t rank = (uint32_t)ceil(p * count);
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void benchmarkSummarize(const double* values, uint32_t count, BenchmarkSummary* summary)
+{
+	memset(summary, 0, sizeof(*summary));
+	if (count == 0)
+		return;
+
+	double* sorted = malloc(count * sizeof(double));
+	memcpy(sorted, values, count * sizeof(double));
+	qsort(sorted, count, sizeof(double), compareDouble);
+
+	double sum = 0.0;
+	for (uint32_t i = 0; i < count; ++i)
+		sum += sorted[i];
+	summary->mean = sum / count;
+	summary->min = sorted[0];
+	summary->p50 = percentile(sorted, count, 0.50);
+	summary->p95 = percentile(sorted, count, 0.95);
+	summary->p99 = percentile(sorted, count, 0.99);
+	summary->max = sorted[count - 1];
+	free(sorted);
+}
+
+static void writeString(FILE* file, const char* text)
+{
+	fputc('"', file);
+	for (const char* c = text ? text : ""; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+			fprintf(file, "\\%c", *c);
+		else if ((unsigned char)*c < 0x20)
+			fprintf(file, "\\u%04x", (unsigned char)*c);
+		else
+			fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+static void writeSummary(FILE* file, const BenchmarkSummary* s)
+{
+	fprintf(file, "{\"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+	    s->mean, s->min, s->p50, s->p95, s->p99, s->max);
+}
+
+// Per-frame counter values, in the order of BenchmarkCounters
+#define BENCHMARK_COUNTER_COUNT (sizeof(BenchmarkCounters) / sizeof(uint32_t))
+static const char* const counterNames[BENCHMARK_COUNTER_COUNT] = {
+    "draws", "dispatches", "pipeline_binds", "descriptor_set_binds", "buffer_binds", "push_constants", "barriers", "render_passes", "triangles"};
+
+// Mean of a GPU scope over the frames it ran in, or of the CPU frame time for scope == UINT32_MAX
+static double frameMean(const BenchmarkFrame* frames, uint32_t count, uint32_t scope, uint32_t* samples)
+{
+	double sum = 0.0;
+	*samples = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (scope == UINT32_MAX)
+			sum += frames[i].cpuMs;
+		else if (frames[i].gpuMask & (1u << scope))
+			sum += frames[i].gpuMs[scope];
+		else
+			continue;
+		(*samples)++;
+	}
+	return *samples ? sum / *samples : 0.0;
+}
+
+static void writeAbEntry(FILE* file, double specialized, double generic)
+{
+	double delta = specialized - generic;
+	fprintf(file, "{\"specialized\": %.4f, \"generic\": %.4f, \"delta\": %.4f, \"delta_pct\": %.2f}", specialized,
+	    generic, delta, generic > 0.0 ? delta * 100.0 / generic : 0.0);
+}
+
+static void writePipelines(FILE* file, const BenchmarkPipelines* p)
+{
+	fprintf(file, "{\"variants\": %u, \"new\": %u, \"cache_hits\": %u, \"build_ms\": %.3f}", p->variants, p->built,
+	    p->cacheHits, p->buildMs);
+}
+
+// Means of both runs per scope; delta is specialized minus generic, so negative is a win. The
+// mesh pipelines each run switched to sit next to them, since fewer variants is the trade-off.
+static void writeSpecializeAb(FILE* file, const BenchmarkReport* report)
+{
+	uint32_t count = report->frameCount, samples, genericSamples;
+	fprintf(file, "  \"specialize_ab\": {\n    \"mesh_pipelines\": {\"specialized\": ");
+	writePipelines(file, &report->pipelines);
+	fprintf(file, ", \"generic\": ");
+	writePipelines(file, &report->genericPipelines);
+	fprintf(file, "},\n    \"cpu_frame_ms\": ");
+	writeAbEntry(file, frameMean(report->frames, count, UINT32_MAX, &samples),
+	    frameMean(report->genericFrames, count, UINT32_MAX, &genericSamples));
+	fprintf(file, ",\n    \"gpu_ms\": {");
+	bool first = true;
+	for (uint32_t scope = 0; scope < report->gpuScopeCount; ++scope)
+	{
+		double specialized = frameMean(report->frames, count, scope, &samples);
+		double generic = frameMean(report->genericFrames, count, scope, &genericSamples);
+		if (samples == 0 || genericSamples == 0)
+			continue;
+		fprintf(file, "%s\n      ", first ? "" : ",");
+		writeString(file, report->gpuScopeNames[scope]);
+		fprintf(file, ": ");
+		writeAbEntry(file, specialized, generic);
+		first = false;
+	}
+	fprintf(file, "%s}\n  },\n", first ? "" : "\n    ");
+}
+
+bool benchmarkWriteJson(const char* path, const BenchmarkReport* report)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	uint32_t count = report->frameCount;
+	double* values = malloc((count > 0 ? count : 1) * sizeof(double));
+	BenchmarkSummary summary;
+
+	fprintf(file, "{\n  \"device\": {\"name\": ");
+	writeString(file, report->deviceName);
+	fprintf(file, ", \"type\": ");
+	writeString(file, report->deviceType);
+	fprintf(file, ", \"driver\": ");
+	writeString(file, report->driverVersion);
+	fprintf(file, "},\n");
+	fprintf(file, "  \"width\": %u,\n  \"height\": %u,\n", report->width, report->height);
+	fprintf(file, "  \"frames\": %u,\n  \"warmup_frames\": %u,\n  \"frame_dt\": %.9g,\n", count, report->warmupFrames, BENCHMARK_FRAME_DT);
+	fprintf(file, "  \"specialize_materials\": %s,\n", report->specialized ? "true" : "false");
+	fprintf(file, "  \"pipelines\": {\"create_ms\": %.3f, \"cache_warm\": %s, \"mesh\": ", report->pipelineCreateMs,
+	    report->pipelineCacheWarm ? "true" : "false");
+	writePipelines(file, &report->pipelines);
+	fprintf(file, "},\n");
+
+	for (uint32_t i = 0; i < count; ++i)
+		values[i] = report->frames[i].cpuMs;
+	benchmarkSummarize(values, count, &summary);
+	fprintf(file, "  \"cpu_frame_ms\": ");
+	writeSummary(file, &summary);
+	fprintf(file, ",\n");
+
+	// Only scopes that ran in at least one frame; cached shadow cascades skip most frames
+	fprintf(file, "  \"gpu_ms\": {");
+	bool first = true;
+	for (uint32_t scope = 0; scope < report->gpuScopeCount; ++scope)
+	{
+		uint32_t samples = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (report->frames[i].gpuMask & (1u << scope))
+				values[samples++] = report->frames[i].gpuMs[scope];
+		}
+		if (samples == 0)
+			continue;
+		benchmarkSummarize(values, samples, &summary);
+		fprintf(file, "%s\n    ", first ? "" : ",");
+		writeString(file, report->gpuScopeNames[scope]);
+		fprintf(file, ": {\"frames\": %u, \"ms\": ", samples);
+		writeSummary(file, &summary);
+		fprintf(file, "}");
+		first = false;
+	}
+	fprintf(file, "%s},\n", first ? "" : "\n  ");
+
+	fprintf(file, "  \"counts_per_frame\": {");
+	for (uint32_t c = 0; c < BENCHMARK_COUNTER_COUNT; ++c)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			values[i] = ((const uint32_t*)&report->frames[i].counters)[c];
+		benchmarkSummarize(values, count, &summary);
+		fprintf(file, "%s\n    \"%s\": {\"mean\": %.2f, \"min\": %.0f, \"max\": %.0f}", c ? "," : "",
+		    counterNames[c], summary.mean, summary.min, summary.max);
+	}
+	fprintf(file, "\n  },\n");
+
+	for (uint32_t i = 0; i < count; ++i)
+		values[i] = report->frames[i].counterUs;
+	benchmarkSummarize(values, count, &summary);
+	fprintf(file, "  \"counter_overhead_us\": {\"budget\": %.1f, \"us\": ", BENCHMARK_COUNTER_BUDGET_US);
+	writeSummary(file, &summary);
+	fprintf(file, "},\n");
+
+	if (report->genericFrames)
+		writeSpecializeAb(file, report);
+
+	fprintf(file, "  \"memory\": {\"device_bytes\": %llu, \"device_peak_bytes\": %llu, \"device_allocations\": %u, \"host_peak_rss_kb\": %llu},\n",
+	    (unsigned long long)report->deviceMemoryBytes, (unsigned long long)report->deviceMemoryPeakBytes,
+	    report->deviceAllocations, (unsigned long long)report->hostPeakRssKb);
+
+	// Raw samples for plotting: cpu ms, then one value per GPU scope (null when it didn't run), then draws
+	fprintf(file, "  \"sample_columns\": [\"cpu_ms\"");
+	for (uint32_t scope = 0; scope < report->gpuScopeCount; ++scope)
+		fprintf(file, ", \"gpu_%s_ms\"", report->gpuScopeNames[scope]);
+	fprintf(file, ", \"draws\"],\n");
+	fprintf(file, "  \"samples\": [");
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const BenchmarkFrame* frame = &report->frames[i];
+		fprintf(file, "%s\n    [%.4f", i ? "," : "", frame->cpuMs);
+		for (uint32_t scope = 0; scope < report->gpuScopeCount; ++scope)
+		{
+			if (frame->gpuMask & (1u << scope))
+				fprintf(file, ", %.4f", frame->gpuMs[scope]);
+			else
+				fprintf(file, ", null");
+		}
+		fprintf(file, ", %u]", frame->counters.draws);
+	}
+	fprintf(file, "\n  ]\n}\n");
+
+	free(values);
+	bool ok = !ferror(file);
+	return fclose(file) == 0 && ok;
+}
+
+static void emptyJob(void* data, uint32_t begin, uint32_t end)
+{
+	(void)data;
+	(void)begin;
+	(void)end;
+}
+
+// A few hundred dependent multiply-adds per element: compute bound, no shared cache lines
+static void spinRange(void* data, uint32_t begin, uint32_t end)
+{
+	double* out = data;
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		double x = (double)i;
+		for (int k = 0; k < 256; ++k)
+			x = x * 0.999999 + 1.0;
+		out[i] = x;
+	}
+}
+
+void benchmarkJobs(void)
+{
+	const uint32_t batchSize = 1024, batchCount = 256;
+	const uint32_t elements = 1u << 20, grain = 1024;
+	double* out = malloc(elements * sizeof(double));
+
+	JobSystem* probe = jobsCreate(0);
+	uint32_t maxWorkers = jobsWorkerCount(probe);
+	jobsDestroy(probe);
+
+	printf("Job system: %u hardware threads\n", maxWorkers);
+	printf("workers  ns/job (batches of %u)  parallel for ms  speedup  stolen\n", batchSize);
+	double baseMs = 0.0;
+	for (uint32_t workers = 1;; workers = workers * 2 < maxWorkers ? workers * 2 : maxWorkers)
+	{
+		JobSystem* js = jobsCreate(workers);
+
+		// Scheduling cost: submit and wait on batches of empty jobs
+		double start = benchmarkNowMs();
+		for (uint32_t b = 0; b < batchCount; ++b)
+		{
+			JobCounter counter = {0};
+			jobsRun(js, emptyJob, NULL, batchSize, &counter);
+			jobsWait(js, &counter);
+		}
+		double perJobNs = (benchmarkNowMs() - start) * 1e6 / ((double)batchCount * batchSize);
+
+		// Scaling: best of a few runs of a compute-bound parallel for
+		double bestMs = 0.0;
+		for (int run = 0; run < 5; ++run)
+		{
+			start = benchmarkNowMs();
+			jobsParallelFor(js, elements, grain, spinRange, out);
+			double ms = benchmarkNowMs() - start;
+			bestMs = run == 0 || ms < bestMs ? ms : bestMs;
+		}
+		if (workers == 1)
+			baseMs = bestMs;
+
+		JobStats stats = jobsStats(js);
+		printf("%7u  %22.1f  %15.2f  %6.2fx  %6llu\n", workers, perJobNs, bestMs, baseMs / bestMs,
+		    (unsigned long long)stats.stolen);
+		jobsDestroy(js);
+		if (workers == maxWorkers)
+			break;
+	}
+	free(out);
+}
+
+// Appends every regular file under directory, recursively, as malloc'd paths
+static void collectFiles(const char* directory, char*** paths, uint32_t* count, uint32_t* capacity)
+{
+	DIR* dir = opendir(directory);
+	if (!dir)
+		return;
+	struct dirent* entry;
+	while ((entry = readdir(dir)))
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+		size_t length = strlen(directory) + strlen(entry->d_name) + 2;
+		char* path = malloc(length);
+		snprintf(path, length, "%s/%s", directory, entry->d_name);
+		struct stat st;
+		if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+		{
+			collectFiles(path, paths, count, capacity);
+			free(path);
+		}
+		else if (S_ISREG(st.st_mode))
+		{
+			if (*count == *capacity)
+			{
+				*capacity = *capacity ? *capacity * 2 : 64;
+				*paths = realloc(*paths, *capacity * sizeof(char*));
+			}
+			(*paths)[(*count)++] = path;
+		}
+		else
+			free(path);
+	}
+	closedir(dir);
+}
+
+// The loaders' old path: one blocking file after another. Every buffer is kept until the end,
+// as the batched reads have to, so both pay the same page faults.
+static uint64_t readFilesStdio(char** paths, uint32_t count)
+{
+	uint64_t bytes = 0;
+	void** buffers = calloc(count, sizeof(void*));
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		FILE* file = fopen(paths[i], "rb");
+		if (!file)
+			continue;
+		fseek(file, 0, SEEK_END);
+		long length = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		buffers[i] = length > 0 ? malloc((size_t)length) : NULL;
+		if (buffers[i])
+			bytes += fread(buffers[i], 1, (size_t)length, file);
+		fclose(file);
+	}
+	for (uint32_t i = 0; i < count; ++i)
+		free(buffers[i]);
+	free(buffers);
+	return bytes;
+}
+
+static uint64_t readFilesBatched(FileIO* io, char** paths, uint32_t count)
+{
+	FileRead* reads = calloc(count, sizeof(FileRead));
+	for (uint32_t i = 0; i < count; ++i)
+		reads[i].path = paths[i];
+	fileioReadBatch(io, reads, count);
+	uint64_t bytes = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		bytes += reads[i].bytesRead;
+		free(reads[i].dst);
+	}
+	free(reads);
+	return bytes;
+}
+
+// Drops the file's clean pages from the page cache, so the next read goes to the device the
+// way it does on a cold start. Needs no privileges, unlike drop_caches.
+static void evictFile(const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+enum
+{
+	FILE_METHOD_STDIO,
+	FILE_METHOD_PREAD,
+	FILE_METHOD_URING,
+	FILE_METHOD_ARCHIVE,
+	FILE_METHOD_COUNT,
+};
+
+typedef struct FileBenchmark
+{
+	char** paths;
+	uint32_t count;
+	const char* pakPath;
+	FileIO* fallback;
+	FileIO* uring;
+	FileIO* archive; // the archive is mounted for each run, so opening it is timed too
+} FileBenchmark;
+
+static double runFileMethod(const FileBenchmark* bench, int method, bool cold, uint64_t* bytes)
+{
+	if (cold)
+	{
+		for (uint32_t i = 0; i < bench->count; ++i)
+			evictFile(bench->paths[i]);
+		evictFile(bench->pakPath);
+	}
+	double start = benchmarkNowMs();
+	if (method == FILE_METHOD_STDIO)
+		*bytes = readFilesStdio(bench->paths, bench->count);
+	else if (method == FILE_METHOD_ARCHIVE)
+	{
+		Pak* pak = pakOpen(bench->pakPath);
+		fileioMount(bench->archive, pak);
+		*bytes = readFilesBatched(bench->archive, bench->paths, bench->count);
+		fileioMount(bench->archive, NULL);
+		pakClose(pak);
+	}
+	else
+		*bytes = readFilesBatched(method == FILE_METHOD_PREAD ? bench->fallback : bench->uring, bench->paths, bench->count);
+	return benchmarkNowMs() - start;
+}
+
+void benchmarkFileIO(const char* directory, const char* pakPath)
+{
+	FileBenchmark bench = {.pakPath = pakPath};
+	uint32_t capacity = 0;
+	collectFiles(directory, &bench.paths, &bench.count, &capacity);
+	if (bench.count == 0)
+	{
+		fprintf(stderr, "File I/O: no files under %s\n", directory);
+		return;
+	}
+
+	JobSystem* js = jobsCreate(0);
+	bench.fallback = fileioCreate(js, false);
+	bench.uring = fileioCreate(js, true);
+	bench.archive = fileioCreate(js, true);
+	Pak* probe = pakOpen(pakPath);
+	uint32_t archived = 0;
+	for (uint32_t i = 0; probe && i < bench.count; ++i)
+		archived += pakFind(probe, bench.paths[i]) != NULL;
+	pakClose(probe);
+
+	uint64_t total = readFilesStdio(bench.paths, bench.count);
+	printf("File I/O: %u files, %.1f MiB under %s, %u workers; %s holds %u of them\n", bench.count,
+	    (double)total / (1024.0 * 1024.0), directory, jobsWorkerCount(js), pakPath, archived);
+	printf("Cold runs evict the files from the page cache first; best of 3 cold, 5 warm\n");
+	printf("method                  cold ms  MiB/s   warm ms  MiB/s\n");
+
+	const char* names[FILE_METHOD_COUNT] = {"stdio, one at a time", "pread on jobs, batched", "io_uring, batched", "archive, mmap"};
+	for (int method = 0; method < FILE_METHOD_COUNT; ++method)
+	{
+		if (method == FILE_METHOD_URING && !fileioUsesUring(bench.uring))
+		{
+			printf("%-22s  unavailable\n", names[method]);
+			continue;
+		}
+		if (method == FILE_METHOD_ARCHIVE && archived == 0)
+		{
+			printf("%-22s  unavailable, build %s with the pack tool\n", names[method], pakPath);
+			continue;
+		}
+		double bestMs[2] = {0.0, 0.0};
+		uint64_t bytes = 0;
+		for (int warm = 0; warm < 2; ++warm)
+		{
+			for (int run = 0; run < (warm ? 5 : 3); ++run)
+			{
+				double ms = runFileMethod(&bench, method, !warm, &bytes);
+				bestMs[warm] = run == 0 || ms < bestMs[warm] ? ms : bestMs[warm];
+			}
+		}
+		double mib = (double)bytes / (1024.0 * 1024.0);
+		printf("%-22s  %7.2f  %5.0f  %8.2f  %5.0f\n", names[method], bestMs[0], mib * 1000.0 / bestMs[0], bestMs[1],
+		    mib * 1000.0 / bestMs[1]);
+	}
+	fileioPrintStats(bench.fallback, "pread");
+	fileioPrintStats(bench.uring, "io_uring");
+	fileioPrintStats(bench.archive, "archive");
+
+	fileioDestroy(bench.archive);
+	fileioDestroy(bench.uring);
+	fileioDestroy(bench.fallback);
+	jobsDestroy(js);
+	for (uint32_t i = 0; i < bench.count; ++i)
+		free(bench.paths[i]);
+	free(bench.paths);
+}
+
+double benchmarkNowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+uint64_t benchmarkPeakRssKb(void)
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return (uint64_t)usage.ru_maxrss; // kilobytes on Linux
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+// Headless benchmark mode (--headless).
+// Argument parsing, the scripted camera path and the JSON report. The same arguments always
+// produce the same camera and frame timestep, so runs on different machines or drivers
+// (lavapipe, SwiftShader) render the same frames. The Vulkan side, offscreen target and
+// command counters, lives in headless.c.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCHMARK_DEFAULT_FRAMES 600
+#define BENCHMARK_DEFAULT_WARMUP 30
+#define BENCHMARK_DEFAULT_WIDTH 1280
+#define BENCHMARK_DEFAULT_HEIGHT 720
+#define BENCHMARK_DEFAULT_OUTPUT "benchmark.json"
+#define BENCHMARK_FRAME_DT (1.0f / 60.0f) // simulation step per frame, independent of how fast frames render
+#define BENCHMARK_MAX_GPU_SCOPES 8
+#define BENCHMARK_IO_DIRECTORY "data" // read by --bench-io
+#define BENCHMARK_COUNTER_BUDGET_US 50.0 // per frame for the command counters (framestats.c)
+
+typedef struct BenchmarkConfig
+{
+	bool headless;
+	bool jobs;             // --bench-jobs: job system microbenchmark, no window or GPU
+	bool io;               // --bench-io: file read microbenchmark, no window or GPU
+	bool noUring;          // --no-uring: file reads always take the pread fallback
+	bool noPak;            // --no-pak: read loose files even when the archive exists
+	const char* pakPath;   // --pak: archive to mount, PAK_DEFAULT_PATH by default
+	bool noSpecialize;     // --no-specialize: one generic mesh pipeline per render state
+	bool abSpecialize;     // --ab-specialize: render the frames specialized, then again generic
+	uint32_t checkParticles; // --check-particles N: compare N GPU particle steps with the CPU reference
+	uint32_t frames;       // measured frames
+	uint32_t warmupFrames; // rendered first and left out of the statistics
+	uint32_t width, height;
+	const char* outputPath;
+} BenchmarkConfig;
+
+// Command buffer calls recorded in one frame
+typedef struct BenchmarkCounters
+{
+	uint32_t draws; // indirect draws count once
+	uint32_t dispatches;
+	uint32_t pipelineBinds;
+	uint32_t descriptorSetBinds;
+	uint32_t bufferBinds; // vertex and index
+	uint32_t pushConstants;
+	uint32_t barriers;
+	uint32_t renderPasses;
+	uint32_t triangles; // direct draws only; indirect counts never reach the CPU
+} BenchmarkCounters;
+
+typedef struct BenchmarkFrame
+{
+	double cpuMs; // wall time of the whole frame, fence wait included
+	double gpuMs[BENCHMARK_MAX_GPU_SCOPES];
+	uint32_t gpuMask; // scopes that ran this frame
+	BenchmarkCounters counters;
+	double counterUs; // what collecting the counters cost
+} BenchmarkFrame;
+
+// One createMeshPipelines call: variants in the permutation cache afterwards, how many of the
+// lookups compiled a new one and how many found one already there, and the compile time
+typedef struct BenchmarkPipelines
+{
+	uint32_t variants;
+	uint32_t built;
+	uint32_t cacheHits;
+	double buildMs;
+} BenchmarkPipelines;
+
+typedef struct BenchmarkSummary
+{
+	double mean, min, p50, p95, p99, max;
+} BenchmarkSummary;
+
+typedef struct BenchmarkReport
+{
+	const char* deviceName;
+	const char* deviceType;
+	const char* driverVersion;
+	uint32_t width, height;
+	uint32_t warmupFrames;
+	const BenchmarkFrame* frames; // measured frames only
+	uint32_t frameCount;
+	const char* const* gpuScopeNames;
+	uint32_t gpuScopeCount;
+	uint64_t deviceMemoryBytes; // live at the end of the run
+	uint64_t deviceMemoryPeakBytes;
+	uint32_t deviceAllocations;
+	uint64_t hostPeakRssKb;
+	bool specialized; // frames were rendered with specialized material pipelines
+	BenchmarkPipelines pipelines; // the mesh pipelines the frames were rendered with
+	double pipelineCreateMs;      // every vkCreate*Pipelines call of the run
+	bool pipelineCacheWarm;
+	// --ab-specialize: the same frameCount frames rendered with generic pipelines, else NULL
+	const BenchmarkFrame* genericFrames;
+	BenchmarkPipelines genericPipelines;
+} BenchmarkReport;
+
+// Fills config from argv; prints usage and returns false on bad arguments
+bool benchmarkParseArgs(int argc, char** argv, BenchmarkConfig* config);
+
+// Camera for frame out of frameCount: a loop through the scene bounds that looks a little
+// ahead along the path, so it sweeps both open and occluded views
+void benchmarkCameraPath(const float sceneMin[3], const float sceneMax[3], uint32_t frame, uint32_t frameCount,
+    float position[3], float target[3]);
+
+void benchmarkSummarize(const double* values, uint32_t count, BenchmarkSummary* summary);
+// Prints the job system's cost per job and parallel for scaling from 1 worker up to one per
+// hardware thread
+void benchmarkJobs(void);
+// Reads every file under directory with stdio one at a time, in one batch through the pread
+// fallback and through io_uring, and out of the archive at pakPath when it holds them. Prints
+// wall time and throughput for each, cold (evicted from the page cache) and warm.
+void benchmarkFileIO(const char* directory, const char* pakPath);
+bool benchmarkWriteJson(const char* path, const BenchmarkReport* report);
+
+double benchmarkNowMs(void);
+uint64_t benchmarkPeakRssKb(void);
@@ -0,0 +1,419 @@
+#include "main.h"
+
+// Bloom on the HDR scene target, then tonemapping into the swapchain.
+// bloom_downsample.comp builds the whole mip chain (half res down to 1/128) in a single
+// dispatch, bloom_upsample.comp then walks back up adding a tent-filtered copy of the
+// smaller mip into each level, and tonemap.frag composites mip 0 over the scene.
+// The HDR target and the chain are frame graph transients; their views change with the
+// graph, so descriptors are rewritten by createBloomDescriptors after every rebuild.
+
+typedef struct BloomDownsampleParams
+{
+	vec4 threshold; // x: threshold, y: soft knee, zw: 1 / mip 0 size
+	vec2 uvScale;   // rendered part of the HDR target
+	i32 mip0Size[2];
+	u32 mipCount;
+} BloomDownsampleParams;
+
+typedef struct BloomUpsampleParams
+{
+	vec2 texelSize;
+	float sourceMip;
+	float radius;
+} BloomUpsampleParams;
+
+typedef struct TonemapParams
+{
+	float exposure;
+	float bloomIntensity;
+	vec2 uvScale; // rendered part of the HDR target
+	vec2 uvMax;   // last texel center inside it
+	float sharpness;
+} TonemapParams;
+
+static u32 bloomMipWidth(Application* app, u32 mip)
+{
+	u32 width = app->width / 2 >> mip;
+	return width > 0 ? width : 1;
+}
+
+static u32 bloomMipHeight(Application* app, u32 mip)
+{
+	u32 height = app->height / 2 >> mip;
+	return height > 0 ? height : 1;
+}
+
+static void createBloomComputePipeline(Application* app, ComputePipeline* compute, const char* shaderPath,
+    const VkDescriptorSetLayoutBinding* bindings, u32 bindingCount, u32 pushConstantSize)
+{
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = bindingCount,
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(app->device, &layoutInfo, NULL, &compute->descLayout));
+
+	VkPushConstantRange pushRange = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = pushConstantSize};
+	VkPipelineLayoutCreateInfo plLayoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+	    .setLayoutCount = 1,
+	    .pSetLayouts = &compute->descLayout,
+	    .pushConstantRangeCount = 1,
+	    .pPushConstantRanges = &pushRange,
+	};
+	VK_CHECK(vkCreatePipelineLayout(app->device, &plLayoutInfo, NULL, &compute->layout));
+
+	compute->shaderModule = LoadShaderModule(app->io, shaderPath, app->device);
+	VkComputePipelineCreateInfo cpInfo = {
+	    .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+	    .stage = {
+	        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+	        .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+	        .module = compute->shaderModule,
+	        .pName = "main",
+	    },
+	    .layout = compute->layout,
+	    .basePipelineIndex = -1,
+	};
+	compute->pipeline = buildComputePipeline(app, &cpInfo);
+}
+
+void createBloomSystem(Application* app)
+{
+	app->bloomEnabled = true;
+	app->bloomThreshold = 1.0f;
+	app->bloomKnee = 0.5f;
+	app->bloomIntensity = 0.04f;
+	app->exposure = 1.0f;
+
+	VkSamplerCreateInfo samplerInfo = {
+	    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+	    .magFilter = VK_FILTER_LINEAR,
+	    .minFilter = VK_FILTER_LINEAR,
+	    .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+	    .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	    .maxLod = (float)BLOOM_MIP_COUNT,
+	};
+	VK_CHECK(vkCreateSampler(app->device, &samplerInfo, NULL, &app->bloomSampler));
+
+	createBloomPipelines(app);
+}
+
+// Declares the HDR target and the bloom chain in the frame graph being built
+void createBloomRenderTargets(Application* app)
+{
+	RenderGraph* graph = &app->frameGraph;
+
+	RgImageDesc hdrDesc = {
+	    .width = app->width,
+	    .height = app->height,
+	    .mipLevels = 1,
+	    .arrayLayers = 1,
+	    .format = HDR_COLOR_FORMAT,
+	    .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	};
+	app->rgHdrColor = rgCreateImage(graph, "hdr_color", &hdrDesc);
+
+	// Stop once the short side reaches one texel
+	u32 shortSide = bloomMipWidth(app, 0) < bloomMipHeight(app, 0) ? bloomMipWidth(app, 0) : bloomMipHeight(app, 0);
+	app->bloomMipCount = 1;
+	while (app->bloomMipCount < BLOOM_MIP_COUNT && (shortSide >> app->bloomMipCount) > 0)
+		app->bloomMipCount++;
+
+	RgImageDesc bloomDesc = {
+	    .width = bloomMipWidth(app, 0),
+	    .height = bloomMipHeight(app, 0),
+	    .mipLevels = app->bloomMipCount,
+	    .arrayLayers = 1,
+	    .format = BLOOM_FORMAT,
+	    .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	};
+	app->rgBloom = rgCreateImage(graph, "bloom", &bloomDesc);
+}
+
+void createBloomPipelines(Application* app)
+{
+	VkDescriptorSetLayoutBinding downsampleBindings[] = {
+	    {.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+	    {.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = BLOOM_MIP_COUNT, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+	};
+	createBloomComputePipeline(app, &app->bloomDownsample, "compiledshaders/bloom_downsample.comp.spv",
+	    downsampleBindings, ARRAYSIZE(downsampleBindings), sizeof(BloomDownsampleParams));
+
+	VkDescriptorSetLayoutBinding upsampleBindings[] = {
+	    {.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+	    {.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+	};
+	createBloomComputePipeline(app, &app->bloomUpsample, "compiledshaders/bloom_upsample.comp.spv",
+	    upsampleBindings, ARRAYSIZE(upsampleBindings), sizeof(BloomUpsampleParams));
+
+	VkDescriptorSetLayoutBinding tonemapBindings[] = {
+	    {.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT},
+	    {.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT},
+	};
+	VkDescriptorSetLayoutCreateInfo tonemapLayoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(tonemapBindings),
+	    .pBindings = tonemapBindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(app->device, &tonemapLayoutInfo, NULL, &app->tonemapDescriptorSetLayout));
+
+	VkPushConstantRange pushRange = {.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT, .offset = 0, .size = sizeof(TonemapParams)};
+	VkPipelineLayoutCreateInfo tonemapPipelineLayoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+	    .setLayoutCount = 1,
+	    .pSetLayouts = &app->tonemapDescriptorSetLayout,
+	    .pushConstantRangeCount = 1,
+	    .pPushConstantRanges = &pushRange,
+	};
+	VK_CHECK(vkCreatePipelineLayout(app->device, &tonemapPipelineLayoutInfo, NULL, &app->tonemapPipelineLayout));
+
+	VkShaderModule vertShader = LoadShaderModule(app->io, "compiledshaders/tonemap.vert.spv", app->device);
+	VkShaderModule fragShader = LoadShaderModule(app->io, "compiledshaders/tonemap.frag.spv", app->device);
+	app->tonemapPipeline = createTonemapPipeline(app, vertShader, fragShader);
+	vkDestroyShaderModule(app->device, vertShader, NULL);
+	vkDestroyShaderModule(app->device, fragShader, NULL);
+
+	// The sets follow the frame graph, and the ones a rebuild replaces stay alive until the frames
+	// using them are done, so the pool holds several generations
+	VkDescriptorPoolSize poolSizes[] = {
+	    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, BLOOM_SET_GENERATIONS * (1 + (BLOOM_MIP_COUNT - 1) + 2)},
+	    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, BLOOM_SET_GENERATIONS * (BLOOM_MIP_COUNT + (BLOOM_MIP_COUNT - 1))},
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+	    .maxSets = BLOOM_SET_GENERATIONS * (1 + (BLOOM_MIP_COUNT - 1) + 1),
+	    .poolSizeCount = ARRAYSIZE(poolSizes),
+	    .pPoolSizes = poolSizes,
+	};
+	VK_CHECK(vkCreateDescriptorPool(app->device, &poolInfo, NULL, &app->bloomDescriptorPool));
+}
+
+static VkResult allocateBloomSets(Application* app, VkDescriptorSet* downsample, VkDescriptorSet* tonemap, VkDescriptorSet* upsample)
+{
+	VkDescriptorSetAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+	    .descriptorPool = app->bloomDescriptorPool,
+	    .descriptorSetCount = 1,
+	    .pSetLayouts = &app->bloomDownsample.descLayout,
+	};
+	VkResult result = vkAllocateDescriptorSets(app->device, &allocInfo, downsample);
+	if (result != VK_SUCCESS)
+		return result;
+	allocInfo.pSetLayouts = &app->tonemapDescriptorSetLayout;
+	result = vkAllocateDescriptorSets(app->device, &allocInfo, tonemap);
+	if (result != VK_SUCCESS)
+	{
+		vkFreeDescriptorSets(app->device, app->bloomDescriptorPool, 1, downsample);
+		return result;
+	}
+
+	VkDescriptorSetLayout upsampleLayouts[BLOOM_MIP_COUNT - 1];
+	for (u32 i = 0; i < BLOOM_MIP_COUNT - 1; ++i)
+		upsampleLayouts[i] = app->bloomUpsample.descLayout;
+	allocInfo.descriptorSetCount = BLOOM_MIP_COUNT - 1;
+	allocInfo.pSetLayouts = upsampleLayouts;
+	result = vkAllocateDescriptorSets(app->device, &allocInfo, upsample);
+	if (result != VK_SUCCESS)
+	{
+		vkFreeDescriptorSets(app->device, app->bloomDescriptorPool, 1, downsample);
+		vkFreeDescriptorSets(app->device, app->bloomDescriptorPool, 1, tonemap);
+	}
+	return result;
+}
+
+// Fresh sets for a rebuilt graph; the current ones may be bound by frames in flight
+static void replaceBloomSets(Application* app)
+{
+	VkDescriptorSet downsample, tonemap, upsample[BLOOM_MIP_COUNT - 1];
+	VkResult result = allocateBloomSets(app, &downsample, &tonemap, upsample);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		// Only when rebuilds outpace frames (e.g. a resize that keeps failing to acquire): every
+		// older generation is still queued, and draining is the only way to get them back
+		VK_CHECK(vkDeviceWaitIdle(app->device));
+		deletionQueueDestroyAll(app, false);
+		result = allocateBloomSets(app, &downsample, &tonemap, upsample);
+	}
+	VK_CHECK(result);
+
+	deferFreeDescriptorSet(app, app->bloomDescriptorPool, app->bloomDownsampleSet);
+	deferFreeDescriptorSet(app, app->bloomDescriptorPool, app->tonemapDescriptorSet);
+	for (u32 i = 0; i < BLOOM_MIP_COUNT - 1; ++i)
+	{
+		deferFreeDescriptorSet(app, app->bloomDescriptorPool, app->bloomUpsampleSets[i]);
+		app->bloomUpsampleSets[i] = upsample[i];
+	}
+	app->bloomDownsampleSet = downsample;
+	app->tonemapDescriptorSet = tonemap;
+}
+
+// Call after the frame graph is compiled
+void createBloomDescriptors(Application* app)
+{
+	RenderGraph* graph = &app->frameGraph;
+	destroyBloomViews(app);
+	replaceBloomSets(app);
+
+	VkImage bloomImage = (VkImage)rgGetHandle(graph, app->rgBloom);
+	for (u32 i = 0; i < app->bloomMipCount; ++i)
+	{
+		VkImageViewCreateInfo viewInfo = {
+		    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		    .image = bloomImage,
+		    .viewType = VK_IMAGE_VIEW_TYPE_2D,
+		    .format = BLOOM_FORMAT,
+		    .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1},
+		};
+		VK_CHECK(vkCreateImageView(app->device, &viewInfo, NULL, &app->bloomMipViews[i]));
+	}
+
+	VkImageView hdrView = (VkImageView)rgGetView(graph, app->rgHdrColor);
+	VkImageView chainView = (VkImageView)rgGetView(graph, app->rgBloom);
+
+	VkDescriptorImageInfo hdrInfo = {app->bloomSampler, hdrView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+	VkDescriptorImageInfo chainGeneralInfo = {app->bloomSampler, chainView, VK_IMAGE_LAYOUT_GENERAL};
+	VkDescriptorImageInfo chainReadInfo = {app->bloomSampler, chainView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+	// Slots past bloomMipCount must still be valid; the shader never writes them
+	VkDescriptorImageInfo mipInfos[BLOOM_MIP_COUNT];
+	for (u32 i = 0; i < BLOOM_MIP_COUNT; ++i)
+		mipInfos[i] = (VkDescriptorImageInfo){VK_NULL_HANDLE, app->bloomMipViews[i < app->bloomMipCount ? i : app->bloomMipCount - 1], VK_IMAGE_LAYOUT_GENERAL};
+
+	VkWriteDescriptorSet writes[4 + 2 * (BLOOM_MIP_COUNT - 1)] = {
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->bloomDownsampleSet, .dstBinding = 0, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &hdrInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->bloomDownsampleSet, .dstBinding = 1, .descriptorCount = BLOOM_MIP_COUNT, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = mipInfos},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->tonemapDescriptorSet, .dstBinding = 0, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &hdrInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->tonemapDescriptorSet, .dstBinding = 1, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &chainReadInfo},
+	};
+	u32 writeCount = 4;
+	for (u32 i = 0; i + 1 < app->bloomMipCount; ++i)
+	{
+		writes[writeCount++] = (VkWriteDescriptorSet){.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->bloomUpsampleSets[i], .dstBinding = 0, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &chainGeneralInfo};
+		writes[writeCount++] = (VkWriteDescriptorSet){.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->bloomUpsampleSets[i], .dstBinding = 1, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &mipInfos[i]};
+	}
+	vkUpdateDescriptorSets(app->device, writeCount, writes, 0, NULL);
+}
+
+// Graph barriers cover entry and exit; the barriers between chain steps are recorded here
+void renderBloomPass(Application* app, VkCommandBuffer cmd)
+{
+	if (!app->bloomEnabled)
+		return;
+
+	gpuTimerBegin(app, cmd, GPU_TIMER_BLOOM);
+
+	u32 width = bloomMipWidth(app, 0);
+	u32 height = bloomMipHeight(app, 0);
+	BloomDownsampleParams downParams = {
+	    .threshold = {app->bloomThreshold, app->bloomKnee, 1.0f / width, 1.0f / height},
+	    .uvScale = {app->renderWidth / (float)app->width, app->renderHeight / (float)app->height},
+	    .mip0Size = {(i32)width, (i32)height},
+	    .mipCount = app->bloomMipCount,
+	};
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, app->bloomDownsample.pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, app->bloomDownsample.layout, 0, 1, &app->bloomDownsampleSet, 0, NULL);
+	vkCmdPushConstants(cmd, app->bloomDownsample.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(downParams), &downParams);
+	vkCmdDispatch(cmd, (width + BLOOM_TILE_SIZE - 1) / BLOOM_TILE_SIZE, (height + BLOOM_TILE_SIZE - 1) / BLOOM_TILE_SIZE, 1);
+
+	VkMemoryBarrier2 chainBarrier = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	};
+	VkDependencyInfo dependencyInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+	    .memoryBarrierCount = 1,
+	    .pMemoryBarriers = &chainBarrier,
+	};
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, app->bloomUpsample.pipeline);
+	for (u32 mip = app->bloomMipCount - 1; mip-- > 0;)
+	{
+		vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+		BloomUpsampleParams upParams = {
+		    .texelSize = {1.0f / bloomMipWidth(app, mip + 1), 1.0f / bloomMipHeight(app, mip + 1)},
+		    .sourceMip = (float)(mip + 1),
+		    .radius = 1.0f,
+		};
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, app->bloomUpsample.layout, 0, 1, &app->bloomUpsampleSets[mip], 0, NULL);
+		vkCmdPushConstants(cmd, app->bloomUpsample.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(upParams), &upParams);
+		vkCmdDispatch(cmd, (bloomMipWidth(app, mip) + 7) / 8, (bloomMipHeight(app, mip) + 7) / 8, 1);
+	}
+
+	gpuTimerEnd(app, cmd, GPU_TIMER_BLOOM);
+}
+
+// Records the fullscreen draw; the caller owns the rendering scope
+void renderTonemapPass(Application* app, VkCommandBuffer cmd)
+{
+	// Sharpening only makes up for upscaling; at native resolution it stays off
+	TonemapParams params = {
+	    .exposure = app->exposure,
+	    .bloomIntensity = app->bloomEnabled ? app->bloomIntensity : 0.0f,
+	    .uvScale = {app->renderWidth / (float)app->width, app->renderHeight / (float)app->height},
+	    .uvMax = {(app->renderWidth - 0.5f) / app->width, (app->renderHeight - 0.5f) / app->height},
+	    .sharpness = app->renderWidth < (u32)app->width ? app->drsSharpness : 0.0f,
+	};
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, app->tonemapPipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, app->tonemapPipelineLayout, 0, 1, &app->tonemapDescriptorSet, 0, NULL);
+	vkCmdPushConstants(cmd, app->tonemapPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(params), &params);
+	vkCmdDraw(cmd, 3, 1, 0, 0);
+}
+
+// Accumulates the last resolved bloom time under the current framebuffer size
+void recordBloomTiming(Application* app)
+{
+	if (!(app->gpuTimer.resolvedMask & (1u << GPU_TIMER_BLOOM)))
+		return;
+
+	BloomTiming* timing = NULL;
+	for (u32 i = 0; i < app->bloomTimingCount; ++i)
+	{
+		if (app->bloomTimings[i].width == app->width && app->bloomTimings[i].height == app->height)
+			timing = &app->bloomTimings[i];
+	}
+	if (!timing)
+	{
+		// Full: the newest size takes over the last slot
+		if (app->bloomTimingCount < BLOOM_MAX_TIMINGS)
+			app->bloomTimingCount++;
+		timing = &app->bloomTimings[app->bloomTimingCount - 1];
+		*timing = (BloomTiming){.width = app->width, .height = app->height};
+	}
+	timing->totalUs += app->gpuTimer.ms[GPU_TIMER_BLOOM] * 1000.0;
+	timing->samples++;
+}
+
+void destroyBloomViews(Application* app)
+{
+	for (u32 i = 0; i < BLOOM_MIP_COUNT; ++i)
+	{
+		deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_IMAGE_VIEW, .view = app->bloomMipViews[i]});
+		app->bloomMipViews[i] = VK_NULL_HANDLE;
+	}
+}
+
+void cleanupBloomSystem(Application* app)
+{
+	for (u32 i = 0; i < app->bloomTimingCount; ++i)
+	{
+		BloomTiming* timing = &app->bloomTimings[i];
+		printf("Bloom %ux%u: %.1f us avg over %u frames\n", timing->width, timing->height,
+		    timing->totalUs / timing->samples, timing->samples);
+	}
+
+	destroyBloomViews(app);
+	vkDestroyDescriptorPool(app->device, app->bloomDescriptorPool, NULL);
+	cleanupComputePipeline(app, &app->bloomDownsample);
+	cleanupComputePipeline(app, &app->bloomUpsample);
+	vkDestroyPipeline(app->device, app->tonemapPipeline, NULL);
+	vkDestroyPipelineLayout(app->device, app->tonemapPipelineLayout, NULL);
+	vkDestroyDescriptorSetLayout(app->device, app->tonemapDescriptorSetLayout, NULL);
+	vkDestroySampler(app->device, app->bloomSampler, NULL);
+}
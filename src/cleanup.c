@@ -18,83 +18,24 @@ void cleanupResources(Application* app)
 	destroyBuffer(app->device, &app->uniformBuffer);
 	destroyBuffer(app->device, &app->indexBuffer);
 	destroyBuffer(app->device, &app->vertexBuffer);
+	destroyBuffer(app->device, &app->positionBuffer);
 	destroyBuffer(app->device, &app->baseColorBuffer);
 	destroyBuffer(app->device, &app->hasTextureBuffer);
 	destroyBuffer(app->device, &app->alphaCutoffBuffer);
 	destroyBuffer(app->device, &app->skyboxUniformBuffer);
-	destroyBuffer(app->device, &app->particleBuffer);
-	destroyBuffer(app->device, &app->computeUniformBuffer);
 
-	// Per-material uniform buffers
-	if (app->materialUniformBuffers)
-	{
-		for (u32 i = 0; i < app->mesh.material_count; ++i)
-		{
-			destroyBuffer(app->device, &app->materialUniformBuffers[i]);
-		}
-		free(app->materialUniformBuffers);
-		app->materialUniformBuffers = NULL;
-	}
-
-	// Clean up multiple textures
-	if (app->baseColorTextures)
-	{
-		for (u32 i = 0; i < app->texture_count; i++)
-		{
-			vkDestroySampler(app->device, app->baseColorTextures[i].sampler, NULL);
-			vkDestroyImageView(app->device, app->baseColorTextures[i].view, NULL);
-			vkDestroyImage(app->device, app->baseColorTextures[i].image, NULL);
-			vkFreeMemory(app->device, app->baseColorTextures[i].memory, NULL);
-		}
-		free(app->baseColorTextures);
-	}
-	if (app->metallicRoughnessTextures)
-	{
-		for (u32 i = 0; i < app->texture_count; i++)
-		{
-			vkDestroySampler(app->device, app->metallicRoughnessTextures[i].sampler, NULL);
-			vkDestroyImageView(app->device, app->metallicRoughnessTextures[i].view, NULL);
-			vkDestroyImage(app->device, app->metallicRoughnessTextures[i].image, NULL);
-			vkFreeMemory(app->device, app->metallicRoughnessTextures[i].memory, NULL);
-		}
-		free(app->metallicRoughnessTextures);
-	}
-	if (app->emissiveTextures)
-	{
-		for (u32 i = 0; i < app->texture_count; i++)
-		{
-			vkDestroySampler(app->device, app->emissiveTextures[i].sampler, NULL);
-			vkDestroyImageView(app->device, app->emissiveTextures[i].view, NULL);
-			vkDestroyImage(app->device, app->emissiveTextures[i].image, NULL);
-			vkFreeMemory(app->device, app->emissiveTextures[i].memory, NULL);
-		}
-		free(app->emissiveTextures);
-	}
+	// Per-material textures, samplers and uniform buffers, and the mesh pipelines
+	resourcesDestroy(app);
 
 	vkDestroyDescriptorPool(app->device, app->descriptorPool, NULL);
 
-	// Clean up descriptor sets array
-	if (app->descriptorSets)
-	{
-		free(app->descriptorSets);
-	}
-
 	// Clean up mesh data
-	free(app->mesh.vertices);
-	free(app->mesh.indices);
+	gltfSourceFree(app->mesh.source); // only still here if the scene never finished attaching
 
 	// Free material strings and array
-	if (app->mesh.materials)
-	{
-		for (u32 i = 0; i < app->mesh.material_count; ++i)
-		{
-			free(app->mesh.materials[i].baseColorTexturePath);
-			free(app->mesh.materials[i].metallicRoughnessTexturePath);
-			free(app->mesh.materials[i].emissiveTexturePath);
-		}
-		free(app->mesh.materials);
-		app->mesh.materials = NULL;
-	}
+	arenaFree(&app->mesh.strings);
+	free(app->mesh.materials);
+	app->mesh.materials = NULL;
 
 	// Clean up primitives
 	free(app->mesh.primitives);
@@ -102,14 +43,12 @@ void cleanupResources(Application* app)
 
 void cleanupPipeline(Application* app)
 {
-	for (u32 i = 0; i < app->mesh.material_count; ++i)
-	{
-		vkDestroyPipeline(app->device, app->pipelines[i], NULL);
-	}
-	free(app->pipelines);
+	destroyMeshPipelines(app);
 	vkDestroyPipelineLayout(app->device, app->pipelineLayout, NULL);
 	vkDestroyShaderModule(app->device, app->fragShaderModule, NULL);
 	vkDestroyShaderModule(app->device, app->vertShaderModule, NULL);
+	vkDestroyShaderModule(app->device, app->depthOnlyVertShaderModule, NULL);
+	vkDestroyShaderModule(app->device, app->depthMaskFragShaderModule, NULL);
 	vkDestroyDescriptorSetLayout(app->device, app->descriptorSetLayout, NULL);
 }
 
@@ -0,0 +1,201 @@
+#define _POSIX_C_SOURCE 200809L
+#include "clusters.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CLUSTER_HAS_X86 1
+#endif
+
+static double clusterNowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+void clusterInit(ClusterGrid* grid)
+{
+	memset(grid, 0, sizeof(*grid));
+	// One block, rows of CLUSTER_GRID_X floats stay 16-byte aligned for the SSE loads
+	float* block = aligned_alloc(16, sizeof(float) * CLUSTER_COUNT * 6);
+	grid->minX = block + CLUSTER_COUNT * 0;
+	grid->minY = block + CLUSTER_COUNT * 1;
+	grid->minZ = block + CLUSTER_COUNT * 2;
+	grid->maxX = block + CLUSTER_COUNT * 3;
+	grid->maxY = block + CLUSTER_COUNT * 4;
+	grid->maxZ = block + CLUSTER_COUNT * 5;
+#ifdef CLUSTER_HAS_X86
+	grid->hasSse = true;
+#endif
+}
+
+void clusterDestroy(ClusterGrid* grid)
+{
+	free(grid->minX);
+	memset(grid, 0, sizeof(*grid));
+}
+
+ClusterParams clusterMakeParams(float zNear, float zFar, float fovY, float width, float height)
+{
+	float logRange = logf(zFar / zNear);
+	return (ClusterParams){
+	    .zNear = zNear,
+	    .zFar = zFar,
+	    .sliceScale = CLUSTER_GRID_Z / logRange,
+	    .sliceBias = CLUSTER_GRID_Z * logf(zNear) / logRange,
+	    .width = width,
+	    .height = height,
+	    .tanHalfFovY = tanf(fovY * 0.5f),
+	    .aspect = width / height,
+	};
+}
+
+static float sliceDepth(const ClusterParams* p, int slice)
+{
+	return p->zNear * powf(p->zFar / p->zNear, (float)slice / CLUSTER_GRID_Z);
+}
+
+static int depthSlice(const ClusterParams* p, float depth)
+{
+	int slice = (int)floorf(logf(depth) * p->sliceScale - p->sliceBias);
+	return slice < 0 ? 0 : (slice >= CLUSTER_GRID_Z ? CLUSTER_GRID_Z - 1 : slice);
+}
+
+void clusterUpdateBounds(ClusterGrid* grid, const ClusterParams* params)
+{
+	grid->params = *params;
+	float tanX = params->tanHalfFovY * params->aspect;
+	float tanY = params->tanHalfFovY;
+
+	for (int z = 0; z < CLUSTER_GRID_Z; ++z)
+	{
+		float dNear = sliceDepth(params, z);
+		float dFar = sliceDepth(params, z + 1);
+		for (int y = 0; y < CLUSTER_GRID_Y; ++y)
+		{
+			// Tile rows count down from the top of the screen, view space +Y is up
+			float top = 1.0f - 2.0f * y / CLUSTER_GRID_Y;
+			float bottom = 1.0f - 2.0f * (y + 1) / CLUSTER_GRID_Y;
+			for (int x = 0; x < CLUSTER_GRID_X; ++x)
+			{
+				float left = -1.0f + 2.0f * x / CLUSTER_GRID_X;
+				float right = -1.0f + 2.0f * (x + 1) / CLUSTER_GRID_X;
+				int c = (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x;
+				grid->minX[c] = fminf(left * tanX * dNear, left * tanX * dFar);
+				grid->maxX[c] = fmaxf(right * tanX * dNear, right * tanX * dFar);
+				grid->minY[c] = fminf(bottom * tanY * dNear, bottom * tanY * dFar);
+				grid->maxY[c] = fmaxf(top * tanY * dNear, top * tanY * dFar);
+				grid->minZ[c] = -dFar;
+				grid->maxZ[c] = -dNear;
+			}
+		}
+	}
+}
+
+// Sets bit x for every cluster in the row whose AABB the sphere touches
+static uint32_t testRowScalar(const ClusterGrid* grid, int row, const float center[3], float radius)
+{
+	uint32_t mask = 0;
+	int base = row * CLUSTER_GRID_X;
+	for (int x = 0; x < CLUSTER_GRID_X; ++x)
+	{
+		int c = base + x;
+		float dx = fmaxf(fmaxf(grid->minX[c] - center[0], center[0] - grid->maxX[c]), 0.0f);
+		float dy = fmaxf(fmaxf(grid->minY[c] - center[1], center[1] - grid->maxY[c]), 0.0f);
+		float dz = fmaxf(fmaxf(grid->minZ[c] - center[2], center[2] - grid->maxZ[c]), 0.0f);
+		if (dx * dx + dy * dy + dz * dz <= radius * radius)
+			mask |= 1u << x;
+	}
+	return mask;
+}
+
+#ifdef CLUSTER_HAS_X86
+static uint32_t testRowSse(const ClusterGrid* grid, int row, const float center[3], float radius)
+{
+	__m128 cx = _mm_set1_ps(center[0]);
+	__m128 cy = _mm_set1_ps(center[1]);
+	__m128 cz = _mm_set1_ps(center[2]);
+	__m128 r2 = _mm_set1_ps(radius * radius);
+	__m128 zero = _mm_setzero_ps();
+	uint32_t mask = 0;
+	int base = row * CLUSTER_GRID_X;
+	for (int x = 0; x < CLUSTER_GRID_X; x += 4)
+	{
+		int c = base + x;
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(grid->minX + c), cx), _mm_sub_ps(cx, _mm_load_ps(grid->maxX + c))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(grid->minY + c), cy), _mm_sub_ps(cy, _mm_load_ps(grid->maxY + c))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(grid->minZ + c), cz), _mm_sub_ps(cz, _mm_load_ps(grid->maxZ + c))), zero);
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		mask |= (uint32_t)_mm_movemask_ps(_mm_cmple_ps(d2, r2)) << x;
+	}
+	return mask;
+}
+#endif
+
+void clusterAssignLights(ClusterGrid* grid, const float view[16], const ClusterLight* lights, uint32_t lightCount,
+    uint32_t* counts, uint32_t* indices)
+{
+	double start = clusterNowMs();
+	const ClusterParams* p = &grid->params;
+	memset(counts, 0, sizeof(uint32_t) * CLUSTER_COUNT);
+
+	uint32_t (*testRow)(const ClusterGrid*, int, const float[3], float) = testRowScalar;
+#ifdef CLUSTER_HAS_X86
+	if (grid->hasSse && !grid->useReference)
+		testRow = testRowSse;
+#endif
+
+	for (uint32_t i = 0; i < lightCount; ++i)
+	{
+		const float* pos = lights[i].positionRadius;
+		float radius = pos[3];
+		float center[3];
+		for (int r = 0; r < 3; ++r)
+			center[r] = view[0 * 4 + r] * pos[0] + view[1 * 4 + r] * pos[1] + view[2 * 4 + r] * pos[2] + view[3 * 4 + r];
+
+		// The camera looks down -Z; only slices the sphere's depth range overlaps are tested
+		float depth = -center[2];
+		if (depth + radius < p->zNear || depth - radius > p->zFar)
+			continue;
+		int z0 = depthSlice(p, fmaxf(depth - radius, p->zNear));
+		int z1 = depthSlice(p, fminf(depth + radius, p->zFar));
+
+		for (int z = z0; z <= z1; ++z)
+		{
+			for (int y = 0; y < CLUSTER_GRID_Y; ++y)
+			{
+				int row = z * CLUSTER_GRID_Y + y;
+				uint32_t mask = testRow(grid, row, center, radius);
+				while (mask)
+				{
+					int x = __builtin_ctz(mask);
+					mask &= mask - 1;
+					uint32_t c = (uint32_t)(row * CLUSTER_GRID_X + x);
+					if (counts[c] < CLUSTER_MAX_LIGHTS)
+						indices[c * CLUSTER_MAX_LIGHTS + counts[c]] = i;
+					counts[c]++;
+				}
+			}
+		}
+	}
+
+	grid->stats.lights = lightCount;
+	grid->stats.maxPerCluster = 0;
+	grid->stats.overflowed = 0;
+	for (uint32_t c = 0; c < CLUSTER_COUNT; ++c)
+	{
+		if (counts[c] > grid->stats.maxPerCluster)
+			grid->stats.maxPerCluster = counts[c];
+		if (counts[c] > CLUSTER_MAX_LIGHTS)
+		{
+			counts[c] = CLUSTER_MAX_LIGHTS;
+			grid->stats.overflowed++;
+		}
+	}
+	grid->stats.assignMs = clusterNowMs() - start;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Clustered light assignment.
+// The view frustum is cut into CLUSTER_GRID_X x CLUSTER_GRID_Y screen tiles and
+// CLUSTER_GRID_Z exponential depth slices; every cluster gets the list of point lights
+// whose sphere touches its view-space AABB. light_cull.comp does this on the GPU; the
+// CPU path here mirrors it exactly (no Vulkan) so the two can be compared.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+#define CLUSTER_MAX_LIGHTS 256    // fixed slot per cluster in the index list
+#define MAX_CLUSTERED_LIGHTS 16384
+
+// Matches the std430 Light struct in tri.frag / light_cull.comp
+typedef struct ClusterLight
+{
+	float positionRadius[4]; // world position, influence radius
+	float color[4];          // rgb * intensity
+} ClusterLight;
+
+// Matches UniformBufferObject.clusterDepth / clusterScreen
+typedef struct ClusterParams
+{
+	float zNear, zFar;
+	float sliceScale, sliceBias; // slice = log(viewZ) * scale - bias
+	float width, height;         // framebuffer size in pixels
+	float tanHalfFovY, aspect;
+} ClusterParams;
+
+typedef struct ClusterStats
+{
+	uint32_t lights;
+	uint32_t maxPerCluster; // before clamping to CLUSTER_MAX_LIGHTS
+	uint32_t overflowed;    // clusters that hit CLUSTER_MAX_LIGHTS
+	double assignMs;
+} ClusterStats;
+
+typedef struct ClusterGrid
+{
+	ClusterParams params;
+	// View-space cluster bounds in SoA layout, one row of CLUSTER_GRID_X per (slice, y)
+	float* minX; float* minY; float* minZ;
+	float* maxX; float* maxY; float* maxZ;
+	bool hasSse;
+	bool useReference; // force the scalar path
+	ClusterStats stats;
+} ClusterGrid;
+
+void clusterInit(ClusterGrid* grid);
+void clusterDestroy(ClusterGrid* grid);
+
+ClusterParams clusterMakeParams(float zNear, float zFar, float fovY, float width, float height);
+// Rebuilds the cluster AABBs when the projection changed
+void clusterUpdateBounds(ClusterGrid* grid, const ClusterParams* params);
+
+// view is a column-major 4x4 matrix (cglm mat4 layout). counts has CLUSTER_COUNT entries,
+// indices CLUSTER_COUNT * CLUSTER_MAX_LIGHTS; cluster c owns indices[c * CLUSTER_MAX_LIGHTS ...].
+void clusterAssignLights(ClusterGrid* grid, const float view[16], const ClusterLight* lights, uint32_t lightCount,
+    uint32_t* counts, uint32_t* indices);
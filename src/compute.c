@@ -1,24 +1,31 @@
 #include "main.h"
 
 
-void createComputeSync(Application* app);
-void updateStorageImage(Application* app, StorageImage* img, float* data);
+void updateStorageImage(Application* app, StorageImage* img, const void* data);
 void clearStorageImage(Application* app, StorageImage* img);
-void createComputePipeline(Application* app, ComputePipeline* compute, const char* shaderPath, VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount);
+void createComputePipeline(Application* app, ComputePipeline* compute, const char* shaderPath, VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, uint32_t pushConstantSize);
 void createComputeDescriptors(Application* app, ComputePipeline* compute, VkDescriptorSet* descriptorSet, VkDescriptorPoolSize* poolSizes, uint32_t poolSizeCount, VkWriteDescriptorSet* descriptorWrites, uint32_t descriptorWriteCount);
 void createComputeDescriptorSetLayout(Application* app);
-void recordComputeCommands(Application* app);
-void updateComputeUniforms(Application* app, vec3 mousePos, int is_additive, vec2 path_mask_ws_dims);
+void recordComputeCommands(Application* app, VkCommandBuffer commandBuffer);
+void createPathMask(Application* app);
+void queuePathBrush(Application* app, vec3 worldPos, bool additive);
 
-void createComputeSync(Application* app)
+static VkDeviceSize storageTexelSize(VkFormat format)
 {
-	VkFenceCreateInfo fenceInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-	vkCreateFence(app->device, &fenceInfo, NULL, &app->computeFence);
+	switch (format)
+	{
+	case VK_FORMAT_R8_UNORM: return 1;
+	case VK_FORMAT_R8G8B8A8_UNORM: return 4;
+	case VK_FORMAT_R32G32B32A32_SFLOAT: return 4 * sizeof(float);
+	default: assert(!"unhandled storage image format"); return 0;
+	}
 }
-void updateStorageImage(Application* app, StorageImage* img, float* data)
+
+// data holds width * height texels in img->format
+void updateStorageImage(Application* app, StorageImage* img, const void* data)
 {
 	// Create staging buffer
-	VkDeviceSize size = img->extent.width * img->extent.height * 4 * sizeof(float);
+	VkDeviceSize size = (VkDeviceSize)img->extent.width * img->extent.height * storageTexelSize(img->format);
 	Buffer staging = createStagingBuffer(app, data, size);
 
 	// Copy buffer to image
@@ -75,10 +82,10 @@ void clearStorageImage(Application* app, StorageImage* img)
 	endSingleTimeCommands(app, cmd);
 }
 
-void createComputePipeline(Application* app, ComputePipeline* compute, const char* shaderPath, VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount)
+void createComputePipeline(Application* app, ComputePipeline* compute, const char* shaderPath, VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, uint32_t pushConstantSize)
 {
 	// Load compute shader module
-	VkShaderModule shader = LoadShaderModule(shaderPath, app->device);
+	VkShaderModule shader = LoadShaderModule(app->io, shaderPath, app->device);
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo = {
 	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
@@ -90,14 +97,16 @@ void createComputePipeline(Application* app, ComputePipeline* compute, const cha
 
 	VK_CHECK(vkCreateDescriptorSetLayout(app->device, &layoutInfo, NULL, &compute->descLayout));
 
+	// pushConstantSize 0: no push constants
+	VkPushConstantRange pushRange = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = pushConstantSize};
 	VkPipelineLayoutCreateInfo plLayoutInfo = {
 	    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 	    .pNext = NULL,
 	    .flags = 0,
 	    .setLayoutCount = 1,
 	    .pSetLayouts = &compute->descLayout,
-	    .pushConstantRangeCount = 0,
-	    .pPushConstantRanges = NULL,
+	    .pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0,
+	    .pPushConstantRanges = pushConstantSize > 0 ? &pushRange : NULL,
 	};
 
 	VK_CHECK(vkCreatePipelineLayout(app->device, &plLayoutInfo, NULL, &compute->layout));
@@ -121,7 +130,7 @@ void createComputePipeline(Application* app, ComputePipeline* compute, const cha
 	    .basePipelineIndex = -1,
 	};
 
-	VK_CHECK(vkCreateComputePipelines(app->device, VK_NULL_HANDLE, 1, &cpInfo, NULL, &compute->pipeline));
+	compute->pipeline = buildComputePipeline(app, &cpInfo);
 
 	vkDestroyShaderModule(app->device, shader, NULL);
 }
@@ -156,6 +165,125 @@ void createComputeDescriptors(Application* app, ComputePipeline* compute, VkDesc
 	vkUpdateDescriptorSets(app->device, descriptorWriteCount, descriptorWrites, 0, NULL);
 }
 
+// Centered on the origin and large enough for the whole scene; runs again once the model has loaded
+void fitPathMaskToScene(Application* app)
+{
+	app->pathMaskWorldSize[0] = 2.0f * fmaxf(fabsf(app->sceneMin[0]), fabsf(app->sceneMax[0]));
+	app->pathMaskWorldSize[1] = 2.0f * fmaxf(fabsf(app->sceneMin[2]), fabsf(app->sceneMax[2]));
+	for (int i = 0; i < 2; ++i)
+	{
+		if (app->pathMaskWorldSize[i] <= 0.0f)
+			app->pathMaskWorldSize[i] = 1.0f;
+	}
+}
+
+// Path mask: an R8 image painted with brush stamps (RGBA8 where R8 can't be a storage
+// image). It lives in GENERAL from creation on and the frame graph carries its state
+// between frames, so strokes accumulate.
+void createPathMask(Application* app)
+{
+	createStorageImage(app, &app->computeImage, PATH_MASK_SIZE, PATH_MASK_SIZE, app->pathMaskFormat);
+	clearStorageImage(app, &app->computeImage);
+	app->computeImageState = (RgState){.lastWrite = RG_ACCESS_TRANSFER_WRITE, .layout = RG_LAYOUT_GENERAL};
+
+	fitPathMaskToScene(app);
+
+	VkDescriptorSetLayoutBinding bindings[] = {
+	    {
+	        .binding = 0,
+	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+	        .descriptorCount = 1,
+	        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	    }};
+
+	// The shader's format qualifier has to match the image
+	const char* shader = app->pathMaskFormat == PATH_MASK_FORMAT ? "compiledshaders/compute_path_mask.comp.spv" : "compiledshaders/compute_path_mask_rgba8.comp.spv";
+	createComputePipeline(app, &app->compute, shader, bindings, 1, sizeof(PathBrushParams));
+
+	VkDescriptorPoolSize poolSizes[] = {
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1},
+	};
+
+	VkDescriptorImageInfo imageInfo = {
+	    .imageView = app->computeImage.view,
+	    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+	};
+
+	VkWriteDescriptorSet descriptorWrites[] = {
+	    {
+	        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+	        .dstBinding = 0,
+	        .descriptorCount = 1,
+	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+	        .pImageInfo = &imageInfo,
+	    },
+	};
+
+	createComputeDescriptors(app, &app->compute, &app->computeDescSet, poolSizes, 1, descriptorWrites, 1);
+}
+
+// Queues a stamp for the next recorded frame; stamps entirely off the mask are dropped.
+// Nothing calls this yet: no input has ever driven the brush and nothing samples the mask,
+// so the path_mask pass stays empty until a painting tool is hooked up.
+void queuePathBrush(Application* app, vec3 worldPos, bool additive)
+{
+	PathBrushParams stamp = {
+	    .center = {worldPos[0], worldPos[2]},
+	    .worldSize = {app->pathMaskWorldSize[0], app->pathMaskWorldSize[1]},
+	    .radius = additive ? PATH_BRUSH_RADIUS : PATH_ERASE_RADIUS,
+	    .is_additive = additive,
+	};
 
+	// Texel p sits at world (p / size - 0.5) * worldSize, see the shader
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		float center = (stamp.center[axis] / stamp.worldSize[axis] + 0.5f) * PATH_MASK_SIZE;
+		float radius = stamp.radius / stamp.worldSize[axis] * PATH_MASK_SIZE;
+		i32 first = (i32)floorf(center - radius);
+		i32 last = (i32)ceilf(center + radius);
+		first = first > 0 ? first : 0;
+		last = last < PATH_MASK_SIZE - 1 ? last : PATH_MASK_SIZE - 1;
+		if (last < first)
+			return;
+		stamp.origin[axis] = first;
+		stamp.extent[axis] = last - first + 1;
+	}
+	arrput(app->pathBrushStamps, stamp);
+}
 
+// One dispatch per queued stamp, covering only its rectangle. The frame graph (path_mask
+// pass) orders them against the previous frame; consecutive stamps may overlap, so they
+// are ordered here.
+void recordComputeCommands(Application* app, VkCommandBuffer commandBuffer)
+{
+	u32 stampCount = (u32)arrlen(app->pathBrushStamps);
+	if (stampCount == 0)
+		return;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->compute.pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->compute.layout, 0, 1, &app->computeDescSet, 0, NULL);
+
+	VkMemoryBarrier2 stampBarrier = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	};
+	VkDependencyInfo dependencyInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+	    .memoryBarrierCount = 1,
+	    .pMemoryBarriers = &stampBarrier,
+	};
 
+	for (u32 i = 0; i < stampCount; ++i)
+	{
+		const PathBrushParams* stamp = &app->pathBrushStamps[i];
+		if (i > 0)
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		vkCmdPushConstants(commandBuffer, app->compute.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(*stamp), stamp);
+		vkCmdDispatch(commandBuffer, (stamp->extent[0] + PATH_MASK_TILE - 1) / PATH_MASK_TILE,
+		    (stamp->extent[1] + PATH_MASK_TILE - 1) / PATH_MASK_TILE, 1);
+	}
+	arrsetlen(app->pathBrushStamps, 0);
+}
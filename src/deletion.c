@@ -0,0 +1,167 @@
+#include "main.h"
+
+// Deferred deletion. Anything a recorded frame may still reference is queued with the number
+// of the frame being recorded instead of destroyed, and goes once that frame's fence has been
+// waited on. Frames complete in submission order as far as the CPU can tell (each fence wait
+// covers one more frame), so the queue is flushed from the front. Entries carry a frame number
+// rather than sitting in a per-slot list because objects are also retired between frames, e.g.
+// by a swapchain recreate after present, when the current slot no longer matches the frame
+// that last used them.
+
+static void destroyNow(Application* app, const DeferredDeletion* deletion)
+{
+	switch (deletion->kind)
+	{
+	case DEFERRED_IMAGE:
+		vkDestroyImage(app->device, deletion->image, NULL);
+		break;
+	case DEFERRED_IMAGE_VIEW:
+		vkDestroyImageView(app->device, deletion->view, NULL);
+		break;
+	case DEFERRED_MEMORY:
+		vkFreeMemory(app->device, deletion->memory, NULL);
+		break;
+	case DEFERRED_SAMPLER:
+		vkDestroySampler(app->device, deletion->sampler, NULL);
+		break;
+	case DEFERRED_BUFFER:
+		vkDestroyBuffer(app->device, deletion->buffer, NULL);
+		break;
+	case DEFERRED_PIPELINE:
+		vkDestroyPipeline(app->device, deletion->pipeline, NULL);
+		break;
+	case DEFERRED_DESCRIPTOR_SET:
+		vkFreeDescriptorSets(app->device, deletion->descriptorSet.pool, 1, &deletion->descriptorSet.set);
+		break;
+	case DEFERRED_SEMAPHORE:
+		vkDestroySemaphore(app->device, deletion->semaphore, NULL);
+		break;
+	case DEFERRED_SWAPCHAIN:
+		vkDestroySwapchainKHR(app->device, deletion->swapchain, NULL);
+		break;
+	case DEFERRED_REGISTRY_IMAGE:
+		resourcesDestroyImage(app, deletion->registryImage);
+		break;
+	case DEFERRED_REGISTRY_SAMPLER:
+		resourcesDestroySampler(app, deletion->registrySampler);
+		break;
+	case DEFERRED_REGISTRY_BUFFER:
+		resourcesDestroyBuffer(app, deletion->registryBuffer);
+		break;
+	}
+	app->deletion.destroyed++;
+}
+
+// Null handles are skipped, so callers can retire whatever they hold without checking
+void deferDestroy(Application* app, DeferredDeletion deletion)
+{
+	DeletionQueue* queue = &app->deletion;
+	switch (deletion.kind)
+	{
+	case DEFERRED_DESCRIPTOR_SET:
+		if (deletion.descriptorSet.set == VK_NULL_HANDLE)
+			return;
+		break;
+	case DEFERRED_REGISTRY_IMAGE:
+	case DEFERRED_REGISTRY_SAMPLER:
+	case DEFERRED_REGISTRY_BUFFER:
+		if (deletion.registryImage.id == 0)
+			return;
+		break;
+	default:
+		if (deletion.image == VK_NULL_HANDLE)
+			return;
+		break;
+	}
+	deletion.frame = queue->frame;
+	arrput(queue->entries, deletion);
+	queue->deferred++;
+	if ((u32)arrlen(queue->entries) > queue->peakPending)
+		queue->peakPending = (u32)arrlen(queue->entries);
+}
+
+void deferDestroyTexture(Application* app, Texture* texture)
+{
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_SAMPLER, .sampler = texture->sampler});
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_IMAGE_VIEW, .view = texture->view});
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_IMAGE, .image = texture->image});
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_MEMORY, .memory = texture->memory});
+	memset(texture, 0, sizeof(*texture));
+}
+
+void deferDestroyBuffer(Application* app, Buffer* buffer)
+{
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_BUFFER, .buffer = buffer->vkbuffer});
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_MEMORY, .memory = buffer->memory});
+	memset(buffer, 0, sizeof(*buffer));
+}
+
+void deferFreeDescriptorSet(Application* app, VkDescriptorPool pool, VkDescriptorSet set)
+{
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_DESCRIPTOR_SET, .descriptorSet = {pool, set}});
+}
+
+// Swapchains and the semaphores their presents wait on. A frame fence says nothing about
+// vkQueuePresentKHR being done with either, and without VK_EXT_swapchain_maintenance1 there is
+// no present fence to ask, so these are held until an image of the next swapchain has been
+// acquired: presents complete in order, and by the time the frame that uses that image has
+// finished, every earlier present has let go of its swapchain and semaphore.
+void deferDestroyAfterPresent(Application* app, DeferredDeletion deletion)
+{
+	if (deletion.image == VK_NULL_HANDLE)
+		return;
+	arrput(app->deletion.presentPending, deletion);
+	app->deletion.deferred++;
+}
+
+// After a successful vkAcquireNextImageKHR, before the frame is submitted: the held objects
+// go with the frame being recorded
+void deletionQueueImageAcquired(Application* app)
+{
+	DeletionQueue* queue = &app->deletion;
+	for (u32 i = 0; i < (u32)arrlen(queue->presentPending); ++i)
+	{
+		DeferredDeletion deletion = queue->presentPending[i];
+		deletion.frame = queue->frame;
+		arrput(queue->entries, deletion);
+	}
+	arrsetlen(queue->presentPending, 0);
+	if ((u32)arrlen(queue->entries) > queue->peakPending)
+		queue->peakPending = (u32)arrlen(queue->entries);
+}
+
+// Right after the frame's vkQueueSubmit: the current slot's fence now completes this frame
+void deletionQueueSubmitted(Application* app)
+{
+	DeletionQueue* queue = &app->deletion;
+	queue->fenceFrames[app->currentFrame] = ++queue->frame;
+}
+
+// Right after the current slot's fence wait
+void deletionQueueFlush(Application* app)
+{
+	DeletionQueue* queue = &app->deletion;
+	if (queue->fenceFrames[app->currentFrame] > queue->completedFrames)
+		queue->completedFrames = queue->fenceFrames[app->currentFrame];
+
+	u32 count = 0;
+	while (count < (u32)arrlen(queue->entries) && queue->entries[count].frame < queue->completedFrames)
+		destroyNow(app, &queue->entries[count++]);
+	if (count > 0)
+		arrdeln(queue->entries, 0, count);
+}
+
+// After vkDeviceWaitIdle. A device wait doesn't cover presents, so the objects held for them
+// only go at shutdown, right before the device and surface are destroyed.
+void deletionQueueDestroyAll(Application* app, bool shutdown)
+{
+	DeletionQueue* queue = &app->deletion;
+	for (u32 i = 0; i < (u32)arrlen(queue->entries); ++i)
+		destroyNow(app, &queue->entries[i]);
+	arrfree(queue->entries);
+	if (!shutdown)
+		return;
+	for (u32 i = 0; i < (u32)arrlen(queue->presentPending); ++i)
+		destroyNow(app, &queue->presentPending[i]);
+	arrfree(queue->presentPending);
+}
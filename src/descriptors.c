@@ -5,7 +5,7 @@ VkDescriptorSetLayout createDescriptorSetLayout(VkDevice device)
 	VkDescriptorSetLayoutBinding bindings[] = {
 	    {
 	        .binding = 0,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+	        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, // frame uniforms, offset per frame in flight
 	        .descriptorCount = 1,
 	        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
 	    },
@@ -33,6 +33,32 @@ VkDescriptorSetLayout createDescriptorSetLayout(VkDevice device)
 			.descriptorCount = 1,
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
 		},
+	    // Clustered lights: light list, per-cluster counts, per-cluster indices
+	    {
+	        .binding = 5,
+	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	        .descriptorCount = 1,
+	        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+	    },
+	    {
+	        .binding = 6,
+	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	        .descriptorCount = 1,
+	        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+	    },
+	    {
+	        .binding = 7,
+	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	        .descriptorCount = 1,
+	        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+	    },
+	    // Shadow cascades (array view + comparison sampler)
+	    {
+	        .binding = 8,
+	        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+	        .descriptorCount = 1,
+	        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+	    },
 	};
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo = {
@@ -52,14 +78,15 @@ VkDescriptorPool createDescriptorPool(VkDevice device)
 	VkDescriptorPoolSize poolSizes[] = {
 	    {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 300},         // Increased for alpha cutoff buffer (26 textures × 4 uniform buffers each + extra)
 	    {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 500}, // Much more for many textures (26 textures × 2 samplers each + extra)
-	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 100},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 400},          // 3 cluster light buffers per material set + extra
+	    {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .descriptorCount = 100},  // frame uniforms, one per material set and the skybox
 	};
 
 	VkDescriptorPoolCreateInfo poolInfo = {
 	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 	    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, // Allow freeing individual sets
 	    .maxSets = 100,                                             // Allow many descriptor sets
-	    .poolSizeCount = 3,
+	    .poolSizeCount = ARRAYSIZE(poolSizes),
 	    .pPoolSizes = poolSizes,
 	};
 
@@ -81,59 +108,81 @@ VkDescriptorSet allocateDescriptorSet(VkDevice device, VkDescriptorPool pool, co
 	return descriptorSet;
 }
 
-void createDescriptors(Application* app)
+// Points a material set at the material's current textures. Sets are rewritten only before
+// their first use; swapping a texture later goes through a freshly allocated set.
+void writeMaterialDescriptorSet(Application* app, VkDescriptorSet set, MaterialHandle material)
 {
-	// Create descriptor pool
-	app->descriptorPool = createDescriptorPool(app->device);
+	const MaterialPool* materials = &app->resources.materials;
+	u32 index = resourcesMaterialIndex(app, material);
+	assert(index != POOL_INVALID && "descriptor set for a destroyed material");
+
+	VkDescriptorBufferInfo bufferInfo = {
+	    .buffer = app->uniformBuffer.vkbuffer,
+	    .offset = 0,
+	    .range = sizeof(UniformBufferObject)};
+
+	VkDescriptorImageInfo baseColorImageInfo = {
+	    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	    .imageView = resourcesImageView(app, materials->textures[MATERIAL_TEXTURE_BASE_COLOR][index]),
+	    .sampler = resourcesSampler(app, materials->samplers[MATERIAL_TEXTURE_BASE_COLOR][index])};
+
+	VkDescriptorImageInfo metallicRoughnessImageInfo = {
+	    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	    .imageView = resourcesImageView(app, materials->textures[MATERIAL_TEXTURE_METALLIC_ROUGHNESS][index]),
+	    .sampler = resourcesSampler(app, materials->samplers[MATERIAL_TEXTURE_METALLIC_ROUGHNESS][index])};
+
+	VkDescriptorImageInfo emissiveImageInfo = {
+	    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	    .imageView = resourcesImageView(app, materials->textures[MATERIAL_TEXTURE_EMISSIVE][index]),
+	    .sampler = resourcesSampler(app, materials->samplers[MATERIAL_TEXTURE_EMISSIVE][index])};
+
+	VkDescriptorBufferInfo lightBufferInfo = {.buffer = app->lightBuffer.vkbuffer, .offset = 0, .range = VK_WHOLE_SIZE};
+	VkDescriptorBufferInfo clusterCountInfo = {.buffer = app->clusterCountBuffer.vkbuffer, .offset = 0, .range = VK_WHOLE_SIZE};
+	VkDescriptorBufferInfo clusterIndexInfo = {.buffer = app->clusterIndexBuffer.vkbuffer, .offset = 0, .range = VK_WHOLE_SIZE};
+
+	VkDescriptorImageInfo shadowImageInfo = {
+	    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	    .imageView = app->shadowMapView,
+	    .sampler = app->shadowSampler};
+
+	// MaterialGPU buffer already created in createTextureResources
+	VkDescriptorBufferInfo materialBufferInfo = {
+	    .buffer = resourcesBuffer(app, materials->uniforms[index]),
+	    .offset = 0,
+	    .range = sizeof(MaterialGPU)};
+
+	VkWriteDescriptorSet descriptorWrites[] = {
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 0, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .descriptorCount = 1, .pBufferInfo = &bufferInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 1, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .pImageInfo = &baseColorImageInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 2, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .pImageInfo = &metallicRoughnessImageInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 3, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .pImageInfo = &emissiveImageInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 4, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1, .pBufferInfo = &materialBufferInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 5, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .pBufferInfo = &lightBufferInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 6, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .pBufferInfo = &clusterCountInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 7, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .pBufferInfo = &clusterIndexInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 8, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .pImageInfo = &shadowImageInfo},
+	};
 
-	// Allocate descriptor sets for each material
-	app->descriptorSets = calloc(app->mesh.material_count, sizeof(VkDescriptorSet));
+	vkUpdateDescriptorSets(app->device, ARRAYSIZE(descriptorWrites), descriptorWrites, 0, NULL);
+}
 
+// The pool itself is created with the other scene-independent resources, before the model
+// has loaded; this runs once the materials are known
+void createDescriptors(Application* app)
+{
+	// Allocate descriptor sets for each material
+	MaterialPool* materials = &app->resources.materials;
 	for (u32 i = 0; i < app->mesh.material_count; i++)
 	{
-		printf("app->descriptorSetLayout in createDescriptors loop: %p\n", (void*)app->descriptorSetLayout);
-		app->descriptorSets[i] = allocateDescriptorSet(app->device, app->descriptorPool, &app->descriptorSetLayout);
-
-		// Update descriptor set for this material
-		VkDescriptorBufferInfo bufferInfo = {
-		    .buffer = app->uniformBuffer.vkbuffer,
-		    .offset = 0,
-		    .range = sizeof(UniformBufferObject)};
-
-		VkDescriptorImageInfo baseColorImageInfo = {
-		    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		    .imageView = app->baseColorTextures[i].view,
-		    .sampler = app->baseColorTextures[i].sampler};
-
-		VkDescriptorImageInfo metallicRoughnessImageInfo = {
-		    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		    .imageView = app->metallicRoughnessTextures[i].view,
-		    .sampler = app->metallicRoughnessTextures[i].sampler};
-
-		VkDescriptorImageInfo emissiveImageInfo = {
-		    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		    .imageView = app->emissiveTextures[i].view,
-		    .sampler = app->emissiveTextures[i].sampler};
-
-		// MaterialGPU buffer already created in createTextureResources -> app->materialUniformBuffers[i]
-		VkDescriptorBufferInfo materialBufferInfo = {
-		    .buffer = app->materialUniformBuffers[i].vkbuffer,
-		    .offset = 0,
-		    .range = sizeof(MaterialGPU)};
-
-		VkWriteDescriptorSet descriptorWrites[] = {
-		    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->descriptorSets[i], .dstBinding = 0, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1, .pBufferInfo = &bufferInfo},
-		    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->descriptorSets[i], .dstBinding = 1, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .pImageInfo = &baseColorImageInfo},
-		    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->descriptorSets[i], .dstBinding = 2, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .pImageInfo = &metallicRoughnessImageInfo},
-		    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->descriptorSets[i], .dstBinding = 3, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .pImageInfo = &emissiveImageInfo},
-		    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = app->descriptorSets[i], .dstBinding = 4, .dstArrayElement = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1, .pBufferInfo = &materialBufferInfo},
-		};
-
-		vkUpdateDescriptorSets(app->device, ARRAYSIZE(descriptorWrites), descriptorWrites, 0, NULL);
+		MaterialHandle material = app->mesh.materials[i].handle;
+		VkDescriptorSet set = allocateDescriptorSet(app->device, app->descriptorPool, &app->descriptorSetLayout);
+		writeMaterialDescriptorSet(app, set, material);
+		materials->descriptorSets[resourcesMaterialIndex(app, material)] = set;
+
+		// Legacy single descriptor set support (use first texture)
+		if (i == 0)
+			app->descriptorSet = set;
 	}
-
-	// Legacy single descriptor set support (use first texture)
-	app->descriptorSet = app->descriptorSets[0];
 }
 
 void createComputeDescriptorSetLayout(Application* app)
@@ -166,7 +215,7 @@ void createSkyboxDescriptors(Application* app)
 	VkDescriptorBufferInfo skyboxBufferInfo = {
 		.buffer = app->skyboxUniformBuffer.vkbuffer,
 		.offset = 0,
-		.range = sizeof(UniformBufferObject),
+		.range = sizeof(UniformBufferObject), // one frame's copy; the dynamic offset picks which
 	};
 
 	VkDescriptorImageInfo skyboxImageInfo = {
@@ -181,7 +230,7 @@ void createSkyboxDescriptors(Application* app)
 			.dstSet = app->skyboxDescriptorSet,
 			.dstBinding = 0,
 			.dstArrayElement = 0,
-			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 			.descriptorCount = 1,
 			.pBufferInfo = &skyboxBufferInfo,
 		},
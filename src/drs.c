@@ -0,0 +1,163 @@
+#include "drs.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+DrsConfig drsDefaultConfig(float targetMs)
+{
+	return (DrsConfig){
+	    .targetMs = targetMs,
+	    .minScale = 0.5f,
+	    .maxScale = 1.0f,
+	    .step = 0.05f,
+	    .smoothing = 0.2f,
+	    .upscaleMargin = 0.85f,
+	    .cooldown = 8,
+	};
+}
+
+void drsInit(DrsController* drs, const DrsConfig* config)
+{
+	*drs = (DrsController){
+	    .config = *config,
+	    .scale = config->maxScale,
+	};
+}
+
+static float drsQuantize(const DrsConfig* config, float scale)
+{
+	float q = floorf(scale / config->step + 1e-3f) * config->step;
+	return fminf(fmaxf(q, config->minScale), config->maxScale);
+}
+
+float drsUpdate(DrsController* drs, float gpuMs)
+{
+	const DrsConfig* config = &drs->config;
+	if (!drs->primed)
+	{
+		drs->filteredMs = gpuMs;
+		drs->primed = true;
+	}
+	else
+	{
+		drs->filteredMs += (gpuMs - drs->filteredMs) * config->smoothing;
+	}
+
+	drs->framesSinceChange++;
+	if (drs->framesSinceChange < config->cooldown)
+		return drs->scale;
+
+	// GPU time is mostly proportional to the pixel count, i.e. to scale squared
+	float scale = drs->scale;
+	if (drs->filteredMs > config->targetMs)
+	{
+		// Over budget: jump straight to the scale that should fit
+		scale = drsQuantize(config, drs->scale * sqrtf(config->targetMs / drs->filteredMs));
+		if (scale >= drs->scale)
+			scale = drsQuantize(config, drs->scale - config->step);
+	}
+	else if (drs->filteredMs < config->targetMs * config->upscaleMargin)
+	{
+		// Comfortably under: grow one step at a time, only if the estimate still fits
+		float next = drsQuantize(config, drs->scale + config->step);
+		float predicted = drs->filteredMs * (next * next) / (drs->scale * drs->scale);
+		if (predicted < config->targetMs * config->upscaleMargin)
+			scale = next;
+	}
+
+	if (scale != drs->scale)
+	{
+		// The average described the old resolution; rescale it to the new one
+		drs->filteredMs *= (scale * scale) / (drs->scale * drs->scale);
+		drs->scale = scale;
+		drs->framesSinceChange = 0;
+	}
+	return drs->scale;
+}
+
+uint32_t drsScaledSize(uint32_t size, float scale)
+{
+	uint32_t scaled = (uint32_t)(size * scale + 0.5f);
+	return scaled > 0 ? scaled : 1;
+}
+
+uint32_t drsReplay(const DrsConfig* config, const DrsTraceEntry* entries, uint32_t entryCount)
+{
+	DrsController drs;
+	drsInit(&drs, config);
+	for (uint32_t i = 0; i < entryCount; ++i)
+	{
+		drs.config.targetMs = entries[i].targetMs;
+		if (drsUpdate(&drs, entries[i].gpuMs) != entries[i].scale)
+			return i;
+	}
+	return entryCount;
+}
+
+#define DRS_TRACE_HEADER "# target=%g min=%g max=%g step=%g smoothing=%g margin=%g cooldown=%u"
+
+// CSV: a header line with the starting config, then one "gpuMs,scale,targetMs" line per frame
+bool drsTraceWrite(const char* path, const DrsConfig* config, const DrsTraceEntry* entries, uint32_t entryCount)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+	fprintf(file, "# target=%.9g min=%.9g max=%.9g step=%.9g smoothing=%.9g margin=%.9g cooldown=%u\n",
+	    config->targetMs, config->minScale, config->maxScale, config->step, config->smoothing,
+	    config->upscaleMargin, config->cooldown);
+	for (uint32_t i = 0; i < entryCount; ++i)
+		fprintf(file, "%.9g,%.9g,%.9g\n", entries[i].gpuMs, entries[i].scale, entries[i].targetMs);
+	fclose(file);
+	return true;
+}
+
+// Also takes traces from before the budget column, which never changed it
+DrsTraceEntry* drsTraceRead(const char* path, DrsConfig* outConfig, uint32_t* outEntryCount)
+{
+	FILE* file = fopen(path, "r");
+	if (!file)
+		return NULL;
+
+	DrsConfig config;
+	if (fscanf(file, DRS_TRACE_HEADER, &config.targetMs, &config.minScale, &config.maxScale, &config.step,
+	        &config.smoothing, &config.upscaleMargin, &config.cooldown) != 7)
+	{
+		fclose(file);
+		return NULL;
+	}
+
+	uint32_t count = 0, capacity = 256;
+	DrsTraceEntry* entries = malloc(capacity * sizeof(DrsTraceEntry));
+	char line[128];
+	bool ok = true;
+	fgets(line, sizeof(line), file); // rest of the header line
+	while (ok && fgets(line, sizeof(line), file))
+	{
+		if (line[0] == '\n' || line[0] == '#')
+			continue;
+		DrsTraceEntry entry = {.targetMs = config.targetMs};
+		int fields = sscanf(line, "%g,%g,%g", &entry.gpuMs, &entry.scale, &entry.targetMs);
+		if (fields < 2)
+		{
+			ok = false;
+			break;
+		}
+		if (count == capacity)
+		{
+			capacity *= 2;
+			entries = realloc(entries, capacity * sizeof(DrsTraceEntry));
+		}
+		entries[count++] = entry;
+	}
+	fclose(file);
+
+	if (!ok)
+	{
+		free(entries);
+		return NULL;
+	}
+	*outConfig = config;
+	*outEntryCount = count;
+	return entries;
+}
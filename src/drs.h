@@ -0,0 +1,55 @@
+#pragma once
+
+// Dynamic resolution controller.
+// Fed one GPU frame time per frame, returns the render scale for the next one. It is plain
+// C with no clock or Vulkan of its own, so the same timing trace always produces the same
+// sequence of scales; drsTraceWrite dumps what the app fed it and drsTraceRead loads it back
+// for replaying offline.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct DrsConfig
+{
+	float targetMs;      // GPU frame budget
+	float minScale;      // per axis
+	float maxScale;
+	float step;          // scales are multiples of this, so sizes don't change every frame
+	float smoothing;     // weight of the newest sample in the moving average
+	float upscaleMargin; // only grow while below targetMs * upscaleMargin
+	uint32_t cooldown;   // frames to wait after a change (results lag by the frames in flight)
+} DrsConfig;
+
+typedef struct DrsController
+{
+	DrsConfig config;
+	float scale;
+	float filteredMs;
+	uint32_t framesSinceChange;
+	bool primed;
+} DrsController;
+
+// One fed sample and what the controller answered. The budget is editable while the app
+// runs, so every sample carries the one in effect when it was fed.
+typedef struct DrsTraceEntry
+{
+	float gpuMs;
+	float scale;
+	float targetMs;
+} DrsTraceEntry;
+
+DrsConfig drsDefaultConfig(float targetMs);
+void drsInit(DrsController* drs, const DrsConfig* config);
+// gpuMs was measured at the scale currently held by the controller
+float drsUpdate(DrsController* drs, float gpuMs);
+// Resolution at the given scale, at least one pixel
+uint32_t drsScaledSize(uint32_t size, float scale);
+
+// Replays a trace through a fresh controller started with config, switching budgets where
+// the trace does; returns the index of the first entry whose scale differs, or entryCount
+// when all of them match
+uint32_t drsReplay(const DrsConfig* config, const DrsTraceEntry* entries, uint32_t entryCount);
+// config is the one the controller was started with
+bool drsTraceWrite(const char* path, const DrsConfig* config, const DrsTraceEntry* entries, uint32_t entryCount);
+// Returns a malloc'd array the caller frees, or NULL when the file can't be read or parsed
+DrsTraceEntry* drsTraceRead(const char* path, DrsConfig* outConfig, uint32_t* outEntryCount);
@@ -0,0 +1,721 @@
+#define _GNU_SOURCE
+#include "fileio.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define FILEIO_HAVE_URING 1
+#else
+#define FILEIO_HAVE_URING 0
+#endif
+
+#define FILEIO_MAX_READ_CHUNK (1u << 30) // below the kernel's per-call cap of just under 2 GiB
+#define FILEIO_CANCEL_TAG UINT64_MAX       // user_data of cancel requests, never a read index
+
+typedef struct Ring Ring;
+
+struct FileIO
+{
+	JobSystem* jobs;
+	atomic_bool uring; // cleared if a ring ever breaks
+	pthread_mutex_t mutex; // guards the ring pool and the stats
+	Ring* freeRings[FILEIO_MAX_RINGS];
+	uint32_t freeCount;
+	uint32_t ringCount; // leased and free
+	const Pak* pak;
+	bool* shadowed; // per archive entry: a newer loose file is read instead
+	FileIOStats stats;
+};
+
+// One entry of a batch while it is being read
+typedef struct ReadState
+{
+	int fd;
+	uint64_t want; // bytes to read, once the file is sized
+	bool owned;    // dst was allocated here
+	bool done;
+	struct iovec iov; // the chunk in flight; must outlive the submission
+	bool submitted;   // handed to the kernel, which may still write through iov
+	double startMs;
+	const PakEntry* entry; // served from the archive instead
+} ReadState;
+
+typedef struct Batch
+{
+	FileRead* reads;
+	ReadState* states;
+	const Pak* pak;
+	const bool* shadowed;
+} Batch;
+
+static double nowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+// Opens the file, sizes the read and finds it a buffer; false with read->error set when the
+// read can't go ahead
+static bool openRead(FileRead* read, ReadState* state)
+{
+	state->startMs = nowMs();
+	state->fd = open(read->path, O_RDONLY | O_CLOEXEC);
+	if (state->fd < 0)
+	{
+		read->error = errno;
+		return false;
+	}
+	state->want = read->size;
+	if (state->want == 0)
+	{
+		assert(!read->dst && "reading to the end of the file needs a buffer allocated here");
+		struct stat st;
+		if (fstat(state->fd, &st) != 0)
+		{
+			read->error = errno;
+			return false;
+		}
+		state->want = (uint64_t)st.st_size > read->offset ? (uint64_t)st.st_size - read->offset : 0;
+	}
+	if (!read->dst)
+	{
+		read->dst = malloc(state->want + 1);
+		if (!read->dst)
+		{
+			read->error = ENOMEM;
+			return false;
+		}
+		state->owned = true;
+	}
+	return true;
+}
+
+static void finishRead(FileRead* read, ReadState* state)
+{
+	if (state->fd >= 0)
+		close(state->fd);
+	state->fd = -1;
+	if (read->error == 0 && read->bytesRead < state->want)
+		read->error = EIO; // the file ended early
+	if (state->owned)
+	{
+		if (read->error != 0)
+		{
+			free(read->dst);
+			read->dst = NULL;
+		}
+		else
+			((char*)read->dst)[read->bytesRead] = '\0';
+	}
+	read->latencyMs = nowMs() - state->startMs;
+	state->done = true;
+}
+
+static void preadAll(FileRead* read, ReadState* state)
+{
+	while (read->bytesRead < state->want)
+	{
+		uint64_t left = state->want - read->bytesRead;
+		ssize_t n = pread(state->fd, (char*)read->dst + read->bytesRead, left < FILEIO_MAX_READ_CHUNK ? left : FILEIO_MAX_READ_CHUNK,
+		    (off_t)(read->offset + read->bytesRead));
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			read->error = errno;
+			return;
+		}
+		if (n == 0)
+			return; // end of file
+		read->bytesRead += (uint64_t)n;
+	}
+}
+
+static void preadJob(void* data, uint32_t begin, uint32_t end)
+{
+	Batch* batch = data;
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		if (batch->states[i].done)
+			continue;
+		if (openRead(&batch->reads[i], &batch->states[i]))
+			preadAll(&batch->reads[i], &batch->states[i]);
+		finishRead(&batch->reads[i], &batch->states[i]);
+	}
+}
+
+// Blocking preads, one job per file so a slow file only holds up its own worker
+static void readBatchFallback(FileIO* io, Batch* batch, uint32_t count, uint32_t diskCount, FileIOStats* stats)
+{
+	jobsParallelFor(io->jobs, count, 1, preadJob, batch);
+	uint32_t workers = io->jobs ? jobsWorkerCount(io->jobs) : 1;
+	uint32_t depth = diskCount < workers ? diskCount : workers;
+	stats->submits += diskCount;
+	stats->queueDepthSum += (uint64_t)diskCount * depth;
+	stats->maxQueueDepth = depth;
+}
+
+static void pakReadJob(void* data, uint32_t begin, uint32_t end)
+{
+	Batch* batch = data;
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		FileRead* read = &batch->reads[i];
+		ReadState* state = &batch->states[i];
+		if (!state->entry)
+			continue;
+		// Same contract as a file on disk: size 0 runs to the end, a short entry is EIO
+		state->startMs = nowMs();
+		uint64_t available = state->entry->size > read->offset ? state->entry->size - read->offset : 0;
+		state->want = read->size ? read->size : available;
+		if (!read->dst)
+		{
+			read->dst = malloc(state->want + 1);
+			state->owned = read->dst != NULL;
+		}
+		uint64_t length = state->want < available ? state->want : available;
+		if (!read->dst)
+			read->error = ENOMEM;
+		else if (pakRead(batch->pak, state->entry, read->offset, length, read->dst))
+			read->bytesRead = length;
+		else
+			read->error = EIO;
+		finishRead(read, state);
+	}
+}
+
+// Serves what the archive holds straight from its mapping, before anything goes to disk.
+// Returns how many it served.
+static uint32_t readBatchFromPak(Batch* batch, uint32_t count, JobSystem* jobs)
+{
+	uint32_t served = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const PakEntry* entry = pakFind(batch->pak, batch->reads[i].path);
+		if (entry && batch->shadowed[entry - pakEntry(batch->pak, 0)])
+			entry = NULL;
+		batch->states[i].entry = entry;
+		if (entry)
+		{
+			// Readahead for every entry first, so the copies below mostly find their pages resident
+			pakPrefetch(batch->pak, batch->states[i].entry);
+			served++;
+		}
+	}
+	if (served > 0)
+		jobsParallelFor(jobs, count, 1, pakReadJob, batch);
+	return served;
+}
+
+#if FILEIO_HAVE_URING
+
+// Raw io_uring without liburing: the setup and enter syscalls, and the three shared mappings.
+// Every submission goes in through io_uring_enter (no SQPOLL), so the kernel has consumed
+// them all by the time it returns.
+struct Ring
+{
+	int fd;
+	unsigned sqEntries;
+	void* sqMap;
+	size_t sqMapSize;
+	void* cqMap;
+	size_t cqMapSize;
+	struct io_uring_sqe* sqes;
+	size_t sqesSize;
+
+	atomic_uint* sqTail;
+	unsigned sqMask;
+	unsigned* sqArray;
+	atomic_uint* cqHead;
+	atomic_uint* cqTail;
+	unsigned cqMask;
+	struct io_uring_cqe* cqes;
+};
+
+static void ringDestroy(Ring* ring)
+{
+	if (ring->sqes && ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sqesSize);
+	if (ring->cqMap && ring->cqMap != MAP_FAILED && ring->cqMap != ring->sqMap)
+		munmap(ring->cqMap, ring->cqMapSize);
+	if (ring->sqMap && ring->sqMap != MAP_FAILED)
+		munmap(ring->sqMap, ring->sqMapSize);
+	close(ring->fd);
+	free(ring);
+}
+
+static Ring* ringCreate(void)
+{
+	struct io_uring_params params = {0};
+	int fd = (int)syscall(__NR_io_uring_setup, FILEIO_QUEUE_DEPTH, &params);
+	if (fd < 0)
+		return NULL;
+
+	Ring* ring = calloc(1, sizeof(Ring));
+	ring->fd = fd;
+	ring->sqEntries = params.sq_entries;
+	ring->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (singleMap)
+	{
+		size_t size = ring->sqMapSize > ring->cqMapSize ? ring->sqMapSize : ring->cqMapSize;
+		ring->sqMapSize = ring->cqMapSize = size;
+	}
+
+	ring->sqMap = mmap(NULL, ring->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	ring->cqMap = singleMap ? ring->sqMap : mmap(NULL, ring->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (ring->sqMap == MAP_FAILED || ring->cqMap == MAP_FAILED || ring->sqes == MAP_FAILED)
+	{
+		ringDestroy(ring);
+		return NULL;
+	}
+
+	char* sq = ring->sqMap;
+	ring->sqTail = (atomic_uint*)(sq + params.sq_off.tail);
+	ring->sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+	char* cq = ring->cqMap;
+	ring->cqHead = (atomic_uint*)(cq + params.cq_off.head);
+	ring->cqTail = (atomic_uint*)(cq + params.cq_off.tail);
+	ring->cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+	return ring;
+}
+
+static void ringPushRead(Ring* ring, uint32_t index, FileRead* read, ReadState* state)
+{
+	uint64_t left = state->want - read->bytesRead;
+	state->iov.iov_base = (char*)read->dst + read->bytesRead;
+	state->iov.iov_len = left < FILEIO_MAX_READ_CHUNK ? left : FILEIO_MAX_READ_CHUNK;
+
+	unsigned tail = atomic_load_explicit(ring->sqTail, memory_order_relaxed);
+	unsigned slot = tail & ring->sqMask;
+	struct io_uring_sqe* sqe = &ring->sqes[slot];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READV; // READ needs 5.6; READV goes back to the first io_uring kernels
+	sqe->fd = state->fd;
+	sqe->addr = (uint64_t)(uintptr_t)&state->iov;
+	sqe->len = 1;
+	sqe->off = read->offset + read->bytesRead;
+	sqe->user_data = index;
+	ring->sqArray[slot] = slot;
+	state->submitted = true;
+	// Publishes the entry to the kernel
+	atomic_store_explicit(ring->sqTail, tail + 1, memory_order_release);
+}
+
+// After io_uring_enter failed for good: takes back the reads the kernel never saw, cancels the
+// ones it did and reaps every completion, so nothing in flight still points into the batch
+// when it is freed or handed to the fallback
+static void ringDrain(Ring* ring, Batch* batch, uint32_t count, unsigned inFlight, unsigned unsubmitted)
+{
+	// Without SQPOLL the kernel only reads the submission queue inside io_uring_enter, so the
+	// entries it hasn't consumed can be withdrawn
+	unsigned tail = atomic_load_explicit(ring->sqTail, memory_order_relaxed);
+	for (unsigned i = 1; i <= unsubmitted; ++i)
+		batch->states[ring->sqes[(tail - i) & ring->sqMask].user_data].submitted = false;
+	tail -= unsubmitted;
+	inFlight -= unsubmitted;
+
+	// Everything left was consumed, so the queue has room for one cancel per read in flight
+	unsigned cancels = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (!batch->states[i].submitted)
+			continue;
+		unsigned slot = tail & ring->sqMask;
+		struct io_uring_sqe* sqe = &ring->sqes[slot];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = -1;
+		sqe->addr = i; // the user_data of the read to cancel
+		sqe->user_data = FILEIO_CANCEL_TAG;
+		ring->sqArray[slot] = slot;
+		tail++;
+		cancels++;
+	}
+	atomic_store_explicit(ring->sqTail, tail, memory_order_release);
+
+	bool canEnter = true;
+	while (inFlight > 0)
+	{
+		if (canEnter)
+		{
+			int submitted = (int)syscall(__NR_io_uring_enter, ring->fd, cancels, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+			if (submitted >= 0)
+				cancels -= (unsigned)submitted;
+			else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+				canEnter = false;
+		}
+		else
+			sched_yield(); // completions still land in the ring, they just can't be waited on
+
+		unsigned head = atomic_load_explicit(ring->cqHead, memory_order_relaxed);
+		unsigned cqTail = atomic_load_explicit(ring->cqTail, memory_order_acquire);
+		for (; head != cqTail; ++head)
+		{
+			uint64_t userData = ring->cqes[head & ring->cqMask].user_data;
+			if (userData == FILEIO_CANCEL_TAG)
+				continue;
+			batch->states[userData].submitted = false;
+			inFlight--;
+		}
+		atomic_store_explicit(ring->cqHead, head, memory_order_release);
+	}
+}
+
+// Keeps up to sqEntries reads in flight, refilling as completions come back. Returns false if
+// io_uring_enter itself failed; by then nothing is in flight and the reads that didn't finish
+// are reset for the fallback.
+static bool ringReadBatch(Ring* ring, Batch* batch, uint32_t count, FileIOStats* stats)
+{
+	// Reads waiting to be submitted, first time or after a short read. Each read is either
+	// here, in flight or done, so count slots are enough.
+	uint32_t* queue = malloc(count * sizeof(uint32_t));
+	uint32_t queueHead = 0, queueLength = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		FileRead* read = &batch->reads[i];
+		ReadState* state = &batch->states[i];
+		if (state->done)
+			continue;
+		if (!openRead(read, state) || state->want == 0)
+			finishRead(read, state);
+		else
+			queue[queueLength++] = i;
+	}
+
+	unsigned inFlight = 0, unsubmitted = 0;
+	int failure = 0;
+	while (queueLength > 0 || inFlight > 0)
+	{
+		while (queueLength > 0 && inFlight < ring->sqEntries)
+		{
+			uint32_t index = queue[queueHead];
+			queueHead = (queueHead + 1) % count;
+			queueLength--;
+			ringPushRead(ring, index, &batch->reads[index], &batch->states[index]);
+			unsubmitted++;
+			inFlight++;
+		}
+
+		int submitted = (int)syscall(__NR_io_uring_enter, ring->fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (submitted < 0)
+		{
+			if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			{
+				failure = errno;
+				break;
+			}
+		}
+		else
+		{
+			unsubmitted -= (unsigned)submitted;
+			stats->submits++;
+			stats->queueDepthSum += inFlight;
+			if (inFlight > stats->maxQueueDepth)
+				stats->maxQueueDepth = inFlight;
+		}
+
+		unsigned head = atomic_load_explicit(ring->cqHead, memory_order_relaxed);
+		unsigned tail = atomic_load_explicit(ring->cqTail, memory_order_acquire);
+		for (; head != tail; ++head)
+		{
+			struct io_uring_cqe* cqe = &ring->cqes[head & ring->cqMask];
+			uint32_t index = (uint32_t)cqe->user_data;
+			FileRead* read = &batch->reads[index];
+			ReadState* state = &batch->states[index];
+			inFlight--;
+			state->submitted = false;
+			bool again = false;
+			if (cqe->res < 0)
+			{
+				again = cqe->res == -EINTR || cqe->res == -EAGAIN;
+				if (!again)
+					read->error = -cqe->res;
+			}
+			else if (cqe->res > 0)
+			{
+				read->bytesRead += (uint64_t)cqe->res;
+				again = read->bytesRead < state->want; // short read, go again for the rest
+			}
+			if (again)
+			{
+				queue[(queueHead + queueLength) % count] = index;
+				queueLength++;
+			}
+			else
+				finishRead(read, state);
+		}
+		// Hands the completion slots back to the kernel
+		atomic_store_explicit(ring->cqHead, head, memory_order_release);
+	}
+
+	if (failure != 0)
+	{
+		fprintf(stderr, "File I/O: io_uring_enter failed: %s, reading the rest with pread\n", strerror(failure));
+		ringDrain(ring, batch, count, inFlight, unsubmitted);
+		// Unfinished reads start over in the fallback
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			FileRead* read = &batch->reads[i];
+			ReadState* state = &batch->states[i];
+			if (state->done)
+				continue;
+			if (state->fd >= 0)
+				close(state->fd);
+			if (state->owned)
+			{
+				free(read->dst);
+				read->dst = NULL;
+			}
+			memset(state, 0, sizeof(*state));
+			state->fd = -1;
+			read->bytesRead = 0;
+			read->error = 0;
+		}
+	}
+	free(queue);
+	return failure == 0;
+}
+
+#else
+
+struct Ring
+{
+	int unused;
+};
+
+static Ring* ringCreate(void)
+{
+	return NULL;
+}
+
+static void ringDestroy(Ring* ring)
+{
+	free(ring);
+}
+
+static bool ringReadBatch(Ring* ring, Batch* batch, uint32_t count, FileIOStats* stats)
+{
+	(void)ring;
+	(void)batch;
+	(void)count;
+	(void)stats;
+	return false;
+}
+
+#endif
+
+FileIO* fileioCreate(JobSystem* jobs, bool allowUring)
+{
+	FileIO* io = calloc(1, sizeof(FileIO));
+	io->jobs = jobs;
+	pthread_mutex_init(&io->mutex, NULL);
+	// One ring up front doubles as the probe: io_uring_setup fails with ENOSYS on old kernels
+	// and EPERM where seccomp or a sysctl turns it off
+	Ring* ring = allowUring ? ringCreate() : NULL;
+	if (ring)
+	{
+		atomic_init(&io->uring, true);
+		io->freeRings[io->freeCount++] = ring;
+		io->ringCount = 1;
+	}
+	return io;
+}
+
+void fileioDestroy(FileIO* io)
+{
+	if (!io)
+		return;
+	for (uint32_t i = 0; i < io->freeCount; ++i)
+		ringDestroy(io->freeRings[i]);
+	pthread_mutex_destroy(&io->mutex);
+	free(io->shadowed);
+	free(io);
+}
+
+bool fileioUsesUring(const FileIO* io)
+{
+	return atomic_load(&io->uring);
+}
+
+void fileioMount(FileIO* io, const Pak* pak)
+{
+	free(io->shadowed);
+	io->shadowed = NULL;
+	io->pak = pak;
+	if (!pak)
+		return;
+
+	// The archive is only as fresh as the last pack; a loose file edited since then wins, so
+	// an edit shows up without repacking, and the stale copies are called out once here
+	uint32_t count = pakEntryCount(pak), newer = 0;
+	const char* first = NULL;
+	io->shadowed = calloc(count ? count : 1, sizeof(bool));
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const char* name = pakEntryName(pak, pakEntry(pak, i));
+		struct stat st;
+		if (stat(name, &st) != 0 || (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec <= pakModifiedNs(pak))
+			continue;
+		io->shadowed[i] = true;
+		first = first ? first : name;
+		newer++;
+	}
+	if (newer > 0)
+		fprintf(stderr, "File I/O: %u loose file(s) are newer than the archive (%s%s), reading them from disk; repack to pick them up\n",
+		    newer, first, newer > 1 ? ", ..." : "");
+}
+
+FileIOStats fileioStats(const FileIO* io)
+{
+	pthread_mutex_lock((pthread_mutex_t*)&io->mutex);
+	FileIOStats stats = io->stats;
+	pthread_mutex_unlock((pthread_mutex_t*)&io->mutex);
+	return stats;
+}
+
+void fileioPrintStats(const FileIO* io, const char* label)
+{
+	FileIOStats stats = fileioStats(io);
+	if (stats.reads == 0)
+		return;
+	double mib = (double)stats.bytes / (1024.0 * 1024.0);
+	printf("%s: %s, %llu reads (%llu from the archive, %llu failed), %.1f MiB, %.0f MiB/s busy, latency mean %.2f ms max %.2f ms, "
+	       "queue depth mean %.1f max %u\n",
+	    label, fileioUsesUring(io) ? "io_uring" : "pread", (unsigned long long)stats.reads, (unsigned long long)stats.pakReads,
+	    (unsigned long long)stats.failed, mib,
+	    stats.busyMs > 0.0 ? mib * 1000.0 / stats.busyMs : 0.0, stats.totalLatencyMs / (double)stats.reads, stats.maxLatencyMs,
+	    stats.submits ? (double)stats.queueDepthSum / (double)stats.submits : 0.0, stats.maxQueueDepth);
+}
+
+// A ring for the calling batch alone, or NULL when the pool is used up
+static Ring* leaseRing(FileIO* io)
+{
+	pthread_mutex_lock(&io->mutex);
+	Ring* ring = NULL;
+	bool create = false;
+	if (io->freeCount > 0)
+		ring = io->freeRings[--io->freeCount];
+	else if (io->ringCount < FILEIO_MAX_RINGS)
+	{
+		io->ringCount++;
+		create = true;
+	}
+	pthread_mutex_unlock(&io->mutex);
+
+	if (create && !(ring = ringCreate()))
+	{
+		pthread_mutex_lock(&io->mutex);
+		io->ringCount--;
+		pthread_mutex_unlock(&io->mutex);
+	}
+	return ring;
+}
+
+uint32_t fileioReadBatch(FileIO* io, FileRead* reads, uint32_t count)
+{
+	if (count == 0)
+		return 0;
+	double start = nowMs();
+	Batch batch = {.reads = reads, .states = calloc(count, sizeof(ReadState)), .pak = io->pak, .shadowed = io->shadowed};
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		reads[i].bytesRead = 0;
+		reads[i].error = 0;
+		reads[i].latencyMs = 0.0;
+		batch.states[i].fd = -1;
+	}
+
+	FileIOStats local = {0};
+	if (batch.pak)
+		local.pakReads = readBatchFromPak(&batch, count, io->jobs);
+	uint32_t diskCount = count - (uint32_t)local.pakReads;
+
+	Ring* ring = NULL;
+	bool ringOk = true;
+	if (diskCount > 0)
+	{
+		ring = fileioUsesUring(io) ? leaseRing(io) : NULL;
+		if (ring)
+			ringOk = ringReadBatch(ring, &batch, count, &local);
+		if (!ring || !ringOk)
+		{
+			uint32_t left = 0;
+			for (uint32_t i = 0; i < count; ++i)
+				left += !batch.states[i].done;
+			readBatchFallback(io, &batch, count, left, &local);
+		}
+	}
+
+	uint32_t failed = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		local.bytes += reads[i].bytesRead;
+		local.totalLatencyMs += reads[i].latencyMs;
+		if (reads[i].latencyMs > local.maxLatencyMs)
+			local.maxLatencyMs = reads[i].latencyMs;
+		if (reads[i].error != 0)
+			failed++;
+	}
+	free(batch.states);
+
+	pthread_mutex_lock(&io->mutex);
+	if (ring && ringOk)
+		io->freeRings[io->freeCount++] = ring;
+	else if (ring)
+	{
+		// A ring whose enter failed is in an unknown state; later batches read with pread
+		ringDestroy(ring);
+		io->ringCount--;
+		atomic_store(&io->uring, false);
+	}
+	FileIOStats* stats = &io->stats;
+	stats->reads += count;
+	stats->pakReads += local.pakReads;
+	stats->failed += failed;
+	stats->bytes += local.bytes;
+	stats->submits += local.submits;
+	stats->queueDepthSum += local.queueDepthSum;
+	if (local.maxQueueDepth > stats->maxQueueDepth)
+		stats->maxQueueDepth = local.maxQueueDepth;
+	stats->totalLatencyMs += local.totalLatencyMs;
+	if (local.maxLatencyMs > stats->maxLatencyMs)
+		stats->maxLatencyMs = local.maxLatencyMs;
+	stats->busyMs += nowMs() - start;
+	pthread_mutex_unlock(&io->mutex);
+	return failed;
+}
+
+void* fileioReadFile(FileIO* io, const char* path, size_t* outSize)
+{
+	FileRead read = {.path = path};
+	if (fileioReadBatch(io, &read, 1) != 0)
+	{
+		errno = read.error;
+		return NULL;
+	}
+	if (outSize)
+		*outSize = (size_t)read.bytesRead;
+	return read.dst;
+}
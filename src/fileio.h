@@ -0,0 +1,65 @@
+#pragma once
+
+// Batched file reads.
+// A batch is opened up front and its reads are all submitted at once through io_uring, up to
+// FILEIO_QUEUE_DEPTH in flight, then reaped as they complete; short reads are resubmitted for
+// the rest. Rings are not thread safe, so each batch leases one from a small pool and any
+// worker can read at the same time as the others. Without io_uring (old kernel, seccomp,
+// --no-uring) a batch is spread over the job system as blocking preads instead.
+// Reads land in the caller's buffer when one is given, so data can go straight where it is
+// used. With an archive mounted, paths it holds are served from its mapping instead of the
+// disk (see pak.h).
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jobs.h"
+#include "pak.h"
+
+#define FILEIO_QUEUE_DEPTH 64 // submission entries per ring
+#define FILEIO_MAX_RINGS 16   // batches past this many at once fall back to pread
+
+typedef struct FileRead
+{
+	const char* path;
+	void* dst;       // NULL allocates with malloc, zero terminated past the data; the caller frees
+	uint64_t offset;
+	uint64_t size;   // 0 reads from offset to the end of the file, into a buffer allocated here
+	// Filled in by the read
+	uint64_t bytesRead;
+	int error;       // 0, or an errno value; a file shorter than size is EIO
+	double latencyMs; // open to last byte
+} FileRead;
+
+typedef struct FileIOStats
+{
+	uint64_t reads;
+	uint64_t pakReads; // of those, served from the mounted archive
+	uint64_t failed;
+	uint64_t bytes;
+	uint64_t submits;       // io_uring_enter calls, or pread jobs in the fallback
+	uint64_t queueDepthSum; // reads in flight after each submit; divide by submits for the mean
+	uint32_t maxQueueDepth;
+	double totalLatencyMs;  // divide by reads for the mean
+	double maxLatencyMs;
+	double busyMs;          // wall time spent inside batches, overlapping batches counted twice
+} FileIOStats;
+
+typedef struct FileIO FileIO;
+
+// jobs runs the fallback preads and may be NULL; allowUring false always uses the fallback
+FileIO* fileioCreate(JobSystem* jobs, bool allowUring);
+void fileioDestroy(FileIO* io);
+bool fileioUsesUring(const FileIO* io);
+// Serves later reads of the paths pak holds from it, except where the loose file is newer than
+// the archive (reported once here); NULL unmounts. Not while reads run.
+void fileioMount(FileIO* io, const Pak* pak);
+FileIOStats fileioStats(const FileIO* io);
+void fileioPrintStats(const FileIO* io, const char* label);
+
+// Reads every entry and returns how many failed. Blocks until the whole batch is in; callable
+// from any worker.
+uint32_t fileioReadBatch(FileIO* io, FileRead* reads, uint32_t count);
+// The whole file in a malloc'd buffer with a terminating zero; NULL on failure with errno set
+void* fileioReadFile(FileIO* io, const char* path, size_t* outSize);
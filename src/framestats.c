@@ -0,0 +1,318 @@
+#include "main.h"
+
+#include <float.h>
+
+// Per-frame command counts and live device memory. The volk entry points for command
+// recording and memory are wrapped once after volkLoadDevice, so every call the frame makes
+// is counted without touching the passes themselves. Each wrapper is an increment and a
+// tail call; what that adds per frame is measured (frameCounterOverheadUs) and shown next to
+// the counts, against a budget of BENCHMARK_COUNTER_BUDGET_US, so it can stay installed
+// whether or not anything reads them.
+
+typedef struct DeviceAllocation
+{
+	VkDeviceSize size;
+	DeviceMemoryCategory category;
+	bool hostVisible; // buffers in host-visible memory are uniforms, staging and readback
+} DeviceAllocation;
+
+static BenchmarkCounters frameCounters;
+static struct
+{
+	VkDeviceMemory key;
+	DeviceAllocation value;
+}* deviceAllocations; // stb_ds hash map
+static DeviceMemoryStats memoryStats;
+static VkPhysicalDeviceMemoryProperties memoryProperties;
+static double wrapperNs; // what a counting wrapper adds to one call, see measureWrapperNs
+
+static PFN_vkCmdDraw realCmdDraw;
+static PFN_vkCmdDrawIndexed realCmdDrawIndexed;
+static PFN_vkCmdDrawIndirect realCmdDrawIndirect;
+static PFN_vkCmdDispatch realCmdDispatch;
+static PFN_vkCmdDispatchIndirect realCmdDispatchIndirect;
+static PFN_vkCmdBindPipeline realCmdBindPipeline;
+static PFN_vkCmdBindDescriptorSets realCmdBindDescriptorSets;
+static PFN_vkCmdBindVertexBuffers realCmdBindVertexBuffers;
+static PFN_vkCmdBindIndexBuffer realCmdBindIndexBuffer;
+static PFN_vkCmdPushConstants realCmdPushConstants;
+static PFN_vkCmdPipelineBarrier realCmdPipelineBarrier;
+static PFN_vkCmdPipelineBarrier2 realCmdPipelineBarrier2;
+static PFN_vkCmdBeginRendering realCmdBeginRendering;
+static PFN_vkAllocateMemory realAllocateMemory;
+static PFN_vkFreeMemory realFreeMemory;
+static PFN_vkBindBufferMemory realBindBufferMemory;
+static PFN_vkBindImageMemory realBindImageMemory;
+
+// Every pipeline here draws triangle lists
+static VKAPI_ATTR void VKAPI_CALL countCmdDraw(VkCommandBuffer cmd, u32 vertexCount, u32 instanceCount, u32 firstVertex, u32 firstInstance)
+{
+	frameCounters.draws++;
+	frameCounters.triangles += vertexCount / 3 * instanceCount;
+	realCmdDraw(cmd, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdDrawIndexed(VkCommandBuffer cmd, u32 indexCount, u32 instanceCount, u32 firstIndex, i32 vertexOffset, u32 firstInstance)
+{
+	frameCounters.draws++;
+	frameCounters.triangles += indexCount / 3 * instanceCount;
+	realCmdDrawIndexed(cmd, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+// The vertex count of an indirect draw only exists on the GPU
+static VKAPI_ATTR void VKAPI_CALL countCmdDrawIndirect(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, u32 drawCount, u32 stride)
+{
+	frameCounters.draws++;
+	realCmdDrawIndirect(cmd, buffer, offset, drawCount, stride);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdDispatch(VkCommandBuffer cmd, u32 x, u32 y, u32 z)
+{
+	frameCounters.dispatches++;
+	realCmdDispatch(cmd, x, y, z);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdDispatchIndirect(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset)
+{
+	frameCounters.dispatches++;
+	realCmdDispatchIndirect(cmd, buffer, offset);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdBindPipeline(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipeline pipeline)
+{
+	frameCounters.pipelineBinds++;
+	realCmdBindPipeline(cmd, bindPoint, pipeline);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdBindDescriptorSets(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout,
+    u32 firstSet, u32 setCount, const VkDescriptorSet* sets, u32 dynamicOffsetCount, const u32* dynamicOffsets)
+{
+	frameCounters.descriptorSetBinds++;
+	realCmdBindDescriptorSets(cmd, bindPoint, layout, firstSet, setCount, sets, dynamicOffsetCount, dynamicOffsets);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdBindVertexBuffers(VkCommandBuffer cmd, u32 firstBinding, u32 bindingCount,
+    const VkBuffer* buffers, const VkDeviceSize* offsets)
+{
+	frameCounters.bufferBinds++;
+	realCmdBindVertexBuffers(cmd, firstBinding, bindingCount, buffers, offsets);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdBindIndexBuffer(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+	frameCounters.bufferBinds++;
+	realCmdBindIndexBuffer(cmd, buffer, offset, indexType);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdPushConstants(VkCommandBuffer cmd, VkPipelineLayout layout, VkShaderStageFlags stages,
+    u32 offset, u32 size, const void* values)
+{
+	frameCounters.pushConstants++;
+	realCmdPushConstants(cmd, layout, stages, offset, size, values);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdPipelineBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages,
+    VkDependencyFlags flags, u32 memoryBarrierCount, const VkMemoryBarrier* memoryBarriers, u32 bufferBarrierCount,
+    const VkBufferMemoryBarrier* bufferBarriers, u32 imageBarrierCount, const VkImageMemoryBarrier* imageBarriers)
+{
+	frameCounters.barriers++;
+	realCmdPipelineBarrier(cmd, srcStages, dstStages, flags, memoryBarrierCount, memoryBarriers, bufferBarrierCount, bufferBarriers,
+	    imageBarrierCount, imageBarriers);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdPipelineBarrier2(VkCommandBuffer cmd, const VkDependencyInfo* dependencyInfo)
+{
+	frameCounters.barriers++;
+	realCmdPipelineBarrier2(cmd, dependencyInfo);
+}
+
+static VKAPI_ATTR void VKAPI_CALL countCmdBeginRendering(VkCommandBuffer cmd, const VkRenderingInfo* renderingInfo)
+{
+	frameCounters.renderPasses++;
+	realCmdBeginRendering(cmd, renderingInfo);
+}
+
+static void setCategory(VkDeviceMemory memory, DeviceMemoryCategory category)
+{
+	ptrdiff_t index = hmgeti(deviceAllocations, memory);
+	if (index < 0 || deviceAllocations[index].value.category == category)
+		return;
+	DeviceAllocation* allocation = &deviceAllocations[index].value;
+	memoryStats.bytes[allocation->category] -= allocation->size;
+	memoryStats.bytes[category] += allocation->size;
+	allocation->category = category;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL trackAllocateMemory(VkDevice device, const VkMemoryAllocateInfo* allocateInfo,
+    const VkAllocationCallbacks* allocator, VkDeviceMemory* memory)
+{
+	VkResult result = realAllocateMemory(device, allocateInfo, allocator, memory);
+	if (result == VK_SUCCESS)
+	{
+		u32 flags = memoryProperties.memoryTypes[allocateInfo->memoryTypeIndex].propertyFlags;
+		DeviceAllocation allocation = {
+		    .size = allocateInfo->allocationSize,
+		    .category = DEVICE_MEMORY_UNBOUND,
+		    .hostVisible = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0,
+		};
+		hmput(deviceAllocations, *memory, allocation);
+		memoryStats.bytes[DEVICE_MEMORY_UNBOUND] += allocation.size;
+		memoryStats.totalBytes += allocation.size;
+		if (memoryStats.totalBytes > memoryStats.peakBytes)
+			memoryStats.peakBytes = memoryStats.totalBytes;
+		memoryStats.allocations++;
+	}
+	return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL trackFreeMemory(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* allocator)
+{
+	ptrdiff_t index = memory != VK_NULL_HANDLE ? hmgeti(deviceAllocations, memory) : -1;
+	if (index >= 0)
+	{
+		const DeviceAllocation* allocation = &deviceAllocations[index].value;
+		memoryStats.bytes[allocation->category] -= allocation->size;
+		memoryStats.totalBytes -= allocation->size;
+		memoryStats.allocations--;
+		(void)hmdel(deviceAllocations, memory);
+	}
+	realFreeMemory(device, memory, allocator);
+}
+
+// The first bind decides the category; render targets are tagged by their allocator instead
+static VKAPI_ATTR VkResult VKAPI_CALL trackBindBufferMemory(VkDevice device, VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset)
+{
+	ptrdiff_t index = hmgeti(deviceAllocations, memory);
+	if (index >= 0 && deviceAllocations[index].value.category == DEVICE_MEMORY_UNBOUND)
+		setCategory(memory, deviceAllocations[index].value.hostVisible ? DEVICE_MEMORY_HOST_BUFFERS : DEVICE_MEMORY_BUFFERS);
+	return realBindBufferMemory(device, buffer, memory, offset);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL trackBindImageMemory(VkDevice device, VkImage image, VkDeviceMemory memory, VkDeviceSize offset)
+{
+	ptrdiff_t index = hmgeti(deviceAllocations, memory);
+	if (index >= 0 && deviceAllocations[index].value.category == DEVICE_MEMORY_UNBOUND)
+		setCategory(memory, DEVICE_MEMORY_IMAGES);
+	return realBindImageMemory(device, image, memory, offset);
+}
+
+// An increment and a tail call through a pointer, like the wrappers above, in front of a
+// function that does nothing
+static u32 calibrationCount;
+static __attribute__((noinline)) void calibrationTarget(u32 value)
+{
+	__asm__ volatile("" ::"r"(value));
+}
+static void (*volatile calibrationReal)(u32) = calibrationTarget;
+static __attribute__((noinline)) void calibrationWrapper(u32 value)
+{
+	calibrationCount++;
+	calibrationReal(value);
+}
+
+// Timing each wrapped call would cost more than the wrapper, so the difference between
+// calling the empty function directly and through the wrapper is measured once and later
+// multiplied by the calls a frame made. Best of a few rounds, to leave out preemption.
+static double measureWrapperNs(void)
+{
+	enum { CALLS = 1 << 18 };
+	void (*volatile direct)(u32) = calibrationTarget;
+	void (*volatile wrapped)(u32) = calibrationWrapper;
+	double directUs = DBL_MAX, wrappedUs = DBL_MAX;
+	for (int round = 0; round < 3; ++round)
+	{
+		double start = profilerNowUs();
+		for (u32 i = 0; i < CALLS; ++i)
+			direct(i);
+		double mid = profilerNowUs();
+		for (u32 i = 0; i < CALLS; ++i)
+			wrapped(i);
+		double end = profilerNowUs();
+		directUs = fmin(directUs, mid - start);
+		wrappedUs = fmin(wrappedUs, end - mid);
+	}
+	return fmax(wrappedUs - directUs, 0.0) * 1000.0 / CALLS;
+}
+
+// Call right after volkLoadDevice, before anything is allocated
+void installFrameCounters(Application* app)
+{
+	vkGetPhysicalDeviceMemoryProperties(app->physicalDevice, &memoryProperties);
+	wrapperNs = measureWrapperNs();
+	printf("Frame counters: %.2f ns per wrapped call\n", wrapperNs);
+
+	realCmdDraw = vkCmdDraw;
+	realCmdDrawIndexed = vkCmdDrawIndexed;
+	realCmdDrawIndirect = vkCmdDrawIndirect;
+	realCmdDispatch = vkCmdDispatch;
+	realCmdDispatchIndirect = vkCmdDispatchIndirect;
+	realCmdBindPipeline = vkCmdBindPipeline;
+	realCmdBindDescriptorSets = vkCmdBindDescriptorSets;
+	realCmdBindVertexBuffers = vkCmdBindVertexBuffers;
+	realCmdBindIndexBuffer = vkCmdBindIndexBuffer;
+	realCmdPushConstants = vkCmdPushConstants;
+	realCmdPipelineBarrier = vkCmdPipelineBarrier;
+	realCmdPipelineBarrier2 = vkCmdPipelineBarrier2;
+	realCmdBeginRendering = vkCmdBeginRendering;
+	realAllocateMemory = vkAllocateMemory;
+	realFreeMemory = vkFreeMemory;
+	realBindBufferMemory = vkBindBufferMemory;
+	realBindImageMemory = vkBindImageMemory;
+
+	vkCmdDraw = countCmdDraw;
+	vkCmdDrawIndexed = countCmdDrawIndexed;
+	vkCmdDrawIndirect = countCmdDrawIndirect;
+	vkCmdDispatch = countCmdDispatch;
+	vkCmdDispatchIndirect = countCmdDispatchIndirect;
+	vkCmdBindPipeline = countCmdBindPipeline;
+	vkCmdBindDescriptorSets = countCmdBindDescriptorSets;
+	vkCmdBindVertexBuffers = countCmdBindVertexBuffers;
+	vkCmdBindIndexBuffer = countCmdBindIndexBuffer;
+	vkCmdPushConstants = countCmdPushConstants;
+	vkCmdPipelineBarrier = countCmdPipelineBarrier;
+	vkCmdPipelineBarrier2 = countCmdPipelineBarrier2;
+	vkCmdBeginRendering = countCmdBeginRendering;
+	vkAllocateMemory = trackAllocateMemory;
+	vkFreeMemory = trackFreeMemory;
+	vkBindBufferMemory = trackBindBufferMemory;
+	vkBindImageMemory = trackBindImageMemory;
+}
+
+// Counts since the previous call; drawFrame takes them once the frame is recorded
+BenchmarkCounters takeFrameCounters(void)
+{
+	BenchmarkCounters counters = frameCounters;
+	frameCounters = (BenchmarkCounters){0};
+	return counters;
+}
+
+// The wrappers' share of recording the frame these counts came from. Every field but the
+// triangle count is one wrapped call; memory calls are left out, frames rarely make any.
+double frameCounterOverheadUs(const BenchmarkCounters* counters)
+{
+	u32 calls = counters->draws + counters->dispatches + counters->pipelineBinds + counters->descriptorSetBinds +
+	            counters->bufferBinds + counters->pushConstants + counters->barriers + counters->renderPasses;
+	return calls * wrapperNs / 1000.0;
+}
+
+void tagDeviceMemory(VkDeviceMemory memory, DeviceMemoryCategory category)
+{
+	setCategory(memory, category);
+}
+
+const DeviceMemoryStats* deviceMemoryStats(void)
+{
+	return &memoryStats;
+}
+
+const char* deviceMemoryCategoryName(DeviceMemoryCategory category)
+{
+	static const char* const names[DEVICE_MEMORY_CATEGORY_COUNT] = {
+	    [DEVICE_MEMORY_UNBOUND] = "unbound",
+	    [DEVICE_MEMORY_BUFFERS] = "buffers",
+	    [DEVICE_MEMORY_HOST_BUFFERS] = "host buffers",
+	    [DEVICE_MEMORY_IMAGES] = "textures",
+	    [DEVICE_MEMORY_RENDER_TARGETS] = "render targets",
+	};
+	return category < DEVICE_MEMORY_CATEGORY_COUNT ? names[category] : "?";
+}
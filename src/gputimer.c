@@ -0,0 +1,181 @@
+#include "main.h"
+
+// Timestamp queries per frame in flight. A frame's pool is only read back after its fence
+// has been waited on, so results are always available without stalling.
+// Fixed scopes come first in each pool, then the named ranges in the order they were pushed.
+
+static const char* const scopeNames[GPU_TIMER_SCOPE_COUNT] = {
+    [GPU_TIMER_FRAME] = "frame",
+    [GPU_TIMER_BLOOM] = "bloom",
+    [GPU_TIMER_PARTICLES] = "particles",
+    [GPU_TIMER_SHADOW_CASCADE0] = "shadow_cascade0",
+    [GPU_TIMER_SHADOW_CASCADE0 + 1] = "shadow_cascade1",
+    [GPU_TIMER_SHADOW_CASCADE0 + 2] = "shadow_cascade2",
+    [GPU_TIMER_SHADOW_CASCADE0 + 3] = "shadow_cascade3",
+};
+
+static u32 rangeQuery(u32 range)
+{
+	return (GPU_TIMER_SCOPE_COUNT + range) * 2;
+}
+
+void gpuTimerInit(Application* app)
+{
+	GpuTimer* timer = &app->gpuTimer;
+	memset(timer, 0, sizeof(*timer));
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicalDevice, &props);
+	timer->supported = props.limits.timestampComputeAndGraphics && props.limits.timestampPeriod > 0.0f;
+	timer->periodNs = props.limits.timestampPeriod;
+	if (!timer->supported)
+	{
+		printf("GPU timers: timestamps not supported on this device\n");
+		return;
+	}
+
+	VkQueryPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+	    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+	    .queryCount = GPU_TIMER_QUERY_COUNT,
+	};
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		VK_CHECK(vkCreateQueryPool(app->device, &poolInfo, NULL, &timer->pools[i]));
+}
+
+void gpuTimerDestroy(Application* app)
+{
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		vkDestroyQueryPool(app->device, app->gpuTimer.pools[i], NULL);
+	memset(&app->gpuTimer, 0, sizeof(app->gpuTimer));
+}
+
+// Call after waiting on the current frame's fence, before its command buffer is re-recorded
+void gpuTimerResolve(Application* app)
+{
+	GpuTimer* timer = &app->gpuTimer;
+	u32 frame = app->currentFrame;
+	u32 mask = timer->writtenMask[frame];
+	u32 rangeCount = timer->rangeCount[frame];
+	if (!timer->supported || (mask == 0 && rangeCount == 0))
+		return;
+
+	u64 timestamps[GPU_TIMER_QUERY_COUNT];
+	VkResult result = vkGetQueryPoolResults(app->device, timer->pools[frame], 0, GPU_TIMER_QUERY_COUNT,
+	    sizeof(timestamps), timestamps, sizeof(u64), VK_QUERY_RESULT_64_BIT);
+	// Unwritten scopes leave their queries unavailable, which reports VK_NOT_READY
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+		VK_CHECK(result);
+
+	// The frame scope opens first in the command buffer; starts are measured from it
+	u64 origin = (mask & (1u << GPU_TIMER_FRAME)) ? timestamps[GPU_TIMER_FRAME * 2] : timestamps[rangeQuery(0)];
+	double toMs = timer->periodNs / 1e6;
+
+	for (u32 scope = 0; scope < GPU_TIMER_SCOPE_COUNT; ++scope)
+	{
+		if (mask & (1u << scope))
+		{
+			timer->ms[scope] = (double)(timestamps[scope * 2 + 1] - timestamps[scope * 2]) * toMs;
+			timer->startMs[scope] = (double)(timestamps[scope * 2] - origin) * toMs;
+		}
+	}
+	for (u32 i = 0; i < rangeCount; ++i)
+	{
+		u32 query = rangeQuery(i);
+		timer->ranges[i] = (GpuTimerRange){
+		    .name = timer->rangeNames[frame][i],
+		    .depth = timer->rangeDepths[frame][i],
+		    .startMs = (double)(timestamps[query] - origin) * toMs,
+		    .ms = (double)(timestamps[query + 1] - timestamps[query]) * toMs,
+		};
+	}
+	timer->resolvedMask = mask;
+	timer->resolvedRangeCount = rangeCount;
+	timer->writtenMask[frame] = 0;
+	timer->rangeCount[frame] = 0;
+
+	if (!timer->traced[frame])
+		return;
+	timer->traced[frame] = false;
+
+	// Hand the frame to the trace capture on the GPU clock, in microseconds
+	double originUs = (double)origin * timer->periodNs / 1e3;
+	double submitUs = timer->submitUs[frame];
+	u32 traceFrame = timer->traceFrame[frame];
+	for (u32 scope = 0; scope < GPU_TIMER_SCOPE_COUNT; ++scope)
+	{
+		if (mask & (1u << scope))
+			profilerAddGpu(&app->profiler, scopeNames[scope], originUs + timer->startMs[scope] * 1e3, timer->ms[scope] * 1e3, submitUs, traceFrame);
+	}
+	for (u32 i = 0; i < rangeCount; ++i)
+	{
+		const GpuTimerRange* range = &timer->ranges[i];
+		profilerAddGpu(&app->profiler, range->name, originUs + range->startMs * 1e3, range->ms * 1e3, submitUs, traceFrame);
+	}
+}
+
+void gpuTimerReset(Application* app, VkCommandBuffer commandBuffer)
+{
+	GpuTimer* timer = &app->gpuTimer;
+	if (!timer->supported)
+		return;
+	u32 frame = app->currentFrame;
+	vkCmdResetQueryPool(commandBuffer, timer->pools[frame], 0, GPU_TIMER_QUERY_COUNT);
+	timer->writtenMask[frame] = 0;
+	timer->rangeCount[frame] = 0;
+	timer->rangeDepth = 0;
+	timer->traced[frame] = app->profiler.recording;
+	timer->traceFrame[frame] = app->profiler.frame;
+}
+
+void gpuTimerBegin(Application* app, VkCommandBuffer commandBuffer, GpuTimerScope scope)
+{
+	if (!app->gpuTimer.supported)
+		return;
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, app->gpuTimer.pools[app->currentFrame], scope * 2);
+}
+
+void gpuTimerEnd(Application* app, VkCommandBuffer commandBuffer, GpuTimerScope scope)
+{
+	if (!app->gpuTimer.supported)
+		return;
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, app->gpuTimer.pools[app->currentFrame], scope * 2 + 1);
+	app->gpuTimer.writtenMask[app->currentFrame] |= 1u << scope;
+}
+
+// Ranges past GPU_TIMER_MAX_RANGES in a frame are skipped, but still have to be popped
+void gpuTimerPushRange(Application* app, VkCommandBuffer commandBuffer, const char* name)
+{
+	GpuTimer* timer = &app->gpuTimer;
+	if (!timer->supported)
+		return;
+	assert(timer->rangeDepth < GPU_TIMER_MAX_RANGE_DEPTH);
+
+	u32 frame = app->currentFrame;
+	u32 range = UINT32_MAX;
+	if (timer->rangeCount[frame] < GPU_TIMER_MAX_RANGES)
+	{
+		range = timer->rangeCount[frame]++;
+		timer->rangeNames[frame][range] = name;
+		timer->rangeDepths[frame][range] = (u8)timer->rangeDepth;
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, timer->pools[frame], rangeQuery(range));
+	}
+	timer->rangeStack[timer->rangeDepth++] = range;
+}
+
+void gpuTimerPopRange(Application* app, VkCommandBuffer commandBuffer)
+{
+	GpuTimer* timer = &app->gpuTimer;
+	if (!timer->supported)
+		return;
+	assert(timer->rangeDepth > 0);
+
+	u32 range = timer->rangeStack[--timer->rangeDepth];
+	if (range != UINT32_MAX)
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, timer->pools[app->currentFrame], rangeQuery(range) + 1);
+}
+
+const char* gpuTimerScopeName(GpuTimerScope scope)
+{
+	return scope < GPU_TIMER_SCOPE_COUNT ? scopeNames[scope] : "?";
+}
@@ -0,0 +1,204 @@
+#include "main.h"
+
+// Vulkan side of the headless benchmark (benchmark.h): an offscreen color target stands in
+// for the swapchain, and each frame's command counts come from framestats.c.
+
+// Stands in for the swapchain images: one color target the tonemap pass writes and a
+// readback could copy from
+void createOffscreenTarget(Application* app)
+{
+	VkImageCreateInfo imageInfo = {
+	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+	    .imageType = VK_IMAGE_TYPE_2D,
+	    .format = app->swapchainFormat,
+	    .extent = {(u32)app->width, (u32)app->height, 1},
+	    .mipLevels = 1,
+	    .arrayLayers = 1,
+	    .samples = VK_SAMPLE_COUNT_1_BIT,
+	    .tiling = VK_IMAGE_TILING_OPTIMAL,
+	    .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+	    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+	};
+	app->swapchainImageCount = 1;
+	app->swapchainImages = arenaAlloc(&app->swapchainArena, sizeof(VkImage));
+	VK_CHECK(vkCreateImage(app->device, &imageInfo, NULL, &app->swapchainImages[0]));
+
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(app->device, app->swapchainImages[0], &memReqs);
+	VkMemoryAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+	    .allocationSize = memReqs.size,
+	    .memoryTypeIndex = findMemoryType(&app->memoryProperties, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+	};
+	VK_CHECK(vkAllocateMemory(app->device, &allocInfo, NULL, &app->offscreenTargetMemory));
+	tagDeviceMemory(app->offscreenTargetMemory, DEVICE_MEMORY_RENDER_TARGETS);
+	VK_CHECK(vkBindImageMemory(app->device, app->swapchainImages[0], app->offscreenTargetMemory, 0));
+}
+
+void destroyOffscreenTarget(Application* app)
+{
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_IMAGE, .image = app->swapchainImages[0]});
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_MEMORY, .memory = app->offscreenTargetMemory});
+	app->offscreenTargetMemory = VK_NULL_HANDLE;
+}
+
+// Copies what gpuTimerResolve just read back for the frame that last used this slot
+static void takeGpuTimes(Application* app, BenchmarkFrame* frame)
+{
+	if (!app->gpuTimer.supported)
+		return;
+	frame->gpuMask = app->gpuTimer.resolvedMask;
+	for (u32 scope = 0; scope < GPU_TIMER_SCOPE_COUNT; ++scope)
+	{
+		if (frame->gpuMask & (1u << scope))
+			frame->gpuMs[scope] = app->gpuTimer.ms[scope];
+	}
+}
+
+static const char* deviceTypeName(VkPhysicalDeviceType type)
+{
+	switch (type)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+	case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+	default: return "other";
+	}
+}
+
+// Renders warmup + measured frames along the camera path with a fixed timestep. GPU times
+// arrive MAX_FRAMES_IN_FLIGHT frames late, so each is matched back to the frame that recorded
+// it through the slot it ran in.
+static void renderFrames(Application* app, BenchmarkFrame* frames, u32 total)
+{
+	i32 slotFrame[MAX_FRAMES_IN_FLIGHT];
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		slotFrame[i] = -1;
+
+	for (u32 i = 0; i < total; ++i)
+	{
+		vec3 target;
+		benchmarkCameraPath(app->sceneMin, app->sceneMax, i, total, app->cameraPos, target);
+		glm_vec3_sub(target, app->cameraPos, app->cameraFront);
+		glm_normalize(app->cameraFront);
+		app->deltaTime = BENCHMARK_FRAME_DT;
+		updateLights(app, (float)i * BENCHMARK_FRAME_DT);
+
+		u32 slot = app->currentFrame;
+		double start = benchmarkNowMs();
+		drawFrame(app);
+		frames[i].cpuMs = benchmarkNowMs() - start;
+		frames[i].counters = app->frameCounters;
+		frames[i].counterUs = app->counterOverheadUs;
+
+		if (slotFrame[slot] >= 0)
+			takeGpuTimes(app, &frames[slotFrame[slot]]);
+		slotFrame[slot] = (i32)i;
+	}
+
+	// Drain the frames still in flight, oldest first
+	VK_CHECK(vkDeviceWaitIdle(app->device));
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		u32 slot = app->currentFrame;
+		gpuTimerResolve(app);
+		if (slotFrame[slot] >= 0)
+			takeGpuTimes(app, &frames[slotFrame[slot]]);
+		app->currentFrame = (app->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	}
+}
+
+// Renders the benchmark frames and writes the report. With --ab-specialize the same frames are
+// rendered a second time, warmup included, with generic material pipelines.
+bool runBenchmark(Application* app)
+{
+	_Static_assert(GPU_TIMER_SCOPE_COUNT <= BENCHMARK_MAX_GPU_SCOPES, "BenchmarkFrame can't hold every GPU timer scope");
+	const BenchmarkConfig* config = &app->benchmark;
+	u32 total = config->warmupFrames + config->frames;
+	BenchmarkFrame* frames = calloc(total, sizeof(BenchmarkFrame));
+	BenchmarkFrame* genericFrames = NULL;
+	const char* gpuScopeNames[GPU_TIMER_SCOPE_COUNT];
+	for (u32 scope = 0; scope < GPU_TIMER_SCOPE_COUNT; ++scope)
+		gpuScopeNames[scope] = gpuTimerScopeName((GpuTimerScope)scope);
+
+	// Frames are only comparable with every asset resident
+	double loadStart = benchmarkNowMs();
+	if (!assetsWaitAll(app))
+		fprintf(stderr, "Benchmark: some assets failed to load, running with placeholders\n");
+	printf("Benchmark: assets resident after %.1f ms\n", benchmarkNowMs() - loadStart);
+
+	// Runs on the fitted emitter and leaves the particles as they were at creation
+	bool particlesMatch = true;
+	if (config->checkParticles)
+		particlesMatch = particlesCheckAgainstReference(app, config->checkParticles);
+
+	printf("Benchmark: %u frames (+%u warmup) at %dx%d, %s materials\n", config->frames, config->warmupFrames,
+	    app->width, app->height, app->specializeMaterials ? "specialized" : "generic");
+	bool specialized = app->specializeMaterials;
+	BenchmarkPipelines pipelines = app->meshPipelineBuild;
+	renderFrames(app, frames, total);
+
+	if (config->abSpecialize)
+	{
+		app->specializeMaterials = false;
+		createMeshPipelines(app);
+		printf("Benchmark: again with generic materials\n");
+		genericFrames = calloc(total, sizeof(BenchmarkFrame));
+		renderFrames(app, genericFrames, total);
+	}
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicalDevice, &props);
+	char driverVersion[32];
+	snprintf(driverVersion, sizeof(driverVersion), "%u.%u.%u", VK_VERSION_MAJOR(props.driverVersion),
+	    VK_VERSION_MINOR(props.driverVersion), VK_VERSION_PATCH(props.driverVersion));
+
+	const DeviceMemoryStats* memory = deviceMemoryStats();
+	BenchmarkReport report = {
+	    .deviceName = props.deviceName,
+	    .deviceType = deviceTypeName(props.deviceType),
+	    .driverVersion = driverVersion,
+	    .width = (u32)app->width,
+	    .height = (u32)app->height,
+	    .warmupFrames = config->warmupFrames,
+	    .frames = frames + config->warmupFrames,
+	    .frameCount = config->frames,
+	    .gpuScopeNames = gpuScopeNames,
+	    .gpuScopeCount = GPU_TIMER_SCOPE_COUNT,
+	    .deviceMemoryBytes = memory->totalBytes,
+	    .deviceMemoryPeakBytes = memory->peakBytes,
+	    .deviceAllocations = memory->allocations,
+	    .hostPeakRssKb = benchmarkPeakRssKb(),
+	    .specialized = specialized,
+	    .pipelines = pipelines,
+	    .pipelineCreateMs = app->pipelineCreateMs,
+	    .pipelineCacheWarm = app->pipelineCacheWarm,
+	    .genericFrames = genericFrames ? genericFrames + config->warmupFrames : NULL,
+	    .genericPipelines = app->meshPipelineBuild,
+	};
+	bool written = benchmarkWriteJson(config->outputPath, &report);
+
+	BenchmarkSummary cpu;
+	double* values = malloc(config->frames * sizeof(double));
+	for (u32 i = 0; i < config->frames; ++i)
+		values[i] = report.frames[i].cpuMs;
+	benchmarkSummarize(values, config->frames, &cpu);
+	for (u32 i = 0; i < config->frames; ++i)
+		values[i] = report.frames[i].counterUs;
+	BenchmarkSummary counterUs;
+	benchmarkSummarize(values, config->frames, &counterUs);
+	if (counterUs.p95 > BENCHMARK_COUNTER_BUDGET_US)
+		fprintf(stderr, "Benchmark: the command counters cost %.1f us per frame (p95), over the %.0f us budget\n",
+		    counterUs.p95, BENCHMARK_COUNTER_BUDGET_US);
+	printf("Benchmark: CPU frame %.2f ms mean, %.2f ms p95; %llu MB device memory; %s %s\n", cpu.mean, cpu.p95,
+	    (unsigned long long)(memory->peakBytes >> 20), written ? "written to" : "failed to write", config->outputPath);
+
+	free(values);
+	free(genericFrames);
+	free(frames);
+	savePipelineCache(app, PIPELINE_CACHE_PATH);
+	if (!particlesMatch)
+		fprintf(stderr, "Benchmark: GPU particles differ from the CPU reference\n");
+	return written && particlesMatch;
+}
@@ -45,6 +45,30 @@ Buffer createStagingBuffer(Application* app, const void* data, VkDeviceSize size
 	return staging;
 }
 
+// Streams size bytes into dst one window-full at a time, waiting for each copy before the
+// window is refilled. Chunks are whole elements, so fill can convert data as it writes it.
+void uploadThroughStagingWindow(Application* app, Buffer* window, VkBuffer dst, VkDeviceSize size,
+    VkDeviceSize elementSize, StagingFillFn fill, void* userData)
+{
+	VkDeviceSize chunkSize = window->size / elementSize * elementSize;
+	assert(chunkSize > 0 && "staging window smaller than one element");
+	for (VkDeviceSize offset = 0; offset < size; offset += chunkSize)
+	{
+		VkDeviceSize bytes = size - offset < chunkSize ? size - offset : chunkSize;
+		fill(userData, window->data, offset, bytes);
+
+		VkCommandBuffer cmd = beginSingleTimeCommands(app);
+		VkBufferCopy region = {.srcOffset = 0, .dstOffset = offset, .size = bytes};
+		vkCmdCopyBuffer(cmd, window->vkbuffer, dst, 1, &region);
+		endSingleTimeCommands(app, cmd);
+	}
+}
+
+void stagingFillCopy(void* userData, void* dst, VkDeviceSize offset, VkDeviceSize size)
+{
+	memcpy(dst, (const u8*)userData + offset, size);
+}
+
 VkCommandBuffer beginSingleTimeCommands(Application* app)
 {
 	VkCommandBufferAllocateInfo allocInfo = {
@@ -115,6 +139,32 @@ void createBuffer(Application* app, Buffer* buffer, VkDeviceSize size, VkBufferU
 		VK_CHECK(vkMapMemory(app->device, buffer->memory, 0, size, 0, &buffer->data));
 	}
 }
+
+// GPU-only storage; not mapped, so fill it with transfers or from shaders
+void createDeviceLocalBuffer(Application* app, Buffer* buffer, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+	buffer->size = size;
+	buffer->data = NULL;
+
+	VkBufferCreateInfo bufferInfo = {
+	    .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+	    .size = size,
+	    .usage = usage,
+	    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+	};
+	VK_CHECK(vkCreateBuffer(app->device, &bufferInfo, NULL, &buffer->vkbuffer));
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(app->device, buffer->vkbuffer, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+	    .allocationSize = memRequirements.size,
+	    .memoryTypeIndex = findMemoryType(&app->memoryProperties, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+	};
+	VK_CHECK(vkAllocateMemory(app->device, &allocInfo, NULL, &buffer->memory));
+	VK_CHECK(vkBindBufferMemory(app->device, buffer->vkbuffer, buffer->memory, 0));
+}
 void transitionImageLayout(
     VkCommandBuffer cmd,
     VkImage image,
@@ -195,32 +245,36 @@ u32 selectmemorytype(
 }
 
 
-VkShaderModule LoadShaderModule(const char* filepath, VkDevice device)
+// Reads every file in one batch, then creates the modules in order
+void LoadShaderModules(FileIO* io, VkDevice device, const char* const* filepaths, u32 count, VkShaderModule* outModules)
 {
-	FILE* file = fopen(filepath, "rb");
-	assert(file);
+	FileRead reads[16] = {0};
+	assert(count <= ARRAYSIZE(reads));
+	for (u32 i = 0; i < count; ++i)
+		reads[i].path = filepaths[i];
+	fileioReadBatch(io, reads, count);
 
-	fseek(file, 0, SEEK_END);
-	long length = ftell(file);
-	assert(length >= 0);
-	fseek(file, 0, SEEK_SET);
-
-	char* buffer = (char*)malloc(length);
-	assert(buffer);
-
-	size_t rc = fread(buffer, 1, length, file);
-	assert(rc == (size_t)length);
-	fclose(file);
-
-	VkShaderModuleCreateInfo createInfo = {0};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = length;
-	createInfo.pCode = (const u32*)buffer;
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (reads[i].error != 0)
+		{
+			fprintf(stderr, "Failed to read shader %s: %s\n", filepaths[i], strerror(reads[i].error));
+			exit(1);
+		}
+		// malloc'd, so aligned for the u32 words SPIR-V is made of
+		VkShaderModuleCreateInfo createInfo = {0};
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = reads[i].bytesRead;
+		createInfo.pCode = (const u32*)reads[i].dst;
+		VK_CHECK(vkCreateShaderModule(device, &createInfo, NULL, &outModules[i]));
+		free(reads[i].dst);
+	}
+}
 
+VkShaderModule LoadShaderModule(FileIO* io, const char* filepath, VkDevice device)
+{
 	VkShaderModule shaderModule;
-	VK_CHECK(vkCreateShaderModule(device, &createInfo, NULL, &shaderModule));
-
-	free(buffer);
+	LoadShaderModules(io, device, &filepath, 1, &shaderModule);
 	return shaderModule;
 }
 
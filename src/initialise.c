@@ -1,7 +1,8 @@
 #include "main.h"
 #include <vulkan/vulkan_core.h>
 
-VkInstance createVulkanInstance(void)
+// Surface extensions come from GLFW; headless runs create no surface and don't initialise it
+VkInstance createVulkanInstance(bool enableSurface)
 {
 	VkApplicationInfo appInfo = {
 	    .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -24,8 +25,9 @@ VkInstance createVulkanInstance(void)
 #endif
 
 	u32 glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	const char** glfwExtensions = NULL;
+	if (enableSurface)
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
 	const char* extensions[16];
 	assert(glfwExtensionCount < 15);
@@ -48,6 +50,32 @@ VkInstance createVulkanInstance(void)
 	VK_CHECK(vkCreateInstance(&createInfo, NULL, &instance));
 	return instance;
 }
+static const char* physicalDeviceTypeName(VkPhysicalDeviceType type)
+{
+	switch (type)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "Discrete GPU";
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "Integrated GPU";
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "Virtual GPU";
+	case VK_PHYSICAL_DEVICE_TYPE_CPU: return "CPU";
+	default: return "Other";
+	}
+}
+
+// Higher is preferred. CPU implementations (lavapipe, SwiftShader) are a last resort, which is
+// what headless benchmark runs on machines without a GPU end up with.
+static int physicalDeviceRank(VkPhysicalDeviceType type)
+{
+	switch (type)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return 4;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 3;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return 2;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU: return 1;
+	default: return 0;
+	}
+}
+
 VkPhysicalDevice selectPhysicalDevice(VkInstance instance)
 {
 	VkPhysicalDevice physicalDevices[8];
@@ -55,17 +83,17 @@ VkPhysicalDevice selectPhysicalDevice(VkInstance instance)
 	VK_CHECK(vkEnumeratePhysicalDevices(instance, &count, physicalDevices));
 
 	VkPhysicalDevice selected = VK_NULL_HANDLE;
+	int selectedRank = 0;
 
 	for (u32 i = 0; i < count; ++i)
 	{
 		VkPhysicalDeviceProperties props;
 		vkGetPhysicalDeviceProperties(physicalDevices[i], &props);
 
-		if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ||
-		    props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
+		int rank = physicalDeviceRank(props.deviceType);
+		if (rank > 0)
 		{
-			printf("GPU%d: %s (%s)\n", i, props.deviceName,
-			    props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? "Discrete GPU" : "Integrated GPU");
+			printf("GPU%d: %s (%s)\n", i, props.deviceName, physicalDeviceTypeName(props.deviceType));
 			printf("  Vulkan API: %d.%d.%d\n",
 			    VK_VERSION_MAJOR(props.apiVersion),
 			    VK_VERSION_MINOR(props.apiVersion),
@@ -75,17 +103,17 @@ VkPhysicalDevice selectPhysicalDevice(VkInstance instance)
 			    VK_VERSION_MINOR(props.driverVersion),
 			    VK_VERSION_PATCH(props.driverVersion));
 
-			// Prefer discrete GPU
-			if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-				selected = physicalDevices[i];
-			else if (!selected)
+			if (rank > selectedRank)
+			{
 				selected = physicalDevices[i];
+				selectedRank = rank;
+			}
 		}
 	}
 
 	if (!selected)
 	{
-		fprintf(stderr, "No suitable GPU found (integrated or discrete only).\n");
+		fprintf(stderr, "No suitable Vulkan device found.\n");
 		exit(1);
 	}
 
@@ -94,7 +122,7 @@ VkPhysicalDevice selectPhysicalDevice(VkInstance instance)
 
 	printf("\n=== SELECTED GPU ===\n");
 	printf("Name: %s\n", props.deviceName);
-	printf("Type: %s\n", props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? "Discrete GPU" : "Integrated GPU");
+	printf("Type: %s\n", physicalDeviceTypeName(props.deviceType));
 	printf("Vendor ID: 0x%X\n", props.vendorID);
 	printf("Device ID: 0x%X\n", props.deviceID);
 	printf("Vulkan API: %d.%d.%d\n",
@@ -136,7 +164,57 @@ u32 find_graphics_queue_family_index(VkPhysicalDevice pickedPhysicalDevice)
 	free(queueFamilies);
 	return queuefamilyIndex;
 }
-VkDevice create_logical_device(VkPhysicalDevice pickedPhysicaldevice, u32 queueFamilyIndex)
+// Cull mode, front face and depth write/compare are dynamic in core 1.3
+bool supportsDynamicRasterState(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(physicalDevice, &props);
+	return props.apiVersion >= VK_API_VERSION_1_3;
+}
+
+// Per-draw color blend enable needs VK_EXT_extended_dynamic_state3
+bool supportsDynamicBlendEnable(VkPhysicalDevice physicalDevice)
+{
+	u32 count = 0;
+	VK_CHECK(vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &count, NULL));
+	VkExtensionProperties* extensions = malloc(count * sizeof(VkExtensionProperties));
+	VK_CHECK(vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &count, extensions));
+	bool found = false;
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (strcmp(extensions[i].extensionName, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME) == 0)
+			found = true;
+	}
+	free(extensions);
+	if (!found)
+		return false;
+
+	VkPhysicalDeviceExtendedDynamicState3FeaturesEXT eds3Features = {
+	    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+	};
+	VkPhysicalDeviceFeatures2 features2 = {
+	    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+	    .pNext = &eds3Features,
+	};
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+	return eds3Features.extendedDynamicState3ColorBlendEnable;
+}
+
+// The r8 path mask needs shaderStorageImageExtendedFormats for its format qualifier and
+// STORAGE_IMAGE support for R8_UNORM, neither of which the spec guarantees
+bool supportsR8StorageImage(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+	if (!features.shaderStorageImageExtendedFormats)
+		return false;
+
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8_UNORM, &props);
+	return (props.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
+VkDevice create_logical_device(VkPhysicalDevice pickedPhysicaldevice, u32 queueFamilyIndex, bool enableDynamicBlend, bool enableExtendedStorageFormats, bool enableSwapchain)
 {
 	float queuePriority = 1.0f;
 	VkDeviceQueueCreateInfo queueCreateInfo = {
@@ -147,15 +225,29 @@ VkDevice create_logical_device(VkPhysicalDevice pickedPhysicaldevice, u32 queueF
 	};
 
 	const char* deviceExtensions[] = {
-	    VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+	    VK_KHR_SWAPCHAIN_EXTENSION_NAME, // not needed headless, keep first
 	    VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
 	    VK_KHR_MAINTENANCE2_EXTENSION_NAME,
 	    VK_KHR_MULTIVIEW_EXTENSION_NAME,
 	    VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
-	    VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME};
+	    VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+	    VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME}; // optional, keep last
+
+	VkPhysicalDeviceExtendedDynamicState3FeaturesEXT eds3Features = {
+	    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+	    .extendedDynamicState3ColorBlendEnable = VK_TRUE,
+	};
+
+	// Render graph barriers are recorded with vkCmdPipelineBarrier2
+	VkPhysicalDeviceSynchronization2Features synchronization2Features = {
+	    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+	    .pNext = enableDynamicBlend ? &eds3Features : NULL,
+	    .synchronization2 = VK_TRUE,
+	};
 
 	VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures = {
 	    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES,
+	    .pNext = &synchronization2Features,
 	    .dynamicRendering = VK_TRUE,
 	};
 
@@ -163,6 +255,7 @@ VkDevice create_logical_device(VkPhysicalDevice pickedPhysicaldevice, u32 queueF
 	    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
 	    .features = {
 	        .samplerAnisotropy = VK_TRUE,
+	        .shaderStorageImageExtendedFormats = enableExtendedStorageFormats, // r8 path mask
 	    },
 	    .pNext = &dynamicRenderingFeatures,
 	};
@@ -172,8 +265,8 @@ VkDevice create_logical_device(VkPhysicalDevice pickedPhysicaldevice, u32 queueF
 	    .pNext = &features2,
 	    .queueCreateInfoCount = 1,
 	    .pQueueCreateInfos = &queueCreateInfo,
-	    .enabledExtensionCount = ARRAYSIZE(deviceExtensions),
-	    .ppEnabledExtensionNames = deviceExtensions,
+	    .enabledExtensionCount = ARRAYSIZE(deviceExtensions) - (enableDynamicBlend ? 0 : 1) - (enableSwapchain ? 0 : 1),
+	    .ppEnabledExtensionNames = deviceExtensions + (enableSwapchain ? 0 : 1),
 	};
 
 	VkDevice device;
@@ -231,6 +324,9 @@ VkSwapchainKHR createSwapchain(Application* app)
 	    .clipped = VK_TRUE,
 	    .queueFamilyIndexCount = 1,
 	    .pQueueFamilyIndices = &queueFamilyIndex,
+	    // On recreate, the retired swapchain (still alive in the deletion queue) hands over its
+	    // presentation resources
+	    .oldSwapchain = app->swapchain,
 	};
 	VkSwapchainKHR swapchain;
 	VK_CHECK(vkCreateSwapchainKHR(app->device, &swapchainInfo, 0, &swapchain));
@@ -238,7 +334,7 @@ VkSwapchainKHR createSwapchain(Application* app)
 }
 void createSwapchainViews(Application* app)
 {
-	app->swapchainImageViews = malloc(app->swapchainImageCount * sizeof(VkImageView));
+	app->swapchainImageViews = arenaAlloc(&app->swapchainArena, app->swapchainImageCount * sizeof(VkImageView));
 	for (u32 i = 0; i < app->swapchainImageCount; ++i)
 	{
 		VkImageViewCreateInfo viewInfo = {
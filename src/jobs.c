@@ -0,0 +1,420 @@
+#define _POSIX_C_SOURCE 200809L
+#include "jobs.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct Job
+{
+	JobFn fn;
+	void* data;
+	uint32_t begin, end;
+	JobCounter* counter;
+	struct Job* next; // in a counter's waiter list
+	atomic_bool live; // allocated and not yet finished
+} Job;
+
+// Chase-Lev deque (Le, Pop, Cohen, Zappa Nardelli 2013, C11 version) with a fixed ring.
+// The owner pushes and pops at bottom; thieves take from top.
+typedef struct JobDeque
+{
+	_Alignas(64) atomic_llong top;
+	_Alignas(64) atomic_llong bottom;
+	_Atomic(Job*) slots[JOBS_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct Worker
+{
+	JobDeque deque;
+	Job pool[JOBS_POOL_CAPACITY]; // ring, only allocated from by the owner
+	uint32_t poolNext;
+	uint32_t index;
+	uint32_t rng; // victim selection
+	struct JobSystem* js;
+	pthread_t thread;
+	_Alignas(64) atomic_ullong executed, stolen, sleeps;
+} Worker;
+
+struct JobSystem
+{
+	Worker* workers;
+	uint32_t workerCount;
+	atomic_bool running;
+
+	// Idle workers sleep here. Submitters only take the lock when someone is asleep.
+	atomic_uint sleeping;
+	pthread_mutex_t sleepMutex;
+	pthread_cond_t sleepCond;
+};
+
+static _Thread_local Worker* currentWorker;
+
+static bool dequePush(JobDeque* d, Job* job)
+{
+	long long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+	long long t = atomic_load_explicit(&d->top, memory_order_acquire);
+	if (b - t >= JOBS_DEQUE_CAPACITY)
+		return false;
+	atomic_store_explicit(&d->slots[b & (JOBS_DEQUE_CAPACITY - 1)], job, memory_order_relaxed);
+	// Publishes the job's fields along with the slot to the acquire in dequeSteal
+	atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+	return true;
+}
+
+static Job* dequePop(JobDeque* d)
+{
+	long long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+	if (t > b)
+	{
+		atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+		return NULL;
+	}
+	Job* job = atomic_load_explicit(&d->slots[b & (JOBS_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+	if (t == b)
+	{
+		// Last job: race the thieves for it
+		if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+			job = NULL;
+		atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+	}
+	return job;
+}
+
+static Job* dequeSteal(JobDeque* d)
+{
+	long long t = atomic_load_explicit(&d->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	long long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+	if (t >= b)
+		return NULL;
+	Job* job = atomic_load_explicit(&d->slots[t & (JOBS_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+		return NULL; // lost to another thief or the owner
+	return job;
+}
+
+static void runJob(Worker* w, Job* job);
+static Job* findJob(Worker* w);
+
+static Job* allocJob(Worker* w, JobFn fn, void* data, uint32_t begin, uint32_t end, JobCounter* counter)
+{
+	// Skip slots still queued or running; when every one is, help until one frees up. Jobs
+	// running further up this thread's stack never free while we wait, so no single slot
+	// is waited on.
+	Job* job = NULL;
+	while (!job)
+	{
+		for (uint32_t i = 0; i < JOBS_POOL_CAPACITY && !job; ++i)
+		{
+			Job* slot = &w->pool[w->poolNext++ & (JOBS_POOL_CAPACITY - 1)];
+			if (!atomic_load_explicit(&slot->live, memory_order_acquire))
+				job = slot;
+		}
+		if (!job)
+		{
+			Job* other = findJob(w);
+			if (other)
+				runJob(w, other);
+			else
+				sched_yield();
+		}
+	}
+	job->fn = fn;
+	job->data = data;
+	job->begin = begin;
+	job->end = end;
+	job->counter = counter;
+	job->next = NULL;
+	atomic_store_explicit(&job->live, true, memory_order_relaxed);
+	return job;
+}
+
+// Pairs with the fence in workerMain: either the sleeper sees the new job, or this sees the
+// sleeper. A sleeper holds the mutex from announcing itself until it waits, so the signal
+// can't land in between.
+static void wakeWorker(JobSystem* js)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&js->sleeping, memory_order_relaxed) == 0)
+		return;
+	pthread_mutex_lock(&js->sleepMutex);
+	pthread_cond_signal(&js->sleepCond);
+	pthread_mutex_unlock(&js->sleepMutex);
+}
+
+static void enqueue(Worker* w, Job* job)
+{
+	if (!dequePush(&w->deque, job))
+	{
+		runJob(w, job);
+		return;
+	}
+	wakeWorker(w->js);
+}
+
+// Queues every job held back on counter; the list is taken whole, so each is queued once
+static void releaseWaiters(Worker* w, JobCounter* counter)
+{
+	Job* job = atomic_exchange(&counter->waiters, NULL);
+	while (job)
+	{
+		Job* next = job->next;
+		enqueue(w, job);
+		job = next;
+	}
+}
+
+static void runJob(Worker* w, Job* job)
+{
+	job->fn(job->data, job->begin, job->end);
+	JobCounter* counter = job->counter;
+	atomic_store_explicit(&job->live, false, memory_order_release);
+	atomic_fetch_add_explicit(&w->executed, 1, memory_order_relaxed);
+	if (!counter)
+		return;
+	// Counters often live on the waiter's stack: hold it until the waiters are released,
+	// since the waiter can return as soon as pending reads zero
+	atomic_fetch_add(&counter->busy, 1);
+	if (atomic_fetch_sub(&counter->pending, 1) == 1)
+		releaseWaiters(w, counter);
+	atomic_fetch_sub_explicit(&counter->busy, 1, memory_order_release);
+}
+
+static uint32_t nextRandom(uint32_t* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+// Own deque first, then one pass over the others from a random start
+static Job* findJob(Worker* w)
+{
+	Job* job = dequePop(&w->deque);
+	if (job)
+		return job;
+	JobSystem* js = w->js;
+	uint32_t start = nextRandom(&w->rng) % js->workerCount;
+	for (uint32_t i = 0; i < js->workerCount; ++i)
+	{
+		Worker* victim = &js->workers[(start + i) % js->workerCount];
+		if (victim == w)
+			continue;
+		job = dequeSteal(&victim->deque);
+		if (job)
+		{
+			atomic_fetch_add_explicit(&w->stolen, 1, memory_order_relaxed);
+			return job;
+		}
+	}
+	return NULL;
+}
+
+static void* workerMain(void* userData)
+{
+	Worker* w = userData;
+	JobSystem* js = w->js;
+	currentWorker = w;
+
+	uint32_t idleRounds = 0;
+	while (atomic_load_explicit(&js->running, memory_order_acquire))
+	{
+		Job* job = findJob(w);
+		if (!job && ++idleRounds < JOBS_SPIN_ROUNDS)
+		{
+			sched_yield();
+			continue;
+		}
+
+		if (!job)
+		{
+			// Announce, then look once more before waiting; see wakeWorker
+			pthread_mutex_lock(&js->sleepMutex);
+			atomic_fetch_add(&js->sleeping, 1);
+			atomic_thread_fence(memory_order_seq_cst);
+			job = findJob(w);
+			if (!job && atomic_load(&js->running))
+			{
+				atomic_fetch_add_explicit(&w->sleeps, 1, memory_order_relaxed);
+				pthread_cond_wait(&js->sleepCond, &js->sleepMutex);
+			}
+			atomic_fetch_sub(&js->sleeping, 1);
+			pthread_mutex_unlock(&js->sleepMutex);
+		}
+		idleRounds = 0;
+		if (job)
+			runJob(w, job);
+	}
+	return NULL;
+}
+
+JobSystem* jobsCreate(uint32_t workerCount)
+{
+	if (workerCount == 0)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		workerCount = cpus > 0 ? (uint32_t)cpus : 1;
+	}
+	workerCount = workerCount < JOBS_MAX_WORKERS ? workerCount : JOBS_MAX_WORKERS;
+
+	JobSystem* js = calloc(1, sizeof(JobSystem));
+	// The deques want their cache line alignment
+	js->workers = aligned_alloc(64, workerCount * sizeof(Worker));
+	memset(js->workers, 0, workerCount * sizeof(Worker));
+	js->workerCount = workerCount;
+	atomic_store(&js->running, true);
+	pthread_mutex_init(&js->sleepMutex, NULL);
+	pthread_cond_init(&js->sleepCond, NULL);
+
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		Worker* w = &js->workers[i];
+		w->index = i;
+		w->rng = 0x9E3779B9u * (i + 1);
+		w->js = js;
+	}
+	currentWorker = &js->workers[0];
+	for (uint32_t i = 1; i < workerCount; ++i)
+		pthread_create(&js->workers[i].thread, NULL, workerMain, &js->workers[i]);
+	return js;
+}
+
+void jobsDestroy(JobSystem* js)
+{
+	if (!js)
+		return;
+	// Sleepers check running under the mutex, so none can miss this broadcast
+	atomic_store_explicit(&js->running, false, memory_order_release);
+	pthread_mutex_lock(&js->sleepMutex);
+	pthread_cond_broadcast(&js->sleepCond);
+	pthread_mutex_unlock(&js->sleepMutex);
+	for (uint32_t i = 1; i < js->workerCount; ++i)
+		pthread_join(js->workers[i].thread, NULL);
+
+	if (currentWorker && currentWorker->js == js)
+		currentWorker = NULL;
+	pthread_cond_destroy(&js->sleepCond);
+	pthread_mutex_destroy(&js->sleepMutex);
+	free(js->workers);
+	free(js);
+}
+
+uint32_t jobsWorkerCount(const JobSystem* js)
+{
+	return js ? js->workerCount : 1;
+}
+
+JobStats jobsStats(const JobSystem* js)
+{
+	JobStats stats = {0};
+	for (uint32_t i = 0; i < js->workerCount; ++i)
+	{
+		stats.executed += atomic_load_explicit(&js->workers[i].executed, memory_order_relaxed);
+		stats.stolen += atomic_load_explicit(&js->workers[i].stolen, memory_order_relaxed);
+		stats.sleeps += atomic_load_explicit(&js->workers[i].sleeps, memory_order_relaxed);
+	}
+	return stats;
+}
+
+static Worker* callingWorker(JobSystem* js)
+{
+	Worker* w = currentWorker;
+	assert(w && w->js == js && "jobs can only be submitted from a worker of this system");
+	(void)js;
+	return w;
+}
+
+void jobsRun(JobSystem* js, JobFn fn, void* data, uint32_t count, JobCounter* counter)
+{
+	Worker* w = callingWorker(js);
+	if (counter)
+		atomic_fetch_add(&counter->pending, count);
+	for (uint32_t i = 0; i < count; ++i)
+		enqueue(w, allocJob(w, fn, data, i, i + 1, counter));
+}
+
+void jobsRunAfter(JobSystem* js, JobCounter* dependency, JobFn fn, void* data, uint32_t count, JobCounter* counter)
+{
+	Worker* w = callingWorker(js);
+	if (counter)
+		atomic_fetch_add(&counter->pending, count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		Job* job = allocJob(w, fn, data, i, i + 1, counter);
+		job->next = atomic_load(&dependency->waiters);
+		while (!atomic_compare_exchange_weak(&dependency->waiters, &job->next, job))
+			;
+	}
+	// The dependency may have finished while the jobs were being added; whoever takes the
+	// list first queues them
+	if (atomic_load(&dependency->pending) == 0)
+		releaseWaiters(w, dependency);
+}
+
+void jobsWait(JobSystem* js, JobCounter* counter)
+{
+	Worker* w = callingWorker(js);
+	while (atomic_load_explicit(&counter->pending, memory_order_acquire) != 0)
+	{
+		Job* job = findJob(w);
+		if (job)
+			runJob(w, job);
+		else
+			sched_yield();
+	}
+	while (atomic_load_explicit(&counter->busy, memory_order_acquire) != 0)
+		sched_yield();
+}
+
+bool jobsRunOne(JobSystem* js)
+{
+	Worker* w = callingWorker(js);
+	Job* job = findJob(w);
+	if (!job)
+		return false;
+	runJob(w, job);
+	return true;
+}
+
+typedef struct ParallelFor
+{
+	JobFn fn;
+	void* data;
+	uint32_t count, grain;
+} ParallelFor;
+
+static void parallelForRange(void* data, uint32_t begin, uint32_t end)
+{
+	const ParallelFor* pf = data;
+	(void)end;
+	uint32_t first = begin * pf->grain;
+	uint32_t last = first + pf->grain < pf->count ? first + pf->grain : pf->count;
+	pf->fn(pf->data, first, last);
+}
+
+void jobsParallelFor(JobSystem* js, uint32_t count, uint32_t grain, JobFn fn, void* data)
+{
+	grain = grain > 0 ? grain : 1;
+	uint32_t ranges = (count + grain - 1) / grain;
+	if (!js || ranges <= 1)
+	{
+		if (count > 0)
+			fn(data, 0, count);
+		return;
+	}
+
+	// The caller takes the last range itself instead of waiting idle
+	ParallelFor pf = {fn, data, count, grain};
+	JobCounter counter = {0};
+	jobsRun(js, parallelForRange, &pf, ranges - 1, &counter);
+	parallelForRange(&pf, ranges - 1, ranges);
+	jobsWait(js, &counter);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Work-stealing job system.
+// One worker per hardware thread; the thread that creates the system is worker 0 and only
+// runs jobs while it waits on a counter. Each worker owns a Chase-Lev deque: it pushes and
+// pops its own end without locks, idle workers steal from the other end with one CAS.
+// Jobs are plain function pointers over an index range, so a batch of count jobs or a
+// parallel for is one call.
+//
+// Completion is tracked with counters: every job submitted with a counter bumps it, and the
+// counter drops back to zero once they have all run. A batch can be held back until another
+// counter reaches zero (jobsRunAfter), which is how dependencies are expressed.
+// Submitting and waiting are only allowed from worker threads, including worker 0.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define JOBS_MAX_WORKERS 64
+#define JOBS_DEQUE_CAPACITY 4096 // per worker, power of two; a full deque runs the job inline
+#define JOBS_POOL_CAPACITY 8192  // per worker, power of two; past that, submitting helps run jobs
+#define JOBS_SPIN_ROUNDS 64      // failed steal rounds before an idle worker sleeps
+
+struct Job;
+
+typedef void (*JobFn)(void* data, uint32_t begin, uint32_t end);
+
+typedef struct JobCounter
+{
+	atomic_uint pending;
+	atomic_uint busy;             // finishing jobs still touching the counter
+	_Atomic(struct Job*) waiters; // jobs held back until pending reaches zero
+} JobCounter;
+
+typedef struct JobStats
+{
+	uint64_t executed;
+	uint64_t stolen;
+	uint64_t sleeps;
+} JobStats;
+
+typedef struct JobSystem JobSystem;
+
+// workerCount 0 picks one per hardware thread
+JobSystem* jobsCreate(uint32_t workerCount);
+void jobsDestroy(JobSystem* js);
+uint32_t jobsWorkerCount(const JobSystem* js);
+// Summed over the workers; approximate while jobs are running
+JobStats jobsStats(const JobSystem* js);
+
+// Queues count jobs; job i gets the range [i, i + 1). counter may be NULL.
+void jobsRun(JobSystem* js, JobFn fn, void* data, uint32_t count, JobCounter* counter);
+// Same, but the jobs are only queued once dependency reaches zero. dependency must stay
+// alive until then; waiting on counter covers that when the dependency feeds it.
+void jobsRunAfter(JobSystem* js, JobCounter* dependency, JobFn fn, void* data, uint32_t count, JobCounter* counter);
+// Runs queued jobs on the calling worker until counter reaches zero
+void jobsWait(JobSystem* js, JobCounter* counter);
+// Runs at most one queued job on the calling worker; false when none was found. Lets worker 0
+// move background work along between frames when it is the only worker.
+bool jobsRunOne(JobSystem* js);
+
+// Splits [0, count) into ranges of at most grain and waits for all of them. With a NULL
+// system, or a single range, it runs inline.
+void jobsParallelFor(JobSystem* js, uint32_t count, uint32_t grain, JobFn fn, void* data);
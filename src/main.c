@@ -31,122 +31,102 @@
 // set layout is passed to pipeline layout while inialising a pipeline
 // --- Vulkan Helpers ---
 
-void createDepthResources(Application* app)
-{
-	app->depthFormat = findDepthFormat(app->physicalDevice);
-
-	VkImageCreateInfo imageInfo = {
-	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-	    .imageType = VK_IMAGE_TYPE_2D,
-	    .format = app->depthFormat,
-	    .extent = {app->width, app->height, 1},
-	    .mipLevels = 1,
-	    .arrayLayers = 1,
-	    .samples = VK_SAMPLE_COUNT_1_BIT,
-	    .tiling = VK_IMAGE_TILING_OPTIMAL,
-	    .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-	    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-	    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
-
-	VK_CHECK(vkCreateImage(app->device, &imageInfo, NULL, &app->depthImage));
-
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(app->device, app->depthImage, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo = {
-	    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-	    .allocationSize = memRequirements.size,
-	    .memoryTypeIndex = selectmemorytype(&app->memoryProperties, memRequirements.memoryTypeBits,
-	        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)};
-
-	VK_CHECK(vkAllocateMemory(app->device, &allocInfo, NULL, &app->depthImageMemory));
-	VK_CHECK(vkBindImageMemory(app->device, app->depthImage, app->depthImageMemory, 0));
-
-	VkImageViewCreateInfo viewInfo = {
-	    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-
-	    .image = app->depthImage,
-	    .viewType = VK_IMAGE_VIEW_TYPE_2D,
-	    .format = app->depthFormat,
-
-	    .subresourceRange = {
-	        .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
-	        .baseMipLevel = 0,
-	        .levelCount = 1,
-	        .baseArrayLayer = 0,
-	        .layerCount = 1}};
-
-	VK_CHECK(vkCreateImageView(app->device, &viewInfo, NULL, &app->depthImageView));
-}
 void createSwapchainRelatedResources(Application* app)
 {
 	// Create swapchain
 	app->swapchainFormat = VK_FORMAT_B8G8R8A8_SRGB;
 	app->swapchainColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+
+	// The depth image itself is a frame graph transient, created in buildFrameGraph
+	app->depthFormat = findDepthFormat(app->physicalDevice);
+
+	// Headless: a single offscreen image in the same format, never presented
+	if (app->headless)
+	{
+		createOffscreenTarget(app);
+		createSwapchainViews(app);
+		return;
+	}
+
 	app->swapchain = createSwapchain(app);
 
 	// Get swapchain images
 	VK_CHECK(vkGetSwapchainImagesKHR(app->device, app->swapchain, &app->swapchainImageCount, NULL));
-	app->swapchainImages = malloc(app->swapchainImageCount * sizeof(VkImage));
+	app->swapchainImages = arenaAlloc(&app->swapchainArena, app->swapchainImageCount * sizeof(VkImage));
 	VK_CHECK(vkGetSwapchainImagesKHR(app->device, app->swapchain, &app->swapchainImageCount, app->swapchainImages));
 	createSwapchainViews(app);
 
-	// Track swapchain image layouts
-	app->swapchainImageLayouts = malloc(app->swapchainImageCount * sizeof(VkImageLayout));
-	for (u32 i = 0; i < app->swapchainImageCount; ++i)
-	{
-		app->swapchainImageLayouts[i] = VK_IMAGE_LAYOUT_UNDEFINED;
-	}
-
-	// Create depth resources
-	createDepthResources(app);
-
-	app->imageReleaseSemaphore = malloc(app->swapchainImageCount * sizeof(VkSemaphore));
-	app->sceneDoneSemaphores = malloc(app->swapchainImageCount * sizeof(VkSemaphore));
-	app->presentReadySemaphores = malloc(app->swapchainImageCount * sizeof(VkSemaphore));
-	// Allocate per-image present command buffers
-	app->presentCmdBuffers = malloc(app->swapchainImageCount * sizeof(VkCommandBuffer));
-	VkCommandBufferAllocateInfo presentAllocInfo = {
-	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-	    .commandPool = app->commandPool,
-	    .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-	    .commandBufferCount = app->swapchainImageCount,
-	};
-	VK_CHECK(vkAllocateCommandBuffers(app->device, &presentAllocInfo, app->presentCmdBuffers));
+	// One semaphore per image: signaled by the frame's single submit, waited on by present
+	app->imageReleaseSemaphore = arenaAlloc(&app->swapchainArena, app->swapchainImageCount * sizeof(VkSemaphore));
 	for (u32 i = 0; i < app->swapchainImageCount; i++)
 	{
 		app->imageReleaseSemaphore[i] = createSemaphore(app->device);
-		app->sceneDoneSemaphores[i] = createSemaphore(app->device);
-		app->presentReadySemaphores[i] = createSemaphore(app->device);
 	}
 }
 
-void createModelAndBuffers(Application* app)
+// Each stream is decoded from the glTF buffers straight into the staging window on the
+// job system, one window's worth at a time
+static void fillVertices(void* userData, void* dst, VkDeviceSize offset, VkDeviceSize size)
 {
-	// === Load model ===
-//	 loadGltfModel("/home/lka/myprojects/vulkantest3/sponza/Sponza.gltf", &app->mesh);
-	//
-	//
-	loadGltfModel("data/shibahu/scene.gltf", &app->mesh);
+	Application* app = userData;
+	gltfDecodeVertices(&app->mesh, app->jobs, (u32)(offset / sizeof(Vertex)), (u32)(size / sizeof(Vertex)), dst);
+}
 
-	// === Vertex buffer ===
+static void fillIndices(void* userData, void* dst, VkDeviceSize offset, VkDeviceSize size)
+{
+	Application* app = userData;
+	gltfDecodeIndices(&app->mesh, app->jobs, (u32)(offset / sizeof(u32)), (u32)(size / sizeof(u32)), dst);
+}
+
+// The depth prepass stream
+static void fillPositions(void* userData, void* dst, VkDeviceSize offset, VkDeviceSize size)
+{
+	Application* app = userData;
+	gltfDecodePositions(&app->mesh, app->jobs, (u32)(offset / sizeof(vec3)), (u32)(size / sizeof(vec3)), dst);
+}
+
+// Runs when the model arrives from the asset loader; until then nothing binds these. Every
+// stream goes through one fixed-size window, so the mesh never exists as a whole on the CPU.
+void createMeshBuffers(Application* app)
+{
+	double start = benchmarkNowMs();
+	u64 rssBefore = benchmarkPeakRssKb();
 	VkDeviceSize vertexSize = app->mesh.vertex_count * sizeof(Vertex);
-	Buffer vertexStaging = createStagingBuffer(app, app->mesh.vertices, vertexSize);
-	createBuffer(app, &app->vertexBuffer, vertexSize,
+	VkDeviceSize indexSize = app->mesh.index_count * sizeof(u32);
+	VkDeviceSize positionSize = app->mesh.vertex_count * sizeof(vec3);
+
+	VkDeviceSize windowSize = vertexSize > indexSize ? vertexSize : indexSize;
+	if (windowSize > MESH_UPLOAD_WINDOW_BYTES)
+		windowSize = MESH_UPLOAD_WINDOW_BYTES;
+	Buffer window;
+	createBuffer(app, &window, windowSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+	// === Vertex buffer ===
+	createDeviceLocalBuffer(app, &app->vertexBuffer, vertexSize,
 	    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-	copyBufferToDeviceLocal(app->device, app->commandPool, app->graphicsQueue,
-	    vertexStaging.vkbuffer, app->vertexBuffer.vkbuffer, vertexSize);
-	destroyBuffer(app->device, &vertexStaging);
+	uploadThroughStagingWindow(app, &window, app->vertexBuffer.vkbuffer, vertexSize, sizeof(Vertex),
+	    fillVertices, app);
 
 	// === Index buffer ===
-	VkDeviceSize indexSize = app->mesh.index_count * sizeof(u32);
-	Buffer indexStaging = createStagingBuffer(app, app->mesh.indices, indexSize);
-	createBuffer(app, &app->indexBuffer, indexSize,
+	createDeviceLocalBuffer(app, &app->indexBuffer, indexSize,
 	    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-	copyBufferToDeviceLocal(app->device, app->commandPool, app->graphicsQueue,
-	    indexStaging.vkbuffer, app->indexBuffer.vkbuffer, indexSize);
-	destroyBuffer(app->device, &indexStaging);
+	uploadThroughStagingWindow(app, &window, app->indexBuffer.vkbuffer, indexSize, sizeof(u32),
+	    fillIndices, app);
+
+	// === Position-only stream for the depth prepass ===
+	createDeviceLocalBuffer(app, &app->positionBuffer, positionSize,
+	    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	uploadThroughStagingWindow(app, &window, app->positionBuffer.vkbuffer, positionSize, sizeof(vec3),
+	    fillPositions, app);
 
+	destroyBuffer(app->device, &window);
+	printf("Mesh: %u vertices, %u indices decoded and uploaded in %.1f ms (peak RSS %.1f -> %.1f MiB)\n",
+	    app->mesh.vertex_count, app->mesh.index_count, benchmarkNowMs() - start,
+	    (double)rssBefore / 1024.0, (double)benchmarkPeakRssKb() / 1024.0);
+}
+
+void createSkyboxVertexBuffer(Application* app)
+{
 	// === Skybox vertex buffer ===
 	float skyboxVertices[] = {
 	    // positions
@@ -199,74 +179,60 @@ void createModelAndBuffers(Application* app)
 	destroyBuffer(app->device, &skyboxVertexStaging);
 }
 
+// Every material starts out on 1x1 placeholders: white base color and metallic-roughness (the
+// factors alone), black emissive. Real textures are requested from the asset loader and swapped
+// in per material once all of its textures have arrived.
 void createTextureResources(Application* app)
 {
-    app->texture_count = app->mesh.material_count;
-    app->baseColorTextures = calloc(app->texture_count, sizeof(Texture));
-    app->metallicRoughnessTextures = calloc(app->texture_count, sizeof(Texture));
-    app->emissiveTextures = calloc(app->texture_count, sizeof(Texture));
-	app->materialUniformBuffers = calloc(app->texture_count, sizeof(Buffer));
-
-    for (u32 i = 0; i < app->texture_count; ++i)
-    {
-        u32 mipLevels;
-		if (app->mesh.materials[i].hasBaseColorTexture)
-        {
-			createTextureImage(app, app->mesh.materials[i].baseColorTexturePath, &app->baseColorTextures[i], &mipLevels, VK_FORMAT_R8G8B8A8_SRGB);
-        }
-        else
-        {
-            createDummyTexture(app, &app->baseColorTextures[i], &mipLevels);
-        }
-        createTextureSampler(app, &app->baseColorTextures[i], mipLevels);
-
-		if (app->mesh.materials[i].hasMetallicRoughnessTexture)
-        {
-			createTextureImage(app, app->mesh.materials[i].metallicRoughnessTexturePath, &app->metallicRoughnessTextures[i], &mipLevels, VK_FORMAT_R8G8B8A8_UNORM);
-        }
-        else
-        {
-            createDummyTexture(app, &app->metallicRoughnessTextures[i], &mipLevels);
-        }
-        createTextureSampler(app, &app->metallicRoughnessTextures[i], mipLevels);
-
-		if (app->mesh.materials[i].hasEmissiveTexture)
-        {
-			createTextureImage(app, app->mesh.materials[i].emissiveTexturePath, &app->emissiveTextures[i], &mipLevels, VK_FORMAT_R8G8B8A8_SRGB);
-        }
-        else
-        {
-            createDummyTexture(app, &app->emissiveTextures[i], &mipLevels);
-        }
-        createTextureSampler(app, &app->emissiveTextures[i], mipLevels);
-
-	// Create and upload per-material UBO
-	MaterialGPU m = {0};
-	memcpy(m.baseColorFactor, app->mesh.materials[i].baseColorFactor, sizeof(vec4));
-	m.emissiveFactor[0] = app->mesh.materials[i].emissiveFactor[0];
-	m.emissiveFactor[1] = app->mesh.materials[i].emissiveFactor[1];
-	m.emissiveFactor[2] = app->mesh.materials[i].emissiveFactor[2];
-	m.mr_ac_am[0] = app->mesh.materials[i].metallicFactor;
-	m.mr_ac_am[1] = app->mesh.materials[i].roughnessFactor;
-	m.mr_ac_am[2] = app->mesh.materials[i].alphaCutoff;
-	m.mr_ac_am[3] = (float)app->mesh.materials[i].alphaMode;
-	m.hasFlags[0] = app->mesh.materials[i].hasBaseColorTexture;
-	m.hasFlags[1] = app->mesh.materials[i].hasMetallicRoughnessTexture;
-	m.hasFlags[2] = app->mesh.materials[i].hasEmissiveTexture;
-	m.hasFlags[3] = 0; // reserved for per-material shading mode override (0=PBR by default)
-
-	createBuffer(app, &app->materialUniformBuffers[i], sizeof(MaterialGPU), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-	memcpy(app->materialUniformBuffers[i].data, &m, sizeof(MaterialGPU));
-    }
+	assetsPrepareMaterials(app, app->mesh.material_count);
+
+	for (u32 i = 0; i < app->mesh.material_count; ++i)
+	{
+		Material* material = &app->mesh.materials[i];
+		material->handle = resourcesAddMaterial(app);
+
+		Texture placeholders[MATERIAL_TEXTURE_SLOT_COUNT] = {0};
+		u32 mipLevels;
+		createDummyTexture(app, &placeholders[MATERIAL_TEXTURE_BASE_COLOR], &mipLevels);
+		createTextureSampler(app, &placeholders[MATERIAL_TEXTURE_BASE_COLOR], mipLevels);
+		createDummyTexture(app, &placeholders[MATERIAL_TEXTURE_METALLIC_ROUGHNESS], &mipLevels);
+		createTextureSampler(app, &placeholders[MATERIAL_TEXTURE_METALLIC_ROUGHNESS], mipLevels);
+		createSolidTexture(app, &placeholders[MATERIAL_TEXTURE_EMISSIVE], &mipLevels, (const u8[4]){0, 0, 0, 255});
+		createTextureSampler(app, &placeholders[MATERIAL_TEXTURE_EMISSIVE], mipLevels);
+		for (u32 slot = 0; slot < MATERIAL_TEXTURE_SLOT_COUNT; ++slot)
+		{
+			ImageHandle oldImage;
+			SamplerHandle oldSampler;
+			resourcesSetMaterialTexture(app, material->handle, (MaterialTextureSlot)slot, &placeholders[slot], &oldImage, &oldSampler);
+		}
+
+		if (material->hasBaseColorTexture)
+			assetsLoadTexture(app, material->baseColorTexturePath, i, MATERIAL_TEXTURE_BASE_COLOR);
+		if (material->hasMetallicRoughnessTexture)
+			assetsLoadTexture(app, material->metallicRoughnessTexturePath, i, MATERIAL_TEXTURE_METALLIC_ROUGHNESS);
+		if (material->hasEmissiveTexture)
+			assetsLoadTexture(app, material->emissiveTexturePath, i, MATERIAL_TEXTURE_EMISSIVE);
+	}
+	materials_build_gpu_ubos(app);
 }
 
 void createUniformBuffers(Application* app)
 {
-	createBuffer(app, &app->uniformBuffer, sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicalDevice, &props);
+	VkDeviceSize alignment = props.limits.minUniformBufferOffsetAlignment;
+	app->uniformStride = (sizeof(UniformBufferObject) + alignment - 1) & ~(alignment - 1);
+	createBuffer(app, &app->uniformBuffer, app->uniformStride * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 	createBuffer(app, &app->baseColorBuffer, sizeof(vec4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 	createBuffer(app, &app->hasTextureBuffer, sizeof(int), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 	createBuffer(app, &app->alphaCutoffBuffer, sizeof(float), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-	createBuffer(app, &app->skyboxUniformBuffer, sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	createBuffer(app, &app->skyboxUniformBuffer, app->uniformStride * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+}
+
+// Dynamic offset of the current frame's copy in uniformBuffer and skyboxUniformBuffer
+u32 frameUniformOffset(const Application* app)
+{
+	return (u32)(app->currentFrame * app->uniformStride);
 }
 
 void createCommandPoolAndBuffer(Application* app, u32 queueFamilyIndex)
@@ -288,15 +254,6 @@ void createCommandPoolAndBuffer(Application* app, u32 queueFamilyIndex)
 	    .commandBufferCount = MAX_FRAMES_IN_FLIGHT,
 	};
 	VK_CHECK(vkAllocateCommandBuffers(app->device, &cmdAllocInfo, app->commandBuffers));
-
-	// Allocate a dedicated compute command buffer (from the same pool)
-	VkCommandBufferAllocateInfo computeAllocInfo = {
-	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-	    .commandPool = app->commandPool,
-	    .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-	    .commandBufferCount = 1,
-	};
-	VK_CHECK(vkAllocateCommandBuffers(app->device, &computeAllocInfo, &app->computeCmdBuffer));
 }
 
 void createPipeline(Application* app)
@@ -312,31 +269,490 @@ void createPipeline(Application* app)
 	VK_CHECK(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &app->pipelineLayout));
 
 	// Load shaders
-	app->vertShaderModule = LoadShaderModule("compiledshaders/tri.vert.spv", app->device);
-	app->fragShaderModule = LoadShaderModule("compiledshaders/tri.frag.spv", app->device);
+	const char* shaderPaths[] = {
+	    "compiledshaders/tri.vert.spv",
+	    "compiledshaders/tri.frag.spv",
+	    "compiledshaders/depth_only.vert.spv",
+	    "compiledshaders/depth_mask.frag.spv",
+	};
+	VkShaderModule shaderModules[ARRAYSIZE(shaderPaths)];
+	LoadShaderModules(app->io, app->device, shaderPaths, ARRAYSIZE(shaderPaths), shaderModules);
+	app->vertShaderModule = shaderModules[0];
+	app->fragShaderModule = shaderModules[1];
+	app->depthOnlyVertShaderModule = shaderModules[2];
+	app->depthMaskFragShaderModule = shaderModules[3];
+
+	createMeshPipelines(app);
+}
 
-	// Create pipelines for each material
-	    
-    app->pipelines = calloc(app->mesh.material_count, sizeof(VkPipeline));
+// Mesh pipelines bake the prepass mode, the material permutation and (when specialized) the
+// shading model into their state. Every material is mapped onto a key; variants missing from
+// the permutation cache are compiled in parallel, existing ones are reused. Nothing is
+// destroyed here, so settings can change while earlier frames are still in flight.
+void createMeshPipelines(Application* app)
+{
+	u32 materialCount = app->mesh.material_count;
 
-	for (u32 i = 0; i < app->mesh.material_count; ++i)
+	u32 firstNew = app->meshPipelineCount;
+	u32 lookups = 0;
+	u32* shadedIndex = malloc(materialCount * sizeof(u32));
+	u32* prepassIndex = malloc(materialCount * sizeof(u32));
+	for (u32 i = 0; i < materialCount; ++i)
+	{
+		Material* material = &app->mesh.materials[i];
+		MeshPipelineKey key;
+		memset(&key, 0, sizeof(key));
+		key.kind = MESH_PIPELINE_SHADED;
+		key.doubleSided = material->doubleSided;
+		key.blended = material->alphaMode == 2;
+		key.depthPrepass = app->depthPrepassEnabled;
+		key.vertShader = app->vertShaderModule;
+		key.fragShader = app->fragShaderModule;
+		key.colorFormat = HDR_COLOR_FORMAT;
+		key.depthFormat = app->depthFormat;
+		// Whatever is dynamic stays out of the key, so those materials collapse onto one pipeline
+		key.dynamicState = (app->dynamicRasterState ? MESH_DYNAMIC_RASTER : 0) | (app->dynamicBlendEnable ? MESH_DYNAMIC_BLEND : 0);
+		if (app->dynamicRasterState)
+		{
+			key.doubleSided = 0;
+			key.depthPrepass = 0;
+		}
+		if (app->dynamicBlendEnable)
+			key.blended = 0;
+		for (u32 c = 0; c < MESH_SPEC_COUNT; ++c)
+			key.spec[c] = -1;
+		if (app->specializeMaterials)
+		{
+			key.spec[MESH_SPEC_HAS_BASE_COLOR] = material->hasBaseColorTexture ? 1 : 0;
+			key.spec[MESH_SPEC_HAS_METALLIC_ROUGHNESS] = material->hasMetallicRoughnessTexture ? 1 : 0;
+			key.spec[MESH_SPEC_HAS_EMISSIVE] = material->hasEmissiveTexture ? 1 : 0;
+			key.spec[MESH_SPEC_ALPHA_MODE] = material->alphaMode;
+			key.spec[MESH_SPEC_SHADING_MODEL] = app->stylizedMode;
+		}
+		shadedIndex[i] = findOrAddMeshPipeline(app, &key);
+		lookups++;
+
+		prepassIndex[i] = UINT32_MAX;
+		if (!app->depthPrepassEnabled || material->alphaMode == 2)
+			continue;
+		bool masked = material->alphaMode == 1;
+		memset(&key, 0, sizeof(key));
+		key.kind = masked ? MESH_PIPELINE_PREPASS_MASKED : MESH_PIPELINE_PREPASS_OPAQUE;
+		key.dynamicState = app->dynamicRasterState ? MESH_DYNAMIC_RASTER : 0;
+		key.doubleSided = app->dynamicRasterState ? 0 : material->doubleSided;
+		key.vertShader = masked ? app->vertShaderModule : app->depthOnlyVertShaderModule;
+		key.fragShader = masked ? app->depthMaskFragShaderModule : VK_NULL_HANDLE;
+		key.colorFormat = HDR_COLOR_FORMAT;
+		key.depthFormat = app->depthFormat;
+		prepassIndex[i] = findOrAddMeshPipeline(app, &key);
+		lookups++;
+	}
+
+	double start = benchmarkNowMs();
+	compileMeshPipelines(app, firstNew, PIPELINE_COMPILE_MAX_THREADS);
+	u32 built = app->meshPipelineCount - firstNew;
+	app->meshPipelineBuild = (BenchmarkPipelines){app->meshPipelineCount, built, lookups - built, benchmarkNowMs() - start};
+	printf("Mesh pipelines: %u new, %u reused, %u variants cached for %u materials (%.1f ms)\n",
+	    built, lookups - built, app->meshPipelineCount, materialCount, app->meshPipelineBuild.buildMs);
+
+	// Workers only fill in the VkPipelines; the registry is main thread only
+	for (u32 i = firstNew; i < app->meshPipelineCount; ++i)
+		app->meshPipelineEntries[i].handle = resourcesAddPipeline(app, app->meshPipelineEntries[i].pipeline);
+
+	MaterialPool* materials = &app->resources.materials;
+	for (u32 i = 0; i < materialCount; ++i)
+	{
+		u32 index = resourcesMaterialIndex(app, app->mesh.materials[i].handle);
+		materials->pipelines[index] = app->meshPipelineEntries[shadedIndex[i]].handle;
+		materials->prepassPipelines[index] = prepassIndex[i] != UINT32_MAX ? app->meshPipelineEntries[prepassIndex[i]].handle : (PipelineHandle){0};
+	}
+	app->meshPipelineStylizedMode = app->stylizedMode;
+	free(shadedIndex);
+	free(prepassIndex);
+}
+
+void destroyMeshPipelines(Application* app)
+{
+	for (u32 i = 0; i < app->meshPipelineCount; ++i)
+		resourcesDestroyPipeline(app, app->meshPipelineEntries[i].handle);
+	free(app->meshPipelineEntries);
+	app->meshPipelineEntries = NULL;
+	app->meshPipelineCount = 0;
+	app->meshPipelineCapacity = 0;
+}
+
+// --- Occlusion Culling ---
+
+void initOcclusionCulling(Application* app)
+{
+	occlusionInit(&app->occlusion, OCCLUSION_WIDTH, OCCLUSION_HEIGHT, 4);
+	app->primitiveVisible = malloc(app->mesh.primitive_count * sizeof(bool));
+	memset(app->primitiveVisible, 1, app->mesh.primitive_count * sizeof(bool));
+	app->occlusionEnabled = true;
+
+	// Only opaque primitives can hide anything; masked and blended ones have holes. They are
+	// ranked by area from the glTF source, and only the chosen ones' positions are decoded.
+	u32 count = app->mesh.primitive_count ? app->mesh.primitive_count : 1;
+	float* primitiveAreas = malloc(count * sizeof(float));
+	gltfPrimitiveAreas(&app->mesh, app->jobs, primitiveAreas);
+
+	OccluderSource* sources = malloc(count * sizeof(OccluderSource));
+	float* areas = malloc(count * sizeof(float));
+	u32* sourcePrimitives = malloc(count * sizeof(u32));
+	u32 sourceCount = 0;
+	for (u32 i = 0; i < app->mesh.primitive_count; ++i)
+	{
+		Primitive* prim = &app->mesh.primitives[i];
+		int mat = prim->material_index;
+		if (mat >= 0 && (u32)mat < app->mesh.material_count && app->mesh.materials[mat].alphaMode != 0)
+			continue;
+		sources[sourceCount] = (OccluderSource){prim->first_index, prim->index_count};
+		areas[sourceCount] = primitiveAreas[i];
+		sourcePrimitives[sourceCount++] = i;
+	}
+
+	bool* selected = malloc(count * sizeof(bool));
+	u32 triangles = occlusionRankOccluders(areas, sources, sourceCount, OCCLUSION_DEFAULT_TRIANGLE_BUDGET, selected);
+	float* dst = occlusionReserveOccluders(&app->occlusion, triangles);
+	for (u32 s = 0; s < sourceCount; ++s)
+	{
+		if (!selected[s])
+			continue;
+		gltfPrimitiveTriangles(&app->mesh, sourcePrimitives[s], dst);
+		dst += (size_t)(sources[s].indexCount / 3) * 9;
+	}
+	printf("Occlusion: %u occluder triangles from %u opaque primitives (AVX2 %s)\n",
+	    app->occlusion.occluderTriangleCount, sourceCount, app->occlusion.hasAvx2 ? "on" : "off");
+	free(selected);
+	free(sourcePrimitives);
+	free(areas);
+	free(sources);
+	free(primitiveAreas);
+}
+
+#define OCCLUSION_TEST_GRAIN 256 // AABB tests per job; each is a handful of depth samples
+
+typedef struct OcclusionTestContext
+{
+	Application* app;
+	const float* viewProj;
+} OcclusionTestContext;
+
+// The depth buffer is read-only once rasterized, so ranges of primitives test independently
+static void occlusionTestJob(void* userData, uint32_t begin, uint32_t end)
+{
+	OcclusionTestContext* ctx = userData;
+	Application* app = ctx->app;
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		Primitive* prim = &app->mesh.primitives[i];
+		app->primitiveVisible[i] = occlusionTestAabb(&app->occlusion, ctx->viewProj, prim->aabbMin, prim->aabbMax);
+	}
+}
+
+void updateOcclusionCulling(Application* app)
+{
+	app->drawsCulled = 0;
+	if (!app->primitiveVisible)
+		return; // scene still loading
+	if (!app->occlusionEnabled)
+	{
+		memset(app->primitiveVisible, 1, app->mesh.primitive_count * sizeof(bool));
+		return;
+	}
+
+	mat4 view, proj, viewProj;
+	computeCameraMatrices(app, view, proj);
+	glm_mat4_mul(proj, view, viewProj);
+
+	occlusionRasterize(&app->occlusion, (float*)viewProj);
+
+	double start = occlusionNowMs();
+	OcclusionTestContext test = {app, (float*)viewProj};
+	jobsParallelFor(app->jobs, app->mesh.primitive_count, OCCLUSION_TEST_GRAIN, occlusionTestJob, &test);
+	for (u32 i = 0; i < app->mesh.primitive_count; ++i)
 	{
-		app->pipelines[i] = createMeshPipeline(app, app->vertShaderModule, app->fragShaderModule, &app->mesh.materials[i]);
-		printf("Pipeline for material %u: %p\n", i, (void*)app->pipelines[i]);
+		if (!app->primitiveVisible[i])
+			app->drawsCulled++;
 	}
+	app->occlusion.stats.tested = app->mesh.primitive_count;
+	app->occlusion.stats.culled = app->drawsCulled;
+	app->occlusion.stats.testMs = occlusionNowMs() - start;
 }
 
+// Sorts this frame's visible primitives into the two draw groups once, so the prepass,
+// opaque and blended passes each walk only their own primitives
+static void buildDrawLists(Application* app)
+{
+	Arena* scratch = &app->frameArenas[app->currentFrame];
+	for (u32 group = 0; group < 2; ++group)
+	{
+		app->drawLists[group] = arenaAlloc(scratch, app->mesh.primitive_count * sizeof(u32));
+		app->drawListCounts[group] = 0;
+	}
+	for (u32 i = 0; i < app->mesh.primitive_count; ++i)
+	{
+		if (app->primitiveVisible && !app->primitiveVisible[i])
+			continue;
+		const Primitive* prim = &app->mesh.primitives[i];
+		int mat = (prim->material_index >= 0 && prim->material_index < (int)app->mesh.material_count) ? prim->material_index : 0;
+		u32 group = app->mesh.material_count > 0 && app->mesh.materials[mat].alphaMode == 2 ? 1 : 0;
+		app->drawLists[group][app->drawListCounts[group]++] = i;
+	}
+}
+
+void cleanupOcclusionCulling(Application* app)
+{
+	occlusionDestroy(&app->occlusion);
+	free(app->primitiveVisible);
+	app->primitiveVisible = NULL;
+}
+
+// --- Clustered Lighting ---
+
+// Union of the primitive AABBs, used to place lights and size the shadow cascades' depth range
+static void computeSceneBounds(Application* app)
+{
+	glm_vec3_fill(app->sceneMin, -10.0f);
+	glm_vec3_fill(app->sceneMax, 10.0f);
+	if (app->mesh.primitive_count == 0)
+		return;
+	glm_vec3_copy(app->mesh.primitives[0].aabbMin, app->sceneMin);
+	glm_vec3_copy(app->mesh.primitives[0].aabbMax, app->sceneMax);
+	for (u32 i = 1; i < app->mesh.primitive_count; ++i)
+	{
+		glm_vec3_minv(app->sceneMin, app->mesh.primitives[i].aabbMin, app->sceneMin);
+		glm_vec3_maxv(app->sceneMax, app->mesh.primitives[i].aabbMax, app->sceneMax);
+	}
+}
+
+static float lightRandom(u32* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return (float)(*state >> 8) / 16777216.0f;
+}
+
+static ClusterParams frameClusterParams(Application* app)
+{
+	// Clusters tile the scaled scene; the aspect stays the projection's, not the rounded size's
+	ClusterParams params = clusterMakeParams(CAMERA_Z_NEAR, CAMERA_Z_FAR, glm_rad(CAMERA_FOV_Y_DEGREES), (float)app->renderWidth, (float)app->renderHeight);
+	params.aspect = app->width / (float)app->height;
+	return params;
+}
+
+// Scatter the lights through the scene bounds with a fixed seed so runs stay comparable. Runs
+// again once the model has loaded and the bounds are known.
+static void scatterClusteredLights(Application* app)
+{
+	vec3 extent;
+	glm_vec3_sub(app->sceneMax, app->sceneMin, extent);
+	float baseRadius = glm_vec3_norm(extent) * 0.03f;
+
+	u32 seed = 0x9E3779B9u;
+	for (u32 i = 0; i < MAX_CLUSTERED_LIGHTS; ++i)
+	{
+		ClusterLight* light = &app->lights[i];
+		for (int c = 0; c < 3; ++c)
+			app->lightOrigins[i][c] = light->positionRadius[c] = app->sceneMin[c] + extent[c] * lightRandom(&seed);
+		app->lightOrigins[i][3] = lightRandom(&seed) * 2.0f * GLM_PIf;
+		light->positionRadius[3] = baseRadius * (0.5f + lightRandom(&seed));
+
+		// Fully saturated hue
+		float h = lightRandom(&seed) * 6.0f;
+		light->color[0] = glm_clamp(fabsf(h - 3.0f) - 1.0f, 0.0f, 1.0f) * 4.0f;
+		light->color[1] = glm_clamp(2.0f - fabsf(h - 2.0f), 0.0f, 1.0f) * 4.0f;
+		light->color[2] = glm_clamp(2.0f - fabsf(h - 4.0f), 0.0f, 1.0f) * 4.0f;
+	}
+}
+
+void createClusteredLighting(Application* app)
+{
+	clusterInit(&app->clusterGrid);
+	app->lights = calloc(MAX_CLUSTERED_LIGHTS, sizeof(ClusterLight));
+	app->lightOrigins = calloc(MAX_CLUSTERED_LIGHTS, sizeof(vec4));
+	app->cpuClusterCounts = malloc(sizeof(u32) * CLUSTER_COUNT);
+	app->cpuClusterIndices = malloc(sizeof(u32) * CLUSTER_COUNT * CLUSTER_MAX_LIGHTS);
+	app->numActiveLights = DEFAULT_POINT_LIGHTS;
+	scatterClusteredLights(app);
+
+	// The CPU writes a frame's lights while the previous frame may still be reading its own,
+	// so the writes go to that frame's upload buffer and the GPU copies them over in order
+	VkDeviceSize lightSize = sizeof(ClusterLight) * MAX_CLUSTERED_LIGHTS;
+	VkDeviceSize countSize = sizeof(u32) * CLUSTER_COUNT;
+	VkDeviceSize indexSize = sizeof(u32) * CLUSTER_COUNT * CLUSTER_MAX_LIGHTS;
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	createDeviceLocalBuffer(app, &app->lightBuffer, lightSize, usage);
+	createDeviceLocalBuffer(app, &app->clusterCountBuffer, countSize, usage);
+	createDeviceLocalBuffer(app, &app->clusterIndexBuffer, indexSize, usage);
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		createBuffer(app, &app->lightUpload[i], lightSize + countSize + indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		memset((char*)app->lightUpload[i].data + lightSize, 0, countSize);
+	}
+
+	VkDescriptorSetLayoutBinding bindings[] = {
+	    {.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+	    {.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+	    {.binding = 2, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+	    {.binding = 3, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+	};
+	createComputePipeline(app, &app->lightCull, "compiledshaders/light_cull.comp.spv", bindings, ARRAYSIZE(bindings), 0);
+
+	VkDescriptorPoolSize poolSizes[] = {
+	    {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .descriptorCount = 1},
+	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 3},
+	};
+	VkDescriptorBufferInfo uniformInfo = {.buffer = app->uniformBuffer.vkbuffer, .range = sizeof(UniformBufferObject)};
+	VkDescriptorBufferInfo lightInfo = {.buffer = app->lightBuffer.vkbuffer, .range = VK_WHOLE_SIZE};
+	VkDescriptorBufferInfo countInfo = {.buffer = app->clusterCountBuffer.vkbuffer, .range = VK_WHOLE_SIZE};
+	VkDescriptorBufferInfo indexInfo = {.buffer = app->clusterIndexBuffer.vkbuffer, .range = VK_WHOLE_SIZE};
+	VkWriteDescriptorSet writes[] = {
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstBinding = 0, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .pBufferInfo = &uniformInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstBinding = 1, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .pBufferInfo = &lightInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstBinding = 2, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .pBufferInfo = &countInfo},
+	    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstBinding = 3, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .pBufferInfo = &indexInfo},
+	};
+	createComputeDescriptors(app, &app->lightCull, &app->lightCullDescSet, poolSizes, ARRAYSIZE(poolSizes), writes, ARRAYSIZE(writes));
+
+	printf("Clustered lighting: %ux%ux%u clusters, %u of %u lights active (SSE %s)\n",
+	    CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, app->numActiveLights, MAX_CLUSTERED_LIGHTS,
+	    app->clusterGrid.hasSse ? "on" : "off");
+}
+
+// Writes this frame's lights into its upload buffer; with CPU culling the cluster lists are
+// built here as well. recordLightUploadCommands copies them to the GPU.
+void updateClusteredLighting(Application* app, mat4 view)
+{
+	char* upload = app->lightUpload[app->currentFrame].data;
+	VkDeviceSize countOffset = sizeof(ClusterLight) * MAX_CLUSTERED_LIGHTS;
+	VkDeviceSize indexOffset = countOffset + sizeof(u32) * CLUSTER_COUNT;
+	memcpy(upload, app->lights, sizeof(ClusterLight) * app->numActiveLights);
+	arrsetlen(app->lightUploadRegions, 0);
+	if (!app->clusterCullOnCpu)
+		return;
+
+	ClusterParams params = frameClusterParams(app);
+	if (memcmp(&params, &app->clusterGrid.params, sizeof(params)) != 0)
+		clusterUpdateBounds(&app->clusterGrid, &params);
+	clusterAssignLights(&app->clusterGrid, (float*)view, app->lights, app->numActiveLights,
+	    app->cpuClusterCounts, app->cpuClusterIndices);
+
+	// Only the used part of each cluster's slot goes to the (write-combined) mapping and over
+	// to the GPU
+	memcpy(upload + countOffset, app->cpuClusterCounts, sizeof(u32) * CLUSTER_COUNT);
+	u32* dst = (u32*)(upload + indexOffset);
+	for (u32 c = 0; c < CLUSTER_COUNT; ++c)
+	{
+		if (app->cpuClusterCounts[c] == 0)
+			continue;
+		VkDeviceSize slot = sizeof(u32) * c * CLUSTER_MAX_LIGHTS;
+		VkDeviceSize size = sizeof(u32) * app->cpuClusterCounts[c];
+		memcpy(dst + c * CLUSTER_MAX_LIGHTS, app->cpuClusterIndices + c * CLUSTER_MAX_LIGHTS, size);
+		arrput(app->lightUploadRegions, ((VkBufferCopy){.srcOffset = indexOffset + slot, .dstOffset = slot, .size = size}));
+	}
+}
+
+// The light_upload pass: this frame's lights, and the cluster lists when they came from the CPU
+void recordLightUploadCommands(Application* app, VkCommandBuffer commandBuffer)
+{
+	VkBuffer upload = app->lightUpload[app->currentFrame].vkbuffer;
+	VkDeviceSize countOffset = sizeof(ClusterLight) * MAX_CLUSTERED_LIGHTS;
+	if (app->numActiveLights > 0)
+	{
+		VkBufferCopy lights = {.size = sizeof(ClusterLight) * app->numActiveLights};
+		vkCmdCopyBuffer(commandBuffer, upload, app->lightBuffer.vkbuffer, 1, &lights);
+	}
+	if (!app->clusterCullOnCpu)
+		return;
+	VkBufferCopy counts = {.srcOffset = countOffset, .size = sizeof(u32) * CLUSTER_COUNT};
+	vkCmdCopyBuffer(commandBuffer, upload, app->clusterCountBuffer.vkbuffer, 1, &counts);
+	if (arrlen(app->lightUploadRegions) > 0)
+		vkCmdCopyBuffer(commandBuffer, upload, app->clusterIndexBuffer.vkbuffer, (u32)arrlen(app->lightUploadRegions), app->lightUploadRegions);
+}
+
+void recordLightCullCommands(Application* app, VkCommandBuffer commandBuffer)
+{
+	if (app->clusterCullOnCpu)
+		return;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->lightCull.pipeline);
+	u32 uniformOffset = frameUniformOffset(app);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->lightCull.layout, 0, 1, &app->lightCullDescSet, 1, &uniformOffset);
+	vkCmdDispatch(commandBuffer, CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
+}
+
+void cleanupClusteredLighting(Application* app)
+{
+	cleanupComputePipeline(app, &app->lightCull);
+	destroyBuffer(app->device, &app->lightBuffer);
+	destroyBuffer(app->device, &app->clusterCountBuffer);
+	destroyBuffer(app->device, &app->clusterIndexBuffer);
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		destroyBuffer(app->device, &app->lightUpload[i]);
+	arrfree(app->lightUploadRegions);
+	clusterDestroy(&app->clusterGrid);
+	free(app->lights);
+	free(app->lightOrigins);
+	free(app->cpuClusterCounts);
+	free(app->cpuClusterIndices);
+}
+
+// --- Scene loading ---
+
+// Everything that does not depend on the model. The model is requested from the asset loader
+// and attached once it has decoded, so the first frame never waits on it.
 void createResources(Application* app)
 {
-	createModelAndBuffers(app);
-	createTextureResources(app);
+	resourcesInit(app);
+	assetsInit(app);
+	app->assets.model = assetsLoadModel(app, SCENE_MODEL_PATH);
+	createSkyboxVertexBuffer(app);
 	app->descriptorSetLayout = createDescriptorSetLayout(app->device);
-	printf("app->descriptorSetLayout in createResources: %p\n", (void*)app->descriptorSetLayout);
+	app->descriptorPool = createDescriptorPool(app->device);
 
 	createUniformBuffers(app);
-	updateBaseColorAndHasTexture(app);
+	computeSceneBounds(app); // default bounds until the model arrives
+	createClusteredLighting(app);
+	createShadowResources(app);
+}
 
+// Called from the main loop when the model request completes: takes over the decoded mesh and
+// builds the per-model state that used to be created up front
+void attachScene(Application* app, Mesh* mesh)
+{
+	double start = benchmarkNowMs();
+	u64 rssBefore = benchmarkPeakRssKb();
+	app->mesh = *mesh;
+	memset(mesh, 0, sizeof(*mesh));
+
+	createMeshBuffers(app);
+	createTextureResources(app);
+	updateBaseColorAndHasTexture(app);
 	createDescriptors(app);
+
+	// The mesh pipelines were built for zero materials; variants stay in the permutation cache
+	createMeshPipelines(app);
+	initOcclusionCulling(app);
+
+	// The geometry is on the GPU and occlusion took its own copy of the occluders, so the glTF
+	// document and buffers go now rather than at exit. Counts and primitives stay for drawing
+	// and culling.
+	gltfSourceFree(app->mesh.source);
+	app->mesh.source = NULL;
+
+	// Everything placed or sized from the default bounds moves to the real ones
+	computeSceneBounds(app);
+	scatterClusteredLights(app);
+	fitParticlesToScene(app);
+	fitPathMaskToScene(app);
+	// The casters only ever change here; cached cascades still hold the empty scene
+	for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+		app->cascades[i].dirty = true;
+
+	printf("Scene: %u primitives, %u materials attached in %.1f ms (peak RSS %.1f -> %.1f MiB)\n",
+	    app->mesh.primitive_count, app->mesh.material_count, benchmarkNowMs() - start,
+	    (double)rssBefore / 1024.0, (double)benchmarkPeakRssKb() / 1024.0);
 }
 
 // --- Vulkan Cleanup Helpers ---
@@ -366,14 +782,23 @@ void toggle_ui_mode(Application* app)
 
 void initWindow(Application* app)
 {
-	glfwInit();
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	app->width = 1280;
 	app->height = 720;
-	app->window = glfwCreateWindow(app->width, app->height, "Vulkan Test", 0, 0);
-	glfwSetWindowUserPointer(app->window, app);
-	glfwSetFramebufferSizeCallback(app->window, framebufferResizeCallback);
-	glfwSetCursorPosCallback(app->window, mouse_callback);
+	if (app->headless)
+	{
+		// GLFW is never initialised: there may be no display at all
+		app->width = (int)app->benchmark.width;
+		app->height = (int)app->benchmark.height;
+	}
+	else
+	{
+		glfwInit();
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		app->window = glfwCreateWindow(app->width, app->height, "Vulkan Test", 0, 0);
+		glfwSetWindowUserPointer(app->window, app);
+		glfwSetFramebufferSizeCallback(app->window, framebufferResizeCallback);
+		glfwSetCursorPosCallback(app->window, mouse_callback);
+	}
 
 	// Initialize camera - positioned to see the ground plane
 	glm_vec3_copy((vec3){0.0f, 0.0f, 0.0f}, app->cameraPos); // Higher up and back
@@ -385,7 +810,8 @@ void initWindow(Application* app)
 	app->lastY = app->height / 2.0f;
 	app->firstMouse = true;
 	app->is_ui_mode = true; // Start in UI mode initially
-	toggle_ui_mode(app);    // Set initial cursor state
+	if (!app->headless)
+		toggle_ui_mode(app); // Set initial cursor state
 	app->deltaTime = 0.0f;
 	app->lastFrame = 0.0f;
 
@@ -452,7 +878,7 @@ void initVulkan(Application* app)
 	app->currentFrame = 0;
 
 	// Create instance
-	app->instance = createVulkanInstance();
+	app->instance = createVulkanInstance(!app->headless);
 	volkLoadInstance(app->instance);
 
 	// Select physical device
@@ -461,14 +887,32 @@ void initVulkan(Application* app)
 
 	// Create logical device and queue
 	u32 graphicsqueueFamilyIndex = find_graphics_queue_family_index(app->physicalDevice);
-	app->device = create_logical_device(app->physicalDevice, graphicsqueueFamilyIndex);
+	app->dynamicRasterState = supportsDynamicRasterState(app->physicalDevice);
+	app->dynamicBlendEnable = app->dynamicRasterState && supportsDynamicBlendEnable(app->physicalDevice);
+	printf("Dynamic mesh state: raster %s, blend enable %s\n",
+	    app->dynamicRasterState ? "on" : "off", app->dynamicBlendEnable ? "on" : "off");
+	bool r8Storage = supportsR8StorageImage(app->physicalDevice);
+	app->pathMaskFormat = r8Storage ? PATH_MASK_FORMAT : PATH_MASK_FALLBACK_FORMAT;
+	if (!r8Storage)
+		printf("Path mask: no R8_UNORM storage images, falling back to R8G8B8A8_UNORM\n");
+	app->device = create_logical_device(app->physicalDevice, graphicsqueueFamilyIndex, app->dynamicBlendEnable, r8Storage, !app->headless);
 	volkLoadDevice(app->device);
+	installFrameCounters(app);
 	vkGetDeviceQueue(app->device, graphicsqueueFamilyIndex, 0, &app->graphicsQueue);
 
 	createCommandPoolAndBuffer(app, graphicsqueueFamilyIndex);
+	createPipelineCache(app, PIPELINE_CACHE_PATH);
+	gpuTimerInit(app);
+	profilerInit(&app->profiler, PROFILER_DEFAULT_EVENTS);
+	DrsConfig drsConfig = drsDefaultConfig(DRS_DEFAULT_TARGET_MS);
+	drsInit(&app->drs, &drsConfig);
+	app->drsEnabled = !app->headless; // benchmark frames all render at the requested size
+	app->drsSharpness = DRS_DEFAULT_SHARPNESS;
+	app->renderScale = 1.0f;
 
 	// Create surface
-	app->surface = createSurface(app->instance, app->window);
+	if (!app->headless)
+		app->surface = createSurface(app->instance, app->window);
 
 	createSwapchainRelatedResources(app);
 
@@ -476,11 +920,12 @@ void initVulkan(Application* app)
 #define MAX_ELEMENT_BUFFER 128 * 1024
 
 	// Store the nuklear context in the app struct
-	app->nkCtx = nk_glfw3_init(app->window, app->device, app->physicalDevice,
-	    graphicsqueueFamilyIndex, app->swapchainImageViews, app->swapchainImageCount,
-	    app->swapchainFormat, NK_GLFW3_INSTALL_CALLBACKS, MAX_VERTEX_BUFFER, MAX_ELEMENT_BUFFER);
-
+	if (!app->headless)
 	{
+		app->nkCtx = nk_glfw3_init(app->window, app->device, app->physicalDevice,
+		    graphicsqueueFamilyIndex, app->swapchainImageViews, app->swapchainImageCount,
+		    app->swapchainFormat, NK_GLFW3_INSTALL_CALLBACKS, MAX_VERTEX_BUFFER, MAX_ELEMENT_BUFFER);
+
 		struct nk_font_atlas* atlas;
 		nk_glfw3_font_stash_begin(&atlas);
 		/*struct nk_font *droid = nk_font_atlas_add_from_file(atlas,
@@ -500,7 +945,7 @@ void initVulkan(Application* app)
 	/*nk_style_set_font(ctx, &droid->handle);*/}
 
 	// Initialize FPS tracking
-	app->fpsLastTime = glfwGetTime();
+	app->fpsLastTime = app->headless ? 0.0 : glfwGetTime();
 	app->fpsFrameCount = 0;
 	app->fps = 0.0f;
 
@@ -513,6 +958,9 @@ void initVulkan(Application* app)
 	app->toonWrap = 0.2f;
 	app->rimStrength = 0.3f;
 	app->rimWidth = 1.5f;
+	app->depthPrepassEnabled = true;
+	// The A/B run starts specialized and switches to generic pipelines halfway
+	app->specializeMaterials = app->benchmark.abSpecialize || !app->benchmark.noSpecialize;
 
 	createResources(app);
 	createPipeline(app);
@@ -521,283 +969,188 @@ void initVulkan(Application* app)
 	createSkyboxDescriptors(app);
 	createSyncObjects(app);
 
-	// Create particle buffer
-	const int PARTICLE_COUNT = 1024;
-	createBuffer(app, &app->particleBuffer, sizeof(Particle) * PARTICLE_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-
-	// Initialize particle data
-	Particle* particles = (Particle*)malloc(sizeof(Particle) * PARTICLE_COUNT);
-	for (int i = 0; i < PARTICLE_COUNT; i++)
-	{
-		particles[i].pos[0] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
-		particles[i].pos[1] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
-		particles[i].pos[2] = 0.0f;
-		particles[i].pos[3] = 1.0f;
-	}
-	memcpy(app->particleBuffer.data, particles, sizeof(Particle) * PARTICLE_COUNT);
-	free(particles);
-
-	// Create particle compute pipeline
-	VkDescriptorSetLayoutBinding particleBindings[] = {
-	    {
-	        .binding = 0,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-	        .descriptorCount = 1,
-	        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-	    },
-	    {
-	        .binding = 1,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-	        .descriptorCount = 1,
-	        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-	    }};
-	createComputePipeline(app, &app->particleCompute, "compiledshaders/particle.comp.spv", particleBindings, 2);
-
-	// Create particle compute descriptors
-	VkDescriptorPoolSize particlePoolSizes[] = {
-	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1},
-	    {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1},
-	};
+	createParticleSystem(app);
+	createPathMask(app);
 
-	VkDescriptorBufferInfo particleBufferInfo = {
-	    .buffer = app->particleBuffer.vkbuffer,
-	    .offset = 0,
-	    .range = sizeof(Particle) * PARTICLE_COUNT,
-	};
-
-	VkDescriptorBufferInfo uniformBufferInfo = {
-	    .buffer = app->uniformBuffer.vkbuffer, // Note: using the main uniform buffer for now
-	    .offset = 0,
-	    .range = sizeof(UniformBufferObject),
-	};
-
-	VkWriteDescriptorSet particleDescriptorWrites[] = {
-	    {
-	        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-	        .dstBinding = 0,
-	        .descriptorCount = 1,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-	        .pBufferInfo = &particleBufferInfo,
-	    },
-	    {
-	        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-	        .dstBinding = 1,
-	        .descriptorCount = 1,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-	        .pBufferInfo = &uniformBufferInfo,
-	    },
-	};
-
-	createComputeDescriptors(app, &app->particleCompute, &app->particleComputeDescSet, particlePoolSizes, 2, particleDescriptorWrites, 2);
-
-	// Create particle graphics descriptor set layout
-	VkDescriptorSetLayoutBinding particleGraphicsBindings[] = {
-	    {
-	        .binding = 0,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-	        .descriptorCount = 1,
-	        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-	    },
-	};
-	VkDescriptorSetLayoutCreateInfo particleGraphicsLayoutInfo = {
-	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-	    .bindingCount = 1,
-	    .pBindings = particleGraphicsBindings,
-	};
-	VK_CHECK(vkCreateDescriptorSetLayout(app->device, &particleGraphicsLayoutInfo, NULL, &app->particleGraphicsDescriptorSetLayout));
+	createBloomSystem(app);
+	buildFrameGraph(app);
 
-	// Create particle graphics pipeline layout
-	VkPipelineLayoutCreateInfo particlePipelineLayoutInfo = {
-	    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-	    .setLayoutCount = 1,
-	    .pSetLayouts = &app->particleGraphicsDescriptorSetLayout,
-	};
-	VK_CHECK(vkCreatePipelineLayout(app->device, &particlePipelineLayoutInfo, NULL, &app->particlePipelineLayout));
+	printf("Pipelines: %.1f ms (%s cache)\n", app->pipelineCreateMs, app->pipelineCacheWarm ? "warm" : "cold");
+}
 
-	// Create particle graphics descriptor set
-	app->particleGraphicsDescriptorSet = allocateDescriptorSet(app->device, app->descriptorPool, &app->particleGraphicsDescriptorSetLayout);
+void computeCameraMatrices(Application* app, mat4 view, mat4 proj)
+{
+	glm_perspective(glm_rad(CAMERA_FOV_Y_DEGREES), app->width / (float)app->height, CAMERA_Z_NEAR, CAMERA_Z_FAR, proj);
+	proj[1][1] *= -1;
+	vec3 center;
+	glm_vec3_add(app->cameraPos, app->cameraFront, center);
+	glm_lookat(app->cameraPos, center, app->cameraUp, view);
+}
 
-	VkDescriptorBufferInfo particleGraphicsBufferInfo = {
-	    .buffer = app->particleBuffer.vkbuffer,
-	    .offset = 0,
-	    .range = sizeof(Particle) * 1024,
-	};
+// Draws either the blended or the non-blended primitives; prepass selects the depth-only pipelines
+static void drawMeshPrimitives(Application* app, VkCommandBuffer commandBuffer, bool prepass, bool blended)
+{
+	if (app->mesh.material_count == 0)
+		return;
 
-	VkWriteDescriptorSet particleGraphicsDescriptorWrite = {
-	    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-	    .dstSet = app->particleGraphicsDescriptorSet,
-	    .dstBinding = 0,
-	    .descriptorCount = 1,
-	    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-	    .pBufferInfo = &particleGraphicsBufferInfo,
-	};
-	vkUpdateDescriptorSets(app->device, 1, &particleGraphicsDescriptorWrite, 0, NULL);
+	VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	VkCullModeFlags boundCullMode = VK_CULL_MODE_FLAG_BITS_MAX_ENUM;
+	VkDeviceSize offset = 0;
+	u32 uniformOffset = frameUniformOffset(app);
 
-	VkShaderModule particleVertShader = LoadShaderModule("compiledshaders/particle.vert.spv", app->device);
-	VkShaderModule particleFragShader = LoadShaderModule("compiledshaders/particle.frag.spv", app->device);
-	app->particlePipeline = createParticlePipeline(app, particleVertShader, particleFragShader);
-	vkDestroyShaderModule(app->device, particleVertShader, NULL);
-	vkDestroyShaderModule(app->device, particleFragShader, NULL);
+	// Dynamic state matches what createMeshPipeline would otherwise bake for this group
+	if (app->dynamicRasterState)
+	{
+		bool depthWrite = prepass || !app->depthPrepassEnabled;
+		bool depthEqual = !prepass && !blended && app->depthPrepassEnabled;
+		vkCmdSetFrontFace(commandBuffer, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+		vkCmdSetDepthWriteEnable(commandBuffer, depthWrite ? VK_TRUE : VK_FALSE);
+		vkCmdSetDepthCompareOp(commandBuffer, depthEqual ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS);
+	}
+	if (app->dynamicBlendEnable && !prepass)
+	{
+		VkBool32 blendEnable = blended ? VK_TRUE : VK_FALSE;
+		vkCmdSetColorBlendEnableEXT(commandBuffer, 0, 1, &blendEnable);
+	}
 
-	// Create the other compute pipeline
-	createStorageImage(app, &app->computeImage, 512, 512);
-	createBuffer(app, &app->computeUniformBuffer, sizeof(ComputeUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	const MaterialPool* materials = &app->resources.materials;
+	const u32* drawList = app->drawLists[blended ? 1 : 0];
+	for (u32 d = 0; d < app->drawListCounts[blended ? 1 : 0]; d++)
+	{
+		Primitive* prim = &app->mesh.primitives[drawList[d]];
+		int mat = (prim->material_index >= 0 && prim->material_index < (int)app->mesh.material_count) ? prim->material_index : 0;
+		int alphaMode = app->mesh.materials[mat].alphaMode;
 
-	VkDescriptorSetLayoutBinding bindings[] = {
-	    {
-	        .binding = 0,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-	        .descriptorCount = 1,
-	        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-	    },
-	    {
-	        .binding = 1,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-	        .descriptorCount = 1,
-	        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-	    }};
-
-	createComputePipeline(app, &app->compute, "compiledshaders/compute_path_mask.comp.spv", bindings, 2);
+		// Opaque prepass draws only need positions; masked ones need UVs for the alpha test
+		VkBuffer vertexBuffer = (prepass && alphaMode == 0) ? app->positionBuffer.vkbuffer : app->vertexBuffer.vkbuffer;
+		if (vertexBuffer != boundVertexBuffer)
+		{
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+			boundVertexBuffer = vertexBuffer;
+		}
 
-	VkDescriptorPoolSize poolSizes[] = {
-	    {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1},
-	    {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1},
-	};
+		// Materials share pipelines, so consecutive draws often skip the bind
+		u32 material = resourcesMaterialIndex(app, app->mesh.materials[mat].handle);
+		VkPipeline pipeline = resourcesPipeline(app, prepass ? materials->prepassPipelines[material] : materials->pipelines[material]);
+		if (pipeline != boundPipeline)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundPipeline = pipeline;
+		}
+		if (app->dynamicRasterState)
+		{
+			VkCullModeFlags cullMode = app->mesh.materials[mat].doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+			if (cullMode != boundCullMode)
+			{
+				vkCmdSetCullMode(commandBuffer, cullMode);
+				boundCullMode = cullMode;
+			}
+		}
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipelineLayout, 0, 1, &materials->descriptorSets[material], 1, &uniformOffset);
 
-	VkDescriptorImageInfo imageInfo = {
-	    .imageView = app->computeImage.view,
-	    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
-	};
+		vkCmdDrawIndexed(commandBuffer, prim->index_count, 1, prim->first_index, 0, 0);
+	}
+}
 
-	VkDescriptorBufferInfo bufferInfo = {
-	    .buffer = app->computeUniformBuffer.vkbuffer,
-	    .offset = 0,
-	    .range = sizeof(ComputeUniforms),
-	};
+static void updateFrameUniforms(Application* app)
+{
+	// Update camera & lights (before any draw so skybox uses current frame matrices)
+	UniformBufferObject ubo = {0};
+	computeCameraMatrices(app, ubo.view, ubo.proj);
+	glm_mat4_identity(ubo.model);
+	glm_vec3_copy(app->cameraPos, ubo.cameraPos);
+	ubo.numLights = app->numActiveLights;
+	ClusterParams clusterParams = frameClusterParams(app);
+	glm_vec4_copy((vec4){clusterParams.zNear, clusterParams.zFar, clusterParams.sliceScale, clusterParams.sliceBias}, ubo.clusterDepth);
+	glm_vec4_copy((vec4){clusterParams.width, clusterParams.height, clusterParams.tanHalfFovY, clusterParams.aspect}, ubo.clusterScreen);
+	updateClusteredLighting(app, ubo.view);
+	updateShadowCascades(app, ubo.view);
+	for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		glm_mat4_copy(app->cascades[i].viewProj, ubo.cascadeViewProj[i]);
+		ubo.cascadeSplits[i] = app->cascades[i].splitFar;
+	}
+	glm_vec4_copy((vec4){1.0f / SHADOW_MAP_SIZE, 0.0005f, 0.0f, app->shadowsEnabled ? 1.0f : 0.0f}, ubo.shadowParams);
+	ubo.dirLight = app->dirLight;
+	// Apply per-frame directional intensity without mutating app->dirLight
+	for (int c = 0; c < 3; ++c) ubo.dirLight.color[c] *= app->dirLightIntensity;
+	ubo.stylizedMode = app->stylizedMode;
+	ubo.toonSteps = app->toonSteps;
+	ubo.toonSpecularStrength = app->toonSpecularStrength;
+	ubo.pad_ubo0 = 0.0f;
+	ubo.toonShadowSoftness = app->toonShadowSoftness;
+	ubo.toonWrap = app->toonWrap;
+	ubo.rimStrength = app->rimStrength;
+	ubo.rimWidth = app->rimWidth;
+	memcpy((char*)app->uniformBuffer.data + frameUniformOffset(app), &ubo, sizeof(ubo));
 
-	VkWriteDescriptorSet descriptorWrites[] = {
-	    {
-	        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-	        .dstBinding = 0,
-	        .descriptorCount = 1,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-	        .pImageInfo = &imageInfo,
-	    },
-	    {
-	        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-	        .dstBinding = 1,
-	        .descriptorCount = 1,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-	        .pBufferInfo = &bufferInfo,
-	    },
-	};
+	// Update skybox uniform buffer (vertex shader removes translation)
+	// Update skybox uniform buffer with view matrix without translation
+	UniformBufferObject skyboxUbo = {0};
+	glm_mat4_copy(ubo.proj, skyboxUbo.proj); // Same projection matrix
+	glm_mat4_copy(ubo.view, skyboxUbo.view); // Copy the view matrix
+	glm_mat4_copy(ubo.model, skyboxUbo.model);
+	// Remove translation from the view matrix (set translation column to 0)
+	skyboxUbo.view[3][0] = 0.0f;
+	skyboxUbo.view[3][1] = 0.0f;
+	skyboxUbo.view[3][2] = 0.0f;
+	glm_mat4_identity(skyboxUbo.model);
+	memcpy((char*)app->skyboxUniformBuffer.data + frameUniformOffset(app), &skyboxUbo, sizeof(skyboxUbo));
+}
 
-	createComputeDescriptors(app, &app->compute, &app->computeDescSet, poolSizes, 2, descriptorWrites, 2);
+// --- Frame graph passes ---
 
-	createComputeSync(app);
+static void pathMaskPass(void* cmd, const RenderGraph* graph, void* userData)
+{
+	(void)graph;
+	recordComputeCommands(userData, (VkCommandBuffer)cmd);
 }
 
-void recordComputeCommands(Application* app)
+static void lightUploadPass(void* cmd, const RenderGraph* graph, void* userData)
 {
-	// Ensure the image is in GENERAL layout for compute writing
-	VkImageMemoryBarrier barrier = {
-	    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-	    .srcAccessMask = 0,
-	    .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-	    .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED, // We don't care about previous content
-	    .newLayout = VK_IMAGE_LAYOUT_GENERAL,
-	    .image = app->computeImage.image,
-	    .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
-	vkCmdPipelineBarrier(
-	    app->computeCmdBuffer,
-	    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-	    0,
-	    0, NULL,
-	    0, NULL,
-	    1, &barrier);
-	// Bind the compute pipeline and descriptor set
-	vkCmdBindPipeline(app->computeCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->compute.pipeline);
-	vkCmdBindDescriptorSets(app->computeCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->compute.layout, 0, 1, &app->computeDescSet, 0, NULL);
-	// Dispatch with one workgroup per pixel (since local size is 1x1)
-	vkCmdDispatch(app->computeCmdBuffer, app->computeImage.extent.width, app->computeImage.extent.height, 1);
-	// If we plan to use the image in the fragment shader, we transition it to SHADER_READ_ONLY_OPTIMAL
-	VkImageMemoryBarrier readBarrier = {
-	    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-	    .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-	    .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-	    .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
-	    .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-	    .image = app->computeImage.image,
-	    .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
-	vkCmdPipelineBarrier(
-	    app->computeCmdBuffer,
-	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-	    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-	    0,
-	    0, NULL,
-	    0, NULL,
-	    1, &readBarrier);
+	(void)graph;
+	recordLightUploadCommands(userData, (VkCommandBuffer)cmd);
 }
 
-void updateComputeUniforms(Application* app, vec3 mousePos, int is_additive, vec2 path_mask_ws_dims)
+static void lightCullPass(void* cmd, const RenderGraph* graph, void* userData)
 {
-	ComputeUniforms uniforms;
-	glm_vec3_copy(mousePos, uniforms.mouse_position);
-	uniforms.is_additive = is_additive;
-	glm_vec2_copy(path_mask_ws_dims, uniforms.path_mask_ws_dims);
-	memcpy(app->computeUniformBuffer.data, &uniforms, sizeof(ComputeUniforms));
+	(void)graph;
+	recordLightCullCommands(userData, (VkCommandBuffer)cmd);
 }
 
-void recordParticleComputeCommands(Application* app)
+static void shadowPass(void* cmd, const RenderGraph* graph, void* userData)
 {
-	// Bind the particle compute pipeline and descriptor set
-	vkCmdBindPipeline(app->computeCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->particleCompute.pipeline);
-	vkCmdBindDescriptorSets(app->computeCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->particleCompute.layout, 0, 1, &app->particleComputeDescSet, 0, NULL);
+	(void)graph;
+	recordShadowCommands(userData, (VkCommandBuffer)cmd);
+}
 
-	// Dispatch the compute shader
-	vkCmdDispatch(app->computeCmdBuffer, 1024, 1, 1);
+static void bloomPass(void* cmd, const RenderGraph* graph, void* userData)
+{
+	(void)graph;
+	renderBloomPass(userData, (VkCommandBuffer)cmd);
+}
 
-	VkMemoryBarrier memoryBarrier = {
-	    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-	    .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-	    .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-	};
-	vkCmdPipelineBarrier(
-	    app->computeCmdBuffer,
-	    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-	    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-	    0,
-	    1, &memoryBarrier,
-	    0, NULL,
-	    0, NULL);
+static void particlesPass(void* cmd, const RenderGraph* graph, void* userData)
+{
+	(void)graph;
+	recordParticleComputeCommands(userData, (VkCommandBuffer)cmd);
 }
-void recordCommandBuffer(Application* app, VkCommandBuffer commandBuffer, u32 imageIndex)
+
+static void particleReadbackPass(void* cmd, const RenderGraph* graph, void* userData)
 {
-	VkCommandBufferBeginInfo beginInfo = {
-	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-	    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-	};
-	VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+	(void)graph;
+	recordParticleReadback(userData, (VkCommandBuffer)cmd);
+}
 
-	// Transition image layout for color attachment from its current layout
-	VkImageLayout currentLayout = app->swapchainImageLayouts ? app->swapchainImageLayouts[imageIndex] : VK_IMAGE_LAYOUT_UNDEFINED;
-	transitionImageLayout(commandBuffer, app->swapchainImages[imageIndex],
-	    currentLayout, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-	    0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-	    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-	    VK_IMAGE_ASPECT_COLOR_BIT);
-
-	// Transition depth image layout
-	transitionImageLayout(commandBuffer, app->depthImage,
-	    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-	    0, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-	    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR,
-	    VK_IMAGE_ASPECT_DEPTH_BIT);
+static void scenePass(void* cmd, const RenderGraph* graph, void* userData)
+{
+	Application* app = userData;
+	VkCommandBuffer commandBuffer = (VkCommandBuffer)cmd;
 
 	VkRenderingAttachmentInfo colorAttachment = {
 	    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-	    .imageView = app->swapchainImageViews[imageIndex],
+	    .imageView = (VkImageView)rgGetView(graph, app->rgHdrColor),
 	    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
 	    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
 	    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
@@ -806,16 +1159,17 @@ void recordCommandBuffer(Application* app, VkCommandBuffer commandBuffer, u32 im
 
 	VkRenderingAttachmentInfo depthAttachment = {
 	    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-	    .imageView = app->depthImageView,
+	    .imageView = (VkImageView)rgGetView(graph, app->rgDepth),
 	    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
 	    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
 	    .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 	    .clearValue.depthStencil = {1.0f, 0},
 	};
 
+	// Only the scaled corner is rendered (and cleared); tonemap never samples past it
 	VkRenderingInfo renderingInfo = {
 	    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
-	    .renderArea = {{0, 0}, {app->width, app->height}},
+	    .renderArea = {{0, 0}, {app->renderWidth, app->renderHeight}},
 	    .layerCount = 1,
 	    .colorAttachmentCount = 1,
 	    .pColorAttachments = &colorAttachment,
@@ -824,162 +1178,439 @@ void recordCommandBuffer(Application* app, VkCommandBuffer commandBuffer, u32 im
 
 	vkCmdBeginRendering(commandBuffer, &renderingInfo);
 
-	// Update camera & lights (before any draw so skybox uses current frame matrices)
-	UniformBufferObject ubo = {0};
-	glm_perspective(glm_rad(45.0f), app->width / (float)app->height, 0.01f, 1000.0f, ubo.proj);
-	ubo.proj[1][1] *= -1;
-	vec3 center;
-	glm_vec3_add(app->cameraPos, app->cameraFront, center);
-	glm_lookat(app->cameraPos, center, app->cameraUp, ubo.view);
-	glm_mat4_identity(ubo.model);
-	glm_vec3_copy(app->cameraPos, ubo.cameraPos);
-	ubo.numLights = app->numActiveLights;
-	for (u32 i = 0; i < app->numActiveLights; i++)
-		ubo.lights[i] = app->lights[i];
-	ubo.dirLight = app->dirLight;
-	// Apply per-frame directional intensity without mutating app->dirLight
-	for (int c = 0; c < 3; ++c) ubo.dirLight.color[c] *= app->dirLightIntensity;
-	ubo.stylizedMode = app->stylizedMode;
-	ubo.toonSteps = app->toonSteps;
-	ubo.toonSpecularStrength = app->toonSpecularStrength;
-	ubo.pad_ubo0 = 0.0f;
-	ubo.toonShadowSoftness = app->toonShadowSoftness;
-	ubo.toonWrap = app->toonWrap;
-	ubo.rimStrength = app->rimStrength;
-	ubo.rimWidth = app->rimWidth;
-	memcpy(app->uniformBuffer.data, &ubo, sizeof(ubo));
-
-	// Update skybox uniform buffer (vertex shader removes translation)
-	// Update skybox uniform buffer with view matrix without translation
-	UniformBufferObject skyboxUbo = {0};
-	glm_mat4_copy(ubo.proj, skyboxUbo.proj); // Same projection matrix
-	glm_mat4_copy(ubo.view, skyboxUbo.view); // Copy the view matrix
-	glm_mat4_copy(ubo.model, skyboxUbo.model);
-	// Remove translation from the view matrix (set translation column to 0)
-	skyboxUbo.view[3][0] = 0.0f;
-	skyboxUbo.view[3][1] = 0.0f;
-	skyboxUbo.view[3][2] = 0.0f;
-	glm_mat4_identity(skyboxUbo.model);
-	memcpy(app->skyboxUniformBuffer.data, &skyboxUbo, sizeof(skyboxUbo));
+	VkViewport viewport = {.x = 0.0f, .y = 0.0f, .width = (float)app->renderWidth, .height = (float)app->renderHeight, .minDepth = 0.0f, .maxDepth = 1.0f};
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-	// Draw skybox
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->skyboxPipeline);
+	VkRect2D scissor = {{0, 0}, {app->renderWidth, app->renderHeight}};
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	VkViewport skyboxViewport = {.x = 0.0f, .y = 0.0f, .width = (float)app->width, .height = (float)app->height, .minDepth = 0.0f, .maxDepth = 1.0f};
-	vkCmdSetViewport(commandBuffer, 0, 1, &skyboxViewport);
+	// No index buffer exists until the scene has loaded
+	if (app->mesh.primitive_count > 0)
+		vkCmdBindIndexBuffer(commandBuffer, app->indexBuffer.vkbuffer, 0, VK_INDEX_TYPE_UINT32);
 
-	VkRect2D skyboxScissor = {{0, 0}, {app->width, app->height}};
-	vkCmdSetScissor(commandBuffer, 0, 1, &skyboxScissor);
+	// Opaque and masked geometry: lay down depth first when enabled, then shade with EQUAL
+	if (app->depthPrepassEnabled)
+	{
+		gpuTimerPushRange(app, commandBuffer, "depth_prepass");
+		drawMeshPrimitives(app, commandBuffer, true, false);
+		gpuTimerPopRange(app, commandBuffer);
+	}
+	gpuTimerPushRange(app, commandBuffer, "opaque");
+	drawMeshPrimitives(app, commandBuffer, false, false);
+	gpuTimerPopRange(app, commandBuffer);
 
+	// Skybox after opaque geometry so only uncovered pixels (depth still 1.0) are shaded
+	gpuTimerPushRange(app, commandBuffer, "skybox");
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->skyboxPipeline);
 	VkBuffer skyboxVertexBuffers[] = {app->skyboxVertexBuffer.vkbuffer};
 	VkDeviceSize offsets[] = {0};
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, skyboxVertexBuffers, offsets);
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->skyboxPipelineLayout, 0, 1, &app->skyboxDescriptorSet, 0, NULL);
+	u32 skyboxOffset = frameUniformOffset(app);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->skyboxPipelineLayout, 0, 1, &app->skyboxDescriptorSet, 1, &skyboxOffset);
 	vkCmdDraw(commandBuffer, 36, 1, 0, 0);
+	gpuTimerPopRange(app, commandBuffer);
+
+	// Blended geometry last, tested against the opaque depth
+	gpuTimerPushRange(app, commandBuffer, "blended");
+	drawMeshPrimitives(app, commandBuffer, false, true);
+	gpuTimerPopRange(app, commandBuffer);
+
+	// Particles are additive, so they go after everything that writes depth
+	gpuTimerPushRange(app, commandBuffer, "particle_draw");
+	drawParticles(app, commandBuffer);
+	gpuTimerPopRange(app, commandBuffer);
+	vkCmdEndRendering(commandBuffer);
+}
+
+static void tonemapPass(void* cmd, const RenderGraph* graph, void* userData)
+{
+	Application* app = userData;
+	VkCommandBuffer commandBuffer = (VkCommandBuffer)cmd;
 
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipelines[0]);
+	// Every pixel is overwritten, nothing to load
+	VkRenderingAttachmentInfo colorAttachment = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+	    .imageView = (VkImageView)rgGetView(graph, app->rgSwapchain),
+	    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	    .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+	    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+	};
+	VkRenderingInfo renderingInfo = {
+	    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+	    .renderArea = {{0, 0}, {app->width, app->height}},
+	    .layerCount = 1,
+	    .colorAttachmentCount = 1,
+	    .pColorAttachments = &colorAttachment,
+	};
+	vkCmdBeginRendering(commandBuffer, &renderingInfo);
 
 	VkViewport viewport = {.x = 0.0f, .y = 0.0f, .width = (float)app->width, .height = (float)app->height, .minDepth = 0.0f, .maxDepth = 1.0f};
 	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
 	VkRect2D scissor = {{0, 0}, {app->width, app->height}};
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	// Bind vertex/index buffers
-	VkBuffer vertexBuffers[] = {app->vertexBuffer.vkbuffer};
-	VkDeviceSize modelOffsets[] = {0};
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, modelOffsets);
-	vkCmdBindIndexBuffer(commandBuffer, app->indexBuffer.vkbuffer, 0, VK_INDEX_TYPE_UINT32);
-	// Draw all primitives
-	for (u32 i = 0; i < app->mesh.primitive_count; i++)
-	{
-		Primitive* prim = &app->mesh.primitives[i];
-		if (prim->material_index >= 0 && prim->material_index < (int)app->mesh.material_count)
-		{
-			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipelines[prim->material_index]);
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipelineLayout, 0, 1, &app->descriptorSets[prim->material_index], 0, NULL);
-		}
+	renderTonemapPass(app, commandBuffer);
+	vkCmdEndRendering(commandBuffer);
+}
 
-		vkCmdDrawIndexed(commandBuffer, prim->index_count, 1, prim->first_index, 0, 0);
-	}
+static void uiPass(void* cmd, const RenderGraph* graph, void* userData)
+{
+	(void)graph;
+	Application* app = userData;
+	nk_glfw3_record((VkCommandBuffer)cmd, app->imageIndex, NK_ANTI_ALIASING_ON);
+}
 
-	// Draw particles
-	// vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->particlePipeline);
-	// VkBuffer particleVertexBuffers[] = {app->particleBuffer.vkbuffer};
-	// VkDeviceSize particleOffsets[] = {0};
-	// vkCmdBindVertexBuffers(commandBuffer, 0, 1, particleVertexBuffers, particleOffsets);
-	// vkCmdDraw(commandBuffer, 1024, 1, 0, 0);
-	//
-	vkCmdEndRendering(commandBuffer);
+// Declares the frame's passes; rebuilt whenever the swapchain (and so the depth size) changes
+void buildFrameGraph(Application* app)
+{
+	RenderGraph* graph = &app->frameGraph;
+	RgBackend backend = rgVulkanBackend(app);
+	rgInit(graph, &backend);
 
-	VkImageMemoryBarrier presentBarrier = {
-	    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-	    .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-	    .dstAccessMask = 0,
-	    .oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-	    .newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-	    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-	    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-	    .image = app->swapchainImages[imageIndex],
-	    .subresourceRange = {
-	        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-	        .baseMipLevel = 0,
-	        .levelCount = 1,
-	        .baseArrayLayer = 0,
-	        .layerCount = 1,
-	    },
+	RgImageDesc swapchainDesc = {
+	    .width = app->width,
+	    .height = app->height,
+	    .mipLevels = 1,
+	    .arrayLayers = 1,
+	    .format = app->swapchainFormat,
+	    .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 	};
+	// The headless target ends the frame ready to be copied out instead of presented
+	RgAccess swapchainFinalAccess = app->headless ? RG_ACCESS_TRANSFER_READ : RG_ACCESS_PRESENT;
+	app->rgSwapchain = rgImportImage(graph, "swapchain", &swapchainDesc, NULL, NULL, &app->swapchainState, swapchainFinalAccess);
 
-	vkCmdPipelineBarrier(
-	    commandBuffer,
-	    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-	    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-	    0,
-	    0, NULL,
-	    0, NULL,
-	    1, &presentBarrier);
+	RgImageDesc depthDesc = {
+	    .width = app->width,
+	    .height = app->height,
+	    .mipLevels = 1,
+	    .arrayLayers = 1,
+	    .format = app->depthFormat,
+	    .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+	    .depth = true,
+	};
+	app->rgDepth = rgCreateImage(graph, "depth", &depthDesc);
+	createBloomRenderTargets(app);
 
-	// Track new layout as PRESENT for this image
-	if (app->swapchainImageLayouts)
+	RgImageDesc pathMaskDesc = {
+	    .width = app->computeImage.extent.width,
+	    .height = app->computeImage.extent.height,
+	    .mipLevels = 1,
+	    .arrayLayers = 1,
+	    .format = app->computeImage.format,
+	    .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+	};
+	app->rgPathMask = rgImportImage(graph, "path_mask", &pathMaskDesc, (void*)app->computeImage.image, (void*)app->computeImage.view, &app->computeImageState, RG_ACCESS_NONE);
+	app->rgParticles = rgImportBuffer(graph, "particles", (void*)app->particleBuffer.vkbuffer, &app->particleBufferState);
+	app->rgParticleCounters = rgImportBuffer(graph, "particle_counters", (void*)app->particleCounterBuffer.vkbuffer, &app->particleCounterState);
+	app->rgLights = rgImportBuffer(graph, "lights", (void*)app->lightBuffer.vkbuffer, &app->lightState);
+	app->rgClusterCounts = rgImportBuffer(graph, "cluster_counts", (void*)app->clusterCountBuffer.vkbuffer, &app->clusterCountState);
+	app->rgClusterIndices = rgImportBuffer(graph, "cluster_indices", (void*)app->clusterIndexBuffer.vkbuffer, &app->clusterIndexState);
+
+	// Imported so cached cascades keep their depth from frame to frame
+	RgImageDesc shadowMapDesc = {
+	    .width = SHADOW_MAP_SIZE,
+	    .height = SHADOW_MAP_SIZE,
+	    .mipLevels = 1,
+	    .arrayLayers = SHADOW_CASCADE_COUNT,
+	    .format = SHADOW_MAP_FORMAT,
+	    .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	    .depth = true,
+	};
+	app->rgShadowMap = rgImportImage(graph, "shadow_map", &shadowMapDesc, (void*)app->shadowMap, (void*)app->shadowMapView, &app->shadowMapState, RG_ACCESS_NONE);
+
+	u32 pass = rgAddPass(graph, "path_mask", pathMaskPass, app);
+	rgPassUse(graph, pass, app->rgPathMask, RG_ACCESS_STORAGE_READ_WRITE_COMPUTE);
+
+	pass = rgAddPass(graph, "particles", particlesPass, app);
+	rgPassUse(graph, pass, app->rgParticles, RG_ACCESS_STORAGE_READ_WRITE_COMPUTE);
+	rgPassUse(graph, pass, app->rgParticleCounters, RG_ACCESS_STORAGE_READ_WRITE_COMPUTE);
+
+	// CPU culling can be switched on and off without rebuilding the graph, so the cluster lists
+	// are declared for both: uploaded here, then either overwritten by light_cull or left as
+	// they are (hence read-write there)
+	pass = rgAddPass(graph, "light_upload", lightUploadPass, app);
+	rgPassUse(graph, pass, app->rgLights, RG_ACCESS_TRANSFER_WRITE);
+	rgPassUse(graph, pass, app->rgClusterCounts, RG_ACCESS_TRANSFER_WRITE);
+	rgPassUse(graph, pass, app->rgClusterIndices, RG_ACCESS_TRANSFER_WRITE);
+
+	pass = rgAddPass(graph, "light_cull", lightCullPass, app);
+	rgPassUse(graph, pass, app->rgLights, RG_ACCESS_STORAGE_READ_COMPUTE);
+	rgPassUse(graph, pass, app->rgClusterCounts, RG_ACCESS_STORAGE_READ_WRITE_COMPUTE);
+	rgPassUse(graph, pass, app->rgClusterIndices, RG_ACCESS_STORAGE_READ_WRITE_COMPUTE);
+
+	pass = rgAddPass(graph, "shadows", shadowPass, app);
+	rgPassUse(graph, pass, app->rgShadowMap, RG_ACCESS_DEPTH_ATTACHMENT_WRITE);
+
+	pass = rgAddPass(graph, "scene", scenePass, app);
+	rgPassUse(graph, pass, app->rgHdrColor, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+	rgPassUse(graph, pass, app->rgDepth, RG_ACCESS_DEPTH_ATTACHMENT_WRITE);
+	rgPassUse(graph, pass, app->rgLights, RG_ACCESS_STORAGE_READ_FRAGMENT);
+	rgPassUse(graph, pass, app->rgClusterCounts, RG_ACCESS_STORAGE_READ_FRAGMENT);
+	rgPassUse(graph, pass, app->rgClusterIndices, RG_ACCESS_STORAGE_READ_FRAGMENT);
+	rgPassUse(graph, pass, app->rgShadowMap, RG_ACCESS_SAMPLED_FRAGMENT);
+	rgPassUse(graph, pass, app->rgParticles, RG_ACCESS_STORAGE_READ_VERTEX);
+	rgPassUse(graph, pass, app->rgParticleCounters, RG_ACCESS_INDIRECT_READ);
+
+	// Writes only the host readback, which the graph doesn't track
+	pass = rgAddPass(graph, "particle_readback", particleReadbackPass, app);
+	rgPassUse(graph, pass, app->rgParticleCounters, RG_ACCESS_TRANSFER_READ);
+	rgPassSideEffects(graph, pass);
+
+	pass = rgAddPass(graph, "bloom", bloomPass, app);
+	rgPassUse(graph, pass, app->rgHdrColor, RG_ACCESS_SAMPLED_COMPUTE);
+	rgPassUse(graph, pass, app->rgBloom, RG_ACCESS_STORAGE_READ_WRITE_COMPUTE);
+
+	pass = rgAddPass(graph, "tonemap", tonemapPass, app);
+	rgPassUse(graph, pass, app->rgHdrColor, RG_ACCESS_SAMPLED_FRAGMENT);
+	rgPassUse(graph, pass, app->rgBloom, RG_ACCESS_SAMPLED_FRAGMENT);
+	rgPassUse(graph, pass, app->rgSwapchain, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+
+	if (!app->headless)
 	{
-		app->swapchainImageLayouts[imageIndex] = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		pass = rgAddPass(graph, "ui", uiPass, app);
+		rgPassUse(graph, pass, app->rgSwapchain, RG_ACCESS_COLOR_ATTACHMENT_READ_WRITE);
 	}
 
+	bool compiled = rgCompile(graph);
+	assert(compiled && "failed to compile the frame graph");
+	(void)compiled;
+	printf("Frame graph: %u passes (%u culled), %llu KB transient in %llu KB\n",
+	    graph->stats.passes, graph->stats.culledPasses,
+	    (unsigned long long)(graph->stats.transientBytes / 1024), (unsigned long long)(graph->stats.allocatedBytes / 1024));
+
+	createBloomDescriptors(app);
+}
+
+void recordCommandBuffer(Application* app, VkCommandBuffer commandBuffer, u32 imageIndex)
+{
+	VkCommandBufferBeginInfo beginInfo = {
+	    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+	    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+	VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+	gpuTimerReset(app, commandBuffer);
+	gpuTimerBegin(app, commandBuffer, GPU_TIMER_FRAME);
+
+	// Update camera & lights before anything is recorded so every pass sees this frame's matrices
+	updateFrameUniforms(app);
+
+	// The acquired image comes back from the presentation engine; contents are cleared anyway
+	app->imageIndex = imageIndex;
+	RgAccess released = app->headless ? RG_ACCESS_TRANSFER_READ : RG_ACCESS_PRESENT;
+	app->swapchainState = (RgState){.readMask = 1u << released, .layout = RG_LAYOUT_UNDEFINED};
+	rgUpdateImport(&app->frameGraph, app->rgSwapchain, (void*)app->swapchainImages[imageIndex],
+	    (void*)app->swapchainImageViews[imageIndex], &app->swapchainState);
+
+	// Compute, scene and UI in one command buffer; the graph places every barrier including PRESENT
+	rgExecute(&app->frameGraph, (void*)commandBuffer);
+
+	gpuTimerEnd(app, commandBuffer, GPU_TIMER_FRAME);
 	VK_CHECK(vkEndCommandBuffer(commandBuffer));
 }
-void drawFrame(Application* app)
+// Picks this frame's scene resolution from the GPU time of the frame just resolved
+static void updateRenderScale(Application* app)
 {
-	VK_CHECK(vkWaitForFences(app->device, 1, &app->inFlightFences[app->currentFrame], VK_TRUE, UINT64_MAX));
+	if (app->drsEnabled && (app->gpuTimer.resolvedMask & (1u << GPU_TIMER_FRAME)))
+	{
+		float gpuMs = (float)app->gpuTimer.ms[GPU_TIMER_FRAME];
+		app->renderScale = drsUpdate(&app->drs, gpuMs);
+		if (app->drsRecordTrace)
+			arrput(app->drsTrace, ((DrsTraceEntry){gpuMs, app->renderScale, app->drs.config.targetMs}));
+	}
+	else if (!app->drsEnabled)
+	{
+		app->renderScale = 1.0f;
+		drsInit(&app->drs, &app->drs.config);
+	}
+	app->renderWidth = drsScaledSize((u32)app->width, app->renderScale);
+	app->renderHeight = drsScaledSize((u32)app->height, app->renderScale);
+}
 
-	u32 imageIndex;
-	VkResult result = vkAcquireNextImageKHR(app->device, app->swapchain, UINT64_MAX, app->ImageAquireSemaphore[app->currentFrame], VK_NULL_HANDLE, &imageIndex);
+// Takes the counts of the frame just recorded and adds it to the overlay history. The cost of
+// the counters is this function plus the wrappers' share of recording.
+static void recordFrameStats(Application* app)
+{
+	double start = profilerNowUs();
+	app->frameCounters = takeFrameCounters();
+	PerfHistory* history = &app->perfHistory;
+	history->cpuMs[history->head] = app->deltaTime * 1000.0f;
+	history->gpuMs[history->head] = (float)app->gpuTimer.ms[GPU_TIMER_FRAME];
+	history->head = (history->head + 1) % PERF_HISTORY_FRAMES;
+	if (history->count < PERF_HISTORY_FRAMES)
+		history->count++;
+	app->counterOverheadUs = frameCounterOverheadUs(&app->frameCounters) + (profilerNowUs() - start);
+}
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+// Frame time graph, histogram and percentiles over the history window, the per-pass GPU
+// split, command counts and device memory. Only built while shown; sorting the window for
+// the percentiles is the one part that isn't constant time.
+static void buildPerfOverlay(Application* app)
+{
+	const PerfHistory* history = &app->perfHistory;
+	if (!nk_begin(app->nkCtx, "Frame times", nk_rect((float)app->width - 330.0f, 10, 320, 620),
+	        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_TITLE | NK_WINDOW_MINIMIZABLE))
 	{
-		recreateSwapchain(app);
+		nk_end(app->nkCtx);
 		return;
 	}
-	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+
+	// Oldest first
+	u32 count = history->count;
+	u32 first = (history->head + PERF_HISTORY_FRAMES - count) % PERF_HISTORY_FRAMES;
+	double cpuMs[PERF_HISTORY_FRAMES], gpuMs[PERF_HISTORY_FRAMES];
+	float maxMs = 1000.0f / 60.0f;
+	for (u32 i = 0; i < count; ++i)
 	{
-		assert(0 && "failed to acquire swap chain image!");
+		u32 index = (first + i) % PERF_HISTORY_FRAMES;
+		cpuMs[i] = history->cpuMs[index];
+		gpuMs[i] = history->gpuMs[index];
+		maxMs = fmaxf(maxMs, fmaxf(history->cpuMs[index], history->gpuMs[index]));
+	}
+	BenchmarkSummary cpu, gpu;
+	benchmarkSummarize(cpuMs, count, &cpu);
+	benchmarkSummarize(gpuMs, count, &gpu);
+
+	char text[128];
+	nk_layout_row_dynamic(app->nkCtx, 18, 1);
+	snprintf(text, sizeof(text), "Last %u frames (ms)    p50    p95    p99    max", count);
+	nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+	snprintf(text, sizeof(text), "CPU %6.2f %6.2f %6.2f %6.2f", cpu.p50, cpu.p95, cpu.p99, cpu.max);
+	nk_label_colored(app->nkCtx, text, NK_TEXT_LEFT, nk_rgb(255, 140, 90));
+	snprintf(text, sizeof(text), "GPU %6.2f %6.2f %6.2f %6.2f", gpu.p50, gpu.p95, gpu.p99, gpu.max);
+	nk_label_colored(app->nkCtx, text, NK_TEXT_LEFT, nk_rgb(110, 200, 120));
+
+	// Rolling graph; the scale never drops below 60 Hz so a steady frame reads as a flat line
+	nk_layout_row_dynamic(app->nkCtx, 90, 1);
+	if (nk_chart_begin_colored(app->nkCtx, NK_CHART_LINES, nk_rgb(255, 140, 90), nk_rgb(255, 200, 160), (int)count, 0.0f, maxMs))
+	{
+		nk_chart_add_slot_colored(app->nkCtx, NK_CHART_LINES, nk_rgb(110, 200, 120), nk_rgb(170, 240, 180), (int)count, 0.0f, maxMs);
+		for (u32 i = 0; i < count; ++i)
+		{
+			nk_chart_push_slot(app->nkCtx, (float)cpuMs[i], 0);
+			nk_chart_push_slot(app->nkCtx, (float)gpuMs[i], 1);
+		}
+		nk_chart_end(app->nkCtx);
 	}
 
-	VK_CHECK(vkResetFences(app->device, 1, &app->inFlightFences[app->currentFrame]));
+	// CPU frame time histogram over 0..max
+	u32 buckets[PERF_HISTOGRAM_BUCKETS] = {0};
+	u32 tallest = 1;
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 bucket = (u32)((float)cpuMs[i] / maxMs * PERF_HISTOGRAM_BUCKETS);
+		bucket = bucket < PERF_HISTOGRAM_BUCKETS ? bucket : PERF_HISTOGRAM_BUCKETS - 1;
+		if (++buckets[bucket] > tallest)
+			tallest = buckets[bucket];
+	}
+	nk_layout_row_dynamic(app->nkCtx, 60, 1);
+	if (nk_chart_begin_colored(app->nkCtx, NK_CHART_COLUMN, nk_rgb(255, 140, 90), nk_rgb(255, 200, 160), PERF_HISTOGRAM_BUCKETS, 0.0f, (float)tallest))
+	{
+		for (u32 i = 0; i < PERF_HISTOGRAM_BUCKETS; ++i)
+			nk_chart_push(app->nkCtx, (float)buckets[i]);
+		nk_chart_end(app->nkCtx);
+	}
+	nk_layout_row_dynamic(app->nkCtx, 18, 2);
+	nk_label(app->nkCtx, "0 ms", NK_TEXT_LEFT);
+	snprintf(text, sizeof(text), "%.1f ms", maxMs);
+	nk_label(app->nkCtx, text, NK_TEXT_RIGHT);
+
+	// Graph passes of the last resolved frame; nested ranges are in the Profiler window
+	nk_layout_row_dynamic(app->nkCtx, 18, 1);
+	double frameMs = app->gpuTimer.ms[GPU_TIMER_FRAME];
+	for (u32 i = 0; i < app->gpuTimer.resolvedRangeCount; ++i)
+	{
+		const GpuTimerRange* range = &app->gpuTimer.ranges[i];
+		if (range->depth > 0)
+			continue;
+		snprintf(text, sizeof(text), "%-12s %7.3f ms %5.1f%%", range->name, range->ms, frameMs > 0.0 ? range->ms / frameMs * 100.0 : 0.0);
+		nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+	}
 
-	// Build Nuklear UI first (updates settings used in this frame)
+	const BenchmarkCounters* counters = &app->frameCounters;
+	snprintf(text, sizeof(text), "Draws %u, dispatches %u, triangles %u", counters->draws, counters->dispatches, counters->triangles);
+	nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+	snprintf(text, sizeof(text), "Pipeline binds %u, descriptor binds %u", counters->pipelineBinds, counters->descriptorSetBinds);
+	nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+	snprintf(text, sizeof(text), "Barriers %u, render passes %u", counters->barriers, counters->renderPasses);
+	nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+	snprintf(text, sizeof(text), "Counting them: %.1f us (budget %.0f)", app->counterOverheadUs, BENCHMARK_COUNTER_BUDGET_US);
+	nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+
+	// The allocation count keeps climbing; the malloc count stops once the arena has grown to fit
+	const ArenaStats* scratch = &app->frameArenas[app->currentFrame].stats;
+	snprintf(text, sizeof(text), "Frame scratch peak %.1f KB, %llu allocations from %llu mallocs",
+	    scratch->peakBytes / 1024.0, (unsigned long long)scratch->allocations, (unsigned long long)scratch->blocks);
+	nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+
+	const DeletionQueue* deletion = &app->deletion;
+	snprintf(text, sizeof(text), "Deferred deletions %u pending (peak %u), %llu destroyed", (u32)arrlen(deletion->entries),
+	    deletion->peakPending, (unsigned long long)deletion->destroyed);
+	nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+
+	const DeviceMemoryStats* memory = deviceMemoryStats();
+	snprintf(text, sizeof(text), "Device memory %.1f MB (peak %.1f) in %u allocations", memory->totalBytes / 1048576.0,
+	    memory->peakBytes / 1048576.0, memory->allocations);
+	nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+	for (u32 category = 0; category < DEVICE_MEMORY_CATEGORY_COUNT; ++category)
+	{
+		if (memory->bytes[category] == 0)
+			continue;
+		snprintf(text, sizeof(text), "  %-15s %8.1f MB", deviceMemoryCategoryName((DeviceMemoryCategory)category), memory->bytes[category] / 1048576.0);
+		nk_label(app->nkCtx, text, NK_TEXT_LEFT);
+	}
+	nk_end(app->nkCtx);
+}
+
+// Every debug window; called before recording so the frame uses the settings edited here
+static void buildDebugUI(Application* app)
+{
 	nk_glfw3_new_frame();
 
+	if (app->perfOverlayVisible)
+		buildPerfOverlay(app);
+
 	// FPS Widget
-	if (nk_begin(app->nkCtx, "Performance", nk_rect(10, 10, 180, 60),
+	if (nk_begin(app->nkCtx, "Performance", nk_rect(10, 10, 220, 140),
 	        NK_WINDOW_BORDER | NK_WINDOW_NO_SCROLLBAR | NK_WINDOW_TITLE))
 	{
 		char fps_text[64];
 		snprintf(fps_text, sizeof(fps_text), "FPS: %.1f", app->fps);
-		nk_layout_row_dynamic(app->nkCtx, 30, 1);
+		nk_layout_row_dynamic(app->nkCtx, 20, 2);
 		nk_label(app->nkCtx, fps_text, NK_TEXT_LEFT);
+		nk_bool overlay = app->perfOverlayVisible;
+		nk_checkbox_label(app->nkCtx, "Overlay", &overlay);
+		app->perfOverlayVisible = overlay;
+		nk_layout_row_dynamic(app->nkCtx, 20, 1);
+
+		// Culling cost versus draws it saved
+		nk_bool occlusionEnabled = app->occlusionEnabled;
+		nk_checkbox_label(app->nkCtx, "Occlusion culling", &occlusionEnabled);
+		app->occlusionEnabled = occlusionEnabled;
+		char cull_text[96];
+		snprintf(cull_text, sizeof(cull_text), "Cull: %.3f ms (%u tris)",
+		    app->occlusion.stats.rasterMs + app->occlusion.stats.testMs, app->occlusion.stats.occluderTriangles);
+		nk_label(app->nkCtx, cull_text, NK_TEXT_LEFT);
+		snprintf(cull_text, sizeof(cull_text), "Draws culled: %u / %u", app->drawsCulled, app->mesh.primitive_count);
+		nk_label(app->nkCtx, cull_text, NK_TEXT_LEFT);
 	}
 	nk_end(app->nkCtx);
 
+	// Progress of the asset loader; gone once everything has been committed
+	if (app->assets.pending > 0)
+	{
+		if (nk_begin(app->nkCtx, "Loading", nk_rect((float)app->width * 0.5f - 120.0f, 10, 240, 60),
+		        NK_WINDOW_BORDER | NK_WINDOW_NO_SCROLLBAR | NK_WINDOW_TITLE))
+		{
+			u32 requested = (u32)arrlen(app->assets.requests);
+			char loading_text[96];
+			snprintf(loading_text, sizeof(loading_text), "Assets: %u / %u (%.1f s)", requested - app->assets.pending, requested,
+			    (benchmarkNowMs() - app->assets.startMs) / 1000.0);
+			nk_layout_row_dynamic(app->nkCtx, 20, 1);
+			nk_label(app->nkCtx, loading_text, NK_TEXT_LEFT);
+		}
+		nk_end(app->nkCtx);
+	}
+
 	// Camera Position Widget
 	if (nk_begin(app->nkCtx, "Camera Position", nk_rect(10, 80, 220, 100),
 	        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_TITLE))
@@ -1000,7 +1631,7 @@ void drawFrame(Application* app)
 	nk_end(app->nkCtx);
 
 	// Light Controls
-	if (nk_begin(app->nkCtx, "Light Controls", nk_rect(10, 190, 220, 250),
+	if (nk_begin(app->nkCtx, "Light Controls", nk_rect(10, 190, 220, 340),
 	        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_TITLE))
 	{
 		nk_layout_row_dynamic(app->nkCtx, 25, 1);
@@ -1019,12 +1650,144 @@ void drawFrame(Application* app)
 		app->dirLight.color[2] = color.b;
 
 		nk_layout_row_dynamic(app->nkCtx, 25, 1);
-		
+		int lightCount = (int)app->numActiveLights;
+		nk_property_int(app->nkCtx, "Point lights", 0, &lightCount, MAX_CLUSTERED_LIGHTS, 256, 16.0f);
+		app->numActiveLights = (u32)lightCount;
+		nk_bool cpuCull = app->clusterCullOnCpu;
+		nk_checkbox_label(app->nkCtx, "CPU light culling", &cpuCull);
+		app->clusterCullOnCpu = cpuCull;
+		if (app->clusterCullOnCpu)
+		{
+			char cluster_text[96];
+			snprintf(cluster_text, sizeof(cluster_text), "Assign: %.2f ms, max %u/cluster",
+			    app->clusterGrid.stats.assignMs, app->clusterGrid.stats.maxPerCluster);
+			nk_label(app->nkCtx, cluster_text, NK_TEXT_LEFT);
+		}
+	}
+	nk_end(app->nkCtx);
+
+	// Shadow cascades: GPU time of the last render and how often each one was re-rendered
+	if (nk_begin(app->nkCtx, "Shadows", nk_rect(530, 10, 260, 200),
+	        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_TITLE))
+	{
+		nk_layout_row_dynamic(app->nkCtx, 25, 1);
+		nk_bool shadows = app->shadowsEnabled;
+		nk_bool cache = app->shadowCacheEnabled;
+		nk_checkbox_label(app->nkCtx, "Enabled", &shadows);
+		nk_checkbox_label(app->nkCtx, "Cache far cascades", &cache);
+		app->shadowsEnabled = shadows;
+		app->shadowCacheEnabled = cache;
+		nk_property_float(app->nkCtx, "Distance", 5.0f, &app->shadowDistance, CAMERA_Z_FAR, 5.0f, 0.5f);
+
+		for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+		{
+			GpuTimerScope scope = GPU_TIMER_SHADOW_CASCADE0 + i;
+			bool rendered = app->gpuTimer.resolvedMask & (1u << scope);
+			char cascade_text[96];
+			snprintf(cascade_text, sizeof(cascade_text), "C%u: %.3f ms, %u updates%s", i, app->gpuTimer.ms[scope],
+			    app->cascades[i].updates, rendered ? "" : " (cached)");
+			nk_label(app->nkCtx, cascade_text, NK_TEXT_LEFT);
+		}
+	}
+	nk_end(app->nkCtx);
+
+	// HDR post: bloom settings and its GPU cost at every framebuffer size seen so far
+	if (nk_begin(app->nkCtx, "Bloom", nk_rect(530, 220, 260, 260),
+	        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_TITLE))
+	{
+		nk_layout_row_dynamic(app->nkCtx, 25, 1);
+		nk_bool bloom = app->bloomEnabled;
+		nk_checkbox_label(app->nkCtx, "Enabled", &bloom);
+		app->bloomEnabled = bloom;
+		nk_property_float(app->nkCtx, "Threshold", 0.0f, &app->bloomThreshold, 16.0f, 0.1f, 0.01f);
+		nk_property_float(app->nkCtx, "Knee", 0.0f, &app->bloomKnee, 1.0f, 0.05f, 0.01f);
+		nk_property_float(app->nkCtx, "Intensity", 0.0f, &app->bloomIntensity, 1.0f, 0.01f, 0.002f);
+		nk_property_float(app->nkCtx, "Exposure", 0.05f, &app->exposure, 16.0f, 0.1f, 0.01f);
+
+		for (u32 i = 0; i < app->bloomTimingCount; ++i)
+		{
+			BloomTiming* timing = &app->bloomTimings[i];
+			char bloom_text[96];
+			snprintf(bloom_text, sizeof(bloom_text), "%ux%u: %.1f us", timing->width, timing->height, timing->totalUs / timing->samples);
+			nk_label(app->nkCtx, bloom_text, NK_TEXT_LEFT);
+		}
+	}
+	nk_end(app->nkCtx);
+
+	// Dynamic resolution
+	if (nk_begin(app->nkCtx, "Resolution", nk_rect(800, 10, 240, 210),
+	        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_TITLE))
+	{
+		nk_layout_row_dynamic(app->nkCtx, 25, 1);
+		nk_bool drs = app->drsEnabled;
+		nk_bool record = app->drsRecordTrace;
+		nk_checkbox_label(app->nkCtx, "Dynamic resolution", &drs);
+		nk_checkbox_label(app->nkCtx, "Record trace", &record);
+		// Traces replay from a fresh controller, so a recording restarts it. Turning DRS off
+		// resets the controller under the recording, which ends it.
+		if (record && drs && !app->drsRecordTrace)
+		{
+			drsInit(&app->drs, &app->drs.config);
+			app->drsTraceConfig = app->drs.config;
+			arrsetlen(app->drsTrace, 0);
+		}
+		app->drsEnabled = drs;
+		app->drsRecordTrace = record && drs;
+		nk_property_float(app->nkCtx, "Target ms", 4.0f, &app->drs.config.targetMs, 50.0f, 0.5f, 0.05f);
+		nk_property_float(app->nkCtx, "Sharpness", 0.0f, &app->drsSharpness, 1.0f, 0.05f, 0.01f);
+		char drs_text[96];
+		snprintf(drs_text, sizeof(drs_text), "%ux%u (%.0f%%), GPU %.2f ms", app->renderWidth, app->renderHeight,
+		    app->renderScale * 100.0f, app->gpuTimer.ms[GPU_TIMER_FRAME]);
+		nk_label(app->nkCtx, drs_text, NK_TEXT_LEFT);
+	}
+	nk_end(app->nkCtx);
+
+	if (nk_begin(app->nkCtx, "Particles", nk_rect(800, 230, 240, 210),
+	        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_TITLE))
+	{
+		nk_layout_row_dynamic(app->nkCtx, 25, 1);
+		nk_bool particles = app->particlesEnabled;
+		nk_checkbox_label(app->nkCtx, "Simulate", &particles);
+		app->particlesEnabled = particles;
+		nk_property_float(app->nkCtx, "Emit / s", 0.0f, &app->particleEmitRate, 2000000.0f, 10000.0f, 1000.0f);
+		nk_property_float(app->nkCtx, "Intensity", 0.0f, &app->particleIntensity, 32.0f, 0.5f, 0.05f);
+		// Copied out MAX_FRAMES_IN_FLIGHT frames ago; good enough for a readout
+		const ParticleCounters* counters = particleCountersReadback(app);
+		char particle_text[96];
+		snprintf(particle_text, sizeof(particle_text), "%u / %u alive, GPU %.2f ms",
+		    PARTICLE_MAX_CAPACITY - counters->deadCount, PARTICLE_MAX_CAPACITY, app->gpuTimer.ms[GPU_TIMER_PARTICLES]);
+		nk_label(app->nkCtx, particle_text, NK_TEXT_LEFT);
+	}
+	nk_end(app->nkCtx);
+
+	// Per-pass GPU times of the last resolved frame, and Chrome trace captures
+	if (nk_begin(app->nkCtx, "Profiler", nk_rect(240, 340, 280, 300),
+	        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_TITLE))
+	{
+		Profiler* profiler = &app->profiler;
+		nk_layout_row_dynamic(app->nkCtx, 25, 1);
+		if (profilerCapturing(profiler))
+		{
+			char capture_text[64];
+			snprintf(capture_text, sizeof(capture_text), "Capturing... %u frames left", profiler->captureFrames + profiler->drainFrames);
+			nk_label(app->nkCtx, capture_text, NK_TEXT_LEFT);
+		}
+		else if (nk_button_label(app->nkCtx, "Capture trace (" PROFILER_TRACE_PATH ")"))
+			profilerStartCapture(profiler, PROFILER_CAPTURE_FRAMES, MAX_FRAMES_IN_FLIGHT);
+
+		nk_layout_row_dynamic(app->nkCtx, 18, 1);
+		for (u32 i = 0; i < app->gpuTimer.resolvedRangeCount; ++i)
+		{
+			const GpuTimerRange* range = &app->gpuTimer.ranges[i];
+			char range_text[96];
+			snprintf(range_text, sizeof(range_text), "%*s%s: %.3f ms", (int)range->depth * 2, "", range->name, range->ms);
+			nk_label(app->nkCtx, range_text, NK_TEXT_LEFT);
+		}
 	}
 	nk_end(app->nkCtx);
 
 	// UI: stylized controls and directional light intensity
-	if (nk_begin(app->nkCtx, "Shading", nk_rect(240, 10, 280, 250),
+	if (nk_begin(app->nkCtx, "Shading", nk_rect(240, 10, 280, 320),
 			NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_TITLE))
 	{
 		nk_layout_row_dynamic(app->nkCtx, 25, 1);
@@ -1039,72 +1802,118 @@ void drawFrame(Application* app)
 		nk_property_float(app->nkCtx, "Light Wrap", 0.0f, &app->toonWrap, 1.0f, 0.01f, 0.005f);
 		nk_property_float(app->nkCtx, "Rim Strength", 0.0f, &app->rimStrength, 2.0f, 0.01f, 0.005f);
 		nk_property_float(app->nkCtx, "Rim Width", 0.1f, &app->rimWidth, 4.0f, 0.1f, 0.01f);
+
+		nk_layout_row_dynamic(app->nkCtx, 25, 1);
+		nk_bool depthPrepass = app->depthPrepassEnabled;
+		nk_bool specialize = app->specializeMaterials;
+		bool rebuild = nk_checkbox_label(app->nkCtx, "Depth prepass", &depthPrepass);
+		rebuild |= nk_checkbox_label(app->nkCtx, "Specialize materials", &specialize);
+		app->depthPrepassEnabled = depthPrepass;
+		app->specializeMaterials = specialize;
+		// Specialized variants bake the shading model in
+		if (app->specializeMaterials && app->stylizedMode != app->meshPipelineStylizedMode)
+			rebuild = true;
+		if (rebuild)
+			createMeshPipelines(app);
 	}
 	nk_end(app->nkCtx);
+}
+
+void drawFrame(Application* app)
+{
+	Profiler* profiler = &app->profiler;
+	profilerBeginCpu(profiler, "wait_fence");
+	VK_CHECK(vkWaitForFences(app->device, 1, &app->inFlightFences[app->currentFrame], VK_TRUE, UINT64_MAX));
+	profilerEndCpu(profiler);
+	deletionQueueFlush(app);
+	arenaReset(&app->frameArenas[app->currentFrame]);
+	gpuTimerResolve(app);
+	recordBloomTiming(app);
+	updateRenderScale(app);
+	profilerBeginCpu(profiler, "assets");
+	assetsUpdate(app);
+	profilerEndCpu(profiler);
+
+	u32 imageIndex = 0;
+	VkResult result = VK_SUCCESS;
+	profilerBeginCpu(profiler, "acquire");
+	if (!app->headless)
+		result = vkAcquireNextImageKHR(app->device, app->swapchain, UINT64_MAX, app->ImageAquireSemaphore[app->currentFrame], VK_NULL_HANDLE, &imageIndex);
+	profilerEndCpu(profiler);
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		recreateSwapchain(app);
+		return;
+	}
+	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+	{
+		assert(0 && "failed to acquire swap chain image!");
+	}
+	if (!app->headless)
+		deletionQueueImageAcquired(app);
+
+	VK_CHECK(vkResetFences(app->device, 1, &app->inFlightFences[app->currentFrame]));
+
+	// Build Nuklear UI first (updates settings used in this frame)
+	if (!app->headless)
+	{
+		profilerBeginCpu(profiler, "ui");
+		buildDebugUI(app);
+		profilerEndCpu(profiler);
+	}
+
+	// Cull against this frame's camera before any draw is recorded
+	profilerBeginCpu(profiler, "occlusion");
+	updateOcclusionCulling(app);
+	buildDrawLists(app);
+	profilerEndCpu(profiler);
 
 	// Record commands after UI so UBO uses updated settings
+	profilerBeginCpu(profiler, "record");
 	VkCommandBuffer commandBuffer = app->commandBuffers[app->currentFrame];
 	VK_CHECK(vkResetCommandBuffer(commandBuffer, 0));
 	recordCommandBuffer(app, commandBuffer, imageIndex);
-
-	// Submit the main command buffer first; signal per-image sceneDone semaphore
+	profilerEndCpu(profiler);
+	profilerBeginCpu(profiler, "frame_stats");
+	recordFrameStats(app);
+	profilerEndCpu(profiler);
+
+	// Single submit per frame: compute, scene, UI and the PRESENT transition share one command buffer.
+	// Headless frames have nothing to acquire or present; the fence alone paces them.
+	bool present = !app->headless;
 	VkSubmitInfo submitInfo = {
 	    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-	    .waitSemaphoreCount = 1,
+	    .waitSemaphoreCount = present ? 1 : 0,
 	    .pWaitSemaphores = &app->ImageAquireSemaphore[app->currentFrame],
 	    .pWaitDstStageMask = (VkPipelineStageFlags[]){VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT},
 	    .commandBufferCount = 1,
 	    .pCommandBuffers = &commandBuffer,
-	    .signalSemaphoreCount = 1,
-	    .pSignalSemaphores = &app->sceneDoneSemaphores[imageIndex],
+	    .signalSemaphoreCount = present ? 1 : 0,
+	    .pSignalSemaphores = present ? &app->imageReleaseSemaphore[imageIndex] : NULL,
 	};
+	profilerBeginCpu(profiler, "submit");
+	app->gpuTimer.submitUs[app->currentFrame] = profilerNowUs();
 	VK_CHECK(vkQueueSubmit(app->graphicsQueue, 1, &submitInfo, app->inFlightFences[app->currentFrame]));
-
-	// Render Nuklear UI waiting on sceneDone; returns NK's own completion semaphore
-	VkSemaphore nk_done_semaphore = nk_glfw3_render(
-	    app->graphicsQueue, imageIndex, app->sceneDoneSemaphores[imageIndex], NK_ANTI_ALIASING_ON);
-
-	// Optional: record a tiny cmd buffer to ensure final layout is PRESENT (no-op if already tracked)
-	VkCommandBuffer presentCmd = app->presentCmdBuffers[imageIndex];
-	VK_CHECK(vkResetCommandBuffer(presentCmd, 0));
-	VkCommandBufferBeginInfo beginInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-	VK_CHECK(vkBeginCommandBuffer(presentCmd, &beginInfo));
-	if (!app->swapchainImageLayouts || app->swapchainImageLayouts[imageIndex] != VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
-	{
-		transitionImageLayout(presentCmd, app->swapchainImages[imageIndex],
-		    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-		    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0,
-		    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		    VK_IMAGE_ASPECT_COLOR_BIT);
-		if (app->swapchainImageLayouts)
-			app->swapchainImageLayouts[imageIndex] = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-	}
-	VK_CHECK(vkEndCommandBuffer(presentCmd));
-
-	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	VkSubmitInfo presentSubmit = {
-	    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-	    .waitSemaphoreCount = 1,
-	    .pWaitSemaphores = &nk_done_semaphore,
-	    .pWaitDstStageMask = &waitStage,
-	    .commandBufferCount = 1,
-	    .pCommandBuffers = &presentCmd,
-	    .signalSemaphoreCount = 1,
-	    .pSignalSemaphores = &app->presentReadySemaphores[imageIndex],
-	};
-	VK_CHECK(vkQueueSubmit(app->graphicsQueue, 1, &presentSubmit, VK_NULL_HANDLE));
+	deletionQueueSubmitted(app);
+	profilerEndCpu(profiler);
+	if (!present)
+	{
+		app->currentFrame = (app->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+		return;
+	}
 
 	VkPresentInfoKHR presentInfo = {
 	    .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
 	    .waitSemaphoreCount = 1,
-	    .pWaitSemaphores = &app->presentReadySemaphores[imageIndex],
+	    .pWaitSemaphores = &app->imageReleaseSemaphore[imageIndex],
 	    .swapchainCount = 1,
 	    .pSwapchains = &app->swapchain,
 	    .pImageIndices = &imageIndex,
 	};
+	profilerBeginCpu(profiler, "present");
 	result = vkQueuePresentKHR(app->graphicsQueue, &presentInfo);
+	profilerEndCpu(profiler);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || app->framebufferResized)
 	{
@@ -1120,8 +1929,18 @@ void drawFrame(Application* app)
 }
 void mainLoop(Application* app)
 {
+	Profiler* profiler = &app->profiler;
 	while (!glfwWindowShouldClose(app->window))
 	{
+		// A finished capture is written before the next frame starts recording
+		if (profilerNewFrame(profiler))
+		{
+			bool written = profilerWriteChromeTrace(profiler, PROFILER_TRACE_PATH);
+			printf("Profiler: %u events%s %s %s\n", profiler->eventCount, profiler->droppedEvents ? " (some dropped)" : "",
+			    written ? "written to" : "failed to write", PROFILER_TRACE_PATH);
+		}
+		profilerBeginCpu(profiler, "frame");
+
 		float currentFrame = glfwGetTime();
 		app->deltaTime = currentFrame - app->lastFrame;
 		app->lastFrame = currentFrame;
@@ -1135,88 +1954,63 @@ void mainLoop(Application* app)
 			app->fpsLastTime = currentFrame;
 		}
 
+		profilerBeginCpu(profiler, "input");
 		glfwPollEvents();
 		processInput(app);
-		updateLights(app);
-
-		// Execute compute shaders
-		VkCommandBufferBeginInfo beginInfo = {
-		    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-		};
-		VK_CHECK(vkBeginCommandBuffer(app->computeCmdBuffer, &beginInfo));
-
-		recordComputeCommands(app);
-		recordParticleComputeCommands(app);
+		profilerEndCpu(profiler);
 
-		VK_CHECK(vkEndCommandBuffer(app->computeCmdBuffer));
-
-		VkSubmitInfo computeSubmit = {
-		    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		    .commandBufferCount = 1,
-		    .pCommandBuffers = &app->computeCmdBuffer,
-		};
-		vkQueueSubmit(app->graphicsQueue, 1, &computeSubmit, app->computeFence);
-
-		// Wait for compute to finish before rendering
-		vkWaitForFences(app->device, 1, &app->computeFence, VK_TRUE, UINT64_MAX);
-		vkResetFences(app->device, 1, &app->computeFence);
+		profilerBeginCpu(profiler, "update_lights");
+		updateLights(app, currentFrame);
+		profilerEndCpu(profiler);
 
 		drawFrame(app);
+		profilerEndCpu(profiler);
 	}
 
 	vkDeviceWaitIdle(app->device);
+	savePipelineCache(app, PIPELINE_CACHE_PATH);
 }
 
+// Everything here may still be in use by frames in flight, so it all goes through the deletion
+// queue. app->swapchain keeps naming the retired swapchain until the next one replaces it.
 void cleanupSwapchain(Application* app)
 {
-	vkDestroyImageView(app->device, app->depthImageView, NULL);
-	vkDestroyImage(app->device, app->depthImage, NULL);
-	vkFreeMemory(app->device, app->depthImageMemory, NULL);
+	// Frees the transient attachments; the bloom mip views go first
+	destroyBloomViews(app);
+	rgDestroy(&app->frameGraph);
 
 	for (u32 i = 0; i < app->swapchainImageCount; i++)
 	{
-		vkDestroyImageView(app->device, app->swapchainImageViews[i], NULL);
+		deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_IMAGE_VIEW, .view = app->swapchainImageViews[i]});
 	}
-	free(app->swapchainImageViews);
-	free(app->swapchainImages);
 
-	vkDestroySwapchainKHR(app->device, app->swapchain, NULL);
-	// Clean up per-image semaphores (they are tied to swapchain images)
+	if (app->headless)
+		destroyOffscreenTarget(app);
+	else
+		deferDestroyAfterPresent(app, (DeferredDeletion){.kind = DEFERRED_SWAPCHAIN, .swapchain = app->swapchain});
+	// Clean up per-image semaphores (they are tied to swapchain images). Presents wait on them,
+	// so like the swapchain they outlive the frame fences; headless frames never present.
 	if (app->imageReleaseSemaphore)
 	{
 		for (u32 i = 0; i < app->swapchainImageCount; i++)
 		{
-			vkDestroySemaphore(app->device, app->imageReleaseSemaphore[i], NULL);
+			DeferredDeletion deletion = {.kind = DEFERRED_SEMAPHORE, .semaphore = app->imageReleaseSemaphore[i]};
+			if (app->headless)
+				deferDestroy(app, deletion);
+			else
+				deferDestroyAfterPresent(app, deletion);
 		}
-		free(app->imageReleaseSemaphore);
 		app->imageReleaseSemaphore = NULL;
 	}
-	if (app->sceneDoneSemaphores)
-	{
-		for (u32 i = 0; i < app->swapchainImageCount; i++)
-		{
-			vkDestroySemaphore(app->device, app->sceneDoneSemaphores[i], NULL);
-		}
-		free(app->sceneDoneSemaphores);
-		app->sceneDoneSemaphores = NULL;
-	}
-	if (app->presentReadySemaphores)
-	{
-		for (u32 i = 0; i < app->swapchainImageCount; i++)
-		{
-			vkDestroySemaphore(app->device, app->presentReadySemaphores[i], NULL);
-		}
-		free(app->presentReadySemaphores);
-		app->presentReadySemaphores = NULL;
-	}
-	if (app->swapchainImageLayouts)
-	{
-		free(app->swapchainImageLayouts);
-		app->swapchainImageLayouts = NULL;
-	}
+	// The per-image arrays all go at once; the memory is kept for the next swapchain
+	app->swapchainImages = NULL;
+	app->swapchainImageViews = NULL;
+	arenaReset(&app->swapchainArena);
 }
 
+// Never waits for the GPU: the old swapchain is handed to the new one as oldSwapchain. The old
+// views and attachments go once the frames using them have finished; the swapchain and its
+// present semaphores once the new swapchain has been presented from (deferDestroyAfterPresent)
 void recreateSwapchain(Application* app)
 {
 	int width = 0, height = 0;
@@ -1227,52 +2021,57 @@ void recreateSwapchain(Application* app)
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle(app->device);
+	profilerBeginCpu(&app->profiler, "recreate_swapchain");
+	double start = benchmarkNowMs();
+	u64 deferred = app->deletion.deferred;
 
-	// Destroy pipeline before swapchain resources (like render pass)
-	vkDestroyPipeline(app->device, app->pipelines[0], NULL);
+	// Mesh pipelines only depend on the swapchain and depth formats, which don't change here
 	cleanupSwapchain(app);
-	// Destroy Nuklear device before swapchain recreation (keeps nk_context alive)
-	nk_glfw3_device_destroy();
 	app->width = width;
 	app->height = height;
 
 	createSwapchainRelatedResources(app);
-	app->pipelines[0] = createMeshPipeline(app, app->vertShaderModule, app->fragShaderModule, &app->mesh.materials[0]);
+	buildFrameGraph(app);
 
-	// Recreate Nuklear device with new swapchain image views and framebuffer size
-	{
-		u32 graphicsqueueFamilyIndex = find_graphics_queue_family_index(app->physicalDevice);
-		nk_glfw3_device_create(
-		    app->device, app->physicalDevice,
-		    graphicsqueueFamilyIndex,
-		    app->swapchainImageViews, app->swapchainImageCount,
-		    app->swapchainFormat,
-		    512 * 1024, 128 * 1024,
-		    (uint32_t)app->width, (uint32_t)app->height);
-
-		// Re-upload font atlas for Nuklear
-		struct nk_font_atlas* atlas = NULL;
-		nk_glfw3_font_stash_begin(&atlas);
-		nk_glfw3_font_stash_end(app->graphicsQueue);
-	}
+	// Nuklear renders into our command buffer, so it only needs the new views and size
+	nk_glfw3_swapchain_changed(app->swapchainImageViews, app->swapchainImageCount, (uint32_t)app->width, (uint32_t)app->height);
 
-	// Make sure Nuklear knows the new framebuffer size
-	nk_glfw3_resize((uint32_t)app->width, (uint32_t)app->height);
+	profilerEndCpu(&app->profiler);
+	printf("Swapchain: recreated at %dx%d in %.2f ms, %llu objects deferred\n", app->width, app->height,
+	    benchmarkNowMs() - start, (unsigned long long)(app->deletion.deferred - deferred));
 }
 
 void cleanup(Application* app)
 {
 	vkDeviceWaitIdle(app->device);
+	assetsDestroy(app);
+	// Retired objects go while the registry and descriptor pool they belong to still exist
+	deletionQueueDestroyAll(app, false);
 
 	// Clean up nuklear
-	nk_glfw3_shutdown();
+	if (!app->headless)
+		nk_glfw3_shutdown();
 
 	cleanAcquiresemaphore_and_fences(app);
 	cleanupResources(app);
 	cleanupPipeline(app);
 	cleanupComputePipeline(app, &app->compute);
-	cleanupComputePipeline(app, &app->particleCompute);
+	cleanupParticleSystem(app);
+	cleanupOcclusionCulling(app);
+	cleanupClusteredLighting(app);
+	cleanupShadowResources(app);
+	cleanupBloomSystem(app);
+	if (arrlen(app->drsTrace) > 0 && drsTraceWrite(DRS_TRACE_PATH, &app->drsTraceConfig, app->drsTrace, (u32)arrlen(app->drsTrace)))
+		printf("Dynamic resolution: %u frames written to %s\n", (u32)arrlen(app->drsTrace), DRS_TRACE_PATH);
+	arrfree(app->drsTrace);
+	gpuTimerDestroy(app);
+	profilerDestroy(&app->profiler);
+	fileioDestroy(app->io);
+	app->io = NULL;
+	pakClose(app->pak);
+	app->pak = NULL;
+	jobsDestroy(app->jobs);
+	app->jobs = NULL;
 	vkDestroyPipeline(app->device, app->skyboxPipeline, NULL);
 	vkDestroyPipelineLayout(app->device, app->skyboxPipelineLayout, NULL);
 	vkDestroyDescriptorSetLayout(app->device, app->skyboxDescriptorSetLayout, NULL);
@@ -1281,29 +2080,62 @@ void cleanup(Application* app)
 	vkDestroyImage(app->device, app->skyboxTexture.image, NULL);
 	vkFreeMemory(app->device, app->skyboxTexture.memory, NULL);
 	destroyBuffer(app->device, &app->skyboxVertexBuffer);
-	vkDestroyPipeline(app->device, app->particlePipeline, NULL);
-	vkDestroyPipelineLayout(app->device, app->particlePipelineLayout, NULL);
-	vkDestroyDescriptorSetLayout(app->device, app->particleGraphicsDescriptorSetLayout, NULL);
 	vkDestroyImageView(app->device, app->computeImage.view, NULL);
 	vkDestroyImage(app->device, app->computeImage.image, NULL);
 	vkFreeMemory(app->device, app->computeImage.memory, NULL);
+	arrfree(app->pathBrushStamps);
 	cleanupSwapchain(app);
-
-	vkDestroySurfaceKHR(app->instance, app->surface, NULL);
+	deletionQueueDestroyAll(app, true);
+	arenaFree(&app->swapchainArena);
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		arenaFree(&app->frameArenas[i]);
+	destroyPipelineCache(app);
+
+	if (!app->headless)
+		vkDestroySurfaceKHR(app->instance, app->surface, NULL);
 	free(app->commandBuffers);
 	vkDestroyCommandPool(app->device, app->commandPool, NULL);
 	vkDestroyDevice(app->device, NULL);
 	vkDestroyInstance(app->instance, NULL);
 
+	if (app->headless)
+		return;
 	glfwDestroyWindow(app->window);
 	glfwTerminate();
 }
 
-int main(void)
+int main(int argc, char** argv)
 {
 	Application app = {0};
+	if (!benchmarkParseArgs(argc, argv, &app.benchmark))
+		return 1;
+	if (app.benchmark.jobs)
+	{
+		benchmarkJobs();
+		return 0;
+	}
+	if (app.benchmark.io)
+	{
+		benchmarkFileIO(BENCHMARK_IO_DIRECTORY, app.benchmark.pakPath);
+		return 0;
+	}
+	app.headless = app.benchmark.headless;
+	app.jobs = jobsCreate(0);
+	printf("Jobs: %u workers\n", jobsWorkerCount(app.jobs));
+	app.io = fileioCreate(app.jobs, !app.benchmark.noUring);
+	printf("File I/O: %s\n", fileioUsesUring(app.io) ? "io_uring" : "pread on the job system");
+	app.pak = app.benchmark.noPak ? NULL : pakOpen(app.benchmark.pakPath);
+	fileioMount(app.io, app.pak);
+	if (app.pak)
+		printf("Archive: %s, %u entries\n", app.benchmark.pakPath, pakEntryCount(app.pak));
+	else
+		printf("Archive: none, reading loose files\n");
 	initWindow(&app);
+	double startupStart = benchmarkNowMs();
 	initVulkan(&app);
+	printf("Startup: %.1f ms (%s pipeline cache)\n", benchmarkNowMs() - startupStart, app.pipelineCacheWarm ? "warm" : "cold");
+	if (app.headless)
+		return runBenchmark(&app) ? 0 : 1;
 	mainLoop(&app);
 	//cleanup(&app);
 	return 0;
@@ -1405,28 +2237,20 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 	glm_vec3_copy(front, app->cameraFront);
 }
 
-void updateLights(Application* app)
+// time in seconds: glfwGetTime in the window loop, the frame index times a fixed step headless
+void updateLights(Application* app, float time)
 {
-	float time = glfwGetTime();
-
-	// Animate light positions in a circular pattern
-	float radius = 3.0f;
-
-	// Light 1 - Red, circular motion in XZ plane
-	app->lights[0].position[0] = cosf(time) * radius;
-	app->lights[0].position[2] = sinf(time) * radius;
-
-	// Light 2 - Green, circular motion in XZ plane (offset)
-	app->lights[1].position[0] = cosf(time + 3.14159265f) * radius;
-	app->lights[1].position[2] = sinf(time + 3.14159265f) * radius;
-
-	// Light 3 - Blue, up and down motion
-	app->lights[2].position[1] = 1.0f + sinf(time * 2.0f) * 1.5f;
-
-	// Light 4 - White, diagonal circular motion
-	app->lights[3].position[0] = cosf(time * 0.5f) * radius * 0.7f;
-	app->lights[3].position[1] = 1.0f + sinf(time * 0.7f) * 1.0f;
-	app->lights[3].position[2] = sinf(time * 0.5f) * radius * 0.7f;
+	// Every light orbits its origin; speed and phase vary so they don't move in lockstep
+	for (u32 i = 0; i < app->numActiveLights; i++)
+	{
+		const float* origin = app->lightOrigins[i];
+		float* position = app->lights[i].positionRadius;
+		float orbit = position[3] * 0.5f;
+		float t = time * (0.5f + 0.1f * (float)(i % 7)) + origin[3];
+		position[0] = origin[0] + cosf(t) * orbit;
+		position[1] = origin[1] + sinf(t * 1.3f) * orbit * 0.5f;
+		position[2] = origin[2] + sinf(t) * orbit;
+	}
 
 	// Animate directional light
 	//	app->dirLight.direction[0] = sinf(time * 2.0f);
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <assert.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #define _USE_MATH_DEFINE
 #include <math.h>
 
@@ -39,6 +41,17 @@
 #include <GLFW/glfw3native.h>
 
 #include "tinytypes.h"
+#include "occlusion.h"
+#include "clusters.h"
+#include "drs.h"
+#include "benchmark.h"
+#include "profiler.h"
+#include "jobs.h"
+#include "arena.h"
+#include "pool.h"
+#include "fileio.h"
+#include "particlesim.h"
+#include "rendergraph.h"
 #define VK_CHECK(call) \
 	do \
 	{\
@@ -88,6 +101,21 @@ typedef struct Texture
 	VkImageView view;
 	VkSampler sampler;
 } Texture;
+
+// Generational handles into the resource registry (resources.c); 0 is never a live handle.
+// Wrapped in structs so one kind can't be passed where another is expected.
+typedef struct ImageHandle { u32 id; } ImageHandle;
+typedef struct SamplerHandle { u32 id; } SamplerHandle;
+typedef struct BufferHandle { u32 id; } BufferHandle;
+typedef struct PipelineHandle { u32 id; } PipelineHandle;
+typedef struct MaterialHandle { u32 id; } MaterialHandle;
+// RGBA8 pixels straight out of stb_image, before any Vulkan object exists
+typedef struct DecodedImage
+{
+	const char* path;
+	stbi_uc* pixels;
+	int width, height, channels;
+} DecodedImage;
 typedef struct StorageImage
 {
 	VkImage image;
@@ -112,6 +140,7 @@ typedef struct Material
     float alphaCutoff;
     int alphaMode;
     bool doubleSided;
+    MaterialHandle handle; // GPU side in the resource registry, once the scene is attached
 } Material;
 
 // GPU-facing packed material data (std140-friendly via vec4-sized fields)
@@ -134,15 +163,34 @@ typedef struct Primitive
 	u32 first_index;    // Starting index in the index buffer
 	u32 index_count;    // Number of indices for this primitive
 	int material_index; // Index into the materials array
+	vec3 aabbMin;       // World-space bounds (vertices are pre-transformed)
+	vec3 aabbMax;
 } Primitive;
 
-#define MAX_POINT_LIGHTS 8
-
-typedef struct PointLight
-{
-	vec4 position;
-	vec4 color;
-} PointLight;
+#define CAMERA_FOV_Y_DEGREES 45.0f
+#define CAMERA_Z_NEAR 0.01f
+#define CAMERA_Z_FAR 1000.0f
+#define DEFAULT_POINT_LIGHTS 1024
+
+#define SHADOW_CASCADE_COUNT 4 // cascadeSplits is a vec4
+#define SHADOW_MAP_SIZE 2048
+#define SHADOW_CACHED_FIRST 2  // cascades from here on are re-rendered only when invalidated
+#define SHADOW_DEFAULT_DISTANCE 60.0f
+#define SHADOW_MAP_FORMAT VK_FORMAT_D32_SFLOAT
+
+// HDR scene target, bloom chain and tonemapping
+#define HDR_COLOR_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+#define BLOOM_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+#define BLOOM_MIP_COUNT 7   // mip 0 is half res; one 64x64 downsample tile reduces to a texel of mip 6
+#define BLOOM_SET_GENERATIONS (MAX_FRAMES_IN_FLIGHT + 2) // descriptor sets in use plus those retired by graph rebuilds
+#define BLOOM_TILE_SIZE 64
+#define BLOOM_MAX_TIMINGS 8 // distinct framebuffer sizes kept for the cost report
+
+// Dynamic resolution: the scene renders into the top-left renderWidth x renderHeight of the
+// full-size HDR target, tonemap.frag upscales and sharpens it into the swapchain
+#define DRS_DEFAULT_TARGET_MS 16.6f
+#define DRS_DEFAULT_SHARPNESS 0.5f
+#define DRS_TRACE_PATH "drs_trace.csv"
 
 typedef struct DirectionalLight
 {
@@ -157,7 +205,8 @@ typedef struct UniformBufferObject
 	mat4 model;
 	vec3 cameraPos;
 	u32 numLights;
-	PointLight lights[MAX_POINT_LIGHTS];
+	vec4 clusterDepth;  // x: zNear, y: zFar, z: slice scale, w: slice bias (ClusterParams)
+	vec4 clusterScreen; // xy: framebuffer size, z: tan(fovY / 2), w: aspect
 	DirectionalLight dirLight;
 	// Stylized rendering controls
 	int stylizedMode;            // 0=PBR, 1=Toon (global override)
@@ -169,12 +218,82 @@ typedef struct UniformBufferObject
 	float toonWrap;              // light wrap (0..1)
 	float rimStrength;           // rim light intensity (0..2)
 	float rimWidth;              // rim width exponent control (0..4)
+	// Directional light shadow cascades
+	mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+	vec4 cascadeSplits; // view-space far distance of each cascade
+	vec4 shadowParams;  // x: 1 / SHADOW_MAP_SIZE, y: depth bias, z: unused, w: enabled
 } UniformBufferObject TYPE_ALIGN16;
 
+typedef enum MeshPipelineKind
+{
+	MESH_PIPELINE_SHADED,
+	MESH_PIPELINE_PREPASS_OPAQUE, // position-only stream, no fragment shader
+	MESH_PIPELINE_PREPASS_MASKED, // alpha-tested depth
+} MeshPipelineKind;
+
+typedef enum MeshDynamicStateFlags
+{
+	MESH_DYNAMIC_RASTER = 1 << 0, // cull mode, front face, depth write and compare op
+	MESH_DYNAMIC_BLEND = 1 << 1,  // color blend enable (EXT_extended_dynamic_state3)
+} MeshDynamicStateFlags;
+
+// tri.frag specialization constants (constant_id order); -1 leaves the branch dynamic
+typedef enum MeshSpecConstant
+{
+	MESH_SPEC_HAS_BASE_COLOR,
+	MESH_SPEC_HAS_METALLIC_ROUGHNESS,
+	MESH_SPEC_HAS_EMISSIVE,
+	MESH_SPEC_ALPHA_MODE,
+	MESH_SPEC_SHADING_MODEL,
+	MESH_SPEC_COUNT
+} MeshSpecConstant;
+
+// Everything a mesh pipeline varies by; materials with equal keys share one VkPipeline
+typedef struct MeshPipelineKey
+{
+	u32 kind; // MeshPipelineKind
+	u32 dynamicState; // MeshDynamicStateFlags; dynamic state is left out of the key
+	u32 doubleSided;
+	u32 blended;
+	u32 depthPrepass; // shaded pipelines test EQUAL against the prepass depth
+	VkShaderModule vertShader;
+	VkShaderModule fragShader;
+	VkFormat colorFormat;
+	VkFormat depthFormat;
+	i32 spec[MESH_SPEC_COUNT];
+} MeshPipelineKey;
+
+typedef struct MeshPipelineEntry
+{
+	u64 hash;
+	MeshPipelineKey key;
+	VkPipeline pipeline;
+	PipelineHandle handle; // registered once compiled; the registry destroys the pipeline
+} MeshPipelineEntry;
+
+// A glTF primitive placed by the node walk, waiting for its vertices to be decoded
+typedef struct GltfPrimitiveTask
+{
+	const cgltf_primitive* primitive;
+	float worldTransform[16]; // mat4, unaligned in the stb_ds array
+	int materialIndex;
+	u32 firstVertex, firstIndex;
+	u32 vertexCount, indexCount;
+	u32 primitiveIndex; // UINT32_MAX past primitive_count
+} GltfPrimitiveTask;
+
+// A loaded glTF kept alive until its streams have been decoded into the GPU buffers
+typedef struct GltfSource
+{
+	Arena import; // cgltf's document and buffers
+	cgltf_data* data;
+	GltfPrimitiveTask* tasks; // stb_ds, in vertex and index order
+	u32* primitiveTasks; // task of each mesh primitive, UINT32_MAX if none
+} GltfSource;
+
 typedef struct Mesh
 {
-	Vertex* vertices;
-	u32* indices;
+	GltfSource* source; // freed once the scene is attached
 	u32 vertex_count;
 	u32 index_count;
 
@@ -188,6 +307,8 @@ typedef struct Mesh
 	char* texture_path; // from glTF material texture
 	vec4 base_color;    // from glTF material baseColorFactor
 	int has_texture;    // 1 if texture used, else 0
+
+	Arena strings; // texture_path and the material texture paths, freed together
 } Mesh;
 
 typedef struct ComputePipeline
@@ -199,26 +320,322 @@ typedef struct ComputePipeline
 	VkDescriptorPool descPool;
 } ComputePipeline;
 
-typedef struct ComputeUniforms
+// One brush stamp on the path mask; matches the push constants of compute_path_mask.comp
+typedef struct PathBrushParams
 {
-	vec3 mouse_position;
+	vec2 center;    // world xz
+	vec2 worldSize; // world extent the mask covers, centered on the origin
+	i32 origin[2];  // first texel of the stamp's bounding rectangle
+	i32 extent[2];  // its size in texels
+	float radius;
 	int is_additive; // bool in GLSL is 4 bytes, we use int (4 bytes) to match
-	vec2 path_mask_ws_dims;
-} ComputeUniforms;
+} PathBrushParams;
 
-typedef struct Particle
+// One pipeline each, from particle.comp's KERNEL specialization constant; in dispatch order
+typedef enum ParticleKernel
 {
-	vec4 pos; // x, y, vx, vy
-} Particle;
+	PARTICLE_KERNEL_PREPARE,
+	PARTICLE_KERNEL_EMIT,
+	PARTICLE_KERNEL_SIMULATE,
+	PARTICLE_KERNEL_SCAN,
+	PARTICLE_KERNEL_SCAN_BLOCKS,
+	PARTICLE_KERNEL_SCATTER,
+	PARTICLE_KERNEL_FINALIZE,
+	PARTICLE_KERNEL_COUNT,
+} ParticleKernel;
 
 #define MAX_FRAMES_IN_FLIGHT 2
 
+// --check-particles runs the kernels at this capacity against the CPU reference
+#define PARTICLE_CHECK_CAPACITY (1u << 16)
+#define PARTICLE_CHECK_TOLERANCE 1e-3f // sin/cos/sqrt differ between the shader and libm
+
+// Path mask painted by compute_path_mask.comp. A stamp only touches the tiles under the
+// brush, so its cost does not depend on the mask size (8192 works as well)
+#define PATH_MASK_SIZE 4096
+#define PATH_MASK_FORMAT VK_FORMAT_R8_UNORM
+#define PATH_MASK_FALLBACK_FORMAT VK_FORMAT_R8G8B8A8_UNORM // storage support is mandatory
+#define PATH_MASK_TILE 8 // workgroup size per axis
+#define PATH_BRUSH_RADIUS 0.45f
+#define PATH_ERASE_RADIUS 0.675f
+
+// GPU timestamp scopes; each scope owns a begin/end query pair in every frame's pool
+typedef enum GpuTimerScope
+{
+	GPU_TIMER_FRAME,
+	GPU_TIMER_BLOOM,
+	GPU_TIMER_PARTICLES,
+	GPU_TIMER_SHADOW_CASCADE0,
+	GPU_TIMER_SCOPE_COUNT = GPU_TIMER_SHADOW_CASCADE0 + SHADOW_CASCADE_COUNT,
+} GpuTimerScope;
+
+// Named ranges follow the fixed scopes in each pool: every frame graph pass gets one, and
+// passes can nest their own inside it
+#define GPU_TIMER_MAX_RANGES 48
+#define GPU_TIMER_MAX_RANGE_DEPTH 4
+#define GPU_TIMER_QUERY_COUNT ((GPU_TIMER_SCOPE_COUNT + GPU_TIMER_MAX_RANGES) * 2)
+
+typedef struct GpuTimerRange
+{
+	const char* name;
+	u32 depth;      // 0 for graph passes
+	double startMs; // from the start of the frame
+	double ms;
+} GpuTimerRange;
+
+typedef struct GpuTimer
+{
+	bool supported;
+	double periodNs;
+	VkQueryPool pools[MAX_FRAMES_IN_FLIGHT];
+	u32 writtenMask[MAX_FRAMES_IN_FLIGHT]; // scopes recorded into each frame's pool
+	u32 resolvedMask;                      // scopes that ran in the last resolved frame
+	double ms[GPU_TIMER_SCOPE_COUNT];      // latest result; kept when a scope is skipped
+	double startMs[GPU_TIMER_SCOPE_COUNT];
+
+	// Ranges in recording order; names and depths wait in their frame's slot until resolved
+	const char* rangeNames[MAX_FRAMES_IN_FLIGHT][GPU_TIMER_MAX_RANGES];
+	u8 rangeDepths[MAX_FRAMES_IN_FLIGHT][GPU_TIMER_MAX_RANGES];
+	u32 rangeCount[MAX_FRAMES_IN_FLIGHT];
+	u32 rangeStack[GPU_TIMER_MAX_RANGE_DEPTH]; // open ranges of the frame being recorded
+	u32 rangeDepth;
+	GpuTimerRange ranges[GPU_TIMER_MAX_RANGES]; // last resolved frame
+	u32 resolvedRangeCount;
+
+	// Frames recorded during a profiler capture, handed to it once resolved
+	bool traced[MAX_FRAMES_IN_FLIGHT];
+	u32 traceFrame[MAX_FRAMES_IN_FLIGHT];
+	double submitUs[MAX_FRAMES_IN_FLIGHT]; // profilerNowUs at vkQueueSubmit
+} GpuTimer;
+
+// Live device memory, by what the first bind put in it (framestats.c)
+typedef enum DeviceMemoryCategory
+{
+	DEVICE_MEMORY_UNBOUND,
+	DEVICE_MEMORY_BUFFERS,        // device-local: geometry, particles, culling
+	DEVICE_MEMORY_HOST_BUFFERS,   // uniforms, staging, readback
+	DEVICE_MEMORY_IMAGES,         // textures, skybox, shadow map
+	DEVICE_MEMORY_RENDER_TARGETS, // frame graph transients and the offscreen target
+	DEVICE_MEMORY_CATEGORY_COUNT,
+} DeviceMemoryCategory;
+
+typedef struct DeviceMemoryStats
+{
+	u64 bytes[DEVICE_MEMORY_CATEGORY_COUNT];
+	u64 totalBytes, peakBytes;
+	u32 allocations;
+} DeviceMemoryStats;
+
+// Rolling frame times for the performance overlay
+#define PERF_HISTORY_FRAMES 240
+#define PERF_HISTOGRAM_BUCKETS 24
+
+typedef struct PerfHistory
+{
+	float cpuMs[PERF_HISTORY_FRAMES]; // wall time between frames
+	float gpuMs[PERF_HISTORY_FRAMES]; // GPU_TIMER_FRAME, as resolved that frame
+	u32 head, count;
+} PerfHistory;
+
+// Average bloom GPU cost at one framebuffer size
+typedef struct BloomTiming
+{
+	u32 width, height;
+	double totalUs;
+	u32 samples;
+} BloomTiming;
+
+typedef struct ShadowCascade
+{
+	mat4 viewProj;
+	mat4 renderedViewProj; // what the cached depth was rendered with
+	float splitFar;        // view-space distance the cascade covers up to
+	vec3 boundsMin;        // light-view box, for caster culling
+	vec3 boundsMax;
+	bool dirty;
+	u32 updates;
+} ShadowCascade;
+// Asset loading: requests decode on the job system and are committed from the frame loop,
+// so the first frame only waits on what every frame needs. The scene draws nothing and
+// materials sample placeholders until their assets are in.
+#define SCENE_MODEL_PATH "data/shibahu/scene.gltf"
+#define ASSET_COMMIT_BUDGET_MS 4.0 // texture uploads per frame stop once this much time is spent
+#define MESH_UPLOAD_WINDOW_BYTES (8u << 20) // staging for geometry uploads, reused chunk by chunk
+
+typedef enum AssetKind
+{
+	ASSET_MODEL,
+	ASSET_TEXTURE, // one texture slot of one material
+	ASSET_CUBEMAP,
+} AssetKind;
+
+typedef enum AssetState
+{
+	ASSET_PENDING,
+	ASSET_READY,  // decoded, waiting for the frame loop to create its GPU objects
+	ASSET_FAILED, // stays on its placeholder
+	ASSET_COMMITTED,
+} AssetState;
+
+typedef enum MaterialTextureSlot
+{
+	MATERIAL_TEXTURE_BASE_COLOR,
+	MATERIAL_TEXTURE_METALLIC_ROUGHNESS,
+	MATERIAL_TEXTURE_EMISSIVE,
+	MATERIAL_TEXTURE_SLOT_COUNT,
+} MaterialTextureSlot;
+
+typedef u32 AssetHandle; // index + 1 into AssetLoader.requests, 0 for none
+
+typedef struct AssetRequest
+{
+	AssetKind kind;
+	_Atomic(AssetState) state; // the decode job publishes READY or FAILED last
+	const char* paths[6];      // one path, six for a cubemap; must outlive the request's job
+	u32 material;              // ASSET_TEXTURE
+	MaterialTextureSlot slot;  // ASSET_TEXTURE
+	JobSystem* jobs;           // for parallel work inside the decode
+	FileIO* io;
+	Mesh mesh;                 // ASSET_MODEL
+	DecodedImage images[6];
+	double submitMs, readyMs;
+	bool handled; // committed or given up on by the frame loop
+} AssetRequest;
+
+typedef struct AssetLoader
+{
+	AssetRequest** requests; // stb_ds array; requests never move while their job runs
+	JobCounter inFlight;     // every decode job, waited on at shutdown
+	u32 pending;             // requests not yet committed or failed
+	u32 failed;
+	u32 firstUnhandled;      // requests before this one are all handled
+	AssetHandle model, skybox;
+	Texture* stagedTextures; // MATERIAL_TEXTURE_SLOT_COUNT per material, uploaded but not bound yet
+	u32* materialPending;    // textures each material still waits for
+	u32 materialCount;
+	double startMs;
+	double sceneMs, allMs; // since startMs; 0 until the model / everything has been committed
+} AssetLoader;
+
+// Resource registry: one pool per kind, each field in its own dense array (see pool.h)
+typedef struct ImagePool
+{
+	HandlePool pool;
+	VkImage* images;
+	VkImageView* views;
+	VkDeviceMemory* memories;
+} ImagePool;
+
+typedef struct SamplerPool
+{
+	HandlePool pool;
+	VkSampler* samplers;
+} SamplerPool;
+
+typedef struct BufferPool
+{
+	HandlePool pool;
+	VkBuffer* buffers;
+	VkDeviceMemory* memories;
+	void** mapped; // NULL unless host visible
+	VkDeviceSize* sizes;
+} BufferPool;
+
+typedef struct PipelinePool
+{
+	HandlePool pool;
+	VkPipeline* pipelines;
+} PipelinePool;
+
+// A material owns its textures and uniform buffer; its pipelines are shared through the
+// permutation cache
+typedef struct MaterialPool
+{
+	HandlePool pool;
+	ImageHandle* textures[MATERIAL_TEXTURE_SLOT_COUNT];
+	SamplerHandle* samplers[MATERIAL_TEXTURE_SLOT_COUNT];
+	BufferHandle* uniforms;
+	VkDescriptorSet* descriptorSets;
+	PipelineHandle* pipelines;
+	PipelineHandle* prepassPipelines; // 0 for blended materials
+} MaterialPool;
+
+typedef struct ResourceRegistry
+{
+	ImagePool images;
+	SamplerPool samplers;
+	BufferPool buffers;
+	PipelinePool pipelines;
+	MaterialPool materials;
+} ResourceRegistry;
+
+// Deferred deletion (deletion.c): replaced objects wait for the frames that may still use them
+typedef enum DeferredKind
+{
+	DEFERRED_IMAGE,
+	DEFERRED_IMAGE_VIEW,
+	DEFERRED_MEMORY,
+	DEFERRED_SAMPLER,
+	DEFERRED_BUFFER,
+	DEFERRED_PIPELINE,
+	DEFERRED_DESCRIPTOR_SET,
+	DEFERRED_SEMAPHORE,
+	DEFERRED_SWAPCHAIN,
+	DEFERRED_REGISTRY_IMAGE,
+	DEFERRED_REGISTRY_SAMPLER,
+	DEFERRED_REGISTRY_BUFFER,
+} DeferredKind;
+
+typedef struct DeferredDeletion
+{
+	DeferredKind kind;
+	u64 frame; // destroyed once this frame has finished on the GPU
+	union
+	{
+		VkImage image;
+		VkImageView view;
+		VkDeviceMemory memory;
+		VkSampler sampler;
+		VkBuffer buffer;
+		VkPipeline pipeline;
+		VkSemaphore semaphore;
+		VkSwapchainKHR swapchain;
+		struct
+		{
+			VkDescriptorPool pool;
+			VkDescriptorSet set;
+		} descriptorSet;
+		ImageHandle registryImage;
+		SamplerHandle registrySampler;
+		BufferHandle registryBuffer;
+	};
+} DeferredDeletion;
+
+typedef struct DeletionQueue
+{
+	DeferredDeletion* entries;               // stb_ds array in retirement order, so frames ascend
+	DeferredDeletion* presentPending;        // stb_ds; retired swapchain objects waiting for the next acquire
+	u64 frame;                               // the frame being recorded: frames submitted so far
+	u64 completedFrames;                     // every frame below this has finished
+	u64 fenceFrames[MAX_FRAMES_IN_FLIGHT];   // frame count each in-flight fence completes, 0 if unused
+	u64 deferred, destroyed;                 // totals since startup
+	u32 peakPending;
+} DeletionQueue;
+
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+#define PIPELINE_COMPILE_MAX_THREADS 8
+
 typedef struct Application
 {
 	GLFWwindow* window;
 	int width, height;
 	bool framebufferResized;
 
+	// --headless: no window, surface or UI; the swapchain image is an offscreen target
+	bool headless;
+	BenchmarkConfig benchmark;
+	VkDeviceMemory offscreenTargetMemory;
+
 	// Camera
 	vec3 cameraPos;
 	vec3 cameraFront;
@@ -248,15 +665,27 @@ typedef struct Application
 	VkImage* swapchainImages;
 	VkImageView* swapchainImageViews;
 	u32 swapchainImageCount;
-	// Track current layouts of swapchain images
-	VkImageLayout* swapchainImageLayouts;
+	Arena swapchainArena; // the per-image arrays, reset whenever the swapchain is
+	u32 imageIndex; // swapchain image being recorded
 
-	// Depth buffer
-	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
-	VkImageView depthImageView;
+	// Depth buffer (a render graph transient)
 	VkFormat depthFormat;
 
+	// Frame graph: owns transient attachments and every barrier in the frame
+	RenderGraph frameGraph;
+	u32 rgSwapchain, rgDepth, rgPathMask, rgParticles, rgLights, rgClusterCounts, rgClusterIndices;
+	RgState swapchainState;     // reset every frame, the presentation engine owns it in between
+	RgState computeImageState;  // persists across frames
+	RgState particleBufferState;
+	RgState particleCounterState;
+	u32 rgParticleCounters;
+	RgState lightState;
+	RgState clusterCountState;
+	RgState clusterIndexState;
+	RgState shadowMapState;
+	u32 rgShadowMap;
+	u32 rgHdrColor, rgBloom; // transients, see createBloomRenderTargets
+
 	// Command pool and buffers
 	Buffer baseColorBuffer;
 	Buffer hasTextureBuffer;
@@ -264,16 +693,45 @@ typedef struct Application
 
 	// Pipeline
 	//	VkRenderPass renderPass;
+	VkPipelineCache pipelineCache; // shared by every pipeline, persisted to PIPELINE_CACHE_PATH
+	bool pipelineCacheWarm;        // loaded a valid cache file this run
+	double pipelineCreateMs;       // total time spent in vkCreate*Pipelines
 	VkDescriptorSetLayout descriptorSetLayout;
-	VkPipeline* pipelines;
+	MeshPipelineEntry* meshPipelineEntries; // permutation cache, kept until shutdown
+	u32 meshPipelineCount;
+	u32 meshPipelineCapacity;
+	bool specializeMaterials;     // bake material flags into tri.frag variants
+	bool dynamicRasterState;      // cull/depth state set per draw instead of per pipeline
+	bool dynamicBlendEnable;      // blend enable set per draw (EXT_extended_dynamic_state3)
+	VkFormat pathMaskFormat;      // PATH_MASK_FORMAT, or PATH_MASK_FALLBACK_FORMAT without r8 storage
+	int meshPipelineStylizedMode; // stylizedMode the current variants were picked for
+	BenchmarkPipelines meshPipelineBuild; // what the last createMeshPipelines built and reused
 	VkPipelineLayout pipelineLayout;
 	VkShaderModule vertShaderModule;
 	VkShaderModule fragShaderModule;
 
-	// Particle simulation
-	ComputePipeline particleCompute;
-	Buffer particleBuffer;
-	VkDescriptorSet particleComputeDescSet;
+	// Depth prepass (opaque: position-only stream, mask: alpha test only)
+	bool depthPrepassEnabled;
+	VkShaderModule depthOnlyVertShaderModule;
+	VkShaderModule depthMaskFragShaderModule;
+
+	// GPU particles, see particles.c
+	Buffer particleBuffer;        // SoA streams and index lists, device local
+	Buffer particleCounterBuffer; // ParticleCounters, device local, read in place as indirect arguments
+	Buffer particleReadbackBuffer; // host-visible copies of the counters, one per frame in flight
+	VkDescriptorSetLayout particleComputeSetLayout;
+	VkPipelineLayout particleComputeLayout;
+	VkPipeline particleKernels[PARTICLE_KERNEL_COUNT];
+	VkDescriptorPool particleDescriptorPool;
+	VkDescriptorSet particleComputeSet;
+	ParticleParams particleParams; // emitter and motion; per-step fields are filled when recording
+	bool particlesEnabled;
+	float particleEmitRate; // particles per second
+	float particleEmitCarry;
+	float particleSize;
+	float particleIntensity;
+	u32 particleCurrent; // alive list holding the live particles
+	u32 particleStep;
 	VkPipeline particlePipeline;
 	VkPipelineLayout particlePipelineLayout;
 	VkDescriptorSetLayout particleGraphicsDescriptorSetLayout;
@@ -283,45 +741,113 @@ typedef struct Application
 	Mesh mesh;
 	Buffer vertexBuffer;
 	Buffer indexBuffer;
+	Buffer positionBuffer; // tightly packed vec3 positions for depth-only passes
 
-	// Multiple textures support
-	Texture* baseColorTextures;
-	Texture* metallicRoughnessTextures;
-	Texture* emissiveTextures;
-	u32 texture_count;               // Number of textures
-	VkDescriptorSet* descriptorSets; // One descriptor set per texture
+	// Per-material textures, uniform buffers, descriptor sets and pipelines, by handle
+	ResourceRegistry resources;
+	DeletionQueue deletion;
 
 	// Legacy single texture support (kept for compatibility)
 	Texture texture;
 	u32 mipLevels;
+	// Frame uniforms, one copy per frame in flight uniformStride apart, bound with a dynamic
+	// offset: the CPU writes a frame's copy while the previous frame may still read its own
 	Buffer uniformBuffer;
+	VkDeviceSize uniformStride;
 
 	// Descriptors
 	VkDescriptorPool descriptorPool;
 	VkDescriptorSet descriptorSet;
 	VkPhysicalDeviceMemoryProperties memProperties;
-	// Per-material UBOs
-	Buffer* materialUniformBuffers; // one per material
 
 	// Lighting
-	PointLight lights[MAX_POINT_LIGHTS];
-	u32 numActiveLights;
 	DirectionalLight dirLight;
 
+	// Clustered point lights
+	ClusterLight* lights;  // MAX_CLUSTERED_LIGHTS, animated on the CPU every frame
+	vec4* lightOrigins;    // xyz orbit center, w phase
+	u32 numActiveLights;
+	Buffer lightBuffer;        // ClusterLight[MAX_CLUSTERED_LIGHTS], device local
+	Buffer clusterCountBuffer; // u32[CLUSTER_COUNT], device local
+	Buffer clusterIndexBuffer; // u32[CLUSTER_COUNT * CLUSTER_MAX_LIGHTS], device local
+	// Host-visible, one per frame in flight: the lights, then cluster counts and indices in
+	// the device buffers' layout. Copied over by the light_upload pass.
+	Buffer lightUpload[MAX_FRAMES_IN_FLIGHT];
+	VkBufferCopy* lightUploadRegions; // stb_ds, this frame's copies into clusterIndexBuffer
+	ComputePipeline lightCull;
+	VkDescriptorSet lightCullDescSet;
+	ClusterGrid clusterGrid;
+	bool clusterCullOnCpu;     // assign with clusterAssignLights instead of light_cull.comp
+	u32* cpuClusterCounts;
+	u32* cpuClusterIndices;
+
+	// Scene bounds from the primitive AABBs
+	vec3 sceneMin;
+	vec3 sceneMax;
+
+	// Cascaded shadow maps for dirLight
+	ShadowCascade cascades[SHADOW_CASCADE_COUNT];
+	VkImage shadowMap; // SHADOW_CASCADE_COUNT layers
+	VkDeviceMemory shadowMapMemory;
+	VkImageView shadowMapView; // array view for sampling
+	VkImageView shadowLayerViews[SHADOW_CASCADE_COUNT];
+	VkSampler shadowSampler;   // comparison sampler
+	VkPipeline shadowPipeline;
+	VkPipelineLayout shadowPipelineLayout;
+	mat4 shadowLightView;      // rotation only, follows dirLight.direction
+	float shadowDistance;
+	bool shadowsEnabled;
+	bool shadowCacheEnabled;
+
+	// Bloom and tonemapping of the HDR scene target
+	ComputePipeline bloomDownsample;
+	ComputePipeline bloomUpsample;
+	VkDescriptorPool bloomDescriptorPool;
+	VkDescriptorSet bloomDownsampleSet;
+	VkDescriptorSet bloomUpsampleSets[BLOOM_MIP_COUNT - 1]; // index N writes mip N
+	VkImageView bloomMipViews[BLOOM_MIP_COUNT];             // views of the current graph's bloom image
+	u32 bloomMipCount;
+	VkSampler bloomSampler; // linear, clamp to edge
+	VkDescriptorSetLayout tonemapDescriptorSetLayout;
+	VkDescriptorSet tonemapDescriptorSet;
+	VkPipelineLayout tonemapPipelineLayout;
+	VkPipeline tonemapPipeline;
+	bool bloomEnabled;
+	float bloomThreshold;
+	float bloomKnee;
+	float bloomIntensity;
+	float exposure;
+	BloomTiming bloomTimings[BLOOM_MAX_TIMINGS];
+	u32 bloomTimingCount;
+
+	// Dynamic resolution scaling, driven by GPU_TIMER_FRAME
+	DrsController drs;
+	bool drsEnabled;
+	float renderScale;
+	u32 renderWidth, renderHeight; // scene resolution this frame
+	float drsSharpness;
+	bool drsRecordTrace;
+	DrsTraceEntry* drsTrace; // stb_ds array, written to DRS_TRACE_PATH on exit
+	DrsConfig drsTraceConfig; // controller config when the recording started
+
+	GpuTimer gpuTimer;
+	Profiler profiler; // CPU scopes and GPU ranges for Chrome trace captures
+	JobSystem* jobs;   // shared by model/texture loading and culling
+	FileIO* io;        // every asset and shader read goes through it
+	Pak* pak;          // mounted on io when the archive exists
+	AssetLoader assets;
+
 	// Sync objects
 	VkSemaphore ImageAquireSemaphore[MAX_FRAMES_IN_FLIGHT]; // Per frame in flight
-	VkSemaphore* imageReleaseSemaphore;                     // Per swapchain image (present wait)
-	VkSemaphore* sceneDoneSemaphores;                       // Per swapchain image (signaled after main rendering)
-	VkCommandBuffer* presentCmdBuffers;                     // Per swapchain image (transition to PRESENT)
-	VkSemaphore* presentReadySemaphores;                    // Per swapchain image (signaled after post-NK present transition)
+	VkSemaphore* imageReleaseSemaphore;                     // Per swapchain image (signaled by the frame submit, present waits)
 	VkFence inFlightFences[MAX_FRAMES_IN_FLIGHT];           // Per frame in flight
 	u32 currentFrame;
-	StorageImage computeImage;
+	Arena frameArenas[MAX_FRAMES_IN_FLIGHT]; // culling and recording scratch, reset after the fence wait
+	StorageImage computeImage; // path mask, pathMaskFormat, persists across frames
 	ComputePipeline compute;
-	VkCommandBuffer computeCmdBuffer;
-	VkFence computeFence;
 	VkDescriptorSet computeDescSet;
-	Buffer computeUniformBuffer;
+	vec2 pathMaskWorldSize;
+	PathBrushParams* pathBrushStamps; // stb_ds array, queued since the last recorded frame
 
 	// Skybox
 	Texture skyboxTexture;
@@ -330,13 +856,27 @@ typedef struct Application
 	VkPipeline skyboxPipeline;
 	VkPipelineLayout skyboxPipelineLayout;
 	Buffer skyboxVertexBuffer;
-	Buffer skyboxUniformBuffer;
+	Buffer skyboxUniformBuffer; // per frame in flight like uniformBuffer, same stride
+
+	// CPU occlusion culling
+	OcclusionBuffer occlusion;
+	bool occlusionEnabled;
+	bool* primitiveVisible; // one per primitive, refreshed before recording
+	u32 drawsCulled;
+	u32* drawLists[2];      // visible primitives in the frame arena: opaque and masked, then blended
+	u32 drawListCounts[2];
 
 	// FPS tracking
 	double fpsLastTime;
 	int fpsFrameCount;
 	float fps;
 
+	// Performance overlay; the history and counters are collected whether or not it's shown
+	bool perfOverlayVisible;
+	PerfHistory perfHistory;
+	BenchmarkCounters frameCounters; // last recorded frame
+	double counterOverheadUs;        // what collecting them cost that frame, see recordFrameStats
+
 	// Nuklear UI context
 	struct nk_context* nkCtx;
 	bool is_ui_mode;
@@ -353,32 +893,91 @@ typedef struct Application
 } Application;
 
 void createSkyboxTexture(Application* app);
+void createCubemapTexture(Application* app, stbi_uc* const faces[6], int texWidth, int texHeight, Texture* outTexture);
+bool decodeSkyboxFaces(FileIO* io, const char* const paths[6], DecodedImage faces[6]);
+void setSkyboxCubemap(Application* app, DecodedImage faces[6]);
+
+// --- Asset loading ---
+
+void assetsInit(Application* app);
+void assetsDestroy(Application* app);
+AssetHandle assetsLoadModel(Application* app, const char* path);
+AssetHandle assetsLoadTexture(Application* app, const char* path, u32 material, MaterialTextureSlot slot);
+AssetHandle assetsLoadCubemap(Application* app, const char* const faces[6]);
+AssetState assetsState(const Application* app, AssetHandle handle);
+void assetsPrepareMaterials(Application* app, u32 materialCount);
+void assetsUpdate(Application* app);
+bool assetsWaitAll(Application* app);
+void attachScene(Application* app, Mesh* mesh);
+
+// --- Deferred deletion ---
+
+void deferDestroy(Application* app, DeferredDeletion deletion);
+void deferDestroyTexture(Application* app, Texture* texture);
+void deferDestroyBuffer(Application* app, Buffer* buffer);
+void deferFreeDescriptorSet(Application* app, VkDescriptorPool pool, VkDescriptorSet set);
+void deferDestroyAfterPresent(Application* app, DeferredDeletion deletion);
+void deletionQueueImageAcquired(Application* app);
+void deletionQueueSubmitted(Application* app);
+void deletionQueueFlush(Application* app);
+void deletionQueueDestroyAll(Application* app, bool shutdown);
+
+// --- Resource registry ---
+
+void resourcesInit(Application* app);
+void resourcesDestroy(Application* app);
+ImageHandle resourcesAddImage(Application* app, VkImage image, VkImageView view, VkDeviceMemory memory);
+VkImageView resourcesImageView(const Application* app, ImageHandle image);
+void resourcesDestroyImage(Application* app, ImageHandle image);
+SamplerHandle resourcesAddSampler(Application* app, VkSampler sampler);
+VkSampler resourcesSampler(const Application* app, SamplerHandle sampler);
+void resourcesDestroySampler(Application* app, SamplerHandle sampler);
+BufferHandle resourcesAddBuffer(Application* app, Buffer* buffer);
+VkBuffer resourcesBuffer(const Application* app, BufferHandle buffer);
+void resourcesDestroyBuffer(Application* app, BufferHandle buffer);
+PipelineHandle resourcesAddPipeline(Application* app, VkPipeline pipeline);
+VkPipeline resourcesPipeline(const Application* app, PipelineHandle pipeline);
+void resourcesDestroyPipeline(Application* app, PipelineHandle pipeline);
+MaterialHandle resourcesAddMaterial(Application* app);
+u32 resourcesMaterialIndex(const Application* app, MaterialHandle material); // POOL_INVALID if stale
+void resourcesSetMaterialTexture(Application* app, MaterialHandle material, MaterialTextureSlot slot, Texture* texture, ImageHandle* oldImage, SamplerHandle* oldSampler);
+void resourcesDestroyMaterial(Application* app, MaterialHandle material);
 
 // --- Compute ---
 
-void createComputeSync(Application* app);
-void updateStorageImage(Application* app, StorageImage* img, float* data);
+void updateStorageImage(Application* app, StorageImage* img, const void* data);
 void clearStorageImage(Application* app, StorageImage* img);
-void createComputePipeline(Application* app, ComputePipeline* compute, const char* shaderPath, VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount);
+void createComputePipeline(Application* app, ComputePipeline* compute, const char* shaderPath, VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, uint32_t pushConstantSize);
 void createComputeDescriptors(Application* app, ComputePipeline* compute, VkDescriptorSet* descriptorSet, VkDescriptorPoolSize* poolSizes, uint32_t poolSizeCount, VkWriteDescriptorSet* descriptorWrites, uint32_t descriptorWriteCount);
 void createComputeDescriptorSetLayout(Application* app);
-void recordComputeCommands(Application* app);
-void updateComputeUniforms(Application* app, vec3 mousePos, int is_additive, vec2 path_mask_ws_dims);
+void recordComputeCommands(Application* app, VkCommandBuffer commandBuffer);
+void createPathMask(Application* app);
+void fitPathMaskToScene(Application* app);
+void queuePathBrush(Application* app, vec3 worldPos, bool additive);
 
 // Vulkan Core Setup
-VkInstance createVulkanInstance(void);
+VkInstance createVulkanInstance(bool enableSurface);
 VkSurfaceKHR createSurface(VkInstance instance, GLFWwindow* window);
 VkPhysicalDevice selectPhysicalDevice(VkInstance instance);
 u32 find_graphics_queue_family_index(VkPhysicalDevice pickedPhysicalDevice);
-VkDevice create_logical_device(VkPhysicalDevice pickedPhysicalDevice, u32 queueFamilyIndex);
+bool supportsDynamicRasterState(VkPhysicalDevice physicalDevice);
+bool supportsDynamicBlendEnable(VkPhysicalDevice physicalDevice);
+bool supportsR8StorageImage(VkPhysicalDevice physicalDevice);
+VkDevice create_logical_device(VkPhysicalDevice pickedPhysicalDevice, u32 queueFamilyIndex, bool enableDynamicBlend, bool enableExtendedStorageFormats, bool enableSwapchain);
 
 // Memory and Buffers
 VkSemaphore createSemaphore(VkDevice device);
 uint32_t findMemoryType(const VkPhysicalDeviceMemoryProperties* memProperties, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 u32 selectmemorytype(VkPhysicalDeviceMemoryProperties* memprops, u32 memtypeBits, VkFlags requirements_mask);
 void createBuffer(Application* app, Buffer* buffer, VkDeviceSize size, VkBufferUsageFlags usage);
+void createDeviceLocalBuffer(Application* app, Buffer* buffer, VkDeviceSize size, VkBufferUsageFlags usage);
 void destroyBuffer(VkDevice device, Buffer* buffer);
 Buffer createStagingBuffer(Application* app, const void* data, VkDeviceSize size);
+// Writes bytes [offset, offset + size) of a stream into the mapped staging window
+typedef void (*StagingFillFn)(void* userData, void* dst, VkDeviceSize offset, VkDeviceSize size);
+void uploadThroughStagingWindow(Application* app, Buffer* window, VkBuffer dst, VkDeviceSize size,
+    VkDeviceSize elementSize, StagingFillFn fill, void* userData);
+void stagingFillCopy(void* userData, void* dst, VkDeviceSize offset, VkDeviceSize size); // userData is the source
 void copyBufferToDeviceLocal(VkDevice device, VkCommandPool commandPool, VkQueue queue, VkBuffer src, VkBuffer dst, VkDeviceSize size);
 // Swapchain
 VkSwapchainKHR createSwapchain(Application* app);
@@ -386,10 +985,25 @@ void createSwapchainViews(Application* app);
 void createSwapchainRelatedResources(Application* app);
 void cleanupSwapchain(Application* app);
 void recreateSwapchain(Application* app);
+// Frame statistics
+void installFrameCounters(Application* app);
+BenchmarkCounters takeFrameCounters(void);
+double frameCounterOverheadUs(const BenchmarkCounters* counters);
+void tagDeviceMemory(VkDeviceMemory memory, DeviceMemoryCategory category);
+const DeviceMemoryStats* deviceMemoryStats(void);
+const char* deviceMemoryCategoryName(DeviceMemoryCategory category);
+// Headless benchmark
+void createOffscreenTarget(Application* app);
+void destroyOffscreenTarget(Application* app);
+bool runBenchmark(Application* app);
 
 // Textures and Samplers
 void createDummyTexture(Application* app, Texture* outTexture, u32* outMipLevels);
+void createSolidTexture(Application* app, Texture* outTexture, u32* outMipLevels, const u8 rgba[4]);
 void createTextureImage(Application* app, const char* path, Texture* outTexture, u32* outMipLevels, VkFormat format);
+bool decodeTextureImage(FileIO* io, const char* path, DecodedImage* out);
+bool decodeTextureMemory(const char* path, const void* bytes, size_t size, DecodedImage* out);
+void uploadTextureImage(Application* app, DecodedImage* decoded, Texture* outTexture, u32* outMipLevels, VkFormat format);
 void generateMipmaps(Application* app, VkCommandBuffer cmd, VkImage image, VkFormat format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 void createTextureSampler(Application* app, Texture* texture, u32 mipLevels);
 void updateBaseColorAndHasTexture(Application* app);
@@ -411,10 +1025,21 @@ VkCommandBuffer beginSingleTimeCommands(Application* app);
 void endSingleTimeCommands(Application* app, VkCommandBuffer commandBuffer);
 void recordCommandBuffer(Application* app, VkCommandBuffer commandBuffer, u32 imageIndex);
 
-void recordComputeCommands(Application* app);
+void recordComputeCommands(Application* app, VkCommandBuffer commandBuffer);
+void computeCameraMatrices(Application* app, mat4 view, mat4 proj);
 void drawFrame(Application* app);
 void createPipeline(Application* app);
-VkPipeline createMeshPipeline(Application* app, VkShaderModule vertShader, VkShaderModule fragShader, Material* material);
+void createPipelineCache(Application* app, const char* path);
+void savePipelineCache(Application* app, const char* path);
+void destroyPipelineCache(Application* app);
+VkPipeline buildGraphicsPipeline(Application* app, const VkGraphicsPipelineCreateInfo* pipelineInfo);
+VkPipeline buildComputePipeline(Application* app, const VkComputePipelineCreateInfo* pipelineInfo);
+void createMeshPipelines(Application* app);
+void destroyMeshPipelines(Application* app);
+VkPipeline createMeshPipeline(Application* app, const MeshPipelineKey* key);
+VkPipeline createDepthPrepassPipeline(Application* app, const MeshPipelineKey* key);
+u32 findOrAddMeshPipeline(Application* app, const MeshPipelineKey* key);
+void compileMeshPipelines(Application* app, u32 firstEntry, u32 threadCount);
 VkPipeline createParticlePipeline(Application* app, VkShaderModule vertShader, VkShaderModule fragShader);
 VkPipeline createBrickPipeline(Application* app, VkShaderModule vertShader, VkShaderModule fragShader);
 VkPipeline createTerrainPipeline(Application* app, VkShaderModule vertShader, VkShaderModule fragShader);
@@ -425,22 +1050,74 @@ void createBloomRenderTargets(Application* app);
 void createBloomPipelines(Application* app);
 void createBloomDescriptors(Application* app);
 void renderBloomPass(Application* app, VkCommandBuffer cmd);
+void renderTonemapPass(Application* app, VkCommandBuffer cmd);
+void recordBloomTiming(Application* app);
+void destroyBloomViews(Application* app);
+void cleanupBloomSystem(Application* app);
+VkPipeline createTonemapPipeline(Application* app, VkShaderModule vertShader, VkShaderModule fragShader);
+// Occlusion culling
+void initOcclusionCulling(Application* app);
+void updateOcclusionCulling(Application* app);
+void cleanupOcclusionCulling(Application* app);
+// Shadows
+void createShadowResources(Application* app);
+void updateShadowCascades(Application* app, mat4 view);
+void recordShadowCommands(Application* app, VkCommandBuffer commandBuffer);
+void cleanupShadowResources(Application* app);
+VkPipeline createShadowPipeline(Application* app, VkShaderModule vertShader);
+// GPU particles
+void createParticleSystem(Application* app);
+void fitParticlesToScene(Application* app);
+void recordParticleComputeCommands(Application* app, VkCommandBuffer commandBuffer);
+void drawParticles(Application* app, VkCommandBuffer commandBuffer);
+void recordParticleReadback(Application* app, VkCommandBuffer commandBuffer);
+const ParticleCounters* particleCountersReadback(const Application* app);
+bool particlesCheckAgainstReference(Application* app, u32 steps);
+void cleanupParticleSystem(Application* app);
+// GPU timers
+void gpuTimerInit(Application* app);
+void gpuTimerDestroy(Application* app);
+void gpuTimerResolve(Application* app);
+void gpuTimerReset(Application* app, VkCommandBuffer commandBuffer);
+void gpuTimerBegin(Application* app, VkCommandBuffer commandBuffer, GpuTimerScope scope);
+void gpuTimerEnd(Application* app, VkCommandBuffer commandBuffer, GpuTimerScope scope);
+void gpuTimerPushRange(Application* app, VkCommandBuffer commandBuffer, const char* name);
+void gpuTimerPopRange(Application* app, VkCommandBuffer commandBuffer);
+const char* gpuTimerScopeName(GpuTimerScope scope);
+// Clustered lighting
+void createClusteredLighting(Application* app);
+void updateClusteredLighting(Application* app, mat4 view);
+void recordLightUploadCommands(Application* app, VkCommandBuffer commandBuffer);
+void recordLightCullCommands(Application* app, VkCommandBuffer commandBuffer);
+void cleanupClusteredLighting(Application* app);
 // Descriptors and Uniforms
 VkDescriptorSetLayout createDescriptorSetLayout(VkDevice device);
 VkDescriptorPool createDescriptorPool(VkDevice device);
 VkDescriptorSet allocateDescriptorSet(VkDevice device, VkDescriptorPool pool, const VkDescriptorSetLayout* pLayout);
 void createDescriptors(Application* app);
+void writeMaterialDescriptorSet(Application* app, VkDescriptorSet set, MaterialHandle material);
 void createUniformBuffers(Application* app);
+u32 frameUniformOffset(const Application* app);
 // Models and GLTF
 void ProcessGltfNode(cgltf_node* node, Mesh* outMesh, cgltf_data* data, mat4 parentTransform,
-    Application* app, uint32_t* vertexOffset, uint32_t* indexOffset, uint32_t* primitiveIndex);
+    GltfPrimitiveTask** tasks, uint32_t* vertexOffset, uint32_t* indexOffset, uint32_t* primitiveIndex);
 void checkMaterials(cgltf_data* data);
-void loadGltfModel(const char* path, Mesh* outMesh);
-void createModelAndBuffers(Application* app);
+bool loadGltfModel(const char* path, Mesh* outMesh, JobSystem* jobs, FileIO* io);
+void gltfDecodeVertices(Mesh* mesh, JobSystem* jobs, u32 firstVertex, u32 count, Vertex* dst);
+void gltfDecodePositions(Mesh* mesh, JobSystem* jobs, u32 firstVertex, u32 count, vec3* dst);
+void gltfDecodeIndices(Mesh* mesh, JobSystem* jobs, u32 firstIndex, u32 count, u32* dst);
+void gltfPrimitiveAreas(const Mesh* mesh, JobSystem* jobs, float* areas);
+void gltfPrimitiveTriangles(const Mesh* mesh, u32 primitive, float* dst);
+void gltfSourceFree(GltfSource* source);
+void createMeshBuffers(Application* app);
+void createSkyboxVertexBuffer(Application* app);
 // Depth and Shaders
-VkShaderModule LoadShaderModule(const char* filepath, VkDevice device);
+VkShaderModule LoadShaderModule(FileIO* io, const char* filepath, VkDevice device);
+void LoadShaderModules(FileIO* io, VkDevice device, const char* const* filepaths, u32 count, VkShaderModule* outModules);
 VkFormat findDepthFormat(VkPhysicalDevice physicalDevice);
-void createDepthResources(Application* app);
+// Render graph
+RgBackend rgVulkanBackend(Application* app);
+void buildFrameGraph(Application* app);
 // Synchronization
 void createSyncObjects(Application* app);
 void cleanAcquiresemaphore_and_fences(Application* app);
@@ -454,18 +1131,18 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 // Application Lifecycle
 void initVulkan(Application* app);
 void createResources(Application* app);
-void updateLights(Application* app);
+void updateLights(Application* app, float time);
 void mainLoop(Application* app);
 void cleanupResources(Application* app);
 void cleanupPipeline(Application* app);
 void cleanupComputePipeline(Application* app, ComputePipeline* compute);
 void cleanup(Application* app);
 
-void createStorageImage(Application* app, StorageImage* img, uint32_t width, uint32_t height);
-void createComputePipeline(Application* app, ComputePipeline* compute, const char* shaderPath, VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount);
+void createStorageImage(Application* app, StorageImage* img, uint32_t width, uint32_t height, VkFormat format);
+void createComputePipeline(Application* app, ComputePipeline* compute, const char* shaderPath, VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, uint32_t pushConstantSize);
 void createComputeDescriptors(Application* app, ComputePipeline* compute, VkDescriptorSet* descriptorSet, VkDescriptorPoolSize* poolSizes, uint32_t poolSizeCount, VkWriteDescriptorSet* descriptorWrites, uint32_t descriptorWriteCount);
 
 
 void createSkyboxPipeline(Application* app);
 
-int main(void);
+int main(int argc, char** argv);
@@ -1,15 +1,18 @@
 #include "main.h"
 
+// (Re)uploads every material's factors into a fresh uniform buffer. Frames in flight may still
+// read the old buffers through the old descriptor sets, so both are retired to the deletion
+// queue and a material that already has a set gets a new one: edits never wait on the GPU.
 void materials_build_gpu_ubos(Application* app)
 {
     if (!app->mesh.material_count) return;
-    if (app->materialUniformBuffers) {
-        materials_free_gpu_ubos(app);
-    }
-    app->materialUniformBuffers = calloc(app->mesh.material_count, sizeof(Buffer));
 
+    MaterialPool* materials = &app->resources.materials;
     for (u32 i = 0; i < app->mesh.material_count; ++i) {
         Material* src = &app->mesh.materials[i];
+        u32 index = resourcesMaterialIndex(app, src->handle);
+        if (index == POOL_INVALID) continue;
+
         MaterialGPU gpu = {0};
         glm_vec4_copy(src->baseColorFactor, gpu.baseColorFactor);
         gpu.emissiveFactor[0] = src->emissiveFactor[0];
@@ -22,17 +25,30 @@ void materials_build_gpu_ubos(Application* app)
         gpu.hasFlags[0] = src->hasBaseColorTexture;
         gpu.hasFlags[1] = src->hasMetallicRoughnessTexture;
         gpu.hasFlags[2] = src->hasEmissiveTexture;
-        createBuffer(app, &app->materialUniformBuffers[i], sizeof(MaterialGPU), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-        memcpy(app->materialUniformBuffers[i].data, &gpu, sizeof(MaterialGPU));
+        gpu.hasFlags[3] = 0; // reserved for per-material shading mode override (0=PBR by default)
+
+        Buffer ubo;
+        createBuffer(app, &ubo, sizeof(MaterialGPU), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+        memcpy(ubo.data, &gpu, sizeof(MaterialGPU));
+        deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_REGISTRY_BUFFER, .registryBuffer = materials->uniforms[index]});
+        materials->uniforms[index] = resourcesAddBuffer(app, &ubo);
+
+        // Before createDescriptors there is no set to replace
+        if (materials->descriptorSets[index] == VK_NULL_HANDLE) continue;
+        VkDescriptorSet set = allocateDescriptorSet(app->device, app->descriptorPool, &app->descriptorSetLayout);
+        writeMaterialDescriptorSet(app, set, src->handle);
+        deferFreeDescriptorSet(app, app->descriptorPool, materials->descriptorSets[index]);
+        materials->descriptorSets[index] = set;
+        if (i == 0)
+            app->descriptorSet = set;
     }
 }
 
 void materials_free_gpu_ubos(Application* app)
 {
-    if (!app->materialUniformBuffers) return;
-    for (u32 i = 0; i < app->mesh.material_count; ++i) {
-        destroyBuffer(app->device, &app->materialUniformBuffers[i]);
+    MaterialPool* materials = &app->resources.materials;
+    for (u32 i = 0; i < materials->pool.count; ++i) {
+        deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_REGISTRY_BUFFER, .registryBuffer = materials->uniforms[i]});
+        materials->uniforms[i] = (BufferHandle){0};
     }
-    free(app->materialUniformBuffers);
-    app->materialUniformBuffers = NULL;
 }
@@ -1,8 +1,10 @@
 #include "main.h"
-void ProcessGltfNode(cgltf_node* node, Mesh* outMesh, cgltf_data* data, mat4 parentTransform, Application* app, uint32_t* vertexOffset, uint32_t* indexOffset, uint32_t* primitiveIndex)
+#include <float.h>
+// Walks the node tree working out each primitive's transform and where its vertices and
+// indices go; the vertex work itself is left to the stream decoders below
+void ProcessGltfNode(cgltf_node* node, Mesh* outMesh, cgltf_data* data, mat4 parentTransform,
+    GltfPrimitiveTask** tasks, uint32_t* vertexOffset, uint32_t* indexOffset, uint32_t* primitiveIndex)
 {
-	(void)app; // unused for now
-
 	// Compute world transform for this node
 	mat4 localTransform;
 	glm_mat4_identity(localTransform);
@@ -19,123 +21,331 @@ void ProcessGltfNode(cgltf_node* node, Mesh* outMesh, cgltf_data* data, mat4 par
 
 			// Determine material index for this primitive
 			int materialIndex = -1;
-			vec4 baseColor = {1.0f, 1.0f, 1.0f, 1.0f};
 			if (primitive->material)
-			{
 				materialIndex = (int)(primitive->material - data->materials);
-				if (materialIndex >= 0 && (u32)materialIndex < outMesh->material_count)
-				{
-					memcpy(baseColor, outMesh->materials[materialIndex].baseColorFactor, sizeof(vec4));
-				}
-			}
 
-			// Find attribute accessors
 			cgltf_accessor* posAccessor = NULL;
-			cgltf_accessor* normalAccessor = NULL;
-			cgltf_accessor* uvAccessor = NULL;
 			for (cgltf_size a = 0; a < primitive->attributes_count; ++a)
 			{
-				const cgltf_attribute* attr = &primitive->attributes[a];
-				if (attr->type == cgltf_attribute_type_position)
-					posAccessor = attr->data;
-				else if (attr->type == cgltf_attribute_type_normal)
-					normalAccessor = attr->data;
-				else if (attr->type == cgltf_attribute_type_texcoord && attr->index == 0)
-					uvAccessor = attr->data;
+				if (primitive->attributes[a].type == cgltf_attribute_type_position)
+					posAccessor = primitive->attributes[a].data;
 			}
-
 			if (!posAccessor)
 				continue; // cannot build vertices
 
-			// Precompute normal matrix from world transform
-			mat3 normalMatrix;
-			glm_mat4_pick3(worldTransform, normalMatrix);
-			glm_mat3_inv(normalMatrix, normalMatrix);
-			glm_mat3_transpose(normalMatrix);
+			GltfPrimitiveTask task = {
+			    .primitive = primitive,
+			    .materialIndex = materialIndex,
+			    .firstVertex = *vertexOffset,
+			    .firstIndex = *indexOffset,
+			    .vertexCount = (uint32_t)posAccessor->count,
+			    .indexCount = (uint32_t)(primitive->indices ? primitive->indices->count : posAccessor->count),
+			    .primitiveIndex = *primitiveIndex < outMesh->primitive_count ? *primitiveIndex : UINT32_MAX,
+			};
+			memcpy(task.worldTransform, worldTransform, sizeof(task.worldTransform));
+			arrput(*tasks, task);
+
+			// Bounds are grown as the vertices are decoded
+			if (task.primitiveIndex != UINT32_MAX)
+			{
+				Primitive* outPrimitive = &outMesh->primitives[task.primitiveIndex];
+				outPrimitive->first_index = task.firstIndex;
+				outPrimitive->index_count = task.indexCount;
+				outPrimitive->material_index = materialIndex;
+				glm_vec3_copy((vec3){FLT_MAX, FLT_MAX, FLT_MAX}, outPrimitive->aabbMin);
+				glm_vec3_copy((vec3){-FLT_MAX, -FLT_MAX, -FLT_MAX}, outPrimitive->aabbMax);
+				(*primitiveIndex)++;
+			}
 
-			const uint32_t startVertex = *vertexOffset;
-			const uint32_t startIndex = *indexOffset;
+			*vertexOffset += task.vertexCount;
+			*indexOffset += task.indexCount;
+		}
+	}
 
-			// Emit vertices
-			for (cgltf_size v = 0; v < posAccessor->count; ++v)
-			{
-				Vertex vert = (Vertex){0};
-
-				// Position
-				float p[3] = {0};
-				cgltf_accessor_read_float(posAccessor, v, p, 3);
-				vec4 pos = {p[0], p[1], p[2], 1.0f};
-				vec4 transformed;
-				glm_mat4_mulv(worldTransform, pos, transformed);
-				glm_vec3_copy(transformed, vert.pos);
-
-				// Normal
-				if (normalAccessor)
-				{
-					float n[3] = {0};
-					cgltf_accessor_read_float(normalAccessor, v, n, 3);
-					vec3 nn = {n[0], n[1], n[2]};
-					glm_mat3_mulv(normalMatrix, nn, vert.normal);
-					glm_vec3_normalize(vert.normal);
-				}
-				else
-				{
-					glm_vec3_copy((vec3){0.0f, 1.0f, 0.0f}, vert.normal);
-				}
+	// Recurse into children
+	for (cgltf_size i = 0; i < node->children_count; ++i)
+	{
+		ProcessGltfNode(node->children[i], outMesh, data, worldTransform, tasks, vertexOffset, indexOffset, primitiveIndex);
+	}
+}
 
-				// Texcoord 0 (flip V for Vulkan)
-				if (uvAccessor)
-				{
-					float uv[2] = {0};
-					cgltf_accessor_read_float(uvAccessor, v, uv, 2);
-					vert.texcoord[0] = uv[0];
-					vert.texcoord[1] = 1.0f - uv[1];
-				}
+// --- Stream decoding ---
+// The mesh streams are decoded from the glTF buffers a range at a time, straight into
+// whatever memory the caller hands over (the upload's staging window), so no full copy of
+// the vertices or indices ever exists on the CPU.
 
-				// Vertex color from material base color
-				memcpy(vert.color, baseColor, sizeof(vec4));
+#define GLTF_DECODE_GRAIN 8192 // elements per job
 
-				outMesh->vertices[(*vertexOffset)++] = vert;
-			}
+typedef enum GltfStream
+{
+	GLTF_STREAM_VERTICES,
+	GLTF_STREAM_POSITIONS,
+	GLTF_STREAM_INDICES,
+} GltfStream;
 
-			// Indices
-			uint32_t indexCount = 0;
-			if (primitive->indices)
-			{
-				indexCount = (uint32_t)primitive->indices->count;
-				for (cgltf_size k = 0; k < primitive->indices->count; ++k)
-				{
-					uint32_t idx = (uint32_t)cgltf_accessor_read_index(primitive->indices, k);
-					outMesh->indices[(*indexOffset)++] = startVertex + idx;
-				}
-			}
-			else
-			{
-				indexCount = (uint32_t)posAccessor->count;
-				for (cgltf_size k = 0; k < posAccessor->count; ++k)
-				{
-					outMesh->indices[(*indexOffset)++] = startVertex + (uint32_t)k;
-				}
-			}
+// Part of one primitive's elements, decoded by one job
+typedef struct GltfSlice
+{
+	u32 task;
+	u32 begin, end; // within the primitive
+	vec3 aabbMin, aabbMax; // vertex slices only
+} GltfSlice;
+
+typedef struct GltfDecodeContext
+{
+	const Mesh* mesh;
+	GltfStream stream;
+	u32 first; // element dst[0] holds
+	void* dst;
+	GltfSlice* slices;
+} GltfDecodeContext;
+
+static cgltf_accessor* findAttribute(const cgltf_primitive* primitive, cgltf_attribute_type type)
+{
+	for (cgltf_size a = 0; a < primitive->attributes_count; ++a)
+	{
+		if (primitive->attributes[a].type == type && primitive->attributes[a].index == 0)
+			return primitive->attributes[a].data;
+	}
+	return NULL;
+}
+
+static void worldPosition(const GltfPrimitiveTask* task, const cgltf_accessor* positions, cgltf_size v, vec3 out)
+{
+	float p[3] = {0};
+	cgltf_accessor_read_float(positions, v, p, 3);
+	vec4 pos = {p[0], p[1], p[2], 1.0f};
+	vec4 transformed;
+	mat4 worldTransform;
+	memcpy(worldTransform, task->worldTransform, sizeof(worldTransform));
+	glm_mat4_mulv(worldTransform, pos, transformed);
+	glm_vec3_copy(transformed, out);
+}
+
+static u32 taskIndex(const GltfPrimitiveTask* task, cgltf_size k)
+{
+	return task->primitive->indices ? (u32)cgltf_accessor_read_index(task->primitive->indices, k) : (u32)k;
+}
+
+static void decodeVertexSlice(const GltfDecodeContext* ctx, GltfSlice* slice)
+{
+	const Mesh* mesh = ctx->mesh;
+	const GltfPrimitiveTask* task = &mesh->source->tasks[slice->task];
+	const cgltf_primitive* primitive = task->primitive;
+	cgltf_accessor* posAccessor = findAttribute(primitive, cgltf_attribute_type_position);
+	cgltf_accessor* normalAccessor = findAttribute(primitive, cgltf_attribute_type_normal);
+	cgltf_accessor* uvAccessor = findAttribute(primitive, cgltf_attribute_type_texcoord);
+
+	vec4 baseColor = {1.0f, 1.0f, 1.0f, 1.0f};
+	if (task->materialIndex >= 0 && (u32)task->materialIndex < mesh->material_count)
+		memcpy(baseColor, mesh->materials[task->materialIndex].baseColorFactor, sizeof(vec4));
+
+	// Precompute normal matrix from world transform
+	mat4 worldTransform;
+	memcpy(worldTransform, task->worldTransform, sizeof(worldTransform));
+	mat3 normalMatrix;
+	glm_mat4_pick3(worldTransform, normalMatrix);
+	glm_mat3_inv(normalMatrix, normalMatrix);
+	glm_mat3_transpose(normalMatrix);
+
+	Vertex* out = (Vertex*)ctx->dst + (task->firstVertex + slice->begin - ctx->first);
+	for (u32 v = slice->begin; v < slice->end; ++v)
+	{
+		Vertex vert = (Vertex){0};
+		worldPosition(task, posAccessor, v, vert.pos);
+		glm_vec3_minv(slice->aabbMin, vert.pos, slice->aabbMin);
+		glm_vec3_maxv(slice->aabbMax, vert.pos, slice->aabbMax);
+
+		if (normalAccessor)
+		{
+			float n[3] = {0};
+			cgltf_accessor_read_float(normalAccessor, v, n, 3);
+			vec3 nn = {n[0], n[1], n[2]};
+			glm_mat3_mulv(normalMatrix, nn, vert.normal);
+			glm_vec3_normalize(vert.normal);
+		}
+		else
+		{
+			glm_vec3_copy((vec3){0.0f, 1.0f, 0.0f}, vert.normal);
+		}
+
+		// Texcoord 0 (flip V for Vulkan)
+		if (uvAccessor)
+		{
+			float uv[2] = {0};
+			cgltf_accessor_read_float(uvAccessor, v, uv, 2);
+			vert.texcoord[0] = uv[0];
+			vert.texcoord[1] = 1.0f - uv[1];
+		}
+
+		// Vertex color from material base color
+		memcpy(vert.color, baseColor, sizeof(vec4));
+		*out++ = vert;
+	}
+}
+
+static void decodeSlices(void* userData, uint32_t begin, uint32_t end)
+{
+	GltfDecodeContext* ctx = userData;
+	for (uint32_t s = begin; s < end; ++s)
+	{
+		GltfSlice* slice = &ctx->slices[s];
+		const GltfPrimitiveTask* task = &ctx->mesh->source->tasks[slice->task];
+		if (ctx->stream == GLTF_STREAM_VERTICES)
+		{
+			decodeVertexSlice(ctx, slice);
+		}
+		else if (ctx->stream == GLTF_STREAM_POSITIONS)
+		{
+			cgltf_accessor* positions = findAttribute(task->primitive, cgltf_attribute_type_position);
+			vec3* out = (vec3*)ctx->dst + (task->firstVertex + slice->begin - ctx->first);
+			for (u32 v = slice->begin; v < slice->end; ++v)
+				worldPosition(task, positions, v, *out++);
+		}
+		else
+		{
+			u32* out = (u32*)ctx->dst + (task->firstIndex + slice->begin - ctx->first);
+			for (u32 k = slice->begin; k < slice->end; ++k)
+				*out++ = task->firstVertex + taskIndex(task, k);
+		}
+	}
+}
+
+// Decodes elements [first, first + count) of a stream into dst on the job system
+static void decodeStream(Mesh* mesh, JobSystem* jobs, GltfStream stream, u32 first, u32 count, void* dst)
+{
+	const GltfSource* source = mesh->source;
+	u32 taskCount = (u32)arrlen(source->tasks);
+	bool indices = stream == GLTF_STREAM_INDICES;
+#define TASK_FIRST(t) (indices ? source->tasks[t].firstIndex : source->tasks[t].firstVertex)
+#define TASK_COUNT(t) (indices ? source->tasks[t].indexCount : source->tasks[t].vertexCount)
+
+	// Tasks are laid out in order, so the first one overlapping the range is found by bisection
+	u32 lo = 0, hi = taskCount;
+	while (lo < hi)
+	{
+		u32 mid = (lo + hi) / 2;
+		if (TASK_FIRST(mid) + TASK_COUNT(mid) <= first)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	GltfSlice* slices = NULL;
+	u32 end = first + count;
+	for (u32 t = lo; t < taskCount && TASK_FIRST(t) < end; ++t)
+	{
+		u32 begin = first > TASK_FIRST(t) ? first - TASK_FIRST(t) : 0;
+		u32 stop = TASK_FIRST(t) + TASK_COUNT(t) < end ? TASK_COUNT(t) : end - TASK_FIRST(t);
+		for (u32 b = begin; b < stop; b += GLTF_DECODE_GRAIN)
+		{
+			GltfSlice slice = {.task = t, .begin = b, .end = stop - b < GLTF_DECODE_GRAIN ? stop : b + GLTF_DECODE_GRAIN};
+			glm_vec3_copy((vec3){FLT_MAX, FLT_MAX, FLT_MAX}, slice.aabbMin);
+			glm_vec3_copy((vec3){-FLT_MAX, -FLT_MAX, -FLT_MAX}, slice.aabbMax);
+			arrput(slices, slice);
+		}
+	}
+#undef TASK_FIRST
+#undef TASK_COUNT
+
+	GltfDecodeContext ctx = {mesh, stream, first, dst, slices};
+	jobsParallelFor(jobs, (u32)arrlen(slices), 1, decodeSlices, &ctx);
+
+	if (stream == GLTF_STREAM_VERTICES)
+	{
+		for (u32 s = 0; s < (u32)arrlen(slices); ++s)
+		{
+			u32 primitive = source->tasks[slices[s].task].primitiveIndex;
+			if (primitive == UINT32_MAX)
+				continue;
+			glm_vec3_minv(mesh->primitives[primitive].aabbMin, slices[s].aabbMin, mesh->primitives[primitive].aabbMin);
+			glm_vec3_maxv(mesh->primitives[primitive].aabbMax, slices[s].aabbMax, mesh->primitives[primitive].aabbMax);
+		}
+	}
+	arrfree(slices);
+}
+
+// Also grows the primitives' bounds, so every vertex has to pass through here once
+void gltfDecodeVertices(Mesh* mesh, JobSystem* jobs, u32 firstVertex, u32 count, Vertex* dst)
+{
+	decodeStream(mesh, jobs, GLTF_STREAM_VERTICES, firstVertex, count, dst);
+}
+
+void gltfDecodePositions(Mesh* mesh, JobSystem* jobs, u32 firstVertex, u32 count, vec3* dst)
+{
+	decodeStream(mesh, jobs, GLTF_STREAM_POSITIONS, firstVertex, count, dst);
+}
 
-			// Record primitive
-			if (*primitiveIndex < outMesh->primitive_count)
+void gltfDecodeIndices(Mesh* mesh, JobSystem* jobs, u32 firstIndex, u32 count, u32* dst)
+{
+	decodeStream(mesh, jobs, GLTF_STREAM_INDICES, firstIndex, count, dst);
+}
+
+typedef struct GltfAreaContext
+{
+	const Mesh* mesh;
+	float* areas;
+} GltfAreaContext;
+
+static void primitiveAreas(void* userData, uint32_t begin, uint32_t end)
+{
+	GltfAreaContext* ctx = userData;
+	for (uint32_t p = begin; p < end; ++p)
+	{
+		u32 t = ctx->mesh->source->primitiveTasks[p];
+		float area = 0.0f;
+		if (t != UINT32_MAX)
+		{
+			const GltfPrimitiveTask* task = &ctx->mesh->source->tasks[t];
+			cgltf_accessor* positions = findAttribute(task->primitive, cgltf_attribute_type_position);
+			for (u32 k = 0; k + 2 < task->indexCount; k += 3)
 			{
-				outMesh->primitives[*primitiveIndex].first_index = startIndex;
-				outMesh->primitives[*primitiveIndex].index_count = indexCount;
-				outMesh->primitives[*primitiveIndex].material_index = materialIndex;
-				(*primitiveIndex)++;
+				vec3 p0, p1, p2;
+				worldPosition(task, positions, taskIndex(task, k + 0), p0);
+				worldPosition(task, positions, taskIndex(task, k + 1), p1);
+				worldPosition(task, positions, taskIndex(task, k + 2), p2);
+				area += occlusionTriangleArea(p0, p1, p2);
 			}
 		}
+		ctx->areas[p] = area;
 	}
+}
 
-	// Recurse into children
-	for (cgltf_size i = 0; i < node->children_count; ++i)
+// World-space surface area of every primitive, what occluders are ranked by
+void gltfPrimitiveAreas(const Mesh* mesh, JobSystem* jobs, float* areas)
+{
+	GltfAreaContext ctx = {mesh, areas};
+	jobsParallelFor(jobs, mesh->primitive_count, 16, primitiveAreas, &ctx);
+}
+
+// A primitive's world-space triangles, 9 floats each, for the occluders that were picked
+void gltfPrimitiveTriangles(const Mesh* mesh, u32 primitive, float* dst)
+{
+	u32 t = mesh->source->primitiveTasks[primitive];
+	if (t == UINT32_MAX)
+		return;
+	const GltfPrimitiveTask* task = &mesh->source->tasks[t];
+	cgltf_accessor* positions = findAttribute(task->primitive, cgltf_attribute_type_position);
+	for (u32 k = 0; k + 2 < task->indexCount; k += 3)
 	{
-		ProcessGltfNode(node->children[i], outMesh, data, worldTransform, app, vertexOffset, indexOffset, primitiveIndex);
+		for (u32 v = 0; v < 3; ++v)
+			worldPosition(task, positions, taskIndex(task, k + v), &dst[v * 3]);
+		dst += 9;
 	}
 }
 
+void gltfSourceFree(GltfSource* source)
+{
+	if (!source)
+		return;
+	// cgltf_free only releases the .gltf file itself; everything else goes with the arena
+	if (source->data)
+		cgltf_free(source->data);
+	arrfree(source->tasks);
+	arenaFree(&source->import);
+	free(source);
+}
+
 void checkMaterials(cgltf_data* data)
 {
 	printf("Total materials defined in file: %zu\n", data->materials_count);
@@ -182,34 +392,126 @@ void checkMaterials(cgltf_data* data)
 // will it be better to load openusd or work on our format for loading data ,we need to be thinking about what data format to ship on production
 // it could be that simple json file can be used to extract needed  data from gltf to our simple json format this is not very important to change now we can also
 // just inially ship with gltf then research about it later as pixar
-void loadGltfModel(const char* path, Mesh* outMesh)
+#define GLTF_IMPORT_BLOCK_SIZE (1u << 20) // cgltf makes thousands of small allocations per file
+
+// Everything cgltf allocates comes from the import arena and goes with it in one free
+static void* gltfArenaAlloc(void* user, cgltf_size size)
+{
+	return arenaAlloc(user, size);
+}
+
+static void gltfArenaFree(void* user, void* ptr)
+{
+	(void)user;
+	(void)ptr;
+}
+
+// cgltf's file hook, so the .gltf itself and anything cgltf still loads go through the batched reader
+static cgltf_result gltfFileRead(const struct cgltf_memory_options* memory_options, const struct cgltf_file_options* file_options,
+    const char* path, cgltf_size* size, void** data)
+{
+	(void)memory_options;
+	FileRead read = {.path = path, .size = size ? *size : 0};
+	if (fileioReadBatch(file_options->user_data, &read, 1) != 0)
+		return read.error == ENOENT ? cgltf_result_file_not_found : cgltf_result_io_error;
+	if (size)
+		*size = read.bytesRead;
+	*data = read.dst; // malloc'd; the arena's free does nothing, so gltfFileRelease frees it
+	return cgltf_result_success;
+}
+
+static void gltfFileRelease(const struct cgltf_memory_options* memory_options, const struct cgltf_file_options* file_options, void* data)
+{
+	(void)memory_options;
+	(void)file_options;
+	free(data);
+}
+
+// Reads every external buffer in one batch, straight into import arena memory that cgltf
+// keeps for it; cgltf_load_buffers then skips them and only handles embedded data
+static bool readGltfBuffers(FileIO* io, cgltf_data* data, const char* dir_path, Arena* import)
+{
+	FileRead* reads = arenaCalloc(import, data->buffers_count, sizeof(FileRead));
+	cgltf_size* owners = arenaAlloc(import, data->buffers_count * sizeof(cgltf_size));
+	u32 count = 0;
+	for (cgltf_size i = 0; i < data->buffers_count; ++i)
+	{
+		const char* uri = data->buffers[i].uri;
+		if (data->buffers[i].data || data->buffers[i].size == 0 || !uri || strncmp(uri, "data:", 5) == 0 || strstr(uri, "://"))
+			continue;
+		size_t dir_len = strlen(dir_path);
+		char* buffer_path = arenaPrintf(import, "%s%s", dir_path, uri);
+		cgltf_decode_uri(buffer_path + dir_len);
+		reads[count].path = buffer_path;
+		reads[count].dst = arenaAlloc(import, data->buffers[i].size);
+		reads[count].size = data->buffers[i].size;
+		owners[count] = i;
+		count++;
+	}
+
+	bool ok = fileioReadBatch(io, reads, count) == 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (reads[i].error == 0)
+		{
+			data->buffers[owners[i]].data = reads[i].dst;
+			data->buffers[owners[i]].data_free_method = cgltf_data_free_method_none;
+		}
+		else
+			fprintf(stderr, "GLTF: failed to read buffer %s: %s\n", reads[i].path, strerror(reads[i].error));
+	}
+	return ok;
+}
+
+// Runs on a worker thread under the asset loader, so failures are reported rather than fatal.
+// Only the layout is worked out here: the document and its buffers stay alive in
+// outMesh->source and the streams are decoded from them while they are uploaded.
+bool loadGltfModel(const char* path, Mesh* outMesh, JobSystem* jobs, FileIO* io)
 {
+	(void)jobs;
+	// The parsed document, the buffers and every scratch string of the import live here.
+	// cgltf keeps a pointer to the arena, so it can't move once parsing starts.
+	double importStart = benchmarkNowMs();
+	GltfSource* source = calloc(1, sizeof(GltfSource));
+	Arena* import = &source->import;
+	arenaInit(import, GLTF_IMPORT_BLOCK_SIZE);
+
 	cgltf_options options = {0};
+	options.memory.alloc_func = gltfArenaAlloc;
+	options.memory.free_func = gltfArenaFree;
+	options.memory.user_data = import;
+	options.file.read = gltfFileRead;
+	options.file.release = gltfFileRelease;
+	options.file.user_data = io;
 	cgltf_data* data = NULL;
 
-	    cgltf_parse_file(&options, path, &data);
+	if (cgltf_parse_file(&options, path, &data) != cgltf_result_success)
+	{
+		fprintf(stderr, "GLTF: failed to parse %s\n", path);
+		gltfSourceFree(source);
+		return false;
+	}
     printf("GLTF materials_count: %zu\n", data->materials_count);
 
 
 	char* dir_path = NULL;
 	char* last_slash = strrchr(path, '/');
 	if (last_slash)
-	{
-		size_t dir_len = last_slash - path + 1;
-		dir_path = malloc(dir_len + 1);
-		strncpy(dir_path, path, dir_len);
-		dir_path[dir_len] = '\0';
-	}
+		dir_path = arenaPrintf(import, "%.*s", (int)(last_slash - path + 1), path);
 	else
+		dir_path = arenaStrdup(import, "./");
+
+	source->data = data;
+	if (!readGltfBuffers(io, data, dir_path, import) || cgltf_load_buffers(&options, data, dir_path) != cgltf_result_success)
 	{
-		dir_path = malloc(3);
-		strcpy(dir_path, "./");
+		fprintf(stderr, "GLTF: failed to load buffers for %s\n", path);
+		gltfSourceFree(source);
+		return false;
 	}
 
-	cgltf_load_buffers(&options, data, dir_path);
-
 	// Initialize mesh
 	memset(outMesh, 0, sizeof(Mesh));
+	outMesh->source = source;
 
 	// Parse materials first
 	outMesh->material_count = data->materials_count;
@@ -269,9 +571,7 @@ void loadGltfModel(const char* path, Mesh* outMesh)
 				{
 					ourMat->hasBaseColorTexture = 1;
 					const char* uri = pbr->base_color_texture.texture->image->uri;
-					size_t full_path_len = strlen(dir_path) + strlen(uri) + 1;
-					ourMat->baseColorTexturePath = malloc(full_path_len);
-					snprintf(ourMat->baseColorTexturePath, full_path_len, "%s%s", dir_path, uri);
+					ourMat->baseColorTexturePath = arenaPrintf(&outMesh->strings, "%s%s", dir_path, uri);
 				}
 
 					// Double-sided
@@ -281,9 +581,7 @@ void loadGltfModel(const char* path, Mesh* outMesh)
 				{
 					ourMat->hasMetallicRoughnessTexture = 1;
 					const char* uri = pbr->metallic_roughness_texture.texture->image->uri;
-					size_t full_path_len = strlen(dir_path) + strlen(uri) + 1;
-					ourMat->metallicRoughnessTexturePath = malloc(full_path_len);
-					snprintf(ourMat->metallicRoughnessTexturePath, full_path_len, "%s%s", dir_path, uri);
+					ourMat->metallicRoughnessTexturePath = arenaPrintf(&outMesh->strings, "%s%s", dir_path, uri);
 				}
 			}
 
@@ -291,38 +589,26 @@ void loadGltfModel(const char* path, Mesh* outMesh)
 			{
 				ourMat->hasEmissiveTexture = 1;
 				const char* uri = mat->emissive_texture.texture->image->uri;
-				size_t full_path_len = strlen(dir_path) + strlen(uri) + 1;
-				ourMat->emissiveTexturePath = malloc(full_path_len);
-				snprintf(ourMat->emissiveTexturePath, full_path_len, "%s%s", dir_path, uri);
+				ourMat->emissiveTexturePath = arenaPrintf(&outMesh->strings, "%s%s", dir_path, uri);
 			}
 
 			memcpy(ourMat->emissiveFactor, mat->emissive_factor, sizeof(float) * 3);
 		}
 	}
 
-	// Count vertices, indices, and primitives
-	size_t totalVertices = 0, totalIndices = 0, totalPrimitives = 0;
+	// Primitives are counted per mesh; the vertex and index totals come from the node walk,
+	// since a mesh used by several nodes is emitted once per node
+	size_t totalPrimitives = 0;
 	for (cgltf_size i = 0; i < data->meshes_count; ++i)
 	{
 		cgltf_mesh* mesh = &data->meshes[i];
 		for (cgltf_size j = 0; j < mesh->primitives_count; ++j)
 		{
-			cgltf_primitive* prim = &mesh->primitives[j];
-			if (prim->attributes_count == 0)
-				continue;
-
-			totalVertices += prim->attributes[0].data->count;
-			totalIndices += prim->indices ? prim->indices->count : prim->attributes[0].data->count;
-			totalPrimitives++;
+			if (mesh->primitives[j].attributes_count > 0)
+				totalPrimitives++;
 		}
 	}
-
-	// Allocate arrays
-	outMesh->vertex_count = totalVertices;
-	outMesh->index_count = totalIndices;
 	outMesh->primitive_count = totalPrimitives;
-	outMesh->vertices = calloc(totalVertices, sizeof(Vertex));
-	outMesh->indices = malloc(totalIndices * sizeof(u32));
 	outMesh->primitives = calloc(totalPrimitives, sizeof(Primitive));
 
 	uint32_t vertexOffset = 0;
@@ -333,7 +619,17 @@ void loadGltfModel(const char* path, Mesh* outMesh)
 
 	for (cgltf_size i = 0; i < data->scenes[0].nodes_count; ++i)
 	{
-		ProcessGltfNode(data->scenes[0].nodes[i], outMesh, data, identity, NULL, &vertexOffset, &indexOffset, &primitiveIndex);
+		ProcessGltfNode(data->scenes[0].nodes[i], outMesh, data, identity, &source->tasks, &vertexOffset, &indexOffset, &primitiveIndex);
+	}
+	outMesh->vertex_count = vertexOffset;
+	outMesh->index_count = indexOffset;
+
+	source->primitiveTasks = arenaAlloc(import, (totalPrimitives ? totalPrimitives : 1) * sizeof(u32));
+	memset(source->primitiveTasks, 0xff, (totalPrimitives ? totalPrimitives : 1) * sizeof(u32));
+	for (u32 t = 0; t < (u32)arrlen(source->tasks); ++t)
+	{
+		if (source->tasks[t].primitiveIndex != UINT32_MAX)
+			source->primitiveTasks[source->tasks[t].primitiveIndex] = t;
 	}
 
 	// Legacy support - use first material for backward compatibility
@@ -342,19 +638,18 @@ void loadGltfModel(const char* path, Mesh* outMesh)
 		memcpy(outMesh->base_color, outMesh->materials[0].baseColorFactor, sizeof(vec4));
 		outMesh->has_texture = outMesh->materials[0].hasBaseColorTexture;
 		if (outMesh->materials[0].baseColorTexturePath)
-		{
-			outMesh->texture_path = malloc(strlen(outMesh->materials[0].baseColorTexturePath) + 1);
-			strcpy(outMesh->texture_path, outMesh->materials[0].baseColorTexturePath);
-		}
+			outMesh->texture_path = outMesh->materials[0].baseColorTexturePath;
 	}
 	else
 	{
 		// Fallback
-		outMesh->texture_path = malloc(strlen("Bark_DeadTree.png") + 1);
-		strcpy(outMesh->texture_path, "Bark_DeadTree.png");
+		outMesh->texture_path = arenaStrdup(&outMesh->strings, "Bark_DeadTree.png");
 	}
 
-	free(dir_path);
-	cgltf_free(data);
+	printf("GLTF: %u primitives, %u vertices, %u indices laid out in %.1f ms, %llu allocations served from %llu blocks (%.1f MiB)\n",
+	    (uint32_t)arrlen(source->tasks), outMesh->vertex_count, outMesh->index_count,
+	    benchmarkNowMs() - importStart, (unsigned long long)import->stats.allocations,
+	    (unsigned long long)import->stats.blocks, (double)import->stats.peakBytes / (1024.0 * 1024.0));
+	return true;
 }
 
@@ -273,8 +273,18 @@ NK_API VkSemaphore nk_glfw3_render(VkQueue graphics_queue,
     uint32_t buffer_index,
     VkSemaphore wait_semaphore,
     enum nk_anti_aliasing AA);
+/* Records the UI pass into a caller-owned command buffer (no submit). The
+ * image view at buffer_index must be in COLOR_ATTACHMENT_OPTIMAL. */
+NK_API void nk_glfw3_record(VkCommandBuffer command_buffer,
+    uint32_t buffer_index,
+    enum nk_anti_aliasing AA);
 NK_API void nk_glfw3_resize(uint32_t framebuffer_width,
     uint32_t framebuffer_height);
+/* Points nk_glfw3_record at a recreated swapchain. Viewport and scissor are
+ * dynamic, so no Vulkan object is destroyed and nothing waits for the GPU. */
+NK_API void nk_glfw3_swapchain_changed(VkImageView* image_views,
+    uint32_t image_views_len, uint32_t framebuffer_width,
+    uint32_t framebuffer_height);
 NK_API void nk_glfw3_device_destroy(void);
 NK_API void nk_glfw3_device_create(
     VkDevice logical_device, VkPhysicalDevice physical_device,
@@ -1132,6 +1142,20 @@ NK_API void nk_glfw3_resize(uint32_t framebuffer_width,
 	nk_glfw3_create_render_resources(dev);
 }
 
+NK_API void nk_glfw3_swapchain_changed(VkImageView* image_views,
+    uint32_t image_views_len, uint32_t framebuffer_width,
+    uint32_t framebuffer_height)
+{
+	struct nk_glfw_device* dev = &glfw.vulkan;
+	glfwGetWindowSize(glfw.win, &glfw.width, &glfw.height);
+	glfwGetFramebufferSize(glfw.win, &glfw.display_width, &glfw.display_height);
+
+	dev->image_views = image_views;
+	dev->image_views_len = image_views_len;
+	dev->framebuffer_width = framebuffer_width;
+	dev->framebuffer_height = framebuffer_height;
+}
+
 NK_API void nk_glfw3_device_destroy(void)
 {
 	struct nk_glfw_device* dev = &glfw.vulkan;
@@ -1350,8 +1374,7 @@ NK_INTERN void update_texture_descriptor_set(
 }
 
 NK_API
-VkSemaphore nk_glfw3_render(VkQueue graphics_queue, uint32_t buffer_index,
-    VkSemaphore wait_semaphore,
+void nk_glfw3_record(VkCommandBuffer command_buffer, uint32_t buffer_index,
     enum nk_anti_aliasing AA)
 {
 	struct nk_glfw_device* dev = &glfw.vulkan;
@@ -1362,21 +1385,13 @@ VkSemaphore nk_glfw3_render(VkQueue graphics_queue, uint32_t buffer_index,
 	        0.0f, -1.0f, 1.0f, 0.0f, 1.0f},
 	};
 
-	VkCommandBufferBeginInfo begin_info;
 	VkClearValue clear_value = {{{0.0f, 0.0f, 0.0f, 0.0f}}};
-	VkCommandBuffer command_buffer;
-	VkResult result;
 	VkViewport viewport;
 
 	VkDeviceSize doffset = 0;
 	VkImageView current_texture = NULL;
 	uint32_t index_offset = 0;
 	VkRect2D scissor;
-	uint32_t wait_semaphore_count;
-	VkSemaphore* wait_semaphores;
-	VkPipelineStageFlags wait_stage =
-	    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	VkSubmitInfo submit_info;
 	VkRenderingAttachmentInfo color_attachment_info;
 	VkRenderingInfo rendering_info;
 
@@ -1386,14 +1401,6 @@ VkSemaphore nk_glfw3_render(VkQueue graphics_queue, uint32_t buffer_index,
 
 	memcpy(dev->mapped_uniform, &projection, sizeof(projection));
 
-	memset(&begin_info, 0, sizeof(VkCommandBufferBeginInfo));
-	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-	command_buffer = dev->command_buffers[buffer_index];
-
-	result = vkBeginCommandBuffer(command_buffer, &begin_info);
-	NK_ASSERT(result == VK_SUCCESS);
-
 	memset(&color_attachment_info, 0, sizeof(VkRenderingAttachmentInfo));
 	color_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 	color_attachment_info.imageView = dev->image_views[buffer_index];
@@ -1517,6 +1524,33 @@ VkSemaphore nk_glfw3_render(VkQueue graphics_queue, uint32_t buffer_index,
 	}
 
 	vkCmdEndRendering(command_buffer);
+}
+
+NK_API
+VkSemaphore nk_glfw3_render(VkQueue graphics_queue, uint32_t buffer_index,
+    VkSemaphore wait_semaphore,
+    enum nk_anti_aliasing AA)
+{
+	struct nk_glfw_device* dev = &glfw.vulkan;
+	VkCommandBufferBeginInfo begin_info;
+	VkCommandBuffer command_buffer;
+	VkResult result;
+	uint32_t wait_semaphore_count;
+	VkSemaphore* wait_semaphores;
+	VkPipelineStageFlags wait_stage =
+	    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	VkSubmitInfo submit_info;
+
+	memset(&begin_info, 0, sizeof(VkCommandBufferBeginInfo));
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+	command_buffer = dev->command_buffers[buffer_index];
+
+	result = vkBeginCommandBuffer(command_buffer, &begin_info);
+	NK_ASSERT(result == VK_SUCCESS);
+
+	nk_glfw3_record(command_buffer, buffer_index, AA);
+
 	result = vkEndCommandBuffer(command_buffer);
 	NK_ASSERT(result == VK_SUCCESS);
 
@@ -0,0 +1,554 @@
+#define _POSIX_C_SOURCE 200809L
+#include "occlusion.h"
+
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OCCLUSION_HAS_X86 1
+#endif
+
+#define OCCLUSION_NEAR_W 1e-5f
+
+typedef struct OcclusionWorkerArg
+{
+	struct OcclusionWorkers* workers;
+	int band;
+} OcclusionWorkerArg;
+
+typedef struct OcclusionWorkers
+{
+	pthread_t threads[OCCLUSION_MAX_THREADS];
+	OcclusionWorkerArg args[OCCLUSION_MAX_THREADS]; // per buffer, so several buffers can run at once
+	pthread_mutex_t mutex;
+	pthread_cond_t startCond;
+	pthread_cond_t doneCond;
+	unsigned long generation;
+	int pending;
+	bool quit;
+	OcclusionBuffer* ob;
+} OcclusionWorkers;
+
+double occlusionNowMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static void transformPoint(const float m[16], const float p[3], float out[4])
+{
+	for (int r = 0; r < 4; ++r)
+	{
+		out[r] = m[0 * 4 + r] * p[0] + m[1 * 4 + r] * p[1] + m[2 * 4 + r] * p[2] + m[3 * 4 + r];
+	}
+}
+
+// --- Setup ---
+
+static void setupScreenTriangles(OcclusionBuffer* ob, const float viewProj[16])
+{
+	ob->screenTriangleCount = 0;
+
+	for (uint32_t t = 0; t < ob->occluderTriangleCount; ++t)
+	{
+		const float* tri = &ob->occluderTris[t * 9];
+		float sx[3], sy[3], depth = -FLT_MAX;
+		bool crossesNear = false;
+
+		for (int v = 0; v < 3; ++v)
+		{
+			float clip[4];
+			transformPoint(viewProj, &tri[v * 3], clip);
+			if (clip[3] <= OCCLUSION_NEAR_W)
+			{
+				crossesNear = true;
+				break;
+			}
+			float invW = 1.0f / clip[3];
+			sx[v] = (clip[0] * invW * 0.5f + 0.5f) * (float)ob->width;
+			sy[v] = (clip[1] * invW * 0.5f + 0.5f) * (float)ob->height;
+			float z = clip[2] * invW;
+			if (z > depth)
+				depth = z;
+		}
+		// Skipping a near-clipped occluder only makes the buffer less occluding
+		if (crossesNear)
+			continue;
+
+		float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+		if (fabsf(area) < 1e-6f)
+			continue;
+		// Occluders may be double sided; normalise winding instead of culling
+		if (area < 0.0f)
+		{
+			float tx = sx[1], ty = sy[1];
+			sx[1] = sx[2];
+			sy[1] = sy[2];
+			sx[2] = tx;
+			sy[2] = ty;
+		}
+
+		float fminX = fminf(sx[0], fminf(sx[1], sx[2]));
+		float fmaxX = fmaxf(sx[0], fmaxf(sx[1], sx[2]));
+		float fminY = fminf(sy[0], fminf(sy[1], sy[2]));
+		float fmaxY = fmaxf(sy[0], fmaxf(sy[1], sy[2]));
+		int minX = (int)floorf(fminX), maxX = (int)ceilf(fmaxX);
+		int minY = (int)floorf(fminY), maxY = (int)ceilf(fmaxY);
+		if (minX < 0)
+			minX = 0;
+		if (minY < 0)
+			minY = 0;
+		if (maxX > ob->width - 1)
+			maxX = ob->width - 1;
+		if (maxY > ob->height - 1)
+			maxY = ob->height - 1;
+		if (minX > maxX || minY > maxY)
+			continue;
+
+		OcclusionScreenTri* st = &ob->screenTris[ob->screenTriangleCount++];
+		for (int e = 0; e < 3; ++e)
+		{
+			int i0 = e, i1 = (e + 1) % 3;
+			// E(p) = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0), positive inside
+			st->a[e] = sy[i0] - sy[i1];
+			st->b[e] = sx[i1] - sx[i0];
+			st->c[e] = -(st->a[e] * sx[i0] + st->b[e] * sy[i0]);
+		}
+		st->depth = depth;
+		st->minX = minX;
+		st->maxX = maxX;
+		st->minY = minY;
+		st->maxY = maxY;
+	}
+}
+
+static void clearBand(OcclusionBuffer* ob, int y0, int y1)
+{
+	for (int y = y0; y < y1; ++y)
+	{
+		float* row = &ob->depth[(size_t)y * ob->width];
+		for (int x = 0; x < ob->width; ++x)
+			row[x] = FLT_MAX;
+	}
+}
+
+static void updateTileMaxDepth(OcclusionBuffer* ob, int tileY0, int tileY1)
+{
+	for (int ty = tileY0; ty < tileY1; ++ty)
+	{
+		for (int tx = 0; tx < ob->tilesX; ++tx)
+		{
+			float maxDepth = -FLT_MAX;
+			for (int y = 0; y < OCCLUSION_TILE_SIZE; ++y)
+			{
+				const float* row = &ob->depth[(size_t)(ty * OCCLUSION_TILE_SIZE + y) * ob->width + tx * OCCLUSION_TILE_SIZE];
+				for (int x = 0; x < OCCLUSION_TILE_SIZE; ++x)
+					maxDepth = row[x] > maxDepth ? row[x] : maxDepth;
+			}
+			ob->tileMaxDepth[ty * ob->tilesX + tx] = maxDepth;
+		}
+	}
+}
+
+// --- Rasterizers ---
+
+static void rasterizeBandScalar(OcclusionBuffer* ob, int y0, int y1)
+{
+	for (uint32_t t = 0; t < ob->screenTriangleCount; ++t)
+	{
+		const OcclusionScreenTri* st = &ob->screenTris[t];
+		int minY = st->minY > y0 ? st->minY : y0;
+		int maxY = st->maxY < y1 - 1 ? st->maxY : y1 - 1;
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			float py = (float)y + 0.5f;
+			float r0 = st->b[0] * py + st->c[0];
+			float r1 = st->b[1] * py + st->c[1];
+			float r2 = st->b[2] * py + st->c[2];
+			float* row = &ob->depth[(size_t)y * ob->width];
+
+			// Same 8-aligned span as the SIMD path so both touch identical pixels
+			int startX = st->minX & ~(OCCLUSION_TILE_SIZE - 1);
+			for (int x = startX; x <= st->maxX; ++x)
+			{
+				float px = (float)x + 0.5f;
+				float e0 = st->a[0] * px + r0;
+				float e1 = st->a[1] * px + r1;
+				float e2 = st->a[2] * px + r2;
+				if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f && st->depth < row[x])
+					row[x] = st->depth;
+			}
+		}
+	}
+}
+
+#ifdef OCCLUSION_HAS_X86
+__attribute__((target("avx2"))) static void rasterizeBandAvx2(OcclusionBuffer* ob, int y0, int y1)
+{
+	const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	for (uint32_t t = 0; t < ob->screenTriangleCount; ++t)
+	{
+		const OcclusionScreenTri* st = &ob->screenTris[t];
+		int minY = st->minY > y0 ? st->minY : y0;
+		int maxY = st->maxY < y1 - 1 ? st->maxY : y1 - 1;
+		if (minY > maxY)
+			continue;
+
+		const __m256 a0 = _mm256_set1_ps(st->a[0]);
+		const __m256 a1 = _mm256_set1_ps(st->a[1]);
+		const __m256 a2 = _mm256_set1_ps(st->a[2]);
+		const __m256 z = _mm256_set1_ps(st->depth);
+		int startX = st->minX & ~(OCCLUSION_TILE_SIZE - 1);
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			float py = (float)y + 0.5f;
+			const __m256 r0 = _mm256_set1_ps(st->b[0] * py + st->c[0]);
+			const __m256 r1 = _mm256_set1_ps(st->b[1] * py + st->c[1]);
+			const __m256 r2 = _mm256_set1_ps(st->b[2] * py + st->c[2]);
+			float* row = &ob->depth[(size_t)y * ob->width];
+
+			for (int x = startX; x <= st->maxX; x += 8)
+			{
+				__m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+				__m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, px), r0);
+				__m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, px), r1);
+				__m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, px), r2);
+				__m256 inside = _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+				    _mm256_and_ps(_mm256_cmp_ps(e1, zero, _CMP_GE_OQ), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ)));
+				if (_mm256_movemask_ps(inside) == 0)
+					continue;
+				__m256 d = _mm256_load_ps(row + x);
+				_mm256_store_ps(row + x, _mm256_blendv_ps(d, _mm256_min_ps(d, z), inside));
+			}
+		}
+	}
+}
+#endif
+
+static void rasterizeBand(OcclusionBuffer* ob, int band, int bandCount)
+{
+	int tileY0 = ob->tilesY * band / bandCount;
+	int tileY1 = ob->tilesY * (band + 1) / bandCount;
+	int y0 = tileY0 * OCCLUSION_TILE_SIZE;
+	int y1 = tileY1 * OCCLUSION_TILE_SIZE;
+	if (y0 == y1)
+		return;
+
+	clearBand(ob, y0, y1);
+#ifdef OCCLUSION_HAS_X86
+	if (ob->hasAvx2 && !ob->useReference)
+		rasterizeBandAvx2(ob, y0, y1);
+	else
+#endif
+		rasterizeBandScalar(ob, y0, y1);
+	updateTileMaxDepth(ob, tileY0, tileY1);
+}
+
+// --- Worker threads ---
+
+static void* occlusionWorkerMain(void* userData)
+{
+	OcclusionWorkerArg* arg = userData;
+	OcclusionWorkers* w = arg->workers;
+	unsigned long seen = 0;
+
+	pthread_mutex_lock(&w->mutex);
+	for (;;)
+	{
+		while (!w->quit && w->generation == seen)
+			pthread_cond_wait(&w->startCond, &w->mutex);
+		if (w->quit)
+			break;
+		seen = w->generation;
+		pthread_mutex_unlock(&w->mutex);
+
+		rasterizeBand(w->ob, arg->band, w->ob->threadCount);
+
+		pthread_mutex_lock(&w->mutex);
+		if (--w->pending == 0)
+			pthread_cond_signal(&w->doneCond);
+	}
+	pthread_mutex_unlock(&w->mutex);
+	return NULL;
+}
+
+void occlusionInit(OcclusionBuffer* ob, int width, int height, int threadCount)
+{
+	memset(ob, 0, sizeof(*ob));
+	ob->width = (width + OCCLUSION_TILE_SIZE - 1) & ~(OCCLUSION_TILE_SIZE - 1);
+	ob->height = (height + OCCLUSION_TILE_SIZE - 1) & ~(OCCLUSION_TILE_SIZE - 1);
+	ob->tilesX = ob->width / OCCLUSION_TILE_SIZE;
+	ob->tilesY = ob->height / OCCLUSION_TILE_SIZE;
+	ob->depth = aligned_alloc(32, (size_t)ob->width * ob->height * sizeof(float));
+	ob->tileMaxDepth = malloc((size_t)ob->tilesX * ob->tilesY * sizeof(float));
+	clearBand(ob, 0, ob->height);
+	for (int i = 0; i < ob->tilesX * ob->tilesY; ++i)
+		ob->tileMaxDepth[i] = FLT_MAX;
+
+#ifdef OCCLUSION_HAS_X86
+	ob->hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	if (threadCount < 1)
+		threadCount = 1;
+	if (threadCount > OCCLUSION_MAX_THREADS)
+		threadCount = OCCLUSION_MAX_THREADS;
+	if (threadCount > ob->tilesY)
+		threadCount = ob->tilesY;
+	ob->threadCount = threadCount;
+
+	if (threadCount > 1)
+	{
+		OcclusionWorkers* w = calloc(1, sizeof(OcclusionWorkers));
+		w->ob = ob;
+		pthread_mutex_init(&w->mutex, NULL);
+		pthread_cond_init(&w->startCond, NULL);
+		pthread_cond_init(&w->doneCond, NULL);
+		// Band 0 runs on the calling thread
+		for (int i = 1; i < threadCount; ++i)
+		{
+			w->args[i] = (OcclusionWorkerArg){.workers = w, .band = i};
+			pthread_create(&w->threads[i], NULL, occlusionWorkerMain, &w->args[i]);
+		}
+		ob->workers = w;
+	}
+}
+
+void occlusionDestroy(OcclusionBuffer* ob)
+{
+	OcclusionWorkers* w = ob->workers;
+	if (w)
+	{
+		pthread_mutex_lock(&w->mutex);
+		w->quit = true;
+		pthread_cond_broadcast(&w->startCond);
+		pthread_mutex_unlock(&w->mutex);
+		for (int i = 1; i < ob->threadCount; ++i)
+			pthread_join(w->threads[i], NULL);
+		pthread_cond_destroy(&w->startCond);
+		pthread_cond_destroy(&w->doneCond);
+		pthread_mutex_destroy(&w->mutex);
+		free(w);
+	}
+	free(ob->depth);
+	free(ob->tileMaxDepth);
+	free(ob->occluderTris);
+	free(ob->screenTris);
+	memset(ob, 0, sizeof(*ob));
+}
+
+// --- Occluder selection ---
+
+typedef struct RankedSource
+{
+	uint32_t index;
+	float area;
+} RankedSource;
+
+static int compareRankedSource(const void* a, const void* b)
+{
+	float fa = ((const RankedSource*)a)->area;
+	float fb = ((const RankedSource*)b)->area;
+	return fa < fb ? 1 : (fa > fb ? -1 : 0);
+}
+
+static const float* vertexAt(const float* positions, size_t stride, uint32_t index)
+{
+	return (const float*)((const unsigned char*)positions + (size_t)index * stride);
+}
+
+float occlusionTriangleArea(const float p0[3], const float p1[3], const float p2[3])
+{
+	float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+	float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+	float cx = e1[1] * e2[2] - e1[2] * e2[1];
+	float cy = e1[2] * e2[0] - e1[0] * e2[2];
+	float cz = e1[0] * e2[1] - e1[1] * e2[0];
+	return 0.5f * sqrtf(cx * cx + cy * cy + cz * cz);
+}
+
+uint32_t occlusionRankOccluders(const float* areas, const OccluderSource* sources, uint32_t sourceCount,
+    uint32_t triangleBudget, bool* selected)
+{
+	RankedSource* ranked = malloc((sourceCount ? sourceCount : 1) * sizeof(RankedSource));
+	for (uint32_t s = 0; s < sourceCount; ++s)
+		ranked[s] = (RankedSource){.index = s, .area = areas[s]};
+	qsort(ranked, sourceCount, sizeof(RankedSource), compareRankedSource);
+
+	// Greedy fill: a source too big for the remaining budget is skipped, smaller ones may still fit
+	uint32_t triangles = 0;
+	for (uint32_t s = 0; s < sourceCount; ++s)
+	{
+		uint32_t count = sources[ranked[s].index].indexCount / 3;
+		selected[ranked[s].index] = triangles + count <= triangleBudget;
+		if (selected[ranked[s].index])
+			triangles += count;
+	}
+	free(ranked);
+	return triangles;
+}
+
+float* occlusionReserveOccluders(OcclusionBuffer* ob, uint32_t triangleCount)
+{
+	free(ob->occluderTris);
+	free(ob->screenTris);
+	ob->occluderTris = malloc((size_t)(triangleCount ? triangleCount : 1) * 9 * sizeof(float));
+	ob->screenTris = malloc((size_t)(triangleCount ? triangleCount : 1) * sizeof(OcclusionScreenTri));
+	ob->occluderTriangleCount = triangleCount;
+	return ob->occluderTris;
+}
+
+void occlusionSelectOccluders(OcclusionBuffer* ob, const float* positions, size_t stride,
+    const uint32_t* indices, const OccluderSource* sources, uint32_t sourceCount, uint32_t triangleBudget)
+{
+	// Zeroed: with no sources GCC can't tell the ranking never reads the placeholder element
+	float* areas = calloc(sourceCount ? sourceCount : 1, sizeof(float));
+	for (uint32_t s = 0; s < sourceCount; ++s)
+	{
+		float area = 0.0f;
+		for (uint32_t i = 0; i + 2 < sources[s].indexCount; i += 3)
+		{
+			const float* p0 = vertexAt(positions, stride, indices[sources[s].firstIndex + i + 0]);
+			const float* p1 = vertexAt(positions, stride, indices[sources[s].firstIndex + i + 1]);
+			const float* p2 = vertexAt(positions, stride, indices[sources[s].firstIndex + i + 2]);
+			area += occlusionTriangleArea(p0, p1, p2);
+		}
+		areas[s] = area;
+	}
+
+	bool* selected = malloc((sourceCount ? sourceCount : 1) * sizeof(bool));
+	uint32_t triangles = occlusionRankOccluders(areas, sources, sourceCount, triangleBudget, selected);
+	float* dst = occlusionReserveOccluders(ob, triangles);
+	for (uint32_t s = 0; s < sourceCount; ++s)
+	{
+		if (!selected[s])
+			continue;
+		const OccluderSource* src = &sources[s];
+		for (uint32_t i = 0; i + 2 < src->indexCount; i += 3)
+		{
+			for (int v = 0; v < 3; ++v)
+				memcpy(&dst[v * 3], vertexAt(positions, stride, indices[src->firstIndex + i + v]), 3 * sizeof(float));
+			dst += 9;
+		}
+	}
+	free(selected);
+	free(areas);
+}
+
+// --- Per-frame ---
+
+void occlusionRasterize(OcclusionBuffer* ob, const float viewProj[16])
+{
+	double start = occlusionNowMs();
+	setupScreenTriangles(ob, viewProj);
+
+	OcclusionWorkers* w = ob->workers;
+	if (w && !ob->useReference)
+	{
+		pthread_mutex_lock(&w->mutex);
+		w->pending = ob->threadCount - 1;
+		w->generation++;
+		pthread_cond_broadcast(&w->startCond);
+		pthread_mutex_unlock(&w->mutex);
+
+		rasterizeBand(ob, 0, ob->threadCount);
+
+		pthread_mutex_lock(&w->mutex);
+		while (w->pending > 0)
+			pthread_cond_wait(&w->doneCond, &w->mutex);
+		pthread_mutex_unlock(&w->mutex);
+	}
+	else
+	{
+		rasterizeBand(ob, 0, 1);
+	}
+
+	ob->stats.occluderTriangles = ob->screenTriangleCount;
+	ob->stats.tested = 0;
+	ob->stats.culled = 0;
+	ob->stats.testMs = 0.0;
+	ob->stats.rasterMs = occlusionNowMs() - start;
+}
+
+void occlusionRasterizeReference(OcclusionBuffer* ob, const float viewProj[16])
+{
+	bool useReference = ob->useReference;
+	ob->useReference = true;
+	occlusionRasterize(ob, viewProj);
+	ob->useReference = useReference;
+}
+
+bool occlusionTestAabb(const OcclusionBuffer* ob, const float viewProj[16], const float aabbMin[3], const float aabbMax[3])
+{
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearest = FLT_MAX;
+
+	for (int c = 0; c < 8; ++c)
+	{
+		float corner[3] = {
+		    (c & 1) ? aabbMax[0] : aabbMin[0],
+		    (c & 2) ? aabbMax[1] : aabbMin[1],
+		    (c & 4) ? aabbMax[2] : aabbMin[2],
+		};
+		float clip[4];
+		transformPoint(viewProj, corner, clip);
+		// Box straddles the camera plane: never cull
+		if (clip[3] <= OCCLUSION_NEAR_W)
+			return true;
+		float invW = 1.0f / clip[3];
+		float sx = (clip[0] * invW * 0.5f + 0.5f) * (float)ob->width;
+		float sy = (clip[1] * invW * 0.5f + 0.5f) * (float)ob->height;
+		float z = clip[2] * invW;
+		minX = sx < minX ? sx : minX;
+		maxX = sx > maxX ? sx : maxX;
+		minY = sy < minY ? sy : minY;
+		maxY = sy > maxY ? sy : maxY;
+		nearest = z < nearest ? z : nearest;
+	}
+
+	int x0 = (int)floorf(minX), x1 = (int)ceilf(maxX);
+	int y0 = (int)floorf(minY), y1 = (int)ceilf(maxY);
+	x0 = x0 < 0 ? 0 : x0;
+	y0 = y0 < 0 ? 0 : y0;
+	x1 = x1 > ob->width ? ob->width : x1;
+	y1 = y1 > ob->height ? ob->height : y1;
+	// Entirely off screen; the frustum would reject it anyway
+	if (x0 >= x1 || y0 >= y1)
+		return false;
+
+	for (int ty = y0 / OCCLUSION_TILE_SIZE; ty <= (y1 - 1) / OCCLUSION_TILE_SIZE; ++ty)
+	{
+		for (int tx = x0 / OCCLUSION_TILE_SIZE; tx <= (x1 - 1) / OCCLUSION_TILE_SIZE; ++tx)
+		{
+			if (ob->tileMaxDepth[ty * ob->tilesX + tx] < nearest)
+				continue; // whole tile is in front of the box
+
+			int py0 = ty * OCCLUSION_TILE_SIZE, py1 = py0 + OCCLUSION_TILE_SIZE;
+			int px0 = tx * OCCLUSION_TILE_SIZE, px1 = px0 + OCCLUSION_TILE_SIZE;
+			py0 = py0 < y0 ? y0 : py0;
+			py1 = py1 > y1 ? y1 : py1;
+			px0 = px0 < x0 ? x0 : px0;
+			px1 = px1 > x1 ? x1 : px1;
+			for (int y = py0; y < py1; ++y)
+			{
+				const float* row = &ob->depth[(size_t)y * ob->width];
+				for (int x = px0; x < px1; ++x)
+				{
+					if (row[x] >= nearest)
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
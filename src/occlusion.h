@@ -0,0 +1,87 @@
+#pragma once
+
+// Masked software occlusion culling on the CPU.
+// Occluder triangles are rasterized into a small depth buffer (no Vulkan here,
+// so the whole module can be exercised on the CPU against the scalar reference).
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define OCCLUSION_WIDTH 320
+#define OCCLUSION_HEIGHT 192
+#define OCCLUSION_TILE_SIZE 8 // 8x8 pixel tiles, one AVX2 register per tile row
+#define OCCLUSION_MAX_THREADS 8
+#define OCCLUSION_DEFAULT_TRIANGLE_BUDGET 4096
+
+typedef struct OccluderSource
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+} OccluderSource;
+
+// Edge functions are evaluated at pixel centers as a * x + (b * y + c)
+typedef struct OcclusionScreenTri
+{
+	float a[3], b[3], c[3];
+	float depth; // farthest vertex depth, keeps occluders conservative
+	int minX, maxX, minY, maxY;
+} OcclusionScreenTri;
+
+typedef struct OcclusionStats
+{
+	uint32_t occluderTriangles; // triangles rasterized this frame
+	uint32_t tested;            // AABBs tested this frame
+	uint32_t culled;            // AABBs rejected this frame
+	double rasterMs;
+	double testMs;
+} OcclusionStats;
+
+struct OcclusionWorkers;
+
+typedef struct OcclusionBuffer
+{
+	int width, height; // width and height are multiples of OCCLUSION_TILE_SIZE
+	int tilesX, tilesY;
+	float* depth;        // row-major, width * height, 32-byte aligned
+	float* tileMaxDepth; // farthest depth stored in each tile
+
+	// World-space occluder triangles, 9 floats per triangle
+	float* occluderTris;
+	uint32_t occluderTriangleCount;
+
+	OcclusionScreenTri* screenTris;
+	uint32_t screenTriangleCount;
+
+	bool useReference; // force the scalar rasterizer
+	bool hasAvx2;
+	int threadCount;
+	struct OcclusionWorkers* workers;
+
+	OcclusionStats stats;
+} OcclusionBuffer;
+
+void occlusionInit(OcclusionBuffer* ob, int width, int height, int threadCount);
+void occlusionDestroy(OcclusionBuffer* ob);
+
+// Picks the largest sources (by surface area) until the triangle budget is used.
+// positions points at the first vertex position, stride is in bytes.
+void occlusionSelectOccluders(OcclusionBuffer* ob, const float* positions, size_t stride,
+    const uint32_t* indices, const OccluderSource* sources, uint32_t sourceCount, uint32_t triangleBudget);
+// The same selection for callers without the whole mesh at hand: ranks sources by areas,
+// marks the chosen ones in selected and returns their triangle count. Reserve that many
+// triangles and write the chosen sources' world-space triangles into them, 9 floats each.
+uint32_t occlusionRankOccluders(const float* areas, const OccluderSource* sources, uint32_t sourceCount,
+    uint32_t triangleBudget, bool* selected);
+float* occlusionReserveOccluders(OcclusionBuffer* ob, uint32_t triangleCount);
+// The area the selection ranks by, summed over a source's triangles
+float occlusionTriangleArea(const float p0[3], const float p1[3], const float p2[3]);
+
+// viewProj is a column-major 4x4 matrix (cglm mat4 layout).
+void occlusionRasterize(OcclusionBuffer* ob, const float viewProj[16]);
+// Returns false when the box is hidden behind the rasterized occluders.
+bool occlusionTestAabb(const OcclusionBuffer* ob, const float viewProj[16], const float aabbMin[3], const float aabbMax[3]);
+
+// Single-threaded scalar rasterizer used as ground truth for the SIMD path.
+void occlusionRasterizeReference(OcclusionBuffer* ob, const float viewProj[16]);
+double occlusionNowMs(void);
@@ -0,0 +1,249 @@
+#define _POSIX_C_SOURCE 200809L
+// Pack tool: builds a .pak archive (see pak.h) from files and directories.
+//   pack [--lz4] OUT.pak PATH...
+// Directories are walked recursively and entries are named by the path as given, so run it
+// from the directory the game runs in. Built as its own binary next to tri.
+#include "pak.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Compression has to save at least an eighth to be worth decoding at load time; PNG and JPEG
+// textures never do and are stored as they are
+#define PACK_MIN_SAVING_SHIFT 3
+
+typedef struct PackFile
+{
+	char* path; // normalized
+	PakEntry entry;
+} PackFile;
+
+static PackFile* files;
+static size_t fileCount, fileCapacity;
+
+static void addFile(const char* path)
+{
+	if (fileCount == fileCapacity)
+	{
+		fileCapacity = fileCapacity ? fileCapacity * 2 : 64;
+		files = realloc(files, fileCapacity * sizeof(PackFile));
+	}
+	PackFile* file = &files[fileCount++];
+	memset(file, 0, sizeof(*file));
+	file->path = malloc(strlen(path) + 1);
+	pakNormalizePath(path, file->path);
+}
+
+static bool collect(const char* path)
+{
+	struct stat st;
+	if (stat(path, &st) != 0)
+	{
+		fprintf(stderr, "pack: cannot stat %s\n", path);
+		return false;
+	}
+	if (S_ISREG(st.st_mode))
+	{
+		addFile(path);
+		return true;
+	}
+	if (!S_ISDIR(st.st_mode))
+		return true;
+
+	DIR* dir = opendir(path);
+	if (!dir)
+	{
+		fprintf(stderr, "pack: cannot open %s\n", path);
+		return false;
+	}
+	bool ok = true;
+	struct dirent* entry;
+	while (ok && (entry = readdir(dir)))
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+		size_t length = strlen(path) + strlen(entry->d_name) + 2;
+		char* child = malloc(length);
+		snprintf(child, length, "%s/%s", path, entry->d_name);
+		ok = collect(child);
+		free(child);
+	}
+	closedir(dir);
+	return ok;
+}
+
+static int comparePaths(const void* a, const void* b)
+{
+	return strcmp(((const PackFile*)a)->path, ((const PackFile*)b)->path);
+}
+
+static void* readWholeFile(const char* path, size_t* outSize)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	void* data = length >= 0 ? malloc((size_t)length + 1) : NULL;
+	if (data && fread(data, 1, (size_t)length, file) != (size_t)length)
+	{
+		free(data);
+		data = NULL;
+	}
+	fclose(file);
+	*outSize = (size_t)length;
+	return data;
+}
+
+static bool padTo(FILE* out, uint64_t alignment)
+{
+	long position = ftell(out);
+	static const char zeros[PAK_ALIGNMENT];
+	uint64_t padding = (alignment - (uint64_t)position % alignment) % alignment;
+	return fwrite(zeros, 1, padding, out) == padding;
+}
+
+int main(int argc, char** argv)
+{
+	bool lz4 = false;
+	int first = 1;
+	if (first < argc && strcmp(argv[first], "--lz4") == 0)
+	{
+		lz4 = true;
+		first++;
+	}
+	if (argc - first < 2)
+	{
+		fprintf(stderr, "usage: %s [--lz4] OUT.pak PATH...\n", argv[0]);
+		return 1;
+	}
+	const char* outPath = argv[first];
+	for (int i = first + 1; i < argc; ++i)
+	{
+		if (!collect(argv[i]))
+			return 1;
+	}
+	// Sorted so the same inputs always give the same archive
+	qsort(files, fileCount, sizeof(PackFile), comparePaths);
+	// Overlapping arguments ("d d/sub/a.txt", "./d d") reach the same file twice; keep one, or
+	// the table of contents would hold two entries for one name
+	size_t unique = 0;
+	for (size_t i = 0; i < fileCount; ++i)
+	{
+		if (unique > 0 && strcmp(files[unique - 1].path, files[i].path) == 0)
+		{
+			free(files[i].path);
+			continue;
+		}
+		files[unique++] = files[i];
+	}
+	fileCount = unique;
+	if (fileCount == 0 || fileCount > UINT32_MAX / 4)
+	{
+		fprintf(stderr, "pack: %zu files, nothing to do\n", fileCount);
+		return 1;
+	}
+
+	char tmpPath[1024];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", outPath);
+	FILE* out = fopen(tmpPath, "wb");
+	if (!out)
+	{
+		fprintf(stderr, "pack: cannot write %s\n", tmpPath);
+		return 1;
+	}
+
+	// Header last, once the table of contents is placed; the data starts on the next page
+	PakHeader header = {.magic = PAK_MAGIC, .version = PAK_VERSION, .entryCount = (uint32_t)fileCount};
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+	uint64_t rawTotal = 0, storedTotal = 0;
+	uint32_t compressedCount = 0;
+	size_t stringsSize = 0;
+	for (size_t i = 0; i < fileCount && ok; ++i)
+	{
+		PackFile* file = &files[i];
+		size_t size;
+		void* data = readWholeFile(file->path, &size);
+		if (!data)
+		{
+			fprintf(stderr, "pack: cannot read %s\n", file->path);
+			ok = false;
+			break;
+		}
+
+		const void* stored = data;
+		size_t storedSize = size;
+		void* compressed = NULL;
+		if (lz4 && size > 0 && size < UINT32_MAX)
+		{
+			size_t bound = pakCompressBound(size);
+			compressed = malloc(bound);
+			size_t compressedSize = pakCompress(data, size, compressed, bound);
+			if (compressedSize > 0 && compressedSize <= size - (size >> PACK_MIN_SAVING_SHIFT))
+			{
+				stored = compressed;
+				storedSize = compressedSize;
+				file->entry.flags |= PAK_ENTRY_LZ4;
+				compressedCount++;
+			}
+		}
+
+		ok = padTo(out, PAK_ALIGNMENT);
+		file->entry.hash = pakHash(file->path);
+		file->entry.offset = (uint64_t)ftell(out);
+		file->entry.storedSize = storedSize;
+		file->entry.size = size;
+		file->entry.nameOffset = (uint32_t)stringsSize;
+		stringsSize += strlen(file->path) + 1;
+		ok = ok && fwrite(stored, 1, storedSize, out) == storedSize;
+		rawTotal += size;
+		storedTotal += storedSize;
+		free(compressed);
+		free(data);
+	}
+
+	// Open addressing at most half full, so lookups stop at the first empty bucket
+	uint32_t bucketCount = 1;
+	while (bucketCount < fileCount * 2)
+		bucketCount <<= 1;
+	uint32_t* buckets = calloc(bucketCount, sizeof(uint32_t));
+	for (size_t i = 0; i < fileCount; ++i)
+	{
+		uint32_t slot = (uint32_t)files[i].entry.hash & (bucketCount - 1);
+		while (buckets[slot] != 0)
+			slot = (slot + 1) & (bucketCount - 1);
+		buckets[slot] = (uint32_t)i + 1;
+	}
+
+	ok = ok && padTo(out, sizeof(uint64_t));
+	header.tocOffset = (uint64_t)ftell(out);
+	header.bucketCount = bucketCount;
+	header.stringsSize = stringsSize;
+	for (size_t i = 0; i < fileCount && ok; ++i)
+		ok = fwrite(&files[i].entry, sizeof(PakEntry), 1, out) == 1;
+	ok = ok && fwrite(buckets, sizeof(uint32_t), bucketCount, out) == bucketCount;
+	for (size_t i = 0; i < fileCount && ok; ++i)
+		ok = fwrite(files[i].path, 1, strlen(files[i].path) + 1, out) == strlen(files[i].path) + 1;
+	ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+	ok = fclose(out) == 0 && ok;
+	free(buckets);
+
+	// Written beside the target and renamed, so a failed pack never leaves a torn archive
+	if (!ok || rename(tmpPath, outPath) != 0)
+	{
+		fprintf(stderr, "pack: failed writing %s\n", outPath);
+		remove(tmpPath);
+		return 1;
+	}
+	printf("pack: %s, %zu files (%u compressed), %.1f MiB stored from %.1f MiB\n", outPath, fileCount, compressedCount,
+	    (double)storedTotal / (1024.0 * 1024.0), (double)rawTotal / (1024.0 * 1024.0));
+
+	for (size_t i = 0; i < fileCount; ++i)
+		free(files[i].path);
+	free(files);
+	return 0;
+}
@@ -0,0 +1,367 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE // madvise
+#include "pak.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5 // the block always ends with at least this many literals
+#define LZ4_MATCH_FINISH 12 // no match starts within this many bytes of the end
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 12
+// A block can't expand by more than this: a 255 length byte is the most one input byte adds
+#define LZ4_MAX_RATIO 255
+
+struct Pak
+{
+	const uint8_t* base;
+	size_t size;
+	const PakHeader* header;
+	const PakEntry* entries;
+	const uint32_t* buckets; // entry index + 1, 0 for empty
+	const char* strings;
+	int64_t modifiedNs; // the archive file's mtime
+};
+
+uint64_t pakHash(const char* path)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const char* c = path; *c; ++c)
+	{
+		hash ^= (uint8_t)*c;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+void pakNormalizePath(const char* path, char* out)
+{
+	while (path[0] == '.' && path[1] == '/')
+		path += 2;
+	char* o = out;
+	for (const char* c = path; *c; ++c)
+	{
+		if (*c == '/' && o > out && o[-1] == '/')
+			continue;
+		*o++ = *c;
+	}
+	*o = '\0';
+}
+
+Pak* pakOpen(const char* path)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PakHeader))
+	{
+		close(fd);
+		return NULL;
+	}
+	size_t size = (size_t)st.st_size;
+	void* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps the file
+	if (base == MAP_FAILED)
+		return NULL;
+
+	// Everything the lookups index is bounds checked once here
+	const PakHeader* header = base;
+	const char* reason = NULL;
+	uint64_t entriesSize = (uint64_t)header->entryCount * sizeof(PakEntry);
+	uint64_t bucketsSize = (uint64_t)header->bucketCount * sizeof(uint32_t);
+	if (header->magic != PAK_MAGIC || header->version != PAK_VERSION)
+		reason = "unrecognised header";
+	else if (header->bucketCount == 0 || (header->bucketCount & (header->bucketCount - 1)) != 0 || header->bucketCount < header->entryCount * 2ull)
+		reason = "bad hash table";
+	else if (header->tocOffset > size || entriesSize + bucketsSize + header->stringsSize > size - header->tocOffset ||
+	         header->tocOffset % sizeof(uint64_t) != 0)
+		reason = "truncated table of contents";
+
+	Pak* pak = calloc(1, sizeof(Pak));
+	pak->base = base;
+	pak->size = size;
+	pak->modifiedNs = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	pak->header = header;
+	if (!reason)
+	{
+		pak->entries = (const PakEntry*)(pak->base + header->tocOffset);
+		pak->buckets = (const uint32_t*)(pak->base + header->tocOffset + entriesSize);
+		pak->strings = (const char*)(pak->base + header->tocOffset + entriesSize + bucketsSize);
+		if (header->stringsSize == 0 || pak->strings[header->stringsSize - 1] != '\0')
+			reason = "bad string table";
+		for (uint32_t i = 0; i < header->entryCount && !reason; ++i)
+		{
+			const PakEntry* entry = &pak->entries[i];
+			if (entry->offset > header->tocOffset || entry->storedSize > header->tocOffset - entry->offset ||
+			    entry->nameOffset >= header->stringsSize)
+				reason = "entry out of bounds";
+			else if (entry->offset % PAK_ALIGNMENT != 0)
+				reason = "misaligned entry";
+			else if (!(entry->flags & PAK_ENTRY_LZ4) && entry->storedSize != entry->size)
+				reason = "entry size mismatch";
+			else if ((entry->flags & PAK_ENTRY_LZ4) && entry->size > entry->storedSize * LZ4_MAX_RATIO)
+				reason = "impossible compression ratio";
+		}
+		// Every entry in exactly one bucket, which leaves empty buckets to end each probe
+		uint8_t* seen = reason ? NULL : calloc(header->entryCount + 1, 1);
+		uint32_t used = 0;
+		for (uint32_t i = 0; i < header->bucketCount && !reason; ++i)
+		{
+			uint32_t slot = pak->buckets[i];
+			if (slot > header->entryCount)
+				reason = "bucket out of bounds";
+			else if (slot != 0 && seen[slot]++)
+				reason = "duplicate bucket";
+			else
+				used += slot != 0;
+		}
+		if (!reason && used != header->entryCount)
+			reason = "entries missing from the hash table";
+		free(seen);
+	}
+	if (reason)
+	{
+		fprintf(stderr, "Archive: ignoring %s (%s)\n", path, reason);
+		pakClose(pak);
+		return NULL;
+	}
+	return pak;
+}
+
+void pakClose(Pak* pak)
+{
+	if (!pak)
+		return;
+	munmap((void*)pak->base, pak->size);
+	free(pak);
+}
+
+int64_t pakModifiedNs(const Pak* pak)
+{
+	return pak->modifiedNs;
+}
+
+uint32_t pakEntryCount(const Pak* pak)
+{
+	return pak->header->entryCount;
+}
+
+const PakEntry* pakEntry(const Pak* pak, uint32_t index)
+{
+	return &pak->entries[index];
+}
+
+const char* pakEntryName(const Pak* pak, const PakEntry* entry)
+{
+	return pak->strings + entry->nameOffset;
+}
+
+const PakEntry* pakFind(const Pak* pak, const char* path)
+{
+	size_t length = strlen(path);
+	char stackName[256];
+	char* name = length < sizeof(stackName) ? stackName : malloc(length + 1);
+	pakNormalizePath(path, name);
+	uint64_t hash = pakHash(name);
+
+	const PakEntry* found = NULL;
+	uint32_t mask = pak->header->bucketCount - 1;
+	// Linear probing; the table is at most half full (checked by pakOpen), so an empty bucket
+	// ends the search well before it could wrap
+	for (uint32_t i = (uint32_t)hash & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes)
+	{
+		uint32_t slot = pak->buckets[i];
+		if (slot == 0)
+			break;
+		const PakEntry* entry = &pak->entries[slot - 1];
+		if (entry->hash == hash && strcmp(pakEntryName(pak, entry), name) == 0)
+		{
+			found = entry;
+			break;
+		}
+	}
+	if (name != stackName)
+		free(name);
+	return found;
+}
+
+void pakPrefetch(const Pak* pak, const PakEntry* entry)
+{
+	if (entry->storedSize > 0)
+		madvise((void*)(pak->base + entry->offset), entry->storedSize, MADV_WILLNEED);
+}
+
+bool pakRead(const Pak* pak, const PakEntry* entry, uint64_t offset, uint64_t size, void* dst)
+{
+	if (offset > entry->size || size > entry->size - offset)
+		return false;
+	if ((entry->flags & PAK_ENTRY_LZ4) && entry->size > entry->storedSize * LZ4_MAX_RATIO)
+		return false; // not from pakOpen, which refuses these; don't size the scratch by it
+	const uint8_t* stored = pak->base + entry->offset;
+	if (!(entry->flags & PAK_ENTRY_LZ4))
+	{
+		memcpy(dst, stored + offset, size);
+		return true;
+	}
+	if (offset == 0 && size == entry->size)
+		return pakDecompress(stored, entry->storedSize, dst, size);
+	// LZ4 blocks only decode from the start; part of an entry goes through a scratch copy
+	uint8_t* scratch = malloc(entry->size);
+	bool ok = scratch && pakDecompress(stored, entry->storedSize, scratch, entry->size);
+	if (ok)
+		memcpy(dst, scratch + offset, size);
+	free(scratch);
+	return ok;
+}
+
+// --- LZ4 block format ---
+// Sequences of [token][literal length bytes][literals][offset, 2 bytes LE][match length bytes].
+// The token's high nibble is the literal count, the low nibble the match length minus 4; a
+// nibble of 15 continues in 255-valued bytes. The last sequence has literals only.
+
+static uint32_t read32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32_t lz4Hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+static uint8_t* writeLength(uint8_t* op, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*op++ = 255;
+	*op++ = (uint8_t)length;
+	return op;
+}
+
+size_t pakCompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+static uint8_t* writeSequence(uint8_t* op, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+{
+	uint8_t* token = op++;
+	*token = (uint8_t)((literalCount >= 15 ? 15 : literalCount) << 4);
+	if (literalCount >= 15)
+		op = writeLength(op, literalCount - 15);
+	memcpy(op, literals, literalCount);
+	op += literalCount;
+	if (matchLength == 0)
+		return op; // the closing literals-only sequence
+	*op++ = (uint8_t)(offset & 0xff);
+	*op++ = (uint8_t)(offset >> 8);
+	size_t code = matchLength - LZ4_MIN_MATCH;
+	*token |= (uint8_t)(code >= 15 ? 15 : code);
+	if (code >= 15)
+		op = writeLength(op, code - 15);
+	return op;
+}
+
+// Greedy single-probe matcher, the same scheme as LZ4's fast mode without the acceleration
+size_t pakCompress(const void* src, size_t size, void* dst, size_t capacity)
+{
+	if (capacity < pakCompressBound(size))
+		return 0;
+	const uint8_t* in = src;
+	uint8_t* op = dst;
+	size_t anchor = 0;
+	if (size > LZ4_MATCH_FINISH)
+	{
+		uint32_t* table = calloc(1u << LZ4_HASH_BITS, sizeof(uint32_t));
+		size_t matchLimit = size - LZ4_LAST_LITERALS;
+		size_t ip = 0;
+		while (ip < size - LZ4_MATCH_FINISH)
+		{
+			uint32_t sequence = read32(in + ip);
+			uint32_t h = lz4Hash(sequence);
+			size_t ref = table[h];
+			table[h] = (uint32_t)ip;
+			if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || read32(in + ref) != sequence)
+			{
+				ip++;
+				continue;
+			}
+			size_t length = LZ4_MIN_MATCH;
+			while (ip + length < matchLimit && in[ref + length] == in[ip + length])
+				length++;
+			op = writeSequence(op, in + anchor, ip - anchor, ip - ref, length);
+			ip += length;
+			anchor = ip;
+		}
+		free(table);
+	}
+	op = writeSequence(op, in + anchor, size - anchor, 0, 0);
+	return (size_t)(op - (uint8_t*)dst);
+}
+
+static bool readLength(const uint8_t** ip, const uint8_t* end, size_t* length)
+{
+	uint8_t b;
+	do
+	{
+		if (*ip >= end)
+			return false;
+		b = *(*ip)++;
+		*length += b;
+	} while (b == 255);
+	return true;
+}
+
+// Bounds checked against both buffers, so a corrupt archive fails instead of overrunning
+bool pakDecompress(const void* src, size_t size, void* dst, size_t dstSize)
+{
+	const uint8_t* ip = src;
+	const uint8_t* end = ip + size;
+	uint8_t* out = dst;
+	uint8_t* op = out;
+	uint8_t* outEnd = out + dstSize;
+	while (ip < end)
+	{
+		uint8_t token = *ip++;
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !readLength(&ip, end, &literalCount))
+			return false;
+		if (literalCount > (size_t)(end - ip) || literalCount > (size_t)(outEnd - op))
+			return false;
+		memcpy(op, ip, literalCount);
+		op += literalCount;
+		ip += literalCount;
+		if (ip == end)
+			break; // the closing sequence
+
+		if (end - ip < 2)
+			return false;
+		size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+		ip += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(&ip, end, &matchLength))
+			return false;
+		matchLength += LZ4_MIN_MATCH;
+		if (offset == 0 || offset > (size_t)(op - out) || matchLength > (size_t)(outEnd - op))
+			return false;
+		const uint8_t* match = op - offset;
+		if (offset >= matchLength)
+			memcpy(op, match, matchLength);
+		else
+		{
+			// Overlapping copy repeats the last offset bytes
+			for (size_t i = 0; i < matchLength; ++i)
+				op[i] = match[i];
+		}
+		op += matchLength;
+	}
+	return op == outEnd;
+}
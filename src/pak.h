@@ -0,0 +1,69 @@
+#pragma once
+
+// Packed asset archive (.pak).
+// One file holding every shipped asset, so a cold start opens one file instead of hundreds.
+// Entry data is page aligned and optionally LZ4 compressed (block format, no frame). The table
+// of contents sits after the data: a fixed-size entry per file, an open-addressed hash table
+// over the entries and a string table of their paths. At runtime the whole archive is mmap'd
+// and fileio serves reads of archived paths from the mapping, so loaders keep using plain
+// paths. Built by the pack tool (packtool.c).
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PAK_MAGIC 0x314B4150u // "PAK1"
+#define PAK_VERSION 1
+#define PAK_ALIGNMENT 4096    // entry data offsets, so each entry starts on its own pages
+#define PAK_DEFAULT_PATH "data.pak"
+
+#define PAK_ENTRY_LZ4 (1u << 0)
+
+typedef struct PakHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t bucketCount; // power of two, at least twice entryCount
+	uint64_t tocOffset;   // PakEntry[entryCount], then uint32_t buckets[bucketCount], then the strings
+	uint64_t stringsSize;
+} PakHeader;
+
+typedef struct PakEntry
+{
+	uint64_t hash;   // pakHash of the path
+	uint64_t offset; // from the start of the archive, PAK_ALIGNMENT aligned
+	uint64_t storedSize;
+	uint64_t size;   // after decompression
+	uint32_t nameOffset; // into the string table, zero terminated
+	uint32_t flags;
+} PakEntry;
+
+typedef struct Pak Pak;
+
+// NULL when the file is missing or not a valid archive
+Pak* pakOpen(const char* path);
+void pakClose(Pak* pak);
+// Modification time of the archive file, in nanoseconds since the epoch
+int64_t pakModifiedNs(const Pak* pak);
+uint32_t pakEntryCount(const Pak* pak);
+const PakEntry* pakEntry(const Pak* pak, uint32_t index);
+const char* pakEntryName(const Pak* pak, const PakEntry* entry);
+
+// Paths are matched after dropping "./" prefixes and doubled slashes
+const PakEntry* pakFind(const Pak* pak, const char* path);
+// Starts readahead of the entry's pages without waiting for them
+void pakPrefetch(const Pak* pak, const PakEntry* entry);
+// Copies bytes [offset, offset + size) of the entry into dst, decompressing as needed; false
+// if the range runs past the entry or the stored data is corrupt
+bool pakRead(const Pak* pak, const PakEntry* entry, uint64_t offset, uint64_t size, void* dst);
+
+// FNV-1a over the normalized path
+uint64_t pakHash(const char* path);
+// Writes the normalized path into out, which must hold strlen(path) + 1 bytes
+void pakNormalizePath(const char* path, char* out);
+
+// LZ4 block format. Compress returns 0 when the output doesn't fit in capacity.
+size_t pakCompressBound(size_t size);
+size_t pakCompress(const void* src, size_t size, void* dst, size_t capacity);
+bool pakDecompress(const void* src, size_t size, void* dst, size_t dstSize);
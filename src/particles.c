@@ -0,0 +1,516 @@
+#include "main.h"
+
+// GPU particles.
+// The step is the kernel sequence described in particlesim.h, recorded by
+// recordParticleComputeCommands; every kernel after prepare is sized by what the previous
+// one wrote into ParticleCounters, so nothing round-trips through the CPU and the cost
+// follows the alive count rather than the capacity. The scene pass then draws the
+// compacted alive list with vkCmdDrawIndirect.
+// All streams and lists share particleBuffer (device local). The counters the kernels update
+// with atomics and the indirect commands read are device local too; after the draw, each
+// frame copies them into its slot of a small host-visible buffer for the UI.
+
+typedef struct ParticleDrawParams
+{
+	mat4 viewProj;
+	vec4 cameraRight; // xyz, particle size
+	vec4 cameraUp;
+	vec4 color;
+	u32 aliveOffset;
+} ParticleDrawParams;
+
+// particleBuffer layout, bindings 1..7 of particle.comp in this order
+typedef enum ParticleStream
+{
+	PARTICLE_STREAM_DEAD_LIST,
+	PARTICLE_STREAM_ALIVE_LISTS,
+	PARTICLE_STREAM_FLAGS,
+	PARTICLE_STREAM_SCANNED,
+	PARTICLE_STREAM_BLOCK_SUMS,
+	PARTICLE_STREAM_POSITIONS,
+	PARTICLE_STREAM_VELOCITIES,
+	PARTICLE_STREAM_COUNT,
+} ParticleStream;
+
+static VkDeviceSize particleStreamSize(ParticleStream stream)
+{
+	switch (stream)
+	{
+	case PARTICLE_STREAM_ALIVE_LISTS: return sizeof(u32) * PARTICLE_MAX_CAPACITY * 2;
+	case PARTICLE_STREAM_BLOCK_SUMS: return sizeof(u32) * PARTICLE_MAX_SCAN_BLOCKS;
+	case PARTICLE_STREAM_POSITIONS:
+	case PARTICLE_STREAM_VELOCITIES: return sizeof(vec4) * PARTICLE_MAX_CAPACITY;
+	default: return sizeof(u32) * PARTICLE_MAX_CAPACITY;
+	}
+}
+
+// Every size is a multiple of 256 bytes, so each stream meets minStorageBufferOffsetAlignment
+static VkDeviceSize particleStreamOffset(ParticleStream stream)
+{
+	VkDeviceSize offset = 0;
+	for (u32 i = 0; i < (u32)stream; ++i)
+		offset += particleStreamSize((ParticleStream)i);
+	return offset;
+}
+
+static VkDescriptorBufferInfo particleStreamInfo(Application* app, ParticleStream stream)
+{
+	return (VkDescriptorBufferInfo){
+	    .buffer = app->particleBuffer.vkbuffer,
+	    .offset = particleStreamOffset(stream),
+	    .range = particleStreamSize(stream),
+	};
+}
+
+// Everything dead, as after creation; the other streams are only read below the counts
+static void resetParticleState(Application* app)
+{
+	ParticleCounters counters = {.deadCount = PARTICLE_MAX_CAPACITY};
+	for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		memcpy((ParticleCounters*)app->particleReadbackBuffer.data + i, &counters, sizeof(counters));
+
+	u32* deadList = malloc(sizeof(u32) * PARTICLE_MAX_CAPACITY);
+	for (u32 i = 0; i < PARTICLE_MAX_CAPACITY; ++i)
+		deadList[i] = i;
+	VkDeviceSize deadListSize = particleStreamSize(PARTICLE_STREAM_DEAD_LIST);
+	Buffer staging = createStagingBuffer(app, deadList, deadListSize);
+	free(deadList);
+
+	VkCommandBuffer cmd = beginSingleTimeCommands(app);
+	VkBufferCopy region = {.dstOffset = particleStreamOffset(PARTICLE_STREAM_DEAD_LIST), .size = deadListSize};
+	vkCmdCopyBuffer(cmd, staging.vkbuffer, app->particleBuffer.vkbuffer, 1, &region);
+	vkCmdUpdateBuffer(cmd, app->particleCounterBuffer.vkbuffer, 0, sizeof(counters), &counters);
+	endSingleTimeCommands(app, cmd);
+	destroyBuffer(app->device, &staging);
+
+	app->particleCurrent = 0;
+	app->particleStep = 0;
+	app->particleEmitCarry = 0.0f;
+}
+
+static void createParticleBuffers(Application* app)
+{
+	// TRANSFER_SRC for the --check-particles readback
+	createDeviceLocalBuffer(app, &app->particleBuffer, particleStreamOffset(PARTICLE_STREAM_COUNT),
+	    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	createDeviceLocalBuffer(app, &app->particleCounterBuffer, sizeof(ParticleCounters),
+	    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+	        VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	createBuffer(app, &app->particleReadbackBuffer, sizeof(ParticleCounters) * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	resetParticleState(app);
+}
+
+static void createParticleKernels(Application* app)
+{
+	VkDescriptorSetLayoutBinding bindings[1 + PARTICLE_STREAM_COUNT];
+	for (u32 i = 0; i < ARRAYSIZE(bindings); ++i)
+	{
+		bindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(bindings),
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(app->device, &layoutInfo, NULL, &app->particleComputeSetLayout));
+
+	VkPushConstantRange pushRange = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(ParticleParams)};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+	    .setLayoutCount = 1,
+	    .pSetLayouts = &app->particleComputeSetLayout,
+	    .pushConstantRangeCount = 1,
+	    .pPushConstantRanges = &pushRange,
+	};
+	VK_CHECK(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &app->particleComputeLayout));
+
+	VkShaderModule shader = LoadShaderModule(app->io, "compiledshaders/particle.comp.spv", app->device);
+	for (u32 kernel = 0; kernel < PARTICLE_KERNEL_COUNT; ++kernel)
+	{
+		VkSpecializationMapEntry entry = {.constantID = 0, .offset = 0, .size = sizeof(u32)};
+		VkSpecializationInfo specInfo = {
+		    .mapEntryCount = 1,
+		    .pMapEntries = &entry,
+		    .dataSize = sizeof(u32),
+		    .pData = &kernel,
+		};
+		VkComputePipelineCreateInfo pipelineInfo = {
+		    .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		    .stage = {
+		        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+		        .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+		        .module = shader,
+		        .pName = "main",
+		        .pSpecializationInfo = &specInfo,
+		    },
+		    .layout = app->particleComputeLayout,
+		    .basePipelineIndex = -1,
+		};
+		app->particleKernels[kernel] = buildComputePipeline(app, &pipelineInfo);
+	}
+	vkDestroyShaderModule(app->device, shader, NULL);
+
+	VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, ARRAYSIZE(bindings)};
+	VkDescriptorPoolCreateInfo poolInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+	    .maxSets = 1,
+	    .poolSizeCount = 1,
+	    .pPoolSizes = &poolSize,
+	};
+	VK_CHECK(vkCreateDescriptorPool(app->device, &poolInfo, NULL, &app->particleDescriptorPool));
+	app->particleComputeSet = allocateDescriptorSet(app->device, app->particleDescriptorPool, &app->particleComputeSetLayout);
+
+	VkDescriptorBufferInfo bufferInfos[1 + PARTICLE_STREAM_COUNT];
+	VkWriteDescriptorSet writes[1 + PARTICLE_STREAM_COUNT];
+	bufferInfos[0] = (VkDescriptorBufferInfo){app->particleCounterBuffer.vkbuffer, 0, sizeof(ParticleCounters)};
+	for (u32 stream = 0; stream < PARTICLE_STREAM_COUNT; ++stream)
+		bufferInfos[1 + stream] = particleStreamInfo(app, (ParticleStream)stream);
+	for (u32 i = 0; i < ARRAYSIZE(writes); ++i)
+	{
+		writes[i] = (VkWriteDescriptorSet){
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = app->particleComputeSet,
+		    .dstBinding = i,
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .pBufferInfo = &bufferInfos[i],
+		};
+	}
+	vkUpdateDescriptorSets(app->device, ARRAYSIZE(writes), writes, 0, NULL);
+}
+
+static void createParticleRenderer(Application* app)
+{
+	VkDescriptorSetLayoutBinding bindings[3];
+	for (u32 i = 0; i < ARRAYSIZE(bindings); ++i)
+	{
+		bindings[i] = (VkDescriptorSetLayoutBinding){
+		    .binding = i,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .descriptorCount = 1,
+		    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		};
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+	    .bindingCount = ARRAYSIZE(bindings),
+	    .pBindings = bindings,
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(app->device, &layoutInfo, NULL, &app->particleGraphicsDescriptorSetLayout));
+
+	VkPushConstantRange pushRange = {.stageFlags = VK_SHADER_STAGE_VERTEX_BIT, .offset = 0, .size = sizeof(ParticleDrawParams)};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+	    .setLayoutCount = 1,
+	    .pSetLayouts = &app->particleGraphicsDescriptorSetLayout,
+	    .pushConstantRangeCount = 1,
+	    .pPushConstantRanges = &pushRange,
+	};
+	VK_CHECK(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &app->particlePipelineLayout));
+
+	app->particleGraphicsDescriptorSet = allocateDescriptorSet(app->device, app->descriptorPool, &app->particleGraphicsDescriptorSetLayout);
+	VkDescriptorBufferInfo bufferInfos[] = {
+	    particleStreamInfo(app, PARTICLE_STREAM_POSITIONS),
+	    particleStreamInfo(app, PARTICLE_STREAM_VELOCITIES),
+	    particleStreamInfo(app, PARTICLE_STREAM_ALIVE_LISTS),
+	};
+	VkWriteDescriptorSet writes[ARRAYSIZE(bufferInfos)];
+	for (u32 i = 0; i < ARRAYSIZE(writes); ++i)
+	{
+		writes[i] = (VkWriteDescriptorSet){
+		    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		    .dstSet = app->particleGraphicsDescriptorSet,
+		    .dstBinding = i,
+		    .descriptorCount = 1,
+		    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		    .pBufferInfo = &bufferInfos[i],
+		};
+	}
+	vkUpdateDescriptorSets(app->device, ARRAYSIZE(writes), writes, 0, NULL);
+
+	VkShaderModule vertShader = LoadShaderModule(app->io, "compiledshaders/particle.vert.spv", app->device);
+	VkShaderModule fragShader = LoadShaderModule(app->io, "compiledshaders/particle.frag.spv", app->device);
+	app->particlePipeline = createParticlePipeline(app, vertShader, fragShader);
+	vkDestroyShaderModule(app->device, vertShader, NULL);
+	vkDestroyShaderModule(app->device, fragShader, NULL);
+}
+
+// The fountain is sized to the scene bounds; runs again once the model has loaded
+void fitParticlesToScene(Application* app)
+{
+	vec3 extent;
+	glm_vec3_sub(app->sceneMax, app->sceneMin, extent);
+	float size = glm_vec3_max(extent);
+	if (size <= 0.0f)
+		size = 1.0f;
+
+	app->particleSize = size * 0.002f;
+	app->particleParams = (ParticleParams){
+	    .emitter = {(app->sceneMin[0] + app->sceneMax[0]) * 0.5f, app->sceneMin[1], (app->sceneMin[2] + app->sceneMax[2]) * 0.5f, size * 0.01f},
+	    .gravityDrag = {0.0f, -size * 0.5f, 0.0f, 0.2f},
+	    .speed = size * 0.6f,
+	    .spread = 0.25f,
+	    .lifeMin = 2.0f,
+	    .lifeMax = 4.0f,
+	    .groundY = app->sceneMin[1],
+	    .bounce = 0.4f,
+	    .capacity = PARTICLE_MAX_CAPACITY,
+	};
+}
+
+void createParticleSystem(Application* app)
+{
+	app->particlesEnabled = true;
+	app->particleEmitRate = 200000.0f;
+	app->particleIntensity = 4.0f;
+	fitParticlesToScene(app);
+
+	createParticleBuffers(app);
+	createParticleKernels(app);
+	createParticleRenderer(app);
+}
+
+static void particleBarrier(VkCommandBuffer cmd)
+{
+	VkMemoryBarrier2 barrier = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+	    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+	};
+	VkDependencyInfo dependencyInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+	    .memoryBarrierCount = 1,
+	    .pMemoryBarriers = &barrier,
+	};
+	vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+}
+
+// Where each kernel's workgroup count comes from: an offset into ParticleCounters, or -1
+// for the kernels that run a single workgroup
+static const i32 particleKernelArgs[PARTICLE_KERNEL_COUNT] = {
+    [PARTICLE_KERNEL_PREPARE] = -1,
+    [PARTICLE_KERNEL_EMIT] = offsetof(ParticleCounters, emitDispatch),
+    [PARTICLE_KERNEL_SIMULATE] = offsetof(ParticleCounters, simulateDispatch),
+    [PARTICLE_KERNEL_SCAN] = offsetof(ParticleCounters, scanDispatch),
+    [PARTICLE_KERNEL_SCAN_BLOCKS] = -1,
+    [PARTICLE_KERNEL_SCATTER] = offsetof(ParticleCounters, scanDispatch),
+    [PARTICLE_KERNEL_FINALIZE] = -1,
+};
+
+static void recordParticleStep(Application* app, VkCommandBuffer commandBuffer, const ParticleParams* params)
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->particleComputeLayout, 0, 1, &app->particleComputeSet, 0, NULL);
+	vkCmdPushConstants(commandBuffer, app->particleComputeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(*params), params);
+
+	for (u32 kernel = 0; kernel < PARTICLE_KERNEL_COUNT; ++kernel)
+	{
+		if (kernel > 0)
+			particleBarrier(commandBuffer);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->particleKernels[kernel]);
+		if (particleKernelArgs[kernel] < 0)
+			vkCmdDispatch(commandBuffer, 1, 1, 1);
+		else
+			vkCmdDispatchIndirect(commandBuffer, app->particleCounterBuffer.vkbuffer, (VkDeviceSize)particleKernelArgs[kernel]);
+	}
+}
+
+void recordParticleComputeCommands(Application* app, VkCommandBuffer commandBuffer)
+{
+	if (!app->particlesEnabled)
+		return;
+
+	gpuTimerBegin(app, commandBuffer, GPU_TIMER_PARTICLES);
+
+	// Long hitches would launch everything at once and tunnel through the ground
+	float dt = app->deltaTime < 0.1f ? app->deltaTime : 0.1f;
+	float emit = app->particleEmitRate * dt + app->particleEmitCarry;
+	ParticleParams params = app->particleParams;
+	params.dt = dt;
+	params.emitRequest = (u32)emit;
+	params.seed = particleHash(app->particleStep++);
+	params.current = app->particleCurrent;
+	app->particleEmitCarry = emit - (float)params.emitRequest;
+	recordParticleStep(app, commandBuffer, &params);
+
+	// The draw recorded after this reads the list the step compacted into
+	app->particleCurrent ^= 1;
+
+	gpuTimerEnd(app, commandBuffer, GPU_TIMER_PARTICLES);
+}
+
+// Emission for step s of the check: steady load, empty steps, and bursts past the capacity
+static u32 particleCheckEmitRequest(u32 s)
+{
+	if (s % 16 == 5)
+		return PARTICLE_CHECK_CAPACITY * 2;
+	if (s % 11 == 7)
+		return 0;
+	return 1500 + (s * 97) % 2000;
+}
+
+// --check-particles: runs the kernels for steps steps at PARTICLE_CHECK_CAPACITY, reads back
+// the counters, both alive lists, the dead list and the positions, and compares them with the
+// CPU reference after the same steps. The GPU state is reset on both sides of the check.
+bool particlesCheckAgainstReference(Application* app, u32 steps)
+{
+	resetParticleState(app);
+	ParticleParams params = app->particleParams;
+	params.dt = BENCHMARK_FRAME_DT;
+	params.capacity = PARTICLE_CHECK_CAPACITY;
+
+	VkCommandBuffer cmd = beginSingleTimeCommands(app);
+	for (u32 s = 0; s < steps; ++s)
+	{
+		if (s > 0)
+			particleBarrier(cmd);
+		params.emitRequest = particleCheckEmitRequest(s);
+		params.seed = particleHash(s);
+		params.current = s & 1;
+		recordParticleStep(app, cmd, &params);
+	}
+
+	// Everything read back lies in the first PARTICLE_CHECK_CAPACITY entries of its stream
+	VkMemoryBarrier2 barrier = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_HOST_BIT,
+	    .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_HOST_READ_BIT,
+	};
+	VkDependencyInfo dependencyInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+	    .memoryBarrierCount = 1,
+	    .pMemoryBarriers = &barrier,
+	};
+	vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+	VkDeviceSize deadSize = sizeof(u32) * PARTICLE_CHECK_CAPACITY;
+	VkDeviceSize aliveSize = sizeof(u32) * PARTICLE_CHECK_CAPACITY * 2;
+	VkDeviceSize positionSize = sizeof(vec4) * PARTICLE_CHECK_CAPACITY;
+	VkDeviceSize countersOffset = deadSize + aliveSize + positionSize;
+	Buffer readback;
+	createBuffer(app, &readback, countersOffset + sizeof(ParticleCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	VkBufferCopy regions[] = {
+	    {.srcOffset = particleStreamOffset(PARTICLE_STREAM_DEAD_LIST), .dstOffset = 0, .size = deadSize},
+	    {.srcOffset = particleStreamOffset(PARTICLE_STREAM_ALIVE_LISTS), .dstOffset = deadSize, .size = aliveSize},
+	    {.srcOffset = particleStreamOffset(PARTICLE_STREAM_POSITIONS), .dstOffset = deadSize + aliveSize, .size = positionSize},
+	};
+	vkCmdCopyBuffer(cmd, app->particleBuffer.vkbuffer, readback.vkbuffer, ARRAYSIZE(regions), regions);
+	VkBufferCopy countersRegion = {.dstOffset = countersOffset, .size = sizeof(ParticleCounters)};
+	vkCmdCopyBuffer(cmd, app->particleCounterBuffer.vkbuffer, readback.vkbuffer, 1, &countersRegion);
+
+	VkMemoryBarrier2 hostBarrier = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+	    .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+	};
+	dependencyInfo.pMemoryBarriers = &hostBarrier;
+	vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+	endSingleTimeCommands(app, cmd);
+
+	ParticleSim reference;
+	if (!particleSimInit(&reference, PARTICLE_CHECK_CAPACITY))
+	{
+		destroyBuffer(app->device, &readback);
+		return false;
+	}
+	for (u32 s = 0; s < steps; ++s)
+	{
+		params.emitRequest = particleCheckEmitRequest(s);
+		params.seed = particleHash(s);
+		params.current = s & 1;
+		particleSimStep(&reference, &params);
+	}
+
+	ParticleCounters counters;
+	memcpy(&counters, (const char*)readback.data + countersOffset, sizeof(counters));
+	const u32* deadList = readback.data;
+	const u32* aliveList = (const u32*)((const char*)readback.data + deadSize);
+	const float* positions = (const float*)((const char*)readback.data + deadSize + aliveSize);
+	u32 current = params.current;
+	bool valid = particleSimValidate(PARTICLE_CHECK_CAPACITY, &counters, current, deadList, aliveList);
+	u32 mismatches = particleSimCompare(&reference, current, &counters, deadList, aliveList, positions, PARTICLE_CHECK_TOLERANCE, stderr);
+	printf("Particles: %u steps, %u alive, %u dead on the GPU: %s, %u mismatches against the CPU reference\n",
+	    steps, counters.aliveCount[current ^ 1], counters.deadCount, valid ? "lists valid" : "lists INVALID", mismatches);
+
+	particleSimDestroy(&reference);
+	destroyBuffer(app->device, &readback);
+	resetParticleState(app);
+	return valid && mismatches == 0;
+}
+
+// Records into the scene pass's rendering scope
+void drawParticles(Application* app, VkCommandBuffer commandBuffer)
+{
+	if (!app->particlesEnabled)
+		return;
+
+	mat4 view, proj;
+	computeCameraMatrices(app, view, proj);
+	ParticleDrawParams params = {
+	    .cameraRight = {view[0][0], view[1][0], view[2][0], app->particleSize},
+	    .cameraUp = {view[0][1], view[1][1], view[2][1], 0.0f},
+	    .color = {app->particleIntensity, app->particleIntensity * 0.8f, app->particleIntensity * 0.6f, 1.0f},
+	    .aliveOffset = app->particleCurrent * PARTICLE_MAX_CAPACITY,
+	};
+	glm_mat4_mul(proj, view, params.viewProj);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->particlePipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->particlePipelineLayout, 0, 1, &app->particleGraphicsDescriptorSet, 0, NULL);
+	vkCmdPushConstants(commandBuffer, app->particlePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(params), &params);
+	vkCmdDrawIndirect(commandBuffer, app->particleCounterBuffer.vkbuffer, offsetof(ParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+// Copies the counters into this frame's readback slot once the draw has read them
+void recordParticleReadback(Application* app, VkCommandBuffer commandBuffer)
+{
+	VkBufferCopy region = {.dstOffset = app->currentFrame * sizeof(ParticleCounters), .size = sizeof(ParticleCounters)};
+	vkCmdCopyBuffer(commandBuffer, app->particleCounterBuffer.vkbuffer, app->particleReadbackBuffer.vkbuffer, 1, &region);
+
+	VkMemoryBarrier2 hostBarrier = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+	    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+	    .dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+	    .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+	};
+	VkDependencyInfo dependencyInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+	    .memoryBarrierCount = 1,
+	    .pMemoryBarriers = &hostBarrier,
+	};
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+// The counters as the frame that last ran in the current slot left them; only valid once
+// drawFrame has waited for that frame's fence
+const ParticleCounters* particleCountersReadback(const Application* app)
+{
+	return (const ParticleCounters*)app->particleReadbackBuffer.data + app->currentFrame;
+}
+
+void cleanupParticleSystem(Application* app)
+{
+	for (u32 kernel = 0; kernel < PARTICLE_KERNEL_COUNT; ++kernel)
+		vkDestroyPipeline(app->device, app->particleKernels[kernel], NULL);
+	vkDestroyPipelineLayout(app->device, app->particleComputeLayout, NULL);
+	vkDestroyDescriptorSetLayout(app->device, app->particleComputeSetLayout, NULL);
+	vkDestroyDescriptorPool(app->device, app->particleDescriptorPool, NULL);
+
+	vkDestroyPipeline(app->device, app->particlePipeline, NULL);
+	vkDestroyPipelineLayout(app->device, app->particlePipelineLayout, NULL);
+	vkDestroyDescriptorSetLayout(app->device, app->particleGraphicsDescriptorSetLayout, NULL);
+
+	destroyBuffer(app->device, &app->particleBuffer);
+	destroyBuffer(app->device, &app->particleCounterBuffer);
+	destroyBuffer(app->device, &app->particleReadbackBuffer);
+}
@@ -0,0 +1,307 @@
+#include "particlesim.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool particleSimInit(ParticleSim* sim, uint32_t capacity)
+{
+	memset(sim, 0, sizeof(*sim));
+	if (capacity == 0 || capacity > PARTICLE_MAX_CAPACITY)
+		return false;
+
+	sim->capacity = capacity;
+	sim->position = calloc((size_t)capacity * 4, sizeof(float));
+	sim->velocity = calloc((size_t)capacity * 4, sizeof(float));
+	sim->deadList = malloc(sizeof(uint32_t) * capacity);
+	sim->aliveList = calloc((size_t)capacity * 2, sizeof(uint32_t));
+	sim->flags = calloc(capacity, sizeof(uint32_t));
+	sim->scanned = calloc(capacity, sizeof(uint32_t));
+	sim->blockSums = calloc(PARTICLE_MAX_SCAN_BLOCKS, sizeof(uint32_t));
+	if (!sim->position || !sim->velocity || !sim->deadList || !sim->aliveList || !sim->flags || !sim->scanned || !sim->blockSums)
+	{
+		particleSimDestroy(sim);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < capacity; ++i)
+		sim->deadList[i] = i;
+	sim->counters.deadCount = capacity;
+	return true;
+}
+
+void particleSimDestroy(ParticleSim* sim)
+{
+	free(sim->position);
+	free(sim->velocity);
+	free(sim->deadList);
+	free(sim->aliveList);
+	free(sim->flags);
+	free(sim->scanned);
+	free(sim->blockSums);
+	memset(sim, 0, sizeof(*sim));
+}
+
+// PCG hash
+uint32_t particleHash(uint32_t x)
+{
+	uint32_t state = x * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+static float particleRandom(uint32_t* state)
+{
+	*state = particleHash(*state);
+	return (float)(*state >> 8) * (1.0f / 16777216.0f);
+}
+
+void particleEmitOne(const ParticleParams* params, uint32_t emitIndex, float position[4], float velocity[4])
+{
+	uint32_t state = params->seed ^ particleHash(emitIndex);
+
+	// Uniform on the spawn disc
+	float angle = particleRandom(&state) * 6.28318531f;
+	float radius = sqrtf(particleRandom(&state)) * params->emitter[3];
+	position[0] = params->emitter[0] + cosf(angle) * radius;
+	position[1] = params->emitter[1];
+	position[2] = params->emitter[2] + sinf(angle) * radius;
+
+	// Upward cone, +-25% speed
+	float coneAngle = particleRandom(&state) * 6.28318531f;
+	float cone = sqrtf(particleRandom(&state)) * params->spread;
+	float speed = params->speed * (0.75f + 0.5f * particleRandom(&state)) / sqrtf(1.0f + cone * cone);
+	velocity[0] = cosf(coneAngle) * cone * speed;
+	velocity[1] = speed;
+	velocity[2] = sinf(coneAngle) * cone * speed;
+
+	float life = params->lifeMin + (params->lifeMax - params->lifeMin) * particleRandom(&state);
+	position[3] = life;
+	velocity[3] = life;
+}
+
+bool particleIntegrate(const ParticleParams* params, float position[4], float velocity[4])
+{
+	float dt = params->dt;
+	float damping = fmaxf(1.0f - params->gravityDrag[3] * dt, 0.0f);
+	for (int c = 0; c < 3; ++c)
+	{
+		velocity[c] = (velocity[c] + params->gravityDrag[c] * dt) * damping;
+		position[c] += velocity[c] * dt;
+	}
+
+	if (position[1] < params->groundY)
+	{
+		position[1] = params->groundY;
+		if (velocity[1] < 0.0f)
+			velocity[1] = -velocity[1] * params->bounce;
+	}
+
+	position[3] -= dt;
+	return position[3] > 0.0f;
+}
+
+static uint32_t groupCount(uint32_t threads, uint32_t groupSize)
+{
+	return (threads + groupSize - 1) / groupSize;
+}
+
+void particleSimPrepare(ParticleSim* sim, const ParticleParams* params)
+{
+	ParticleCounters* c = &sim->counters;
+	uint32_t alive = c->aliveCount[params->current];
+	uint32_t emit = params->emitRequest < c->deadCount ? params->emitRequest : c->deadCount;
+
+	// The emitted slots are deadList[deadCount .. deadCount + emit)
+	c->deadCount -= emit;
+	c->emitCount = emit;
+	c->simulateCount = alive + emit;
+	c->emitDispatch[0] = groupCount(emit, PARTICLE_GROUP_SIZE);
+	c->simulateDispatch[0] = groupCount(alive + emit, PARTICLE_GROUP_SIZE);
+	c->scanDispatch[0] = groupCount(alive + emit, PARTICLE_SCAN_BLOCK);
+	for (int i = 1; i < 3; ++i)
+		c->emitDispatch[i] = c->simulateDispatch[i] = c->scanDispatch[i] = 1;
+}
+
+void particleSimEmit(ParticleSim* sim, const ParticleParams* params)
+{
+	const ParticleCounters* c = &sim->counters;
+	uint32_t* alive = sim->aliveList + params->current * sim->capacity;
+	uint32_t aliveBefore = c->simulateCount - c->emitCount;
+	for (uint32_t i = 0; i < c->emitCount; ++i)
+	{
+		uint32_t index = sim->deadList[c->deadCount + i];
+		particleEmitOne(params, i, sim->position + index * 4, sim->velocity + index * 4);
+		alive[aliveBefore + i] = index;
+	}
+}
+
+void particleSimSimulate(ParticleSim* sim, const ParticleParams* params)
+{
+	const uint32_t* alive = sim->aliveList + params->current * sim->capacity;
+	for (uint32_t i = 0; i < sim->counters.simulateCount; ++i)
+	{
+		uint32_t index = alive[i];
+		sim->flags[i] = particleIntegrate(params, sim->position + index * 4, sim->velocity + index * 4);
+	}
+}
+
+void particleSimScan(ParticleSim* sim, const ParticleParams* params)
+{
+	uint32_t count = sim->counters.simulateCount;
+	uint32_t blockCount = groupCount(count, PARTICLE_SCAN_BLOCK);
+
+	// particle_scan.comp: exclusive scan inside each block
+	for (uint32_t block = 0; block < blockCount; ++block)
+	{
+		uint32_t sum = 0;
+		for (uint32_t i = block * PARTICLE_SCAN_BLOCK; i < (block + 1) * PARTICLE_SCAN_BLOCK && i < count; ++i)
+		{
+			sim->scanned[i] = sum;
+			sum += sim->flags[i];
+		}
+		sim->blockSums[block] = sum;
+	}
+
+	// particle_scan_blocks.comp: exclusive scan of the block totals
+	uint32_t total = 0;
+	for (uint32_t block = 0; block < blockCount; ++block)
+	{
+		uint32_t sum = sim->blockSums[block];
+		sim->blockSums[block] = total;
+		total += sum;
+	}
+	sim->counters.aliveCount[params->current ^ 1] = total;
+}
+
+void particleSimScatter(ParticleSim* sim, const ParticleParams* params)
+{
+	const ParticleCounters* c = &sim->counters;
+	const uint32_t* alive = sim->aliveList + params->current * sim->capacity;
+	uint32_t* next = sim->aliveList + (params->current ^ 1) * sim->capacity;
+	for (uint32_t i = 0; i < c->simulateCount; ++i)
+	{
+		uint32_t offset = sim->scanned[i] + sim->blockSums[i / PARTICLE_SCAN_BLOCK];
+		if (sim->flags[i])
+			next[offset] = alive[i];
+		else
+			sim->deadList[c->deadCount + (i - offset)] = alive[i];
+	}
+}
+
+void particleSimFinalize(ParticleSim* sim, const ParticleParams* params)
+{
+	ParticleCounters* c = &sim->counters;
+	uint32_t survivors = c->aliveCount[params->current ^ 1];
+	c->deadCount += c->simulateCount - survivors;
+	c->aliveCount[params->current] = 0;
+	c->draw[0] = 6;
+	c->draw[1] = survivors;
+	c->draw[2] = 0;
+	c->draw[3] = 0;
+}
+
+void particleSimStep(ParticleSim* sim, const ParticleParams* params)
+{
+	particleSimPrepare(sim, params);
+	particleSimEmit(sim, params);
+	particleSimSimulate(sim, params);
+	particleSimScan(sim, params);
+	particleSimScatter(sim, params);
+	particleSimFinalize(sim, params);
+}
+
+bool particleSimValidate(uint32_t capacity, const ParticleCounters* counters, uint32_t current,
+    const uint32_t* deadList, const uint32_t* aliveList)
+{
+	uint32_t alive = counters->aliveCount[current ^ 1];
+	if (alive > capacity || counters->deadCount > capacity || alive + counters->deadCount != capacity)
+	{
+		fprintf(stderr, "particles: %u alive + %u dead != capacity %u\n", alive, counters->deadCount, capacity);
+		return false;
+	}
+	if (counters->draw[1] != alive)
+	{
+		fprintf(stderr, "particles: drawing %u instances with %u alive\n", counters->draw[1], alive);
+		return false;
+	}
+
+	uint8_t* seen = calloc(capacity, 1);
+	const uint32_t* live = aliveList + (size_t)(current ^ 1) * capacity;
+	bool ok = true;
+	for (uint32_t i = 0; i < capacity && ok; ++i)
+	{
+		uint32_t index = i < alive ? live[i] : deadList[i - alive];
+		ok = index < capacity && !seen[index];
+		if (!ok)
+			fprintf(stderr, "particles: %s entry %u holds %s index %u\n", i < alive ? "alive" : "dead",
+			    i < alive ? i : i - alive, index < capacity ? "duplicate" : "out of range", index);
+		else
+			seen[index] = 1;
+	}
+	free(seen);
+	return ok;
+}
+
+static bool counterMatches(const char* name, uint32_t actual, uint32_t expected, FILE* log, uint32_t* mismatches)
+{
+	if (actual == expected)
+		return true;
+	if (log && (*mismatches)++ < 8)
+		fprintf(log, "particles: %s %u, reference %u\n", name, actual, expected);
+	return false;
+}
+
+uint32_t particleSimCompare(const ParticleSim* reference, uint32_t current, const ParticleCounters* counters,
+    const uint32_t* deadList, const uint32_t* aliveList, const float* positions, float tolerance, FILE* log)
+{
+	const ParticleCounters* expected = &reference->counters;
+	uint32_t mismatches = 0, reported = 0;
+	mismatches += !counterMatches("deadCount", counters->deadCount, expected->deadCount, log, &reported);
+	mismatches += !counterMatches("emitCount", counters->emitCount, expected->emitCount, log, &reported);
+	mismatches += !counterMatches("simulateCount", counters->simulateCount, expected->simulateCount, log, &reported);
+	mismatches += !counterMatches("aliveCount[0]", counters->aliveCount[0], expected->aliveCount[0], log, &reported);
+	mismatches += !counterMatches("aliveCount[1]", counters->aliveCount[1], expected->aliveCount[1], log, &reported);
+	mismatches += !counterMatches("draw instances", counters->draw[1], expected->draw[1], log, &reported);
+	if (mismatches)
+		return mismatches; // the lists can't line up
+
+	const uint32_t* live = aliveList + (size_t)(current ^ 1) * reference->capacity;
+	const uint32_t* expectedLive = reference->aliveList + (size_t)(current ^ 1) * reference->capacity;
+	uint32_t alive = expected->aliveCount[current ^ 1];
+	for (uint32_t i = 0; i < alive; ++i)
+	{
+		if (live[i] == expectedLive[i])
+			continue;
+		if (log && reported++ < 8)
+			fprintf(log, "particles: alive[%u] = %u, reference %u\n", i, live[i], expectedLive[i]);
+		mismatches++;
+	}
+	for (uint32_t i = 0; i < expected->deadCount; ++i)
+	{
+		if (deadList[i] == reference->deadList[i])
+			continue;
+		if (log && reported++ < 8)
+			fprintf(log, "particles: dead[%u] = %u, reference %u\n", i, deadList[i], reference->deadList[i]);
+		mismatches++;
+	}
+	if (mismatches)
+		return mismatches;
+
+	for (uint32_t i = 0; i < alive; ++i)
+	{
+		uint32_t index = expectedLive[i];
+		for (int c = 0; c < 4; ++c)
+		{
+			float a = positions[index * 4 + c];
+			float b = reference->position[index * 4 + c];
+			if (fabsf(a - b) <= tolerance * fmaxf(1.0f, fabsf(b)))
+				continue;
+			if (log && reported++ < 8)
+				fprintf(log, "particles: particle %u component %d = %g, reference %g\n", index, c, a, b);
+			mismatches++;
+			break;
+		}
+	}
+	return mismatches;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+// GPU particle system, CPU reference.
+// Particles live in SoA streams (position + remaining life, velocity + total lifetime)
+// indexed through a dead list and two alive lists that swap every step. One step is the
+// same sequence of kernels on both sides:
+//   prepare   reserve min(request, dead) slots from the top of the dead list
+//   emit      initialise them and append them to the current alive list
+//   simulate  integrate every alive particle, flag the ones still alive
+//   scan      exclusive prefix sum of the flags (per block, then over the block sums)
+//   scatter   survivors to the other alive list, the rest back onto the dead list
+//   finalize  counts and indirect arguments for the next step and the draw
+// No step depends on atomics, so list order is deterministic and a GPU readback can be
+// compared entry by entry with this reference (positions within float tolerance; the
+// shaders' sin/cos/sqrt are not bit exact).
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PARTICLE_MAX_CAPACITY (1u << 21)
+#define PARTICLE_GROUP_SIZE 256 // emit / simulate threads per workgroup
+#define PARTICLE_SCAN_BLOCK 512 // flags per scan workgroup (two per thread)
+#define PARTICLE_MAX_SCAN_BLOCKS (PARTICLE_MAX_CAPACITY / PARTICLE_SCAN_BLOCK)
+
+// Matches the push constant block of the particle_*.comp kernels
+typedef struct ParticleParams
+{
+	float emitter[4];     // world position, spawn disc radius
+	float gravityDrag[4]; // acceleration, linear drag per second
+	float speed;          // launch speed
+	float spread;         // cone half-width as a tangent
+	float lifeMin, lifeMax;
+	float groundY;        // collision plane
+	float bounce;         // restitution on the plane
+	float dt;
+	uint32_t emitRequest; // particles to spawn this step
+	uint32_t seed;        // different every step
+	uint32_t current;     // alive list holding the live particles, 0 or 1
+	uint32_t capacity;
+	uint32_t pad;
+} ParticleParams;
+
+// Matches the std430 Counters block; the dispatch and draw members are used in place as
+// indirect arguments
+typedef struct ParticleCounters
+{
+	uint32_t emitDispatch[3];     // VkDispatchIndirectCommand
+	uint32_t emitCount;
+	uint32_t simulateDispatch[3]; // one thread per particle alive after emission
+	uint32_t simulateCount;
+	uint32_t scanDispatch[3];     // one workgroup per PARTICLE_SCAN_BLOCK particles
+	uint32_t deadCount;
+	uint32_t aliveCount[2];
+	uint32_t draw[4];             // VkDrawIndirectCommand: 6 vertices per alive particle
+} ParticleCounters;
+
+typedef struct ParticleSim
+{
+	uint32_t capacity;
+	float* position; // 4 per particle: xyz, remaining life
+	float* velocity; // 4 per particle: xyz, lifetime
+	uint32_t* deadList;
+	uint32_t* aliveList; // two lists of capacity entries
+	uint32_t* flags;
+	uint32_t* scanned;   // exclusive offset inside the particle's scan block
+	uint32_t* blockSums; // then exclusive offset of the block
+	ParticleCounters counters;
+} ParticleSim;
+
+// capacity is at most PARTICLE_MAX_CAPACITY; every particle starts on the dead list
+bool particleSimInit(ParticleSim* sim, uint32_t capacity);
+void particleSimDestroy(ParticleSim* sim);
+
+// The per-particle functions the kernels share
+uint32_t particleHash(uint32_t x);
+void particleEmitOne(const ParticleParams* params, uint32_t emitIndex, float position[4], float velocity[4]);
+bool particleIntegrate(const ParticleParams* params, float position[4], float velocity[4]);
+
+void particleSimPrepare(ParticleSim* sim, const ParticleParams* params);
+void particleSimEmit(ParticleSim* sim, const ParticleParams* params);
+void particleSimSimulate(ParticleSim* sim, const ParticleParams* params);
+void particleSimScan(ParticleSim* sim, const ParticleParams* params);
+void particleSimScatter(ParticleSim* sim, const ParticleParams* params);
+void particleSimFinalize(ParticleSim* sim, const ParticleParams* params);
+// All of the above; afterwards the live particles are in list params->current ^ 1
+void particleSimStep(ParticleSim* sim, const ParticleParams* params);
+
+// Checks the state after a step that ran with params->current == current, on the CPU
+// reference or on a GPU readback: alive + dead == capacity and every index is on exactly one
+// list. Reports the first problem to stderr and returns false.
+bool particleSimValidate(uint32_t capacity, const ParticleCounters* counters, uint32_t current,
+    const uint32_t* deadList, const uint32_t* aliveList);
+// Compares a GPU readback (same layout as ParticleSim: both alive lists, 4 floats of
+// position per particle) with the reference after the same steps. Counters and both lists
+// must match exactly, live positions within tolerance (relative beyond 1). Returns the
+// number of mismatches and prints the first few to log.
+uint32_t particleSimCompare(const ParticleSim* reference, uint32_t current, const ParticleCounters* counters,
+    const uint32_t* deadList, const uint32_t* aliveList, const float* positions, float tolerance, FILE* log);
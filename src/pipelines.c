@@ -1,23 +1,310 @@
 
 #include "main.h"
 
+#include <pthread.h>
 
-VkPipeline createMeshPipeline(Application* app, VkShaderModule vertShader, VkShaderModule fragShader, Material* material)
+// --- Pipeline cache ---
+
+#define PIPELINE_CACHE_MAGIC 0x43504B56u // "VKPC"
+#define PIPELINE_CACHE_FILE_VERSION 1u
+
+// Our own header in front of the driver blob. The driver's header carries the cache UUID
+// but not the driver version, so a blob from another driver build is rejected up front.
+typedef struct PipelineCacheFileHeader
+{
+	u32 magic;
+	u32 fileVersion;
+	u32 vendorID;
+	u32 deviceID;
+	u32 driverVersion;
+	u8 pipelineCacheUUID[VK_UUID_SIZE];
+	u64 dataSize;
+	u32 checksum; // FNV-1a over the blob, catches truncated writes
+} PipelineCacheFileHeader;
+
+static u32 pipelineCacheChecksum(const u8* data, size_t size)
+{
+	u32 hash = 2166136261u;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void fillPipelineCacheHeader(Application* app, PipelineCacheFileHeader* header)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(app->physicalDevice, &props);
+	memset(header, 0, sizeof(*header));
+	header->magic = PIPELINE_CACHE_MAGIC;
+	header->fileVersion = PIPELINE_CACHE_FILE_VERSION;
+	header->vendorID = props.vendorID;
+	header->deviceID = props.deviceID;
+	header->driverVersion = props.driverVersion;
+	memcpy(header->pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+// Returns the validated blob from path (caller frees), or NULL if it is missing or stale
+static void* readPipelineCacheFile(Application* app, const char* path, size_t* outSize)
+{
+	// The header lands in place, then the blob is read straight into its own buffer
+	PipelineCacheFileHeader expected, header;
+	FileRead headerRead = {.path = path, .dst = &header, .size = sizeof(header)};
+	fileioReadBatch(app->io, &headerRead, 1);
+	if (headerRead.error == ENOENT)
+	{
+		printf("Pipeline cache: no %s, starting cold\n", path);
+		return NULL;
+	}
+
+	fillPipelineCacheHeader(app, &expected);
+	void* data = NULL;
+	const char* reason = NULL;
+
+	if (headerRead.error != 0 || header.magic != PIPELINE_CACHE_MAGIC || header.fileVersion != PIPELINE_CACHE_FILE_VERSION)
+		reason = "unrecognised header";
+	else if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID)
+		reason = "different device";
+	else if (header.driverVersion != expected.driverVersion)
+		reason = "driver version changed";
+	else if (memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		reason = "pipeline cache UUID changed";
+	else if (header.dataSize == 0)
+		reason = "corrupt data";
+	else
+	{
+		FileRead dataRead = {.path = path, .dst = malloc(header.dataSize), .offset = sizeof(header), .size = header.dataSize};
+		if (!dataRead.dst || fileioReadBatch(app->io, &dataRead, 1) != 0 || pipelineCacheChecksum(dataRead.dst, header.dataSize) != header.checksum)
+		{
+			reason = "corrupt data";
+			free(dataRead.dst);
+		}
+		else
+			data = dataRead.dst;
+	}
+
+	if (reason)
+	{
+		printf("Pipeline cache: ignoring %s (%s)\n", path, reason);
+		return NULL;
+	}
+	*outSize = header.dataSize;
+	return data;
+}
+
+void createPipelineCache(Application* app, const char* path)
+{
+	size_t size = 0;
+	void* data = readPipelineCacheFile(app, path, &size);
+
+	VkPipelineCacheCreateInfo cacheInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+	    .initialDataSize = size,
+	    .pInitialData = data,
+	};
+	VK_CHECK(vkCreatePipelineCache(app->device, &cacheInfo, NULL, &app->pipelineCache));
+	app->pipelineCacheWarm = data != NULL;
+	app->pipelineCreateMs = 0.0;
+	if (data)
+		printf("Pipeline cache: loaded %zu bytes from %s\n", size, path);
+	free(data);
+}
+
+void savePipelineCache(Application* app, const char* path)
+{
+	size_t size = 0;
+	VK_CHECK(vkGetPipelineCacheData(app->device, app->pipelineCache, &size, NULL));
+	u8* data = malloc(size);
+	VK_CHECK(vkGetPipelineCacheData(app->device, app->pipelineCache, &size, data));
+
+	PipelineCacheFileHeader header;
+	fillPipelineCacheHeader(app, &header);
+	header.dataSize = size;
+	header.checksum = pipelineCacheChecksum(data, size);
+
+	// Write next to the target and rename, so a crash never leaves a half-written cache
+	char tmpPath[512];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+	FILE* file = fopen(tmpPath, "wb");
+	if (file)
+	{
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data, 1, size, file) == size;
+		ok = fclose(file) == 0 && ok;
+		if (ok && rename(tmpPath, path) == 0)
+			printf("Pipeline cache: saved %zu bytes to %s\n", size, path);
+		else
+			remove(tmpPath);
+	}
+	free(data);
+}
+
+void destroyPipelineCache(Application* app)
+{
+	vkDestroyPipelineCache(app->device, app->pipelineCache, NULL);
+	app->pipelineCache = VK_NULL_HANDLE;
+}
+
+// Pipelines may be compiled from worker threads (the cache itself is internally synchronized).
+// Timed with benchmarkNowMs rather than glfwGetTime so headless runs, which never initialise GLFW, report it too
+static pthread_mutex_t pipelineTimeMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void addPipelineTime(Application* app, double start)
+{
+	double ms = benchmarkNowMs() - start;
+	pthread_mutex_lock(&pipelineTimeMutex);
+	app->pipelineCreateMs += ms;
+	pthread_mutex_unlock(&pipelineTimeMutex);
+}
+
+// Every pipeline goes through the shared cache; creation time is summed for the startup report
+VkPipeline buildGraphicsPipeline(Application* app, const VkGraphicsPipelineCreateInfo* pipelineInfo)
+{
+	double start = benchmarkNowMs();
+	VkPipeline pipeline;
+	VK_CHECK(vkCreateGraphicsPipelines(app->device, app->pipelineCache, 1, pipelineInfo, NULL, &pipeline));
+	addPipelineTime(app, start);
+	return pipeline;
+}
+
+VkPipeline buildComputePipeline(Application* app, const VkComputePipelineCreateInfo* pipelineInfo)
+{
+	double start = benchmarkNowMs();
+	VkPipeline pipeline;
+	VK_CHECK(vkCreateComputePipelines(app->device, app->pipelineCache, 1, pipelineInfo, NULL, &pipeline));
+	addPipelineTime(app, start);
+	return pipeline;
+}
+
+// --- Mesh pipeline deduplication ---
+
+static u64 hashMeshPipelineKey(const MeshPipelineKey* key)
+{
+	const u8* bytes = (const u8*)key;
+	u64 hash = 14695981039346656037ull;
+	for (size_t i = 0; i < sizeof(*key); ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// Keys must be zero-initialized so padding never changes the hash
+u32 findOrAddMeshPipeline(Application* app, const MeshPipelineKey* key)
+{
+	u64 hash = hashMeshPipelineKey(key);
+	for (u32 i = 0; i < app->meshPipelineCount; ++i)
+	{
+		MeshPipelineEntry* entry = &app->meshPipelineEntries[i];
+		if (entry->hash == hash && memcmp(&entry->key, key, sizeof(*key)) == 0)
+			return i;
+	}
+
+	if (app->meshPipelineCount == app->meshPipelineCapacity)
+	{
+		app->meshPipelineCapacity = app->meshPipelineCapacity ? app->meshPipelineCapacity * 2 : 32;
+		app->meshPipelineEntries = realloc(app->meshPipelineEntries, app->meshPipelineCapacity * sizeof(MeshPipelineEntry));
+	}
+	u32 index = app->meshPipelineCount++;
+	app->meshPipelineEntries[index] = (MeshPipelineEntry){.hash = hash, .key = *key, .pipeline = VK_NULL_HANDLE};
+	return index;
+}
+
+typedef struct MeshPipelineCompileJob
+{
+	Application* app;
+	pthread_mutex_t mutex;
+	u32 next;
+} MeshPipelineCompileJob;
+
+static void* meshPipelineCompileWorker(void* arg)
+{
+	MeshPipelineCompileJob* job = arg;
+	for (;;)
+	{
+		pthread_mutex_lock(&job->mutex);
+		u32 index = job->next++;
+		pthread_mutex_unlock(&job->mutex);
+		if (index >= job->app->meshPipelineCount)
+			break;
+
+		MeshPipelineEntry* entry = &job->app->meshPipelineEntries[index];
+		entry->pipeline = entry->key.kind == MESH_PIPELINE_SHADED
+		                      ? createMeshPipeline(job->app, &entry->key)
+		                      : createDepthPrepassPipeline(job->app, &entry->key);
+	}
+	return NULL;
+}
+
+// Compiles every entry from firstEntry on; the calling thread works too
+void compileMeshPipelines(Application* app, u32 firstEntry, u32 threadCount)
+{
+	MeshPipelineCompileJob job = {.app = app, .next = firstEntry};
+	pthread_mutex_init(&job.mutex, NULL);
+
+	pthread_t threads[PIPELINE_COMPILE_MAX_THREADS];
+	u32 spawned = 0;
+	threadCount = MIN(MIN(threadCount, PIPELINE_COMPILE_MAX_THREADS), app->meshPipelineCount - firstEntry);
+	for (u32 i = 1; i < threadCount; ++i)
+	{
+		if (pthread_create(&threads[spawned], NULL, meshPipelineCompileWorker, &job) == 0)
+			spawned++;
+	}
+	meshPipelineCompileWorker(&job);
+	for (u32 i = 0; i < spawned; ++i)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&job.mutex);
+}
+
+
+// Raster and blend state left dynamic here is set per draw in drawMeshPrimitives
+static u32 meshDynamicStates(const MeshPipelineKey* key, VkDynamicState* outStates)
+{
+	u32 count = 0;
+	outStates[count++] = VK_DYNAMIC_STATE_VIEWPORT;
+	outStates[count++] = VK_DYNAMIC_STATE_SCISSOR;
+	if (key->dynamicState & MESH_DYNAMIC_RASTER)
+	{
+		outStates[count++] = VK_DYNAMIC_STATE_CULL_MODE;
+		outStates[count++] = VK_DYNAMIC_STATE_FRONT_FACE;
+		outStates[count++] = VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE;
+		outStates[count++] = VK_DYNAMIC_STATE_DEPTH_COMPARE_OP;
+	}
+	if (key->dynamicState & MESH_DYNAMIC_BLEND)
+		outStates[count++] = VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT;
+	return count;
+}
+
+VkPipeline createMeshPipeline(Application* app, const MeshPipelineKey* key)
 {
-	// Hook: choose an alternate fragment shader for toon if needed later
-	// Currently we always use the same module; toon is handled in tri.frag via ubo.stylizedMode
+	// Texture presence, alpha mode and shading model become constants so the compiler
+	// can drop the unused fetches and branches
+	VkSpecializationMapEntry specEntries[MESH_SPEC_COUNT];
+	for (u32 i = 0; i < MESH_SPEC_COUNT; ++i)
+		specEntries[i] = (VkSpecializationMapEntry){.constantID = i, .offset = i * sizeof(i32), .size = sizeof(i32)};
+	VkSpecializationInfo specInfo = {
+	    .mapEntryCount = MESH_SPEC_COUNT,
+	    .pMapEntries = specEntries,
+	    .dataSize = sizeof(key->spec),
+	    .pData = key->spec,
+	};
+
 	VkPipelineShaderStageCreateInfo stages[2] = {
 	    {
 	        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 	        .stage = VK_SHADER_STAGE_VERTEX_BIT,
-	        .module = vertShader,
+	        .module = key->vertShader,
 	        .pName = "main",
 	    },
 	    {
 	        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 	        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-	        .module = fragShader,
+	        .module = key->fragShader,
 	        .pName = "main",
+	        .pSpecializationInfo = &specInfo,
 	    },
 	};
 
@@ -61,7 +348,7 @@ VkPipeline createMeshPipeline(Application* app, VkShaderModule vertShader, VkSha
 	    .depthClampEnable = VK_FALSE,
 	    .rasterizerDiscardEnable = VK_FALSE,
 	    .polygonMode = VK_POLYGON_MODE_FILL,
-	    .cullMode = material->doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT,
+	    .cullMode = key->doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT,
 	    .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
 	    .depthBiasEnable = VK_FALSE,
 	    .depthBiasConstantFactor = 0.0f,
@@ -75,18 +362,20 @@ VkPipeline createMeshPipeline(Application* app, VkShaderModule vertShader, VkSha
 	    .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
 	};
 
+	// After a depth prepass the opaque/masked surfaces are already resolved: shade only the exact match.
+	// Blended materials never enter the prepass, so they keep LESS without writing depth.
 	VkPipelineDepthStencilStateCreateInfo depthStencilState = {
 	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
 	    .depthTestEnable = VK_TRUE,
-	    .depthWriteEnable = VK_TRUE,
-	    .depthCompareOp = VK_COMPARE_OP_LESS,
+	    .depthWriteEnable = key->depthPrepass ? VK_FALSE : VK_TRUE,
+	    .depthCompareOp = (key->depthPrepass && !key->blended) ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS,
 	    .depthBoundsTestEnable = VK_FALSE,
 	    .stencilTestEnable = VK_FALSE,
 	};
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachment = {
 	    .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        .blendEnable = material->alphaMode == 2 ? VK_TRUE : VK_FALSE,
+        .blendEnable = key->blended ? VK_TRUE : VK_FALSE,
         .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
         .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         .colorBlendOp = VK_BLEND_OP_ADD,
@@ -101,18 +390,19 @@ VkPipeline createMeshPipeline(Application* app, VkShaderModule vertShader, VkSha
 	    .pAttachments = &colorBlendAttachment,
 	};
 
-	VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkDynamicState dynamicStates[8];
+	u32 dynamicStateCount = meshDynamicStates(key, dynamicStates);
 	VkPipelineDynamicStateCreateInfo dynamicState = {
 	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-	    .dynamicStateCount = ARRAYSIZE(dynamicStates),
+	    .dynamicStateCount = dynamicStateCount,
 	    .pDynamicStates = dynamicStates,
 	};
 
 	VkPipelineRenderingCreateInfo renderingInfo = {
 	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
 	    .colorAttachmentCount = 1,
-	    .pColorAttachmentFormats = &app->swapchainFormat,
-	    .depthAttachmentFormat = app->depthFormat,
+	    .pColorAttachmentFormats = &key->colorFormat,
+	    .depthAttachmentFormat = key->depthFormat,
 	    .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
 	};
 	VkGraphicsPipelineCreateInfo pipelineInfo = {
@@ -132,51 +422,332 @@ VkPipeline createMeshPipeline(Application* app, VkShaderModule vertShader, VkSha
 	    .renderPass = VK_NULL_HANDLE,
 	};
 
-	VkPipeline pipeline;
-	VK_CHECK(vkCreateGraphicsPipelines(app->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &pipeline));
-	return pipeline;
+	return buildGraphicsPipeline(app, &pipelineInfo);
 }
 
-VkPipeline createParticlePipeline(Application* app, VkShaderModule vertShader, VkShaderModule fragShader)
+// Depth-only pipeline for the prepass. Without a fragment shader it reads the position-only
+// stream (opaque); with one it uses the full vertex layout so the mask shader gets UVs.
+VkPipeline createDepthPrepassPipeline(Application* app, const MeshPipelineKey* key)
 {
+	bool alphaTested = key->kind == MESH_PIPELINE_PREPASS_MASKED;
 	VkPipelineShaderStageCreateInfo stages[2] = {
 	    {
 	        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 	        .stage = VK_SHADER_STAGE_VERTEX_BIT,
-	        .module = vertShader,
+	        .module = key->vertShader,
 	        .pName = "main",
 	    },
 	    {
 	        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 	        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-	        .module = fragShader,
+	        .module = key->fragShader,
 	        .pName = "main",
 	    },
 	};
 
-	// Vertex input layout
 	VkVertexInputBindingDescription bindingDesc = {
 	    .binding = 0,
-	    .stride = sizeof(Particle),
+	    .stride = alphaTested ? sizeof(Vertex) : sizeof(vec3),
 	    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
 	};
 
 	VkVertexInputAttributeDescription attributes[] = {
-	    {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(Particle, pos)},
+	    {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = 0},
+	    {.location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Vertex, normal)},
+	    {.location = 2, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(Vertex, texcoord)},
+	    {.location = 3, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(Vertex, color)},
 	};
 
 	VkPipelineVertexInputStateCreateInfo vertexInput = {
 	    .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
 	    .vertexBindingDescriptionCount = 1,
 	    .pVertexBindingDescriptions = &bindingDesc,
-	    .vertexAttributeDescriptionCount = 1,
+	    .vertexAttributeDescriptionCount = alphaTested ? ARRAYSIZE(attributes) : 1,
 	    .pVertexAttributeDescriptions = attributes,
 	};
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
 	    .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-	    .topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST,
+	    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+	};
+
+	VkPipelineViewportStateCreateInfo viewportState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+	    .viewportCount = 1,
+	    .scissorCount = 1,
+	};
+
+	VkPipelineRasterizationStateCreateInfo rasterizationState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+	    .polygonMode = VK_POLYGON_MODE_FILL,
+	    .cullMode = key->doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT,
+	    .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+	    .lineWidth = 1.0f,
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisampleState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+	    .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+	};
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+	    .depthTestEnable = VK_TRUE,
+	    .depthWriteEnable = VK_TRUE,
+	    .depthCompareOp = VK_COMPARE_OP_LESS,
+	};
+
+	// Rendered inside the main pass, so the color attachment exists but is left untouched
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {
+	    .colorWriteMask = 0,
+	    .blendEnable = VK_FALSE,
+	};
+
+	VkPipelineColorBlendStateCreateInfo colorBlendState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+	    .attachmentCount = 1,
+	    .pAttachments = &colorBlendAttachment,
+	};
+
+	VkDynamicState dynamicStates[8];
+	u32 dynamicStateCount = meshDynamicStates(key, dynamicStates);
+	VkPipelineDynamicStateCreateInfo dynamicState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+	    .dynamicStateCount = dynamicStateCount,
+	    .pDynamicStates = dynamicStates,
+	};
+
+	VkPipelineRenderingCreateInfo renderingInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+	    .colorAttachmentCount = 1,
+	    .pColorAttachmentFormats = &key->colorFormat,
+	    .depthAttachmentFormat = key->depthFormat,
+	    .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+	};
+	VkGraphicsPipelineCreateInfo pipelineInfo = {
+	    .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+	    .pNext = &renderingInfo,
+	    .stageCount = alphaTested ? 2 : 1,
+	    .pStages = stages,
+	    .pVertexInputState = &vertexInput,
+	    .pInputAssemblyState = &inputAssembly,
+	    .pViewportState = &viewportState,
+	    .pRasterizationState = &rasterizationState,
+	    .pMultisampleState = &multisampleState,
+	    .pDepthStencilState = &depthStencilState,
+	    .pColorBlendState = &colorBlendState,
+	    .pDynamicState = &dynamicState,
+	    .layout = app->pipelineLayout,
+	    .renderPass = VK_NULL_HANDLE,
+	};
+
+	return buildGraphicsPipeline(app, &pipelineInfo);
+}
+
+// Depth-only cascade rendering from the position stream; no color attachment
+VkPipeline createShadowPipeline(Application* app, VkShaderModule vertShader)
+{
+	VkPipelineShaderStageCreateInfo stage = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+	    .stage = VK_SHADER_STAGE_VERTEX_BIT,
+	    .module = vertShader,
+	    .pName = "main",
+	};
+
+	VkVertexInputBindingDescription bindingDesc = {
+	    .binding = 0,
+	    .stride = sizeof(vec3),
+	    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+	};
+	VkVertexInputAttributeDescription attribute = {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = 0};
+
+	VkPipelineVertexInputStateCreateInfo vertexInput = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+	    .vertexBindingDescriptionCount = 1,
+	    .pVertexBindingDescriptions = &bindingDesc,
+	    .vertexAttributeDescriptionCount = 1,
+	    .pVertexAttributeDescriptions = &attribute,
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+	    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+	};
+
+	VkPipelineViewportStateCreateInfo viewportState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+	    .viewportCount = 1,
+	    .scissorCount = 1,
+	};
+
+	// Both faces cast (single-sided glTF planes would leak otherwise); slope bias against acne
+	VkPipelineRasterizationStateCreateInfo rasterizationState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+	    .polygonMode = VK_POLYGON_MODE_FILL,
+	    .cullMode = VK_CULL_MODE_NONE,
+	    .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+	    .depthBiasEnable = VK_TRUE,
+	    .depthBiasConstantFactor = 1.25f,
+	    .depthBiasSlopeFactor = 1.75f,
+	    .lineWidth = 1.0f,
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisampleState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+	    .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+	};
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+	    .depthTestEnable = VK_TRUE,
+	    .depthWriteEnable = VK_TRUE,
+	    .depthCompareOp = VK_COMPARE_OP_LESS,
+	};
+
+	VkPipelineColorBlendStateCreateInfo colorBlendState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+	};
+
+	VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamicState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+	    .dynamicStateCount = ARRAYSIZE(dynamicStates),
+	    .pDynamicStates = dynamicStates,
+	};
+
+	VkFormat depthFormat = SHADOW_MAP_FORMAT;
+	VkPipelineRenderingCreateInfo renderingInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+	    .colorAttachmentCount = 0,
+	    .depthAttachmentFormat = depthFormat,
+	};
+	VkGraphicsPipelineCreateInfo pipelineInfo = {
+	    .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+	    .pNext = &renderingInfo,
+	    .stageCount = 1,
+	    .pStages = &stage,
+	    .pVertexInputState = &vertexInput,
+	    .pInputAssemblyState = &inputAssembly,
+	    .pViewportState = &viewportState,
+	    .pRasterizationState = &rasterizationState,
+	    .pMultisampleState = &multisampleState,
+	    .pDepthStencilState = &depthStencilState,
+	    .pColorBlendState = &colorBlendState,
+	    .pDynamicState = &dynamicState,
+	    .layout = app->shadowPipelineLayout,
+	    .renderPass = VK_NULL_HANDLE,
+	};
+
+	return buildGraphicsPipeline(app, &pipelineInfo);
+}
+
+// Fullscreen triangle into the swapchain, no depth, no vertex input
+VkPipeline createTonemapPipeline(Application* app, VkShaderModule vertShader, VkShaderModule fragShader)
+{
+	VkPipelineShaderStageCreateInfo stages[] = {
+	    {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = vertShader, .pName = "main"},
+	    {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = fragShader, .pName = "main"},
+	};
+
+	VkPipelineVertexInputStateCreateInfo vertexInput = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+	    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+	};
+
+	VkPipelineViewportStateCreateInfo viewportState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+	    .viewportCount = 1,
+	    .scissorCount = 1,
+	};
 
+	VkPipelineRasterizationStateCreateInfo rasterizationState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+	    .polygonMode = VK_POLYGON_MODE_FILL,
+	    .cullMode = VK_CULL_MODE_NONE,
+	    .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+	    .lineWidth = 1.0f,
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisampleState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+	    .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+	};
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+	};
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {
+	    .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+	};
+
+	VkPipelineColorBlendStateCreateInfo colorBlendState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+	    .attachmentCount = 1,
+	    .pAttachments = &colorBlendAttachment,
+	};
+
+	VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamicState = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+	    .dynamicStateCount = ARRAYSIZE(dynamicStates),
+	    .pDynamicStates = dynamicStates,
+	};
+
+	VkPipelineRenderingCreateInfo renderingInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+	    .colorAttachmentCount = 1,
+	    .pColorAttachmentFormats = &app->swapchainFormat,
+	};
+	VkGraphicsPipelineCreateInfo pipelineInfo = {
+	    .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+	    .pNext = &renderingInfo,
+	    .stageCount = ARRAYSIZE(stages),
+	    .pStages = stages,
+	    .pVertexInputState = &vertexInput,
+	    .pInputAssemblyState = &inputAssembly,
+	    .pViewportState = &viewportState,
+	    .pRasterizationState = &rasterizationState,
+	    .pMultisampleState = &multisampleState,
+	    .pDepthStencilState = &depthStencilState,
+	    .pColorBlendState = &colorBlendState,
+	    .pDynamicState = &dynamicState,
+	    .layout = app->tonemapPipelineLayout,
+	    .renderPass = VK_NULL_HANDLE,
+	};
+
+	return buildGraphicsPipeline(app, &pipelineInfo);
+}
+
+VkPipeline createParticlePipeline(Application* app, VkShaderModule vertShader, VkShaderModule fragShader)
+{
+	VkPipelineShaderStageCreateInfo stages[2] = {
+	    {
+	        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+	        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+	        .module = vertShader,
+	        .pName = "main",
+	    },
+	    {
+	        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+	        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+	        .module = fragShader,
+	        .pName = "main",
+	    },
+	};
+
+	// Everything is fetched from the particle storage buffers
+	VkPipelineVertexInputStateCreateInfo vertexInput = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+	    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
 	};
 
 	VkPipelineViewportStateCreateInfo viewportState = {
@@ -207,9 +778,9 @@ VkPipeline createParticlePipeline(Application* app, VkShaderModule vertShader, V
 
 	VkPipelineDepthStencilStateCreateInfo depthStencilState = {
 	    .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-	    .depthTestEnable = VK_FALSE,
+	    .depthTestEnable = VK_TRUE, // hidden by opaque geometry, but never occlude each other
 	    .depthWriteEnable = VK_FALSE,
-	    .depthCompareOp = VK_COMPARE_OP_ALWAYS,
+	    .depthCompareOp = VK_COMPARE_OP_LESS,
 	    .depthBoundsTestEnable = VK_FALSE,
 	    .stencilTestEnable = VK_FALSE,
 	};
@@ -217,8 +788,9 @@ VkPipeline createParticlePipeline(Application* app, VkShaderModule vertShader, V
 	VkPipelineColorBlendAttachmentState colorBlendAttachment = {
 	    .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
 		.blendEnable = VK_TRUE,
-		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
-		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		// Additive, so the unsorted draw order doesn't matter
+		.srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE,
 		.colorBlendOp = VK_BLEND_OP_ADD,
 		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
 		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
@@ -238,10 +810,12 @@ VkPipeline createParticlePipeline(Application* app, VkShaderModule vertShader, V
 	    .pDynamicStates = dynamicStates,
 	};
 
+	// Drawn inside the scene pass, so it targets the HDR color image
+	VkFormat hdrFormat = HDR_COLOR_FORMAT;
 	VkPipelineRenderingCreateInfo renderingInfo = {
 	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
 	    .colorAttachmentCount = 1,
-	    .pColorAttachmentFormats = &app->swapchainFormat,
+	    .pColorAttachmentFormats = &hdrFormat,
 	    .depthAttachmentFormat = app->depthFormat,
 	    .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
 	};
@@ -262,9 +836,7 @@ VkPipeline createParticlePipeline(Application* app, VkShaderModule vertShader, V
 	    .renderPass = VK_NULL_HANDLE,
 	};
 
-	VkPipeline pipeline;
-	VK_CHECK(vkCreateGraphicsPipelines(app->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &pipeline));
-	return pipeline;
+	return buildGraphicsPipeline(app, &pipelineInfo);
 }
 
 
@@ -0,0 +1,123 @@
+#include "pool.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t makeHandle(uint32_t slot, uint32_t generation)
+{
+	return (generation << POOL_INDEX_BITS) | slot;
+}
+
+static void* growArray(void* array, size_t count, size_t elementSize)
+{
+	void* grown = realloc(array, count * elementSize);
+	if (!grown)
+	{
+		fprintf(stderr, "Pool: out of memory growing to %zu items\n", count);
+		abort();
+	}
+	return grown;
+}
+
+static void grow(HandlePool* pool)
+{
+	uint32_t capacity = pool->capacity ? pool->capacity * 2 : 64;
+	if (capacity > POOL_MAX_ITEMS)
+		capacity = POOL_MAX_ITEMS;
+	assert(capacity > pool->capacity && "pool full");
+	pool->generations = growArray(pool->generations, capacity, sizeof(uint32_t));
+	pool->denseOf = growArray(pool->denseOf, capacity, sizeof(uint32_t));
+	pool->slotOf = growArray(pool->slotOf, capacity, sizeof(uint32_t));
+	pool->freeSlots = growArray(pool->freeSlots, capacity, sizeof(uint32_t));
+	for (uint32_t i = 0; i < pool->columnCount; ++i)
+		*pool->columns[i].data = growArray(*pool->columns[i].data, capacity, pool->columns[i].elementSize);
+	pool->capacity = capacity;
+}
+
+void poolAddColumn(HandlePool* pool, void* column, size_t elementSize)
+{
+	assert(pool->columnCount < POOL_MAX_COLUMNS && "raise POOL_MAX_COLUMNS");
+	assert(pool->capacity == 0 && "columns are added before the first item");
+	pool->columns[pool->columnCount++] = (PoolColumn){.data = column, .elementSize = elementSize};
+}
+
+void poolDestroy(HandlePool* pool)
+{
+	free(pool->generations);
+	free(pool->denseOf);
+	free(pool->slotOf);
+	free(pool->freeSlots);
+	for (uint32_t i = 0; i < pool->columnCount; ++i)
+	{
+		free(*pool->columns[i].data);
+		*pool->columns[i].data = NULL;
+	}
+	memset(pool, 0, sizeof(*pool));
+}
+
+uint32_t poolAdd(HandlePool* pool, uint32_t* outIndex)
+{
+	if (pool->count == pool->capacity)
+		grow(pool);
+
+	uint32_t slot;
+	if (pool->freeCount > 0)
+		slot = pool->freeSlots[--pool->freeCount];
+	else
+	{
+		slot = pool->slotCount++;
+		pool->generations[slot] = 1;
+	}
+	uint32_t index = pool->count++;
+	pool->denseOf[slot] = index;
+	pool->slotOf[index] = slot;
+	for (uint32_t i = 0; i < pool->columnCount; ++i)
+	{
+		const PoolColumn* column = &pool->columns[i];
+		memset((char*)*column->data + index * column->elementSize, 0, column->elementSize);
+	}
+	*outIndex = index;
+	return makeHandle(slot, pool->generations[slot]);
+}
+
+bool poolRemove(HandlePool* pool, uint32_t handle)
+{
+	uint32_t index = poolIndex(pool, handle);
+	if (index == POOL_INVALID)
+		return false;
+	uint32_t slot = handle & POOL_MAX_ITEMS;
+	uint32_t last = --pool->count;
+	if (index != last)
+	{
+		for (uint32_t i = 0; i < pool->columnCount; ++i)
+		{
+			const PoolColumn* column = &pool->columns[i];
+			char* data = *column->data;
+			memcpy(data + index * column->elementSize, data + last * column->elementSize, column->elementSize);
+		}
+		uint32_t movedSlot = pool->slotOf[last];
+		pool->slotOf[index] = movedSlot;
+		pool->denseOf[movedSlot] = index;
+	}
+	// Generation 0 is skipped on wrap so a zeroed handle never matches
+	uint32_t generation = (pool->generations[slot] + 1) & POOL_GENERATION_MASK;
+	pool->generations[slot] = generation ? generation : 1;
+	pool->freeSlots[pool->freeCount++] = slot;
+	return true;
+}
+
+uint32_t poolIndex(const HandlePool* pool, uint32_t handle)
+{
+	uint32_t slot = handle & POOL_MAX_ITEMS;
+	if (slot >= pool->slotCount || pool->generations[slot] != handle >> POOL_INDEX_BITS)
+		return POOL_INVALID;
+	return pool->denseOf[slot];
+}
+
+uint32_t poolHandleAt(const HandlePool* pool, uint32_t index)
+{
+	uint32_t slot = pool->slotOf[index];
+	return makeHandle(slot, pool->generations[slot]);
+}
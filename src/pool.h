@@ -0,0 +1,53 @@
+#pragma once
+
+// Generational handle pool with structure-of-arrays storage.
+// Items live packed at the front of caller-owned columns (one array per field), so walking
+// every live item is a linear pass over each field. A handle is a slot index plus the
+// slot's generation: removing an item bumps the generation, so stale handles fail the lookup
+// instead of reaching whatever reused the slot. Removal moves the last item into the hole
+// and patches its slot, which keeps lookups O(1) through two arrays and never leaves gaps.
+// Not thread safe.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define POOL_INDEX_BITS 20
+#define POOL_MAX_ITEMS ((1u << POOL_INDEX_BITS) - 1)
+#define POOL_GENERATION_MASK ((1u << (32 - POOL_INDEX_BITS)) - 1)
+#define POOL_MAX_COLUMNS 12
+#define POOL_INVALID UINT32_MAX
+
+typedef struct PoolColumn
+{
+	void** data; // the caller's column pointer, reallocated as the pool grows
+	size_t elementSize;
+} PoolColumn;
+
+// Zero-initialized is an empty pool with no columns
+typedef struct HandlePool
+{
+	uint32_t* generations; // per slot, never 0 so that handle 0 is always invalid
+	uint32_t* denseOf;     // slot -> item index
+	uint32_t* slotOf;      // item index -> slot
+	uint32_t* freeSlots;   // stack of removed slots, reused before new ones
+	uint32_t freeCount;
+	uint32_t slotCount;
+	uint32_t count;        // live items, packed at [0, count) in every column
+	uint32_t capacity;
+	PoolColumn columns[POOL_MAX_COLUMNS];
+	uint32_t columnCount;
+} HandlePool;
+
+// column is the address of a T* field; every column must be added before the first poolAdd
+void poolAddColumn(HandlePool* pool, void* column, size_t elementSize);
+// Frees the slot arrays and every column; the items themselves are the caller's to release first
+void poolDestroy(HandlePool* pool);
+
+// New item at *outIndex with every column zeroed there
+uint32_t poolAdd(HandlePool* pool, uint32_t* outIndex);
+// The last item moves into the removed one's place; false for a stale handle
+bool poolRemove(HandlePool* pool, uint32_t handle);
+// Item index of a live handle, POOL_INVALID otherwise. Indices change on removal; handles don't.
+uint32_t poolIndex(const HandlePool* pool, uint32_t handle);
+uint32_t poolHandleAt(const HandlePool* pool, uint32_t index);
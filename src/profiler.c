@@ -0,0 +1,162 @@
+#define _POSIX_C_SOURCE 200809L
+#include "profiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void profilerInit(Profiler* profiler, uint32_t eventCapacity)
+{
+	memset(profiler, 0, sizeof(*profiler));
+	profiler->events = malloc(eventCapacity * sizeof(ProfilerEvent));
+	profiler->eventCapacity = profiler->events ? eventCapacity : 0;
+}
+
+void profilerDestroy(Profiler* profiler)
+{
+	free(profiler->events);
+	memset(profiler, 0, sizeof(*profiler));
+}
+
+void profilerStartCapture(Profiler* profiler, uint32_t frames, uint32_t gpuLatency)
+{
+	profiler->eventCount = 0;
+	profiler->droppedEvents = 0;
+	profiler->captureFrames = frames;
+	profiler->drainFrames = gpuLatency + 1; // results for the last frame land while recording the gpuLatency-th after it
+	profiler->gpuClockAnchored = false;
+}
+
+bool profilerNewFrame(Profiler* profiler)
+{
+	profiler->frame++;
+	profiler->recording = false;
+	if (profiler->captureFrames > 0)
+	{
+		profiler->captureFrames--;
+		profiler->recording = true;
+		return false;
+	}
+	if (profiler->drainFrames > 0)
+		return --profiler->drainFrames == 0;
+	return false;
+}
+
+bool profilerCapturing(const Profiler* profiler)
+{
+	return profiler->captureFrames > 0 || profiler->drainFrames > 0;
+}
+
+static void pushEvent(Profiler* profiler, const ProfilerEvent* event)
+{
+	if (profiler->eventCount == profiler->eventCapacity)
+	{
+		profiler->droppedEvents++;
+		return;
+	}
+	profiler->events[profiler->eventCount++] = *event;
+}
+
+// The stack is kept even when not recording, so a capture can start between begin and end
+void profilerBeginCpu(Profiler* profiler, const char* name)
+{
+	// Scopes nested deeper than the stack are counted but not recorded
+	if (profiler->depth < PROFILER_MAX_DEPTH)
+	{
+		profiler->stackNames[profiler->depth] = name;
+		profiler->stackStartUs[profiler->depth] = profilerNowUs();
+	}
+	profiler->depth++;
+}
+
+void profilerEndCpu(Profiler* profiler)
+{
+	if (profiler->depth == 0)
+		return;
+	uint32_t depth = --profiler->depth;
+	if (depth >= PROFILER_MAX_DEPTH || !profiler->recording)
+		return;
+	ProfilerEvent event = {
+	    .name = profiler->stackNames[depth],
+	    .startUs = profiler->stackStartUs[depth],
+	    .durationUs = profilerNowUs() - profiler->stackStartUs[depth],
+	    .frame = profiler->frame,
+	    .track = PROFILER_TRACK_CPU,
+	};
+	pushEvent(profiler, &event);
+}
+
+void profilerAddGpu(Profiler* profiler, const char* name, double gpuStartUs, double durationUs, double cpuSubmitUs, uint32_t frame)
+{
+	if (!profilerCapturing(profiler))
+		return;
+	if (!profiler->gpuClockAnchored)
+	{
+		profiler->gpuToCpuUs = cpuSubmitUs - gpuStartUs;
+		profiler->gpuClockAnchored = true;
+	}
+	ProfilerEvent event = {
+	    .name = name,
+	    .startUs = gpuStartUs + profiler->gpuToCpuUs,
+	    .durationUs = durationUs,
+	    .frame = frame,
+	    .track = PROFILER_TRACK_GPU,
+	};
+	pushEvent(profiler, &event);
+}
+
+static void writeName(FILE* file, const char* name)
+{
+	fputc('"', file);
+	for (const char* c = name ? name : "?"; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+			fputc('\\', file);
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+bool profilerWriteChromeTrace(const Profiler* profiler, const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	// Timestamps relative to the earliest event keep the numbers small
+	double originUs = 0.0;
+	for (uint32_t i = 0; i < profiler->eventCount; ++i)
+	{
+		if (i == 0 || profiler->events[i].startUs < originUs)
+			originUs = profiler->events[i].startUs;
+	}
+
+	// One process per track so the viewer shows CPU and GPU as separate rows
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 1, \"args\": {\"name\": \"CPU\"}},\n", PROFILER_TRACK_CPU + 1);
+	fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 1, \"args\": {\"name\": \"main\"}},\n", PROFILER_TRACK_CPU + 1);
+	fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 1, \"args\": {\"name\": \"GPU\"}},\n", PROFILER_TRACK_GPU + 1);
+	fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 1, \"args\": {\"name\": \"graphics queue\"}}", PROFILER_TRACK_GPU + 1);
+
+	for (uint32_t i = 0; i < profiler->eventCount; ++i)
+	{
+		const ProfilerEvent* event = &profiler->events[i];
+		fprintf(file, ",\n{\"name\": ");
+		writeName(file, event->name);
+		fprintf(file, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"frame\": %u}}",
+		    event->track == PROFILER_TRACK_GPU ? "gpu" : "cpu", event->track + 1, event->startUs - originUs,
+		    event->durationUs, event->frame);
+	}
+	fprintf(file, "\n]}\n");
+
+	bool ok = !ferror(file);
+	return fclose(file) == 0 && ok;
+}
+
+double profilerNowUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Frame profiler: CPU scopes and GPU ranges captured over a number of frames and written
+// out as a Chrome trace (chrome://tracing, Perfetto). Plain C with no Vulkan: the GPU
+// timer resolves its queries and hands the ranges over with profilerAddGpu.
+// Nothing is recorded outside a capture, so the scopes can stay in the frame loop.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PROFILER_MAX_DEPTH 16
+#define PROFILER_DEFAULT_EVENTS (1u << 16)
+#define PROFILER_CAPTURE_FRAMES 120
+#define PROFILER_TRACE_PATH "trace.json"
+
+typedef enum ProfilerTrack
+{
+	PROFILER_TRACK_CPU, // main thread
+	PROFILER_TRACK_GPU, // graphics queue
+} ProfilerTrack;
+
+typedef struct ProfilerEvent
+{
+	const char* name; // static string
+	double startUs;   // CPU clock, see profilerNowUs
+	double durationUs;
+	uint32_t frame;
+	ProfilerTrack track;
+} ProfilerEvent;
+
+typedef struct Profiler
+{
+	ProfilerEvent* events;
+	uint32_t eventCount, eventCapacity;
+	uint32_t droppedEvents;
+
+	uint32_t frame;          // frames since init
+	uint32_t captureFrames;  // left to record
+	uint32_t drainFrames;    // left to wait for GPU results after the last recorded frame
+	bool recording;          // this frame's CPU scopes are kept
+	bool gpuClockAnchored;
+	double gpuToCpuUs;       // added to GPU timestamps to place them on the CPU clock
+
+	const char* stackNames[PROFILER_MAX_DEPTH];
+	double stackStartUs[PROFILER_MAX_DEPTH];
+	uint32_t depth;
+} Profiler;
+
+void profilerInit(Profiler* profiler, uint32_t eventCapacity);
+void profilerDestroy(Profiler* profiler);
+
+// Records the next `frames` frames. GPU results arrive gpuLatency frames late, so the capture
+// only completes that many frames after the last one recorded.
+void profilerStartCapture(Profiler* profiler, uint32_t frames, uint32_t gpuLatency);
+// Call at the top of every frame; returns true on the frame the capture completes
+bool profilerNewFrame(Profiler* profiler);
+// Recording or still waiting for GPU results
+bool profilerCapturing(const Profiler* profiler);
+
+void profilerBeginCpu(Profiler* profiler, const char* name);
+void profilerEndCpu(Profiler* profiler);
+
+// A GPU range in GPU clock microseconds. The first range of a capture is placed at
+// cpuSubmitUs, the submit of the frame that ran it; later ones keep their GPU clock offsets
+// from it, so the queue timeline stays exact and lines up with the CPU within one submit.
+void profilerAddGpu(Profiler* profiler, const char* name, double gpuStartUs, double durationUs, double cpuSubmitUs, uint32_t frame);
+
+bool profilerWriteChromeTrace(const Profiler* profiler, const char* path);
+
+double profilerNowUs(void);
@@ -0,0 +1,499 @@
+#include "rendergraph.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define RG_BIT(access) (1u << (uint32_t)(access))
+
+bool rgAccessIsWrite(RgAccess access)
+{
+	switch (access)
+	{
+	case RG_ACCESS_COLOR_ATTACHMENT_WRITE:
+	case RG_ACCESS_COLOR_ATTACHMENT_READ_WRITE:
+	case RG_ACCESS_DEPTH_ATTACHMENT_WRITE:
+	case RG_ACCESS_STORAGE_WRITE_COMPUTE:
+	case RG_ACCESS_STORAGE_READ_WRITE_COMPUTE:
+	case RG_ACCESS_TRANSFER_WRITE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Whether the pass depends on the previous contents (used for culling)
+static bool rgAccessReadsContents(RgAccess access)
+{
+	switch (access)
+	{
+	case RG_ACCESS_NONE:
+	case RG_ACCESS_COLOR_ATTACHMENT_WRITE:
+	case RG_ACCESS_DEPTH_ATTACHMENT_WRITE:
+	case RG_ACCESS_STORAGE_WRITE_COMPUTE:
+	case RG_ACCESS_TRANSFER_WRITE:
+		return false;
+	default:
+		return true;
+	}
+}
+
+RgLayout rgAccessLayout(RgAccess access)
+{
+	switch (access)
+	{
+	case RG_ACCESS_COLOR_ATTACHMENT_WRITE:
+	case RG_ACCESS_COLOR_ATTACHMENT_READ_WRITE:
+		return RG_LAYOUT_COLOR_ATTACHMENT;
+	case RG_ACCESS_DEPTH_ATTACHMENT_WRITE:
+		return RG_LAYOUT_DEPTH_ATTACHMENT;
+	case RG_ACCESS_DEPTH_ATTACHMENT_READ:
+		return RG_LAYOUT_DEPTH_READ_ONLY;
+	case RG_ACCESS_SAMPLED_FRAGMENT:
+	case RG_ACCESS_SAMPLED_COMPUTE:
+		return RG_LAYOUT_SHADER_READ_ONLY;
+	case RG_ACCESS_STORAGE_READ_COMPUTE:
+	case RG_ACCESS_STORAGE_WRITE_COMPUTE:
+	case RG_ACCESS_STORAGE_READ_WRITE_COMPUTE:
+	case RG_ACCESS_STORAGE_READ_FRAGMENT:
+		return RG_LAYOUT_GENERAL;
+	case RG_ACCESS_TRANSFER_READ:
+		return RG_LAYOUT_TRANSFER_SRC;
+	case RG_ACCESS_TRANSFER_WRITE:
+		return RG_LAYOUT_TRANSFER_DST;
+	case RG_ACCESS_PRESENT:
+		return RG_LAYOUT_PRESENT;
+	default:
+		return RG_LAYOUT_UNDEFINED;
+	}
+}
+
+void rgInit(RenderGraph* graph, const RgBackend* backend)
+{
+	memset(graph, 0, sizeof(*graph));
+	graph->backend = *backend;
+}
+
+void rgDestroy(RenderGraph* graph)
+{
+	RgBackend backend = graph->backend;
+	for (uint32_t i = 0; i < graph->resourceCount; ++i)
+	{
+		RgResource* res = &graph->resources[i];
+		if (!res->imported && res->handle)
+			backend.destroyImage(backend.user, res->handle, res->view);
+	}
+	for (uint32_t i = 0; i < graph->slotCount; ++i)
+	{
+		if (graph->slots[i].memory)
+			backend.freeMemory(backend.user, graph->slots[i].memory);
+	}
+	rgInit(graph, &backend);
+}
+
+static uint32_t addResource(RenderGraph* graph, const char* name, RgResourceKind kind)
+{
+	assert(graph->resourceCount < RG_MAX_RESOURCES);
+	assert(!graph->compiled);
+	uint32_t index = graph->resourceCount++;
+	RgResource* res = &graph->resources[index];
+	memset(res, 0, sizeof(*res));
+	res->name = name;
+	res->kind = kind;
+	res->firstPass = -1;
+	res->lastPass = -1;
+	res->memorySlot = RG_INVALID;
+	res->aliasPrevious = RG_INVALID;
+	return index;
+}
+
+uint32_t rgImportImage(RenderGraph* graph, const char* name, const RgImageDesc* desc, void* image, void* view, RgState* state, RgAccess finalAccess)
+{
+	uint32_t index = addResource(graph, name, RG_RESOURCE_IMAGE);
+	RgResource* res = &graph->resources[index];
+	res->imported = true;
+	res->image = *desc;
+	res->handle = image;
+	res->view = view;
+	res->externalState = state;
+	res->finalAccess = finalAccess;
+	return index;
+}
+
+uint32_t rgImportBuffer(RenderGraph* graph, const char* name, void* buffer, RgState* state)
+{
+	uint32_t index = addResource(graph, name, RG_RESOURCE_BUFFER);
+	RgResource* res = &graph->resources[index];
+	res->imported = true;
+	res->handle = buffer;
+	res->externalState = state;
+	return index;
+}
+
+void rgUpdateImport(RenderGraph* graph, uint32_t resource, void* handle, void* view, RgState* state)
+{
+	RgResource* res = &graph->resources[resource];
+	assert(res->imported);
+	res->handle = handle;
+	res->view = view;
+	res->externalState = state;
+}
+
+uint32_t rgCreateImage(RenderGraph* graph, const char* name, const RgImageDesc* desc)
+{
+	uint32_t index = addResource(graph, name, RG_RESOURCE_IMAGE);
+	graph->resources[index].image = *desc;
+	return index;
+}
+
+uint32_t rgAddPass(RenderGraph* graph, const char* name, RgExecuteFn execute, void* userData)
+{
+	assert(graph->passCount < RG_MAX_PASSES);
+	assert(!graph->compiled);
+	uint32_t index = graph->passCount++;
+	RgPass* pass = &graph->passes[index];
+	memset(pass, 0, sizeof(*pass));
+	pass->name = name;
+	pass->execute = execute;
+	pass->userData = userData;
+	return index;
+}
+
+void rgPassUse(RenderGraph* graph, uint32_t pass, uint32_t resource, RgAccess access)
+{
+	RgPass* p = &graph->passes[pass];
+	assert(p->useCount < RG_MAX_PASS_USES);
+	for (uint32_t i = 0; i < p->useCount; ++i)
+		assert(p->uses[i].resource != resource && "declare one combined access per resource");
+	p->uses[p->useCount++] = (RgUse){.resource = resource, .access = access};
+}
+
+void rgPassSideEffects(RenderGraph* graph, uint32_t pass)
+{
+	graph->passes[pass].sideEffects = true;
+}
+
+// --- Compile ---
+
+static void cullPasses(RenderGraph* graph)
+{
+	bool keep[RG_MAX_PASSES] = {false};
+
+	for (uint32_t p = 0; p < graph->passCount; ++p)
+	{
+		RgPass* pass = &graph->passes[p];
+		keep[p] = pass->sideEffects;
+		for (uint32_t u = 0; u < pass->useCount; ++u)
+		{
+			if (rgAccessIsWrite(pass->uses[u].access) && graph->resources[pass->uses[u].resource].imported)
+				keep[p] = true;
+		}
+	}
+
+	// Writers are always recorded before their readers, so one backwards sweep marks every producer
+	for (int32_t p = (int32_t)graph->passCount - 1; p >= 0; --p)
+	{
+		if (!keep[p])
+			continue;
+		const RgPass* pass = &graph->passes[p];
+		for (uint32_t u = 0; u < pass->useCount; ++u)
+		{
+			if (!rgAccessReadsContents(pass->uses[u].access))
+				continue;
+			for (int32_t w = p - 1; w >= 0; --w)
+			{
+				const RgPass* writer = &graph->passes[w];
+				bool found = false;
+				for (uint32_t wu = 0; wu < writer->useCount; ++wu)
+				{
+					if (writer->uses[wu].resource == pass->uses[u].resource && rgAccessIsWrite(writer->uses[wu].access))
+						found = true;
+				}
+				if (found)
+				{
+					keep[w] = true;
+					break;
+				}
+			}
+		}
+	}
+
+	graph->stats.passes = graph->passCount;
+	graph->stats.culledPasses = 0;
+	for (uint32_t p = 0; p < graph->passCount; ++p)
+	{
+		graph->passes[p].culled = !keep[p];
+		if (!keep[p])
+			graph->stats.culledPasses++;
+	}
+}
+
+static void computeLifetimes(RenderGraph* graph)
+{
+	for (uint32_t p = 0; p < graph->passCount; ++p)
+	{
+		const RgPass* pass = &graph->passes[p];
+		if (pass->culled)
+			continue;
+		for (uint32_t u = 0; u < pass->useCount; ++u)
+		{
+			RgResource* res = &graph->resources[pass->uses[u].resource];
+			if (res->firstPass < 0)
+				res->firstPass = (int32_t)p;
+			res->lastPass = (int32_t)p;
+		}
+	}
+}
+
+// Greedy interval packing: a transient reuses the smallest slot whose previous owner
+// is dead before it is first used.
+static bool allocateTransients(RenderGraph* graph)
+{
+	uint32_t order[RG_MAX_RESOURCES];
+	uint32_t count = 0;
+	RgMemoryRequirements requirements[RG_MAX_RESOURCES];
+
+	for (uint32_t i = 0; i < graph->resourceCount; ++i)
+	{
+		RgResource* res = &graph->resources[i];
+		if (res->imported || res->firstPass < 0)
+			continue;
+		// Insertion sort by first use
+		uint32_t at = count++;
+		while (at > 0 && graph->resources[order[at - 1]].firstPass > res->firstPass)
+		{
+			order[at] = order[at - 1];
+			at--;
+		}
+		order[at] = i;
+	}
+
+	graph->stats.transientBytes = 0;
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		uint32_t index = order[k];
+		RgResource* res = &graph->resources[index];
+		res->handle = graph->backend.createImage(graph->backend.user, &res->image, &requirements[index]);
+		if (!res->handle)
+			return false;
+		const RgMemoryRequirements* req = &requirements[index];
+		res->size = req->size;
+		graph->stats.transientBytes += req->size;
+
+		uint32_t best = RG_INVALID;
+		for (uint32_t s = 0; s < graph->slotCount; ++s)
+		{
+			RgMemorySlot* slot = &graph->slots[s];
+			if (slot->lastPass >= res->firstPass || (slot->typeBits & req->typeBits) == 0)
+				continue;
+			if (best == RG_INVALID)
+			{
+				best = s;
+				continue;
+			}
+			// Prefer the tightest slot that already fits, otherwise the one that grows least
+			uint64_t bestSize = graph->slots[best].size;
+			bool fits = slot->size >= req->size, bestFits = bestSize >= req->size;
+			if ((fits && (!bestFits || slot->size < bestSize)) || (!fits && !bestFits && slot->size > bestSize))
+				best = s;
+		}
+
+		if (best == RG_INVALID)
+		{
+			best = graph->slotCount++;
+			graph->slots[best] = (RgMemorySlot){.typeBits = req->typeBits, .lastResource = RG_INVALID};
+		}
+
+		RgMemorySlot* slot = &graph->slots[best];
+		res->memorySlot = best;
+		res->aliasPrevious = slot->lastResource;
+		slot->size = slot->size > req->size ? slot->size : req->size;
+		slot->alignment = slot->alignment > req->alignment ? slot->alignment : req->alignment;
+		slot->typeBits &= req->typeBits;
+		slot->lastPass = res->lastPass;
+		slot->lastResource = index;
+	}
+
+	graph->stats.allocatedBytes = 0;
+	for (uint32_t s = 0; s < graph->slotCount; ++s)
+	{
+		RgMemorySlot* slot = &graph->slots[s];
+		slot->memory = graph->backend.allocateMemory(graph->backend.user, slot->size, slot->typeBits);
+		if (!slot->memory)
+			return false;
+		graph->stats.allocatedBytes += slot->size;
+	}
+
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		RgResource* res = &graph->resources[order[k]];
+		res->view = graph->backend.bindImage(graph->backend.user, res->handle, &res->image, graph->slots[res->memorySlot].memory, 0);
+	}
+	return true;
+}
+
+bool rgCompile(RenderGraph* graph)
+{
+	assert(!graph->compiled);
+	cullPasses(graph);
+	computeLifetimes(graph);
+	if (!allocateTransients(graph))
+		return false;
+	graph->compiled = true;
+	return true;
+}
+
+// --- Execute ---
+
+static void planAccess(RenderGraph* graph, uint32_t resource, RgAccess access)
+{
+	RgResource* res = &graph->resources[resource];
+	RgState* state = &res->state;
+	bool isImage = res->kind == RG_RESOURCE_IMAGE;
+	RgLayout newLayout = isImage ? rgAccessLayout(access) : RG_LAYOUT_UNDEFINED;
+	bool layoutChange = isImage && state->layout != newLayout;
+	uint32_t writeBits = state->lastWrite != RG_ACCESS_NONE ? RG_BIT(state->lastWrite) : 0;
+	uint32_t src = 0;
+
+	if (rgAccessIsWrite(access) || layoutChange)
+	{
+		// WAW, WAR, and layout transitions wait on everything since the last write
+		src = writeBits | state->readMask;
+	}
+	else if ((state->readMask & RG_BIT(access)) == 0)
+	{
+		// RAW: first read of this kind since the write (earlier readers chain the visibility)
+		src = writeBits | state->readMask;
+	}
+
+	if (src != 0 || layoutChange)
+	{
+		assert(graph->barrierCount < RG_MAX_BARRIERS);
+		graph->barriers[graph->barrierCount++] = (RgBarrier){
+		    .resource = resource,
+		    .srcAccessMask = src,
+		    .dstAccessMask = RG_BIT(access),
+		    .oldLayout = state->layout,
+		    .newLayout = newLayout,
+		};
+	}
+
+	if (rgAccessIsWrite(access))
+	{
+		state->lastWrite = access;
+		state->readMask = 0;
+	}
+	else
+	{
+		state->readMask = (layoutChange ? 0 : state->readMask) | RG_BIT(access);
+	}
+	state->layout = newLayout;
+}
+
+static void planBarriers(RenderGraph* graph)
+{
+	graph->barrierCount = 0;
+
+	// The first owner of each slot still has to wait on the last owner from the previous frame
+	uint32_t carried[RG_MAX_RESOURCES] = {0};
+	for (uint32_t s = 0; s < graph->slotCount; ++s)
+	{
+		const RgState* last = &graph->resources[graph->slots[s].lastResource].state;
+		carried[s] = last->readMask | (last->lastWrite != RG_ACCESS_NONE ? RG_BIT(last->lastWrite) : 0);
+	}
+
+	for (uint32_t i = 0; i < graph->resourceCount; ++i)
+	{
+		RgResource* res = &graph->resources[i];
+		if (res->imported && res->externalState)
+			res->state = *res->externalState;
+		else
+			res->state = (RgState){0};
+	}
+
+	for (uint32_t p = 0; p < graph->passCount; ++p)
+	{
+		RgPass* pass = &graph->passes[p];
+		pass->firstBarrier = graph->barrierCount;
+		pass->barrierCount = 0;
+		if (pass->culled)
+			continue;
+
+		for (uint32_t u = 0; u < pass->useCount; ++u)
+		{
+			uint32_t r = pass->uses[u].resource;
+			RgResource* res = &graph->resources[r];
+			// Aliased memory: the new owner waits for the old owner's last accesses, contents are discarded
+			if (!res->imported && res->firstPass == (int32_t)p)
+			{
+				if (res->aliasPrevious != RG_INVALID)
+				{
+					const RgState* prev = &graph->resources[res->aliasPrevious].state;
+					res->state.readMask = prev->readMask | (prev->lastWrite != RG_ACCESS_NONE ? RG_BIT(prev->lastWrite) : 0);
+				}
+				else
+				{
+					res->state.readMask = carried[res->memorySlot];
+				}
+			}
+			planAccess(graph, r, pass->uses[u].access);
+		}
+		pass->barrierCount = graph->barrierCount - pass->firstBarrier;
+	}
+
+	graph->finalBarrier = graph->barrierCount;
+	for (uint32_t i = 0; i < graph->resourceCount; ++i)
+	{
+		RgResource* res = &graph->resources[i];
+		if (res->imported && res->finalAccess != RG_ACCESS_NONE)
+			planAccess(graph, i, res->finalAccess);
+	}
+	graph->finalBarrierCount = graph->barrierCount - graph->finalBarrier;
+}
+
+void rgExecute(RenderGraph* graph, void* cmd)
+{
+	assert(graph->compiled);
+	planBarriers(graph);
+
+	graph->stats.barriers = graph->barrierCount;
+	graph->stats.barrierBatches = 0;
+	for (uint32_t p = 0; p < graph->passCount; ++p)
+	{
+		RgPass* pass = &graph->passes[p];
+		if (pass->culled)
+			continue;
+		if (graph->backend.cmdPassBegin)
+			graph->backend.cmdPassBegin(graph->backend.user, cmd, graph, p);
+		if (pass->barrierCount)
+		{
+			graph->backend.cmdBarriers(graph->backend.user, cmd, graph, &graph->barriers[pass->firstBarrier], pass->barrierCount);
+			graph->stats.barrierBatches++;
+		}
+		if (pass->execute)
+			pass->execute(cmd, graph, pass->userData);
+		if (graph->backend.cmdPassEnd)
+			graph->backend.cmdPassEnd(graph->backend.user, cmd, graph, p);
+	}
+	if (graph->finalBarrierCount)
+	{
+		graph->backend.cmdBarriers(graph->backend.user, cmd, graph, &graph->barriers[graph->finalBarrier], graph->finalBarrierCount);
+		graph->stats.barrierBatches++;
+	}
+
+	for (uint32_t i = 0; i < graph->resourceCount; ++i)
+	{
+		RgResource* res = &graph->resources[i];
+		if (res->imported && res->externalState)
+			*res->externalState = res->state;
+	}
+}
+
+void* rgGetHandle(const RenderGraph* graph, uint32_t resource)
+{
+	return graph->resources[resource].handle;
+}
+
+void* rgGetView(const RenderGraph* graph, uint32_t resource)
+{
+	return graph->resources[resource].view;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+// Frame graph: passes declare how they access images and buffers, the graph culls
+// passes nobody consumes, aliases transient memory and emits one barrier batch per pass.
+// The core knows nothing about Vulkan; everything API-specific goes through RgBackend,
+// so compile/execute can be driven on the CPU with a mock backend.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RG_MAX_RESOURCES 64
+#define RG_MAX_PASSES 32
+#define RG_MAX_PASS_USES 16
+#define RG_MAX_BARRIERS (RG_MAX_PASSES * RG_MAX_PASS_USES + RG_MAX_RESOURCES)
+#define RG_INVALID UINT32_MAX
+
+typedef enum RgAccess
+{
+	RG_ACCESS_NONE = 0,
+	RG_ACCESS_COLOR_ATTACHMENT_WRITE,      // cleared / overwritten
+	RG_ACCESS_COLOR_ATTACHMENT_READ_WRITE, // loaded then written (overlays, blending)
+	RG_ACCESS_DEPTH_ATTACHMENT_WRITE,
+	RG_ACCESS_DEPTH_ATTACHMENT_READ,
+	RG_ACCESS_SAMPLED_FRAGMENT,
+	RG_ACCESS_SAMPLED_COMPUTE,
+	RG_ACCESS_STORAGE_READ_COMPUTE,
+	RG_ACCESS_STORAGE_WRITE_COMPUTE,
+	RG_ACCESS_STORAGE_READ_WRITE_COMPUTE,
+	RG_ACCESS_STORAGE_READ_VERTEX,
+	RG_ACCESS_STORAGE_READ_FRAGMENT,
+	RG_ACCESS_VERTEX_ATTRIBUTE_READ,
+	RG_ACCESS_INDIRECT_READ,
+	RG_ACCESS_TRANSFER_READ,
+	RG_ACCESS_TRANSFER_WRITE,
+	RG_ACCESS_PRESENT,
+	RG_ACCESS_COUNT
+} RgAccess;
+
+typedef enum RgLayout
+{
+	RG_LAYOUT_UNDEFINED = 0,
+	RG_LAYOUT_GENERAL,
+	RG_LAYOUT_COLOR_ATTACHMENT,
+	RG_LAYOUT_DEPTH_ATTACHMENT,
+	RG_LAYOUT_DEPTH_READ_ONLY,
+	RG_LAYOUT_SHADER_READ_ONLY,
+	RG_LAYOUT_TRANSFER_SRC,
+	RG_LAYOUT_TRANSFER_DST,
+	RG_LAYOUT_PRESENT,
+} RgLayout;
+
+typedef enum RgResourceKind
+{
+	RG_RESOURCE_IMAGE,
+	RG_RESOURCE_BUFFER,
+} RgResourceKind;
+
+// Synchronization state of a resource. Imported resources keep theirs outside the
+// graph so it carries over between frames.
+typedef struct RgState
+{
+	RgAccess lastWrite;
+	uint32_t readMask; // (1 << RgAccess) of every read since lastWrite
+	RgLayout layout;
+} RgState;
+
+typedef struct RgImageDesc
+{
+	uint32_t width, height;
+	uint32_t mipLevels, arrayLayers;
+	uint32_t format; // VkFormat
+	uint32_t usage;  // VkImageUsageFlags
+	bool depth;      // depth aspect instead of color
+} RgImageDesc;
+
+typedef struct RgBarrier
+{
+	uint32_t resource;
+	uint32_t srcAccessMask; // (1 << RgAccess) bits
+	uint32_t dstAccessMask;
+	RgLayout oldLayout;
+	RgLayout newLayout;
+} RgBarrier;
+
+typedef struct RgMemoryRequirements
+{
+	uint64_t size;
+	uint64_t alignment;
+	uint32_t typeBits;
+} RgMemoryRequirements;
+
+struct RenderGraph;
+
+typedef struct RgBackend
+{
+	void* user;
+	// Creates an unbound transient image and reports what memory it needs
+	void* (*createImage)(void* user, const RgImageDesc* desc, RgMemoryRequirements* outRequirements);
+	void* (*allocateMemory)(void* user, uint64_t size, uint32_t typeBits);
+	// Binds the image at offset and returns its view
+	void* (*bindImage)(void* user, void* image, const RgImageDesc* desc, void* memory, uint64_t offset);
+	void (*destroyImage)(void* user, void* image, void* view);
+	void (*freeMemory)(void* user, void* memory);
+	void (*cmdBarriers)(void* user, void* cmd, const struct RenderGraph* graph, const RgBarrier* barriers, uint32_t count);
+	// Optional; bracket each executed pass, its barrier batch included (profiling, debug labels)
+	void (*cmdPassBegin)(void* user, void* cmd, const struct RenderGraph* graph, uint32_t pass);
+	void (*cmdPassEnd)(void* user, void* cmd, const struct RenderGraph* graph, uint32_t pass);
+} RgBackend;
+
+typedef void (*RgExecuteFn)(void* cmd, const struct RenderGraph* graph, void* userData);
+
+typedef struct RgUse
+{
+	uint32_t resource;
+	RgAccess access;
+} RgUse;
+
+typedef struct RgPass
+{
+	const char* name;
+	RgUse uses[RG_MAX_PASS_USES];
+	uint32_t useCount;
+	RgExecuteFn execute;
+	void* userData;
+	bool sideEffects; // keep even if nothing reads its outputs
+	bool culled;
+	uint32_t firstBarrier, barrierCount;
+} RgPass;
+
+typedef struct RgResource
+{
+	const char* name;
+	RgResourceKind kind;
+	bool imported;
+	RgImageDesc image;
+	void* handle; // VkImage / VkBuffer
+	void* view;   // VkImageView for images
+	RgState* externalState; // imported only
+	RgAccess finalAccess;   // imported only: access to leave it in after the last pass
+
+	// Compile results
+	RgState state;
+	int32_t firstPass, lastPass;
+	uint32_t memorySlot;
+	uint32_t aliasPrevious; // resource that used the same memory before this one
+	uint64_t size;
+} RgResource;
+
+typedef struct RgMemorySlot
+{
+	uint64_t size;
+	uint64_t alignment;
+	uint32_t typeBits;
+	int32_t lastPass;
+	uint32_t lastResource;
+	void* memory;
+} RgMemorySlot;
+
+typedef struct RgStats
+{
+	uint32_t passes;
+	uint32_t culledPasses;
+	uint32_t barriers;
+	uint32_t barrierBatches;
+	uint64_t transientBytes; // sum of every transient's size
+	uint64_t allocatedBytes; // memory actually allocated after aliasing
+} RgStats;
+
+typedef struct RenderGraph
+{
+	RgBackend backend;
+	RgResource resources[RG_MAX_RESOURCES];
+	uint32_t resourceCount;
+	RgPass passes[RG_MAX_PASSES];
+	uint32_t passCount;
+	RgMemorySlot slots[RG_MAX_RESOURCES];
+	uint32_t slotCount;
+	RgBarrier barriers[RG_MAX_BARRIERS];
+	uint32_t barrierCount;
+	uint32_t finalBarrier, finalBarrierCount;
+	bool compiled;
+	RgStats stats;
+} RenderGraph;
+
+void rgInit(RenderGraph* graph, const RgBackend* backend);
+// Frees transient memory and forgets every pass and resource
+void rgDestroy(RenderGraph* graph);
+
+uint32_t rgImportImage(RenderGraph* graph, const char* name, const RgImageDesc* desc, void* image, void* view, RgState* state, RgAccess finalAccess);
+uint32_t rgImportBuffer(RenderGraph* graph, const char* name, void* buffer, RgState* state);
+// Swaps the handles of an imported resource (e.g. the acquired swapchain image)
+void rgUpdateImport(RenderGraph* graph, uint32_t resource, void* handle, void* view, RgState* state);
+uint32_t rgCreateImage(RenderGraph* graph, const char* name, const RgImageDesc* desc);
+
+uint32_t rgAddPass(RenderGraph* graph, const char* name, RgExecuteFn execute, void* userData);
+void rgPassUse(RenderGraph* graph, uint32_t pass, uint32_t resource, RgAccess access);
+void rgPassSideEffects(RenderGraph* graph, uint32_t pass);
+
+// Culls passes, computes transient lifetimes and creates aliased transient resources
+bool rgCompile(RenderGraph* graph);
+// Plans barriers from the current imported states, records every live pass, then
+// writes the final states back to the imported resources.
+void rgExecute(RenderGraph* graph, void* cmd);
+
+void* rgGetHandle(const RenderGraph* graph, uint32_t resource);
+void* rgGetView(const RenderGraph* graph, uint32_t resource);
+
+bool rgAccessIsWrite(RgAccess access);
+RgLayout rgAccessLayout(RgAccess access);
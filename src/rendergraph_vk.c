@@ -0,0 +1,233 @@
+#include "main.h"
+
+// Vulkan backend for the render graph: transient images come from aliased device-local
+// memory and every barrier batch becomes one vkCmdPipelineBarrier2. Each pass is a named GPU
+// timer range.
+
+typedef struct RgVkAccess
+{
+	VkPipelineStageFlags2 stage;
+	VkAccessFlags2 access;
+} RgVkAccess;
+
+static const RgVkAccess rgVkAccessTable[RG_ACCESS_COUNT] = {
+    [RG_ACCESS_NONE] = {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE},
+    [RG_ACCESS_COLOR_ATTACHMENT_WRITE] = {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT},
+    [RG_ACCESS_COLOR_ATTACHMENT_READ_WRITE] = {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT},
+    [RG_ACCESS_DEPTH_ATTACHMENT_WRITE] = {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT},
+    [RG_ACCESS_DEPTH_ATTACHMENT_READ] = {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT},
+    [RG_ACCESS_SAMPLED_FRAGMENT] = {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT},
+    [RG_ACCESS_SAMPLED_COMPUTE] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT},
+    [RG_ACCESS_STORAGE_READ_COMPUTE] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT},
+    [RG_ACCESS_STORAGE_WRITE_COMPUTE] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT},
+    [RG_ACCESS_STORAGE_READ_WRITE_COMPUTE] = {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT},
+    [RG_ACCESS_STORAGE_READ_VERTEX] = {VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT},
+    [RG_ACCESS_STORAGE_READ_FRAGMENT] = {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT},
+    [RG_ACCESS_VERTEX_ATTRIBUTE_READ] = {VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT},
+    [RG_ACCESS_INDIRECT_READ] = {VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT},
+    [RG_ACCESS_TRANSFER_READ] = {VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT},
+    [RG_ACCESS_TRANSFER_WRITE] = {VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT},
+    // As a source this is the acquire semaphore's wait stage; as a destination nothing waits
+    [RG_ACCESS_PRESENT] = {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE},
+};
+
+static VkImageLayout rgVkLayout(RgLayout layout)
+{
+	switch (layout)
+	{
+	case RG_LAYOUT_GENERAL: return VK_IMAGE_LAYOUT_GENERAL;
+	case RG_LAYOUT_COLOR_ATTACHMENT: return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	case RG_LAYOUT_DEPTH_ATTACHMENT: return VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+	case RG_LAYOUT_DEPTH_READ_ONLY: return VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+	case RG_LAYOUT_SHADER_READ_ONLY: return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	case RG_LAYOUT_TRANSFER_SRC: return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	case RG_LAYOUT_TRANSFER_DST: return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	case RG_LAYOUT_PRESENT: return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	default: return VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+}
+
+static void rgVkMasks(uint32_t accessBits, bool source, VkPipelineStageFlags2* stage, VkAccessFlags2* access)
+{
+	*stage = VK_PIPELINE_STAGE_2_NONE;
+	*access = VK_ACCESS_2_NONE;
+	for (u32 a = 0; a < RG_ACCESS_COUNT; ++a)
+	{
+		if (!(accessBits & (1u << a)))
+			continue;
+		if (!source && a == RG_ACCESS_PRESENT)
+			continue;
+		*stage |= rgVkAccessTable[a].stage;
+		// Only writes need to be made available; reads only need the execution dependency
+		if (!source || rgAccessIsWrite((RgAccess)a))
+			*access |= rgVkAccessTable[a].access;
+	}
+}
+
+static void* rgVkCreateImage(void* user, const RgImageDesc* desc, RgMemoryRequirements* outRequirements)
+{
+	Application* app = user;
+	VkImageCreateInfo imageInfo = {
+	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+	    .imageType = VK_IMAGE_TYPE_2D,
+	    .format = (VkFormat)desc->format,
+	    .extent = {desc->width, desc->height, 1},
+	    .mipLevels = desc->mipLevels,
+	    .arrayLayers = desc->arrayLayers,
+	    .samples = VK_SAMPLE_COUNT_1_BIT,
+	    .tiling = VK_IMAGE_TILING_OPTIMAL,
+	    .usage = desc->usage,
+	    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+	    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+
+	VkImage image;
+	VK_CHECK(vkCreateImage(app->device, &imageInfo, NULL, &image));
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(app->device, image, &memRequirements);
+	outRequirements->size = memRequirements.size;
+	outRequirements->alignment = memRequirements.alignment;
+	outRequirements->typeBits = memRequirements.memoryTypeBits;
+	return (void*)image;
+}
+
+static void* rgVkAllocateMemory(void* user, uint64_t size, uint32_t typeBits)
+{
+	Application* app = user;
+	VkMemoryAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+	    .allocationSize = size,
+	    .memoryTypeIndex = selectmemorytype(&app->memoryProperties, typeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)};
+
+	VkDeviceMemory memory;
+	VK_CHECK(vkAllocateMemory(app->device, &allocInfo, NULL, &memory));
+	tagDeviceMemory(memory, DEVICE_MEMORY_RENDER_TARGETS);
+	return (void*)memory;
+}
+
+static void* rgVkBindImage(void* user, void* image, const RgImageDesc* desc, void* memory, uint64_t offset)
+{
+	Application* app = user;
+	VK_CHECK(vkBindImageMemory(app->device, (VkImage)image, (VkDeviceMemory)memory, offset));
+
+	VkImageViewCreateInfo viewInfo = {
+	    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+	    .image = (VkImage)image,
+	    .viewType = VK_IMAGE_VIEW_TYPE_2D,
+	    .format = (VkFormat)desc->format,
+	    .subresourceRange = {
+	        .aspectMask = desc->depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT,
+	        .baseMipLevel = 0,
+	        .levelCount = desc->mipLevels,
+	        .baseArrayLayer = 0,
+	        .layerCount = desc->arrayLayers}};
+
+	VkImageView view;
+	VK_CHECK(vkCreateImageView(app->device, &viewInfo, NULL, &view));
+	return (void*)view;
+}
+
+// Graphs are torn down and rebuilt while earlier frames still use their attachments
+static void rgVkDestroyImage(void* user, void* image, void* view)
+{
+	Application* app = user;
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_IMAGE_VIEW, .view = (VkImageView)view});
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_IMAGE, .image = (VkImage)image});
+}
+
+static void rgVkFreeMemory(void* user, void* memory)
+{
+	Application* app = user;
+	deferDestroy(app, (DeferredDeletion){.kind = DEFERRED_MEMORY, .memory = (VkDeviceMemory)memory});
+}
+
+static void rgVkCmdBarriers(void* user, void* cmd, const RenderGraph* graph, const RgBarrier* barriers, uint32_t count)
+{
+	(void)user;
+	VkImageMemoryBarrier2 imageBarriers[RG_MAX_PASS_USES + RG_MAX_RESOURCES];
+	VkBufferMemoryBarrier2 bufferBarriers[RG_MAX_PASS_USES + RG_MAX_RESOURCES];
+	u32 imageCount = 0, bufferCount = 0;
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		const RgBarrier* b = &barriers[i];
+		const RgResource* res = &graph->resources[b->resource];
+		VkPipelineStageFlags2 srcStage, dstStage;
+		VkAccessFlags2 srcAccess, dstAccess;
+		rgVkMasks(b->srcAccessMask, true, &srcStage, &srcAccess);
+		rgVkMasks(b->dstAccessMask, false, &dstStage, &dstAccess);
+
+		if (res->kind == RG_RESOURCE_BUFFER)
+		{
+			bufferBarriers[bufferCount++] = (VkBufferMemoryBarrier2){
+			    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+			    .srcStageMask = srcStage,
+			    .srcAccessMask = srcAccess,
+			    .dstStageMask = dstStage,
+			    .dstAccessMask = dstAccess,
+			    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			    .buffer = (VkBuffer)res->handle,
+			    .offset = 0,
+			    .size = VK_WHOLE_SIZE,
+			};
+			continue;
+		}
+
+		imageBarriers[imageCount++] = (VkImageMemoryBarrier2){
+		    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		    .srcStageMask = srcStage,
+		    .srcAccessMask = srcAccess,
+		    .dstStageMask = dstStage,
+		    .dstAccessMask = dstAccess,
+		    .oldLayout = rgVkLayout(b->oldLayout),
+		    .newLayout = rgVkLayout(b->newLayout),
+		    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		    .image = (VkImage)res->handle,
+		    .subresourceRange = {
+		        .aspectMask = res->image.depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT,
+		        .baseMipLevel = 0,
+		        .levelCount = VK_REMAINING_MIP_LEVELS,
+		        .baseArrayLayer = 0,
+		        .layerCount = VK_REMAINING_ARRAY_LAYERS,
+		    },
+		};
+	}
+
+	VkDependencyInfo dependencyInfo = {
+	    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+	    .bufferMemoryBarrierCount = bufferCount,
+	    .pBufferMemoryBarriers = bufferBarriers,
+	    .imageMemoryBarrierCount = imageCount,
+	    .pImageMemoryBarriers = imageBarriers,
+	};
+	vkCmdPipelineBarrier2((VkCommandBuffer)cmd, &dependencyInfo);
+}
+
+static void rgVkCmdPassBegin(void* user, void* cmd, const RenderGraph* graph, uint32_t pass)
+{
+	gpuTimerPushRange((Application*)user, (VkCommandBuffer)cmd, graph->passes[pass].name);
+}
+
+static void rgVkCmdPassEnd(void* user, void* cmd, const RenderGraph* graph, uint32_t pass)
+{
+	(void)graph;
+	(void)pass;
+	gpuTimerPopRange((Application*)user, (VkCommandBuffer)cmd);
+}
+
+RgBackend rgVulkanBackend(Application* app)
+{
+	return (RgBackend){
+	    .user = app,
+	    .createImage = rgVkCreateImage,
+	    .allocateMemory = rgVkAllocateMemory,
+	    .bindImage = rgVkBindImage,
+	    .destroyImage = rgVkDestroyImage,
+	    .freeMemory = rgVkFreeMemory,
+	    .cmdBarriers = rgVkCmdBarriers,
+	    .cmdPassBegin = rgVkCmdPassBegin,
+	    .cmdPassEnd = rgVkCmdPassEnd,
+	};
+}
@@ -0,0 +1,249 @@
+#include "main.h"
+
+// Resource registry. Every GPU object the scene owns is registered here and referred to by a
+// generational handle rather than a raw Vulkan handle or a material number. Lookups are O(1)
+// and a handle to something already destroyed looks up as VK_NULL_HANDLE instead of whatever
+// took its slot, so assets can be streamed in and out while handles to them are still around.
+// Main thread only.
+
+void resourcesInit(Application* app)
+{
+	ResourceRegistry* resources = &app->resources;
+	memset(resources, 0, sizeof(*resources));
+
+	ImagePool* images = &resources->images;
+	poolAddColumn(&images->pool, &images->images, sizeof(VkImage));
+	poolAddColumn(&images->pool, &images->views, sizeof(VkImageView));
+	poolAddColumn(&images->pool, &images->memories, sizeof(VkDeviceMemory));
+
+	SamplerPool* samplers = &resources->samplers;
+	poolAddColumn(&samplers->pool, &samplers->samplers, sizeof(VkSampler));
+
+	BufferPool* buffers = &resources->buffers;
+	poolAddColumn(&buffers->pool, &buffers->buffers, sizeof(VkBuffer));
+	poolAddColumn(&buffers->pool, &buffers->memories, sizeof(VkDeviceMemory));
+	poolAddColumn(&buffers->pool, &buffers->mapped, sizeof(void*));
+	poolAddColumn(&buffers->pool, &buffers->sizes, sizeof(VkDeviceSize));
+
+	PipelinePool* pipelines = &resources->pipelines;
+	poolAddColumn(&pipelines->pool, &pipelines->pipelines, sizeof(VkPipeline));
+
+	MaterialPool* materials = &resources->materials;
+	for (u32 slot = 0; slot < MATERIAL_TEXTURE_SLOT_COUNT; ++slot)
+	{
+		poolAddColumn(&materials->pool, &materials->textures[slot], sizeof(ImageHandle));
+		poolAddColumn(&materials->pool, &materials->samplers[slot], sizeof(SamplerHandle));
+	}
+	poolAddColumn(&materials->pool, &materials->uniforms, sizeof(BufferHandle));
+	poolAddColumn(&materials->pool, &materials->descriptorSets, sizeof(VkDescriptorSet));
+	poolAddColumn(&materials->pool, &materials->pipelines, sizeof(PipelineHandle));
+	poolAddColumn(&materials->pool, &materials->prepassPipelines, sizeof(PipelineHandle));
+}
+
+// Destroys whatever is still registered. The GPU must be idle; descriptor sets go with the pool.
+void resourcesDestroy(Application* app)
+{
+	ResourceRegistry* resources = &app->resources;
+
+	// Materials only hold handles into the other pools, which are torn down below
+	poolDestroy(&resources->materials.pool);
+
+	ImagePool* images = &resources->images;
+	for (u32 i = 0; i < images->pool.count; ++i)
+	{
+		vkDestroyImageView(app->device, images->views[i], NULL);
+		vkDestroyImage(app->device, images->images[i], NULL);
+		vkFreeMemory(app->device, images->memories[i], NULL);
+	}
+	poolDestroy(&images->pool);
+
+	SamplerPool* samplers = &resources->samplers;
+	for (u32 i = 0; i < samplers->pool.count; ++i)
+		vkDestroySampler(app->device, samplers->samplers[i], NULL);
+	poolDestroy(&samplers->pool);
+
+	BufferPool* buffers = &resources->buffers;
+	for (u32 i = 0; i < buffers->pool.count; ++i)
+	{
+		vkDestroyBuffer(app->device, buffers->buffers[i], NULL);
+		vkFreeMemory(app->device, buffers->memories[i], NULL);
+	}
+	poolDestroy(&buffers->pool);
+
+	PipelinePool* pipelines = &resources->pipelines;
+	for (u32 i = 0; i < pipelines->pool.count; ++i)
+		vkDestroyPipeline(app->device, pipelines->pipelines[i], NULL);
+	poolDestroy(&pipelines->pool);
+}
+
+// --- Images ---
+
+// Takes ownership of the image, its view and its memory
+ImageHandle resourcesAddImage(Application* app, VkImage image, VkImageView view, VkDeviceMemory memory)
+{
+	ImagePool* images = &app->resources.images;
+	u32 index;
+	ImageHandle handle = {poolAdd(&images->pool, &index)};
+	images->images[index] = image;
+	images->views[index] = view;
+	images->memories[index] = memory;
+	return handle;
+}
+
+VkImageView resourcesImageView(const Application* app, ImageHandle image)
+{
+	const ImagePool* images = &app->resources.images;
+	u32 index = poolIndex(&images->pool, image.id);
+	return index != POOL_INVALID ? images->views[index] : VK_NULL_HANDLE;
+}
+
+void resourcesDestroyImage(Application* app, ImageHandle image)
+{
+	ImagePool* images = &app->resources.images;
+	u32 index = poolIndex(&images->pool, image.id);
+	if (index == POOL_INVALID)
+		return;
+	vkDestroyImageView(app->device, images->views[index], NULL);
+	vkDestroyImage(app->device, images->images[index], NULL);
+	vkFreeMemory(app->device, images->memories[index], NULL);
+	poolRemove(&images->pool, image.id);
+}
+
+// --- Samplers ---
+
+SamplerHandle resourcesAddSampler(Application* app, VkSampler sampler)
+{
+	SamplerPool* samplers = &app->resources.samplers;
+	u32 index;
+	SamplerHandle handle = {poolAdd(&samplers->pool, &index)};
+	samplers->samplers[index] = sampler;
+	return handle;
+}
+
+VkSampler resourcesSampler(const Application* app, SamplerHandle sampler)
+{
+	const SamplerPool* samplers = &app->resources.samplers;
+	u32 index = poolIndex(&samplers->pool, sampler.id);
+	return index != POOL_INVALID ? samplers->samplers[index] : VK_NULL_HANDLE;
+}
+
+void resourcesDestroySampler(Application* app, SamplerHandle sampler)
+{
+	SamplerPool* samplers = &app->resources.samplers;
+	u32 index = poolIndex(&samplers->pool, sampler.id);
+	if (index == POOL_INVALID)
+		return;
+	vkDestroySampler(app->device, samplers->samplers[index], NULL);
+	poolRemove(&samplers->pool, sampler.id);
+}
+
+// --- Buffers ---
+
+// Takes ownership of the buffer and its memory; *buffer is cleared
+BufferHandle resourcesAddBuffer(Application* app, Buffer* buffer)
+{
+	BufferPool* buffers = &app->resources.buffers;
+	u32 index;
+	BufferHandle handle = {poolAdd(&buffers->pool, &index)};
+	buffers->buffers[index] = buffer->vkbuffer;
+	buffers->memories[index] = buffer->memory;
+	buffers->mapped[index] = buffer->data;
+	buffers->sizes[index] = buffer->size;
+	memset(buffer, 0, sizeof(*buffer));
+	return handle;
+}
+
+VkBuffer resourcesBuffer(const Application* app, BufferHandle buffer)
+{
+	const BufferPool* buffers = &app->resources.buffers;
+	u32 index = poolIndex(&buffers->pool, buffer.id);
+	return index != POOL_INVALID ? buffers->buffers[index] : VK_NULL_HANDLE;
+}
+
+void resourcesDestroyBuffer(Application* app, BufferHandle buffer)
+{
+	BufferPool* buffers = &app->resources.buffers;
+	u32 index = poolIndex(&buffers->pool, buffer.id);
+	if (index == POOL_INVALID)
+		return;
+	vkDestroyBuffer(app->device, buffers->buffers[index], NULL);
+	vkFreeMemory(app->device, buffers->memories[index], NULL);
+	poolRemove(&buffers->pool, buffer.id);
+}
+
+// --- Pipelines ---
+
+PipelineHandle resourcesAddPipeline(Application* app, VkPipeline pipeline)
+{
+	PipelinePool* pipelines = &app->resources.pipelines;
+	u32 index;
+	PipelineHandle handle = {poolAdd(&pipelines->pool, &index)};
+	pipelines->pipelines[index] = pipeline;
+	return handle;
+}
+
+VkPipeline resourcesPipeline(const Application* app, PipelineHandle pipeline)
+{
+	const PipelinePool* pipelines = &app->resources.pipelines;
+	u32 index = poolIndex(&pipelines->pool, pipeline.id);
+	return index != POOL_INVALID ? pipelines->pipelines[index] : VK_NULL_HANDLE;
+}
+
+void resourcesDestroyPipeline(Application* app, PipelineHandle pipeline)
+{
+	PipelinePool* pipelines = &app->resources.pipelines;
+	u32 index = poolIndex(&pipelines->pool, pipeline.id);
+	if (index == POOL_INVALID)
+		return;
+	vkDestroyPipeline(app->device, pipelines->pipelines[index], NULL);
+	poolRemove(&pipelines->pool, pipeline.id);
+}
+
+// --- Materials ---
+
+// Starts with no textures, uniform buffer, descriptor set or pipelines
+MaterialHandle resourcesAddMaterial(Application* app)
+{
+	u32 index;
+	return (MaterialHandle){poolAdd(&app->resources.materials.pool, &index)};
+}
+
+u32 resourcesMaterialIndex(const Application* app, MaterialHandle material)
+{
+	return poolIndex(&app->resources.materials.pool, material.id);
+}
+
+// Registers texture's image and sampler for the slot and returns the ones they replace, which
+// may still be in use by a frame in flight
+void resourcesSetMaterialTexture(Application* app, MaterialHandle material, MaterialTextureSlot slot, Texture* texture, ImageHandle* oldImage, SamplerHandle* oldSampler)
+{
+	ImageHandle image = resourcesAddImage(app, texture->image, texture->view, texture->memory);
+	SamplerHandle sampler = resourcesAddSampler(app, texture->sampler);
+	memset(texture, 0, sizeof(*texture));
+
+	MaterialPool* materials = &app->resources.materials;
+	u32 index = poolIndex(&materials->pool, material.id);
+	assert(index != POOL_INVALID && "texture for a destroyed material");
+	*oldImage = materials->textures[slot][index];
+	*oldSampler = materials->samplers[slot][index];
+	materials->textures[slot][index] = image;
+	materials->samplers[slot][index] = sampler;
+}
+
+// Destroys everything the material owns right away; pipelines are shared and stay
+void resourcesDestroyMaterial(Application* app, MaterialHandle material)
+{
+	MaterialPool* materials = &app->resources.materials;
+	u32 index = poolIndex(&materials->pool, material.id);
+	if (index == POOL_INVALID)
+		return;
+	for (u32 slot = 0; slot < MATERIAL_TEXTURE_SLOT_COUNT; ++slot)
+	{
+		resourcesDestroyImage(app, materials->textures[slot][index]);
+		resourcesDestroySampler(app, materials->samplers[slot][index]);
+	}
+	resourcesDestroyBuffer(app, materials->uniforms[index]);
+	if (materials->descriptorSets[index] != VK_NULL_HANDLE)
+		vkFreeDescriptorSets(app->device, app->descriptorPool, 1, &materials->descriptorSets[index]);
+	poolRemove(&materials->pool, material.id);
+}
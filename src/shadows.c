@@ -0,0 +1,286 @@
+#include "main.h"
+
+#include <float.h>
+
+// Cascaded shadow maps for dirLight.
+// Each cascade is fitted to the bounding sphere of its view frustum slice, so its size does
+// not change as the camera turns, and its center is snapped to whole shadow texels in light
+// space so edges don't shimmer while moving. Cascades from SHADOW_CACHED_FIRST on snap to a
+// much coarser grid (with a matching margin) and keep their depth until the light turns or
+// the grid cell changes. That assumes static casters: the scene mesh is never moved or edited
+// after attachScene (which re-renders every cascade) and particles don't cast, so nothing else
+// has to mark a cascade dirty.
+
+#define SHADOW_SPLIT_LAMBDA 0.75f // blend between logarithmic (1) and uniform (0) splits
+#define SHADOW_CACHE_STEP 0.25f   // recenter step of cached cascades, fraction of the radius
+
+static void computeCascadeSplits(float zNear, float zFar, float splits[SHADOW_CASCADE_COUNT])
+{
+	for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		float p = (float)(i + 1) / SHADOW_CASCADE_COUNT;
+		float logSplit = zNear * powf(zFar / zNear, p);
+		float uniformSplit = zNear + (zFar - zNear) * p;
+		splits[i] = glm_lerp(uniformSplit, logSplit, SHADOW_SPLIT_LAMBDA);
+	}
+}
+
+// Light-view box of a world-space AABB
+static void lightSpaceBounds(Application* app, const vec3 worldMin, const vec3 worldMax, vec3 outMin, vec3 outMax)
+{
+	glm_vec3_fill(outMin, FLT_MAX);
+	glm_vec3_fill(outMax, -FLT_MAX);
+	for (int k = 0; k < 8; ++k)
+	{
+		vec3 corner = {(k & 1) ? worldMax[0] : worldMin[0], (k & 2) ? worldMax[1] : worldMin[1], (k & 4) ? worldMax[2] : worldMin[2]};
+		vec3 p;
+		glm_mat4_mulv3(app->shadowLightView, corner, 1.0f, p);
+		glm_vec3_minv(outMin, p, outMin);
+		glm_vec3_maxv(outMax, p, outMax);
+	}
+}
+
+static bool boxesOverlap(const vec3 aMin, const vec3 aMax, const vec3 bMin, const vec3 bMax)
+{
+	return aMin[0] <= bMax[0] && aMax[0] >= bMin[0] &&
+	       aMin[1] <= bMax[1] && aMax[1] >= bMin[1] &&
+	       aMin[2] <= bMax[2] && aMax[2] >= bMin[2];
+}
+
+void createShadowResources(Application* app)
+{
+	app->shadowsEnabled = true;
+	app->shadowCacheEnabled = true;
+	app->shadowDistance = SHADOW_DEFAULT_DISTANCE;
+
+	VkImageCreateInfo imageInfo = {
+	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+	    .imageType = VK_IMAGE_TYPE_2D,
+	    .format = SHADOW_MAP_FORMAT,
+	    .extent = {SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1},
+	    .mipLevels = 1,
+	    .arrayLayers = SHADOW_CASCADE_COUNT,
+	    .samples = VK_SAMPLE_COUNT_1_BIT,
+	    .tiling = VK_IMAGE_TILING_OPTIMAL,
+	    .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+	    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+	};
+	VK_CHECK(vkCreateImage(app->device, &imageInfo, NULL, &app->shadowMap));
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(app->device, app->shadowMap, &memRequirements);
+	VkMemoryAllocateInfo allocInfo = {
+	    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+	    .allocationSize = memRequirements.size,
+	    .memoryTypeIndex = selectmemorytype(&app->memoryProperties, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+	};
+	VK_CHECK(vkAllocateMemory(app->device, &allocInfo, NULL, &app->shadowMapMemory));
+	VK_CHECK(vkBindImageMemory(app->device, app->shadowMap, app->shadowMapMemory, 0));
+
+	VkImageViewCreateInfo viewInfo = {
+	    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+	    .image = app->shadowMap,
+	    .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+	    .format = SHADOW_MAP_FORMAT,
+	    .subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, SHADOW_CASCADE_COUNT},
+	};
+	VK_CHECK(vkCreateImageView(app->device, &viewInfo, NULL, &app->shadowMapView));
+	for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.subresourceRange.baseArrayLayer = i;
+		viewInfo.subresourceRange.layerCount = 1;
+		VK_CHECK(vkCreateImageView(app->device, &viewInfo, NULL, &app->shadowLayerViews[i]));
+	}
+
+	// Hardware PCF: the compare result is filtered across the 2x2 footprint
+	VkSamplerCreateInfo samplerInfo = {
+	    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+	    .magFilter = VK_FILTER_LINEAR,
+	    .minFilter = VK_FILTER_LINEAR,
+	    .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+	    .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+	    .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+	    .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+	    .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+	    .compareEnable = VK_TRUE,
+	    .compareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+	    .maxLod = 1.0f,
+	};
+	VK_CHECK(vkCreateSampler(app->device, &samplerInfo, NULL, &app->shadowSampler));
+
+	VkPushConstantRange pushRange = {.stageFlags = VK_SHADER_STAGE_VERTEX_BIT, .offset = 0, .size = sizeof(mat4)};
+	VkPipelineLayoutCreateInfo layoutInfo = {
+	    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+	    .pushConstantRangeCount = 1,
+	    .pPushConstantRanges = &pushRange,
+	};
+	VK_CHECK(vkCreatePipelineLayout(app->device, &layoutInfo, NULL, &app->shadowPipelineLayout));
+
+	VkShaderModule vertShader = LoadShaderModule(app->io, "compiledshaders/shadow.vert.spv", app->device);
+	app->shadowPipeline = createShadowPipeline(app, vertShader);
+	vkDestroyShaderModule(app->device, vertShader, NULL);
+
+	for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+		app->cascades[i].dirty = true;
+}
+
+void updateShadowCascades(Application* app, mat4 view)
+{
+	if (!app->shadowsEnabled)
+	{
+		// Nothing is rendered meanwhile, so everything is stale once shadows come back
+		for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+			app->cascades[i].dirty = true;
+		return;
+	}
+
+	vec3 lightDir;
+	glm_vec3_normalize_to(app->dirLight.direction, lightDir);
+	vec3 up = {0.0f, 1.0f, 0.0f};
+	if (fabsf(lightDir[1]) > 0.99f)
+		glm_vec3_copy((vec3){0.0f, 0.0f, 1.0f}, up);
+	glm_lookat((vec3){0.0f, 0.0f, 0.0f}, lightDir, up, app->shadowLightView);
+
+	// Every cascade spans the scene's whole depth along the light so off-screen casters still land in it
+	vec3 sceneMin, sceneMax;
+	lightSpaceBounds(app, app->sceneMin, app->sceneMax, sceneMin, sceneMax);
+
+	mat4 invView;
+	glm_mat4_inv(view, invView);
+	float tanY = tanf(glm_rad(CAMERA_FOV_Y_DEGREES) * 0.5f);
+	float tanX = tanY * app->width / (float)app->height;
+	float splits[SHADOW_CASCADE_COUNT];
+	computeCascadeSplits(CAMERA_Z_NEAR, app->shadowDistance, splits);
+
+	float zStart = CAMERA_Z_NEAR;
+	for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		ShadowCascade* cascade = &app->cascades[i];
+		float zEnd = splits[i];
+
+		vec3 corners[8];
+		vec3 center = {0.0f, 0.0f, 0.0f};
+		for (int k = 0; k < 8; ++k)
+		{
+			float d = k < 4 ? zStart : zEnd;
+			vec3 viewCorner = {((k & 1) ? 1.0f : -1.0f) * d * tanX, ((k & 2) ? 1.0f : -1.0f) * d * tanY, -d};
+			glm_mat4_mulv3(invView, viewCorner, 1.0f, corners[k]);
+			glm_vec3_add(center, corners[k], center);
+		}
+		glm_vec3_scale(center, 1.0f / 8.0f, center);
+
+		// The radius only depends on the slice shape; rounding keeps float noise from resizing it
+		float radius = 0.0f;
+		for (int k = 0; k < 8; ++k)
+			radius = fmaxf(radius, glm_vec3_distance(center, corners[k]));
+		radius = ceilf(radius * 16.0f) / 16.0f;
+
+		bool cached = app->shadowCacheEnabled && i >= SHADOW_CACHED_FIRST;
+		float extent = radius;
+		float snap = 2.0f * extent / SHADOW_MAP_SIZE;
+		if (cached)
+		{
+			float margin = radius * SHADOW_CACHE_STEP;
+			extent = radius + margin;
+			float texel = 2.0f * extent / SHADOW_MAP_SIZE;
+			snap = texel * ceilf(margin / texel);
+		}
+
+		vec3 lightCenter;
+		glm_mat4_mulv3(app->shadowLightView, center, 1.0f, lightCenter);
+		lightCenter[0] = roundf(lightCenter[0] / snap) * snap;
+		lightCenter[1] = roundf(lightCenter[1] / snap) * snap;
+
+		// The light view looks down -Z, so near/far are negated light-space z
+		mat4 proj;
+		glm_ortho_rh_zo(lightCenter[0] - extent, lightCenter[0] + extent, lightCenter[1] - extent, lightCenter[1] + extent,
+		    -sceneMax[2] - 1.0f, -sceneMin[2] + 1.0f, proj);
+		glm_mat4_mul(proj, app->shadowLightView, cascade->viewProj);
+		cascade->splitFar = zEnd;
+		glm_vec3_copy((vec3){lightCenter[0] - extent, lightCenter[1] - extent, sceneMin[2]}, cascade->boundsMin);
+		glm_vec3_copy((vec3){lightCenter[0] + extent, lightCenter[1] + extent, sceneMax[2]}, cascade->boundsMax);
+
+		if (!cached || memcmp(cascade->viewProj, cascade->renderedViewProj, sizeof(mat4)) != 0)
+			cascade->dirty = true;
+		zStart = zEnd;
+	}
+}
+
+void recordShadowCommands(Application* app, VkCommandBuffer commandBuffer)
+{
+	if (!app->shadowsEnabled)
+		return;
+
+	for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		ShadowCascade* cascade = &app->cascades[i];
+		if (!cascade->dirty)
+			continue;
+
+		gpuTimerBegin(app, commandBuffer, GPU_TIMER_SHADOW_CASCADE0 + i);
+
+		VkRenderingAttachmentInfo depthAttachment = {
+		    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+		    .imageView = app->shadowLayerViews[i],
+		    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+		    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+		    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+		    .clearValue.depthStencil = {1.0f, 0},
+		};
+		VkRenderingInfo renderingInfo = {
+		    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+		    .renderArea = {{0, 0}, {SHADOW_MAP_SIZE, SHADOW_MAP_SIZE}},
+		    .layerCount = 1,
+		    .pDepthAttachment = &depthAttachment,
+		};
+		vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+		VkViewport viewport = {0.0f, 0.0f, (float)SHADOW_MAP_SIZE, (float)SHADOW_MAP_SIZE, 0.0f, 1.0f};
+		VkRect2D scissor = {{0, 0}, {SHADOW_MAP_SIZE, SHADOW_MAP_SIZE}};
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		VkDeviceSize offset = 0;
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->shadowPipeline);
+		if (app->mesh.primitive_count > 0) // the cascade still clears while the scene loads
+		{
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &app->positionBuffer.vkbuffer, &offset);
+			vkCmdBindIndexBuffer(commandBuffer, app->indexBuffer.vkbuffer, 0, VK_INDEX_TYPE_UINT32);
+		}
+		vkCmdPushConstants(commandBuffer, app->shadowPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mat4), cascade->viewProj);
+
+		for (u32 p = 0; p < app->mesh.primitive_count; ++p)
+		{
+			Primitive* prim = &app->mesh.primitives[p];
+			int mat = prim->material_index;
+			if (mat >= 0 && (u32)mat < app->mesh.material_count && app->mesh.materials[mat].alphaMode == 2)
+				continue;
+			vec3 boxMin, boxMax;
+			lightSpaceBounds(app, prim->aabbMin, prim->aabbMax, boxMin, boxMax);
+			if (!boxesOverlap(boxMin, boxMax, cascade->boundsMin, cascade->boundsMax))
+				continue;
+			vkCmdDrawIndexed(commandBuffer, prim->index_count, 1, prim->first_index, 0, 0);
+		}
+
+		vkCmdEndRendering(commandBuffer);
+		gpuTimerEnd(app, commandBuffer, GPU_TIMER_SHADOW_CASCADE0 + i);
+
+		glm_mat4_copy(cascade->viewProj, cascade->renderedViewProj);
+		cascade->dirty = false;
+		cascade->updates++;
+	}
+}
+
+void cleanupShadowResources(Application* app)
+{
+	vkDestroyPipeline(app->device, app->shadowPipeline, NULL);
+	vkDestroyPipelineLayout(app->device, app->shadowPipelineLayout, NULL);
+	vkDestroySampler(app->device, app->shadowSampler, NULL);
+	for (u32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+		vkDestroyImageView(app->device, app->shadowLayerViews[i], NULL);
+	vkDestroyImageView(app->device, app->shadowMapView, NULL);
+	vkDestroyImage(app->device, app->shadowMap, NULL);
+	vkFreeMemory(app->device, app->shadowMapMemory, NULL);
+}
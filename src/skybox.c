@@ -1,39 +1,24 @@
 #include "main.h"
-void createSkyboxTexture(Application* app) {
-    // Vulkan cubemap face order: +X, -X, +Y, -Y, +Z, -Z
-    const char* faces[6] = {
-        "data/skybox/xpos.png",  // Right  (+X)
-        "data/skybox/xneg.png",  // Left   (-X)  
-        "data/skybox/ypos.png",  // Top    (+Y)
-        "data/skybox/yneg.png",  // Bottom (-Y)
-        "data/skybox/zpos.png",  // Front  (+Z)
-        "data/skybox/zneg.png"   // Back   (-Z)
-    };
-
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels[6];
-    VkDeviceSize imageSize = 0;
-    VkDeviceSize layerSize = 0;
-stbi_set_flip_vertically_on_load(false);
-
-    for (int i = 0; i < 6; i++) {
-        pixels[i] = stbi_load(faces[i], &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-        if (!pixels[i]) {
-            fprintf(stderr, "Failed to load skybox texture: %s\n", faces[i]);
-            exit(1);
-        }
-        if (i == 0) {
-            layerSize = texWidth * texHeight * 4;
-        }
-        imageSize += layerSize;
-    }
+// Vulkan cubemap face order: +X, -X, +Y, -Y, +Z, -Z
+static const char* skyboxFaces[6] = {
+    "data/skybox/xpos.png",  // Right  (+X)
+    "data/skybox/xneg.png",  // Left   (-X)
+    "data/skybox/ypos.png",  // Top    (+Y)
+    "data/skybox/yneg.png",  // Bottom (-Y)
+    "data/skybox/zpos.png",  // Front  (+Z)
+    "data/skybox/zneg.png"   // Back   (-Z)
+};
+
+// Six RGBA8 faces of texWidth x texHeight, in cubemap face order
+void createCubemapTexture(Application* app, stbi_uc* const faces[6], int texWidth, int texHeight, Texture* outTexture) {
+    VkDeviceSize layerSize = (VkDeviceSize)texWidth * texHeight * 4;
+    VkDeviceSize imageSize = layerSize * 6;
 
     Buffer stagingBuffer;
     createBuffer(app, &stagingBuffer, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
 
     for (int i = 0; i < 6; i++) {
-        memcpy((char*)stagingBuffer.data + (layerSize * i), pixels[i], layerSize);
-        stbi_image_free(pixels[i]);
+        memcpy((char*)stagingBuffer.data + (layerSize * i), faces[i], layerSize);
     }
 
     VkImageCreateInfo imageInfo = {
@@ -53,10 +38,10 @@ stbi_set_flip_vertically_on_load(false);
         .flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
     };
 
-    VK_CHECK(vkCreateImage(app->device, &imageInfo, NULL, &app->skyboxTexture.image));
+    VK_CHECK(vkCreateImage(app->device, &imageInfo, NULL, &outTexture->image));
 
     VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(app->device, app->skyboxTexture.image, &memRequirements);
+    vkGetImageMemoryRequirements(app->device, outTexture->image, &memRequirements);
 
     VkMemoryAllocateInfo allocInfo = {
         .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
@@ -64,8 +49,8 @@ stbi_set_flip_vertically_on_load(false);
         .memoryTypeIndex = selectmemorytype(&app->memoryProperties, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
     };
 
-    VK_CHECK(vkAllocateMemory(app->device, &allocInfo, NULL, &app->skyboxTexture.memory));
-    VK_CHECK(vkBindImageMemory(app->device, app->skyboxTexture.image, app->skyboxTexture.memory, 0));
+    VK_CHECK(vkAllocateMemory(app->device, &allocInfo, NULL, &outTexture->memory));
+    VK_CHECK(vkBindImageMemory(app->device, outTexture->image, outTexture->memory, 0));
 
     VkCommandBuffer commandBuffer = beginSingleTimeCommands(app);
 
@@ -75,7 +60,7 @@ stbi_set_flip_vertically_on_load(false);
         .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = app->skyboxTexture.image,
+        .image = outTexture->image,
         .subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
         .subresourceRange.baseMipLevel = 0,
         .subresourceRange.levelCount = 1,
@@ -107,7 +92,7 @@ stbi_set_flip_vertically_on_load(false);
             .imageExtent = {(u32)texWidth, (u32)texHeight, 1},
         };
     }
-    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.vkbuffer, app->skyboxTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 6, regions);
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.vkbuffer, outTexture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 6, regions);
 
     VkImageMemoryBarrier barrier2 = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -115,7 +100,7 @@ stbi_set_flip_vertically_on_load(false);
         .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = app->skyboxTexture.image,
+        .image = outTexture->image,
         .subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
         .subresourceRange.baseMipLevel = 0,
         .subresourceRange.levelCount = 1,
@@ -140,7 +125,7 @@ stbi_set_flip_vertically_on_load(false);
 
     VkImageViewCreateInfo viewInfo = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .image = app->skyboxTexture.image,
+        .image = outTexture->image,
         .viewType = VK_IMAGE_VIEW_TYPE_CUBE,
         .format = VK_FORMAT_R8G8B8A8_SRGB,
         .subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
@@ -149,7 +134,7 @@ stbi_set_flip_vertically_on_load(false);
         .subresourceRange.baseArrayLayer = 0,
         .subresourceRange.layerCount = 6,
     };
-    VK_CHECK(vkCreateImageView(app->device, &viewInfo, NULL, &app->skyboxTexture.view));
+    VK_CHECK(vkCreateImageView(app->device, &viewInfo, NULL, &outTexture->view));
 
     VkSamplerCreateInfo samplerInfo = {
 	    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
@@ -169,16 +154,72 @@ stbi_set_flip_vertically_on_load(false);
 	    .minLod = 0.0f,
 	    .maxLod = 1.0f,
 	};
-	VK_CHECK(vkCreateSampler(app->device, &samplerInfo, NULL, &app->skyboxTexture.sampler));
+	VK_CHECK(vkCreateSampler(app->device, &samplerInfo, NULL, &outTexture->sampler));
+}
+
+// Starts with a flat sky-colored cube so the first frames have something to sample; the real
+// faces are decoded in the background and swapped in by setSkyboxCubemap
+void createSkyboxTexture(Application* app) {
+    stbi_uc sky[4] = {110, 140, 180, 255};
+    stbi_uc* const faces[6] = {sky, sky, sky, sky, sky, sky};
+    createCubemapTexture(app, faces, 1, 1, &app->skyboxTexture);
+    stbi_set_flip_vertically_on_load(false); // global in stb_image, so set before any decode job starts
+    app->assets.skybox = assetsLoadCubemap(app, skyboxFaces);
 }
 
+// Runs on a worker; all six must decode and match in size. The faces are read in one batch,
+// so they are all in flight at once.
+bool decodeSkyboxFaces(FileIO* io, const char* const paths[6], DecodedImage faces[6]) {
+    FileRead reads[6] = {0};
+    for (int i = 0; i < 6; i++)
+        reads[i].path = paths[i];
+    fileioReadBatch(io, reads, 6);
+
+    bool ok = true;
+    for (int i = 0; i < 6; i++) {
+        if (reads[i].error != 0) {
+            fprintf(stderr, "Failed to read skybox face %s: %s\n", paths[i], strerror(reads[i].error));
+            ok = false;
+            continue;
+        }
+        bool decoded = decodeTextureMemory(paths[i], reads[i].dst, (size_t)reads[i].bytesRead, &faces[i]);
+        free(reads[i].dst);
+        if (!decoded)
+            ok = false;
+        else if (faces[i].width != faces[0].width || faces[i].height != faces[0].height)
+        {
+            fprintf(stderr, "Skybox face %s is %dx%d, expected %dx%d\n", paths[i], faces[i].width, faces[i].height, faces[0].width, faces[0].height);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Called from the main loop once the faces are decoded; takes ownership of their pixels. The placeholder and its descriptor set
+// may still be in use by frames in flight, so they are retired rather than destroyed.
+void setSkyboxCubemap(Application* app, DecodedImage faces[6]) {
+    stbi_uc* pixels[6];
+    for (int i = 0; i < 6; i++)
+        pixels[i] = faces[i].pixels;
+
+    Texture cubemap = {0};
+    createCubemapTexture(app, pixels, faces[0].width, faces[0].height, &cubemap);
+    for (int i = 0; i < 6; i++) {
+        stbi_image_free(faces[i].pixels);
+        faces[i].pixels = NULL;
+    }
+    deferDestroyTexture(app, &app->skyboxTexture);
+    deferFreeDescriptorSet(app, app->descriptorPool, app->skyboxDescriptorSet);
+    app->skyboxTexture = cubemap;
+    createSkyboxDescriptors(app);
+}
 
 void createSkyboxPipeline(Application* app)
 {
 	VkDescriptorSetLayoutBinding bindings[] = {
 	    {
 	        .binding = 0,
-	        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+	        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 	        .descriptorCount = 1,
 	        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
 	    },
@@ -204,8 +245,8 @@ void createSkyboxPipeline(Application* app)
 	};
 	VK_CHECK(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &app->skyboxPipelineLayout));
 
-	VkShaderModule vertShader = LoadShaderModule("compiledshaders/skybox.vert.spv", app->device);
-	VkShaderModule fragShader = LoadShaderModule("compiledshaders/skybox.frag.spv", app->device);
+	VkShaderModule vertShader = LoadShaderModule(app->io, "compiledshaders/skybox.vert.spv", app->device);
+	VkShaderModule fragShader = LoadShaderModule(app->io, "compiledshaders/skybox.frag.spv", app->device);
 
 	VkPipelineShaderStageCreateInfo shaderStages[] = {
 	    {
@@ -323,15 +364,17 @@ void createSkyboxPipeline(Application* app)
 	    .subpass = 0,
 	};
 
+	// The skybox is drawn into the HDR scene target
+	VkFormat hdrFormat = HDR_COLOR_FORMAT;
 	VkPipelineRenderingCreateInfo renderingCreateInfo = {
 	    .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
 	    .colorAttachmentCount = 1,
-	    .pColorAttachmentFormats = &app->swapchainFormat,
+	    .pColorAttachmentFormats = &hdrFormat,
 	    .depthAttachmentFormat = app->depthFormat,
 	};
 	pipelineInfo.pNext = &renderingCreateInfo;
 
-	VK_CHECK(vkCreateGraphicsPipelines(app->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &app->skyboxPipeline));
+	app->skyboxPipeline = buildGraphicsPipeline(app, &pipelineInfo);
 
 	vkDestroyShaderModule(app->device, vertShader, NULL);
 	vkDestroyShaderModule(app->device, fragShader, NULL);
@@ -103,9 +103,15 @@ void generateMipmaps(Application* app, VkCommandBuffer cmd, VkImage image, VkFor
 }
 
 void createDummyTexture(Application* app, Texture* outTexture, u32* outMipLevels)
+{
+	createSolidTexture(app, outTexture, outMipLevels, (const u8[4]){255, 255, 255, 255});
+}
+
+// 1x1 texture of a single color; also the placeholder while a material's texture loads
+void createSolidTexture(Application* app, Texture* outTexture, u32* outMipLevels, const u8 rgba[4])
 {
 	*outMipLevels = 1;
-	stbi_uc pixels[] = {255, 255, 255, 255};
+	stbi_uc pixels[] = {rgba[0], rgba[1], rgba[2], rgba[3]};
 	VkDeviceSize imageSize = 4;
 
 	Buffer stagingBuffer;
@@ -227,29 +233,61 @@ void createDummyTexture(Application* app, Texture* outTexture, u32* outMipLevels
 	VK_CHECK(vkCreateImageView(app->device, &viewInfo, NULL, &outTexture->view));
 }
 
+// Touches no Vulkan state, so it can run on any worker. The file is read whole and decoded
+// from memory; decodeSkyboxFaces batches its reads and comes in through decodeTextureMemory.
+bool decodeTextureMemory(const char* path, const void* bytes, size_t size, DecodedImage* out)
+{
+	out->path = path;
+	out->pixels = stbi_load_from_memory(bytes, (int)size, &out->width, &out->height, &out->channels, STBI_rgb_alpha);
+	if (!out->pixels)
+	{
+		fprintf(stderr, "Failed to load texture image: %s\n", path);
+		fprintf(stderr, "STB Error: %s\n", stbi_failure_reason());
+		return false;
+	}
+	return true;
+}
+
+bool decodeTextureImage(FileIO* io, const char* path, DecodedImage* out)
+{
+	size_t size;
+	void* bytes = fileioReadFile(io, path, &size);
+	if (!bytes)
+	{
+		out->path = path;
+		out->pixels = NULL;
+		fprintf(stderr, "Failed to read texture image %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	bool ok = decodeTextureMemory(path, bytes, size, out);
+	free(bytes);
+	return ok;
+}
+
 void createTextureImage(Application* app, const char* path, Texture* outTexture, u32* outMipLevels, VkFormat format)
 {
+	DecodedImage decoded;
+	if (!decodeTextureImage(app->io, path, &decoded))
+		exit(1);
+	uploadTextureImage(app, &decoded, outTexture, outMipLevels, format);
+}
 
-	int texWidth, texHeight, texChannels;
-	stbi_uc* pixels = stbi_load(path, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+// Takes ownership of the decoded pixels
+void uploadTextureImage(Application* app, DecodedImage* decoded, Texture* outTexture, u32* outMipLevels, VkFormat format)
+{
+	int texWidth = decoded->width, texHeight = decoded->height;
 	VkDeviceSize imageSize = texWidth * texHeight * 4;
 
 	*outMipLevels = (u32)(floor(log2(texWidth > texHeight ? texWidth : texHeight))) + 1;
 
-	if (!pixels)
-	{
-		fprintf(stderr, "Failed to load texture image: %s\n", path);
-		fprintf(stderr, "STB Error: %s\n", stbi_failure_reason());
-		exit(1);
-	}
-
 	printf("Loaded texture: %s (%dx%d, %d channels, %u mip levels)\n",
-	    path, texWidth, texHeight, texChannels, *outMipLevels);
+	    decoded->path, texWidth, texHeight, decoded->channels, *outMipLevels);
 
 	Buffer stagingBuffer;
 	createBuffer(app, &stagingBuffer, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	memcpy(stagingBuffer.data, pixels, (size_t)imageSize);
-	stbi_image_free(pixels);
+	memcpy(stagingBuffer.data, decoded->pixels, (size_t)imageSize);
+	stbi_image_free(decoded->pixels);
+	decoded->pixels = NULL;
 
 	VkImageCreateInfo imageInfo = {
 	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -380,11 +418,12 @@ void createTextureSampler(Application* app, Texture* texture, u32 mipLevels)
 	VK_CHECK(vkCreateSampler(app->device, &samplerInfo, NULL, &texture->sampler));
 }
 
-void createStorageImage(Application* app, StorageImage* img, uint32_t width, uint32_t height)
+// Leaves the image in GENERAL, where storage images stay for their whole life
+void createStorageImage(Application* app, StorageImage* img, uint32_t width, uint32_t height, VkFormat format)
 {
 	img->extent.width = width;
 	img->extent.height = height;
-	img->format = VK_FORMAT_R32G32B32A32_SFLOAT; // Example format
+	img->format = format;
 
 	VkImageCreateInfo imageInfo = {
 	    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -395,7 +434,7 @@ void createStorageImage(Application* app, StorageImage* img, uint32_t width, uin
 	    .arrayLayers = 1,
 	    .samples = VK_SAMPLE_COUNT_1_BIT,
 	    .tiling = VK_IMAGE_TILING_OPTIMAL,
-	    .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // For compute and sampling
+	    .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, // compute, sampling, clear/upload
 	    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
 	};
 	VK_CHECK(vkCreateImage(app->device, &imageInfo, NULL, &img->image));
@@ -419,4 +458,10 @@ void createStorageImage(Application* app, StorageImage* img, uint32_t width, uin
 	    .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
 	};
 	VK_CHECK(vkCreateImageView(app->device, &viewInfo, NULL, &img->view));
+
+	VkCommandBuffer cmd = beginSingleTimeCommands(app);
+	transitionImageLayout(cmd, img->image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+	    0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+	endSingleTimeCommands(app, cmd);
 }
@@ -0,0 +1,41 @@
+#!/bin/bash
+set -e  # Exit immediately on error
+
+# CPU tests for the modules that don't need Vulkan or a window. Each test is built with just
+# the sources it exercises and run from the repo root (some read committed data under tests/).
+
+mkdir -p build/tests
+
+CFLAGS="-D_DEBUG -Wall -Wextra -ggdb -std=gnu11"
+LDFLAGS="-lm -lpthread"
+
+failed=0
+run_test() {
+    local name="$1"
+    shift
+    echo "  → $name"
+    gcc "tests/$name.c" "$@" -o "build/tests/$name" $CFLAGS $LDFLAGS
+    if ! "./build/tests/$name"; then
+        failed=1
+    fi
+}
+
+echo "Running tests..."
+# The pak and fileio tests pack their inputs with the real tool
+gcc src/packtool.c src/pak.c -o build/tests/pack $CFLAGS
+run_test rendergraph_test src/rendergraph.c
+run_test occlusion_test src/occlusion.c
+run_test clusters_test src/clusters.c
+run_test drs_test src/drs.c
+run_test particlesim_test src/particlesim.c
+run_test jobs_test src/jobs.c
+run_test arena_test src/arena.c
+run_test pool_test src/pool.c
+run_test pak_test src/pak.c
+run_test fileio_test src/fileio.c src/jobs.c src/pak.c
+
+if [ "$failed" -ne 0 ]; then
+    echo "Tests failed."
+    exit 1
+fi
+echo "All tests passed."
@@ -0,0 +1,137 @@
+// Checks the arena's allocation contract (alignment, zero sizes, oversized requests, no
+// overlap) and that a reset folds the chain into one block so a repeated workload stops
+// calling malloc.
+
+#include "../src/arena.h"
+#include "test.h"
+
+#include <string.h>
+
+#define BLOCK_SIZE 1024
+
+static bool aligned(const void* p)
+{
+	return ((uintptr_t)p & (ARENA_ALIGNMENT - 1)) == 0;
+}
+
+// A mix of small, zero and oversized requests, each filled with its own byte
+static uint32_t fillRound(Arena* arena, unsigned char** out, size_t* sizes, uint32_t count)
+{
+	uint32_t misaligned = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		sizes[i] = i % 17 == 0 ? 0 : (i % 29 == 0 ? BLOCK_SIZE * 3 + 5 : 1 + (i * 37) % 200);
+		out[i] = arenaAlloc(arena, sizes[i]);
+		misaligned += !aligned(out[i]);
+		memset(out[i], (int)(i & 0xff), sizes[i]);
+	}
+	return misaligned;
+}
+
+static uint32_t countOverwritten(unsigned char** out, const size_t* sizes, uint32_t count)
+{
+	uint32_t overwritten = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		for (size_t b = 0; b < sizes[i]; ++b)
+		{
+			if (out[i][b] != (unsigned char)(i & 0xff))
+			{
+				overwritten++;
+				break;
+			}
+		}
+	}
+	return overwritten;
+}
+
+static void testAllocations(void)
+{
+	Arena arena;
+	arenaInit(&arena, BLOCK_SIZE);
+	CHECK(arena.head == NULL && arenaCapacity(&arena) == 0);
+
+	enum { COUNT = 300 };
+	unsigned char* out[COUNT];
+	size_t sizes[COUNT];
+	CHECK_EQ_U64(fillRound(&arena, out, sizes, COUNT), 0);
+	CHECK_EQ_U64(countOverwritten(out, sizes, COUNT), 0);
+	CHECK_EQ_U64(arena.stats.allocations, COUNT);
+	CHECK(arena.stats.blocks > 1);
+	CHECK(arena.stats.peakBytes == arena.stats.bytes);
+	CHECK(arenaCapacity(&arena) >= arena.stats.bytes);
+
+	arenaFree(&arena);
+	CHECK(arena.head == NULL && arenaCapacity(&arena) == 0);
+
+	// Zero sizes still get aligned pointers, and an oversized request gets a block of its own
+	// behind the head, which keeps serving small ones
+	CHECK(aligned(arenaAlloc(&arena, 0)));
+	unsigned char* head = arenaAlloc(&arena, 16);
+	arenaAlloc(&arena, BLOCK_SIZE * 4);
+	unsigned char* next = arenaAlloc(&arena, 16);
+	CHECK(next == head + 16);
+	CHECK_EQ_U64(arenaCapacity(&arena), BLOCK_SIZE * 5);
+	arenaFree(&arena);
+}
+
+static void testHelpers(void)
+{
+	Arena arena = {0};
+	uint32_t* zeros = arenaCalloc(&arena, 100, sizeof(uint32_t));
+	uint32_t nonzero = 0;
+	for (uint32_t i = 0; i < 100; ++i)
+		nonzero += zeros[i] != 0;
+	CHECK_EQ_U64(nonzero, 0);
+
+	char source[] = "textures/albedo.png";
+	char* copy = arenaStrdup(&arena, source);
+	source[0] = 'X';
+	CHECK(strcmp(copy, "textures/albedo.png") == 0);
+
+	char* formatted = arenaPrintf(&arena, "%s#%u", "mesh", 42u);
+	CHECK(strcmp(formatted, "mesh#42") == 0);
+	char wide[3000];
+	memset(wide, 'a', sizeof(wide) - 1);
+	wide[sizeof(wide) - 1] = '\0';
+	formatted = arenaPrintf(&arena, "[%s]", wide);
+	CHECK_EQ_U64(strlen(formatted), sizeof(wide) + 1);
+	arenaFree(&arena);
+}
+
+// After the first round and a reset, the same workload fits in the one merged block
+static void testReset(void)
+{
+	Arena arena;
+	arenaInit(&arena, BLOCK_SIZE);
+	enum { COUNT = 200 };
+	unsigned char* out[COUNT];
+	size_t sizes[COUNT];
+	fillRound(&arena, out, sizes, COUNT);
+	uint64_t peak = arena.stats.peakBytes;
+	size_t capacity = arenaCapacity(&arena);
+
+	arenaReset(&arena);
+	CHECK_EQ_U64(arenaCapacity(&arena), capacity);
+	CHECK_EQ_U64(arena.stats.bytes, 0);
+	uint64_t blocks = arena.stats.blocks;
+
+	for (int round = 0; round < 3; ++round)
+	{
+		CHECK_EQ_U64(fillRound(&arena, out, sizes, COUNT), 0);
+		CHECK_EQ_U64(countOverwritten(out, sizes, COUNT), 0);
+		arenaReset(&arena);
+	}
+	CHECK_EQ_U64(arena.stats.blocks, blocks);
+	CHECK_EQ_U64(arena.stats.peakBytes, peak);
+	CHECK_EQ_U64(arena.stats.allocations, COUNT * 4);
+	arenaFree(&arena);
+}
+
+int main(void)
+{
+	testAllocations();
+	testHelpers();
+	testReset();
+	return testReport("arena");
+}
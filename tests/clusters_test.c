@@ -0,0 +1,185 @@
+// Assigns seeded random lights under random views with the SSE row test and the scalar
+// reference, and checks both against a brute-force sphere/AABB test of every cluster: the
+// per-cluster lists must match exactly, order included, also in clusters past
+// CLUSTER_MAX_LIGHTS where only the first lights are kept.
+
+#include "../src/clusters.h"
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VIEW_COUNT 12
+#define LIGHTS_PER_VIEW 1500
+#define CROWDED_LIGHTS 600
+
+static uint32_t g_rng;
+
+static uint32_t nextRandom(void)
+{
+	// xorshift32
+	g_rng ^= g_rng << 13;
+	g_rng ^= g_rng >> 17;
+	g_rng ^= g_rng << 5;
+	return g_rng;
+}
+
+static float randomRange(float lo, float hi)
+{
+	return lo + (hi - lo) * (float)(nextRandom() & 0xffffff) / (float)0xffffff;
+}
+
+// Column-major world-to-view for a camera at eye turned by yaw and pitch, looking down -z
+static void makeView(float view[16], const float eye[3], float yaw, float pitch)
+{
+	float right[3] = {cosf(yaw), 0.0f, -sinf(yaw)};
+	float forward[3] = {-sinf(yaw) * cosf(pitch), sinf(pitch), -cosf(yaw) * cosf(pitch)};
+	float up[3] = {
+	    right[1] * forward[2] - right[2] * forward[1],
+	    right[2] * forward[0] - right[0] * forward[2],
+	    right[0] * forward[1] - right[1] * forward[0],
+	};
+	const float* rows[3] = {right, up, forward};
+	memset(view, 0, 16 * sizeof(float));
+	for (int r = 0; r < 3; ++r)
+	{
+		float sign = r == 2 ? -1.0f : 1.0f;
+		for (int c = 0; c < 3; ++c)
+			view[c * 4 + r] = sign * rows[r][c];
+		view[3 * 4 + r] = -sign * (rows[r][0] * eye[0] + rows[r][1] * eye[1] + rows[r][2] * eye[2]);
+	}
+	view[15] = 1.0f;
+}
+
+// Every cluster against every light, in light order, with the first CLUSTER_MAX_LIGHTS kept
+static void assignBruteForce(const ClusterGrid* grid, const float view[16], const ClusterLight* lights, uint32_t lightCount,
+    uint32_t* counts, uint32_t* indices)
+{
+	memset(counts, 0, sizeof(uint32_t) * CLUSTER_COUNT);
+	for (uint32_t i = 0; i < lightCount; ++i)
+	{
+		const float* pos = lights[i].positionRadius;
+		float center[3];
+		for (int r = 0; r < 3; ++r)
+			center[r] = view[0 * 4 + r] * pos[0] + view[1 * 4 + r] * pos[1] + view[2 * 4 + r] * pos[2] + view[3 * 4 + r];
+		for (uint32_t c = 0; c < CLUSTER_COUNT; ++c)
+		{
+			float dx = fmaxf(fmaxf(grid->minX[c] - center[0], center[0] - grid->maxX[c]), 0.0f);
+			float dy = fmaxf(fmaxf(grid->minY[c] - center[1], center[1] - grid->maxY[c]), 0.0f);
+			float dz = fmaxf(fmaxf(grid->minZ[c] - center[2], center[2] - grid->maxZ[c]), 0.0f);
+			if (dx * dx + dy * dy + dz * dz > pos[3] * pos[3])
+				continue;
+			if (counts[c] < CLUSTER_MAX_LIGHTS)
+				indices[c * CLUSTER_MAX_LIGHTS + counts[c]] = i;
+			counts[c]++;
+		}
+	}
+	for (uint32_t c = 0; c < CLUSTER_COUNT; ++c)
+		counts[c] = counts[c] > CLUSTER_MAX_LIGHTS ? CLUSTER_MAX_LIGHTS : counts[c];
+}
+
+// Clusters whose count or any of their listed lights differ from the expected ones
+static uint32_t countWrongClusters(const uint32_t* counts, const uint32_t* indices, const uint32_t* expectedCounts,
+    const uint32_t* expectedIndices)
+{
+	uint32_t wrong = 0;
+	for (uint32_t c = 0; c < CLUSTER_COUNT; ++c)
+	{
+		size_t base = (size_t)c * CLUSTER_MAX_LIGHTS;
+		if (counts[c] != expectedCounts[c] ||
+		    memcmp(indices + base, expectedIndices + base, counts[c] * sizeof(uint32_t)) != 0)
+			wrong++;
+	}
+	return wrong;
+}
+
+typedef struct Lists
+{
+	uint32_t* counts;
+	uint32_t* indices;
+} Lists;
+
+static Lists newLists(void)
+{
+	return (Lists){malloc(CLUSTER_COUNT * sizeof(uint32_t)), malloc((size_t)CLUSTER_COUNT * CLUSTER_MAX_LIGHTS * sizeof(uint32_t))};
+}
+
+static void freeLists(Lists* lists)
+{
+	free(lists->counts);
+	free(lists->indices);
+}
+
+int main(void)
+{
+	ClusterGrid grid;
+	clusterInit(&grid);
+	if (!grid.hasSse)
+		printf("clusters: no SSE here, testing the scalar path only\n");
+	Lists sse = newLists(), scalar = newLists(), brute = newLists();
+	ClusterLight* lights = malloc((LIGHTS_PER_VIEW + CROWDED_LIGHTS) * sizeof(ClusterLight));
+	uint32_t overflowedViews = 0;
+
+	for (uint32_t v = 0; v < VIEW_COUNT; ++v)
+	{
+		g_rng = 0x9e3779b9u + v * 7919u;
+		float zNear = randomRange(0.05f, 0.5f);
+		float zFar = randomRange(50.0f, 300.0f);
+		float width = randomRange(640.0f, 2560.0f);
+		ClusterParams params = clusterMakeParams(zNear, zFar, randomRange(0.6f, 1.6f), width, width * randomRange(0.4f, 0.8f));
+		clusterUpdateBounds(&grid, &params);
+
+		float view[16];
+		float eye[3] = {randomRange(-20.0f, 20.0f), randomRange(-5.0f, 5.0f), randomRange(-20.0f, 20.0f)};
+		makeView(view, eye, randomRange(-3.14f, 3.14f), randomRange(-1.2f, 1.2f));
+
+		// Scattered lights, some behind the camera or past the far plane, then every other view
+		// a crowd around one spot that pushes the clusters there past CLUSTER_MAX_LIGHTS
+		uint32_t lightCount = LIGHTS_PER_VIEW;
+		for (uint32_t i = 0; i < LIGHTS_PER_VIEW; ++i)
+		{
+			ClusterLight* light = &lights[i];
+			light->positionRadius[0] = eye[0] + randomRange(-zFar, zFar);
+			light->positionRadius[1] = eye[1] + randomRange(-zFar * 0.25f, zFar * 0.25f);
+			light->positionRadius[2] = eye[2] + randomRange(-zFar, zFar);
+			light->positionRadius[3] = randomRange(0.05f, 1.0f) * randomRange(0.5f, 30.0f);
+		}
+		if (v % 2)
+		{
+			float spot[3] = {eye[0] - view[2] * 8.0f, eye[1] - view[6] * 8.0f, eye[2] - view[10] * 8.0f};
+			for (uint32_t i = 0; i < CROWDED_LIGHTS; ++i)
+			{
+				ClusterLight* light = &lights[lightCount++];
+				for (int r = 0; r < 3; ++r)
+					light->positionRadius[r] = spot[r] + randomRange(-2.0f, 2.0f);
+				light->positionRadius[3] = randomRange(3.0f, 6.0f);
+			}
+		}
+
+		assignBruteForce(&grid, view, lights, lightCount, brute.counts, brute.indices);
+		grid.useReference = false;
+		clusterAssignLights(&grid, view, lights, lightCount, sse.counts, sse.indices);
+		uint32_t overflowed = grid.stats.overflowed;
+		grid.useReference = true;
+		clusterAssignLights(&grid, view, lights, lightCount, scalar.counts, scalar.indices);
+
+		uint32_t wrongSse = countWrongClusters(sse.counts, sse.indices, brute.counts, brute.indices);
+		uint32_t wrongScalar = countWrongClusters(scalar.counts, scalar.indices, brute.counts, brute.indices);
+		if (wrongSse || wrongScalar)
+			fprintf(stderr, "clusters: view %u: %u SSE and %u scalar clusters differ\n", v, wrongSse, wrongScalar);
+		CHECK_EQ_U64(wrongSse, 0);
+		CHECK_EQ_U64(wrongScalar, 0);
+		CHECK_EQ_U64(grid.stats.overflowed, overflowed);
+		CHECK(v % 2 == 0 || overflowed > 0);
+		overflowedViews += overflowed > 0;
+	}
+	CHECK(overflowedViews >= VIEW_COUNT / 2);
+
+	free(lights);
+	freeLists(&brute);
+	freeLists(&scalar);
+	freeLists(&sse);
+	clusterDestroy(&grid);
+	return testReport("clusters");
+}
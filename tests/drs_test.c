@@ -0,0 +1,158 @@
+// Replays the committed dynamic resolution traces under tests/data against the scales they
+// recorded, and checks what each one is meant to show about the controller.
+
+#include "../src/drs.h"
+#include "test.h"
+
+#include <stdlib.h>
+
+#define TRACE_DIR "tests/data/"
+
+static DrsTraceEntry* loadTrace(const char* path, DrsConfig* config, uint32_t* count)
+{
+	DrsTraceEntry* entries = drsTraceRead(path, config, count);
+	if (!entries)
+		fprintf(stderr, "can't read %s (run from the repo root)\n", path);
+	CHECK(entries != NULL);
+	return entries;
+}
+
+// Every trace: replays exactly, stays in range and never changes scale inside the cooldown
+static void checkCommon(const char* path, const DrsConfig* config, const DrsTraceEntry* entries, uint32_t count)
+{
+	uint32_t mismatch = drsReplay(config, entries, count);
+	if (mismatch != count)
+		fprintf(stderr, "%s: scale differs at frame %u\n", path, mismatch);
+	CHECK_EQ_U64(mismatch, count);
+
+	uint32_t lastChange = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		CHECK(entries[i].scale >= config->minScale && entries[i].scale <= config->maxScale);
+		if (i > 0 && entries[i].scale != entries[i - 1].scale)
+		{
+			CHECK(i - lastChange >= config->cooldown);
+			lastChange = i;
+		}
+	}
+}
+
+// A 30-frame GPU spike: the scale drops while it lasts and climbs back to full afterwards
+static void testSpike(void)
+{
+	DrsConfig config;
+	uint32_t count = 0;
+	DrsTraceEntry* entries = loadTrace(TRACE_DIR "drs_spike.csv", &config, &count);
+	if (!entries)
+		return;
+	CHECK_EQ_U64(count, 300);
+	checkCommon("drs_spike.csv", &config, entries, count);
+
+	float lowest = config.maxScale;
+	for (uint32_t i = 0; i < count; ++i)
+		lowest = entries[i].scale < lowest ? entries[i].scale : lowest;
+	CHECK(lowest < 0.8f);
+	CHECK(entries[99].scale == config.maxScale);
+	CHECK(entries[count - 1].scale == config.maxScale);
+	free(entries);
+}
+
+// Slowly growing GPU cost with the budget raised partway through: the scale only ever goes
+// down while the budget is fixed, and the replay has to follow the budget change to match
+static void testDrift(void)
+{
+	DrsConfig config;
+	uint32_t count = 0;
+	DrsTraceEntry* entries = loadTrace(TRACE_DIR "drs_drift.csv", &config, &count);
+	if (!entries)
+		return;
+	CHECK_EQ_U64(count, 400);
+	checkCommon("drs_drift.csv", &config, entries, count);
+
+	uint32_t budgetChange = 0;
+	for (uint32_t i = 1; i < count; ++i)
+	{
+		if (entries[i].targetMs != entries[i - 1].targetMs && budgetChange == 0)
+			budgetChange = i;
+	}
+	CHECK_EQ_U64(budgetChange, 250);
+	for (uint32_t i = 1; i < budgetChange; ++i)
+		CHECK(entries[i].scale <= entries[i - 1].scale);
+	CHECK(entries[count - 1].scale < config.maxScale);
+
+	// Ignoring the recorded budget must not replay the same run
+	for (uint32_t i = 0; i < count; ++i)
+		entries[i].targetMs = config.targetMs;
+	CHECK(drsReplay(&config, entries, count) < count);
+	free(entries);
+}
+
+// GPU cost flipping between two levels every 20 frames: the controller follows within the
+// cooldown instead of flapping every frame, and never overshoots the range it needs
+static void testOscillation(void)
+{
+	DrsConfig config;
+	uint32_t count = 0;
+	DrsTraceEntry* entries = loadTrace(TRACE_DIR "drs_oscillation.csv", &config, &count);
+	if (!entries)
+		return;
+	CHECK_EQ_U64(count, 300);
+	checkCommon("drs_oscillation.csv", &config, entries, count);
+
+	uint32_t changes = 0;
+	for (uint32_t i = 1; i < count; ++i)
+	{
+		CHECK(entries[i].scale >= 0.8f - 1e-4f);
+		if (entries[i].scale != entries[i - 1].scale)
+			changes++;
+	}
+	CHECK(changes > 0 && changes <= count / config.cooldown);
+	free(entries);
+}
+
+// Written traces read back exactly, and two-column traces from before the budget column
+// replay with the header's budget
+static void testRoundTrip(void)
+{
+	DrsConfig config = drsDefaultConfig(12.5f);
+	DrsTraceEntry written[3] = {{10.0f, 1.0f, 12.5f}, {14.25f, 1.0f, 12.5f}, {9.0f, 0.95f, 13.0f}};
+	const char* path = "build/tests/drs_roundtrip.csv";
+	CHECK(drsTraceWrite(path, &config, written, 3));
+
+	DrsConfig readConfig;
+	uint32_t count = 0;
+	DrsTraceEntry* entries = drsTraceRead(path, &readConfig, &count);
+	CHECK(entries != NULL);
+	if (entries)
+	{
+		CHECK_EQ_U64(count, 3);
+		CHECK(readConfig.targetMs == config.targetMs && readConfig.step == config.step);
+		CHECK_EQ_U64(readConfig.cooldown, config.cooldown);
+		for (uint32_t i = 0; i < count && i < 3; ++i)
+			CHECK(entries[i].gpuMs == written[i].gpuMs && entries[i].scale == written[i].scale && entries[i].targetMs == written[i].targetMs);
+		free(entries);
+	}
+
+	FILE* file = fopen(path, "w");
+	fprintf(file, "# target=16 min=0.5 max=1 step=0.05 smoothing=0.2 margin=0.85 cooldown=8\n11,1\n12,1\n");
+	fclose(file);
+	entries = drsTraceRead(path, &readConfig, &count);
+	CHECK(entries != NULL);
+	if (entries)
+	{
+		CHECK_EQ_U64(count, 2);
+		CHECK(entries[1].gpuMs == 12.0f && entries[1].targetMs == 16.0f);
+		free(entries);
+	}
+
+	CHECK(drsTraceRead("build/tests/missing.csv", &readConfig, &count) == NULL);
+}
+
+int main(void)
+{
+	testSpike();
+	testDrift();
+	testOscillation();
+	testRoundTrip();
+	return testReport("drs");
+}
@@ -0,0 +1,201 @@
+// Reads a directory of generated files through every fileio path: io_uring when the kernel
+// allows it, blocking preads inline and spread over the job system, and the mounted archive
+// (packed by the real pack tool, see test.sh). All of them must return the same bytes and
+// report missing and short files the same way.
+
+#include "../src/fileio.h"
+#include "test.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define INPUT_DIR "build/tests/fileio_input"
+#define ARCHIVE "build/tests/fileio_test.pak"
+#define FILE_COUNT 48
+
+static const size_t g_sizes[] = {0, 1, 4095, 4096, 4097, 100000, (1u << 20) + 3};
+
+static char g_paths[FILE_COUNT][64];
+static uint8_t* g_data[FILE_COUNT];
+static size_t g_fileSizes[FILE_COUNT];
+
+static void makeInputs(void)
+{
+	mkdir(INPUT_DIR, 0755);
+	uint32_t rng = 2463534242u;
+	for (uint32_t i = 0; i < FILE_COUNT; ++i)
+	{
+		snprintf(g_paths[i], sizeof(g_paths[i]), INPUT_DIR "/file%02u.bin", i);
+		size_t size = g_sizes[i % (sizeof(g_sizes) / sizeof(g_sizes[0]))];
+		g_fileSizes[i] = size;
+		g_data[i] = malloc(size + 1);
+		// Every other file compressible, so the archive holds both kinds of entry
+		for (size_t b = 0; b < size; ++b)
+		{
+			rng ^= rng << 13;
+			rng ^= rng >> 17;
+			rng ^= rng << 5;
+			g_data[i][b] = i % 2 ? (uint8_t)(b / 64 + i) : (uint8_t)rng;
+		}
+		FILE* file = fopen(g_paths[i], "wb");
+		CHECK(file != NULL);
+		if (file)
+		{
+			CHECK(fwrite(g_data[i], 1, size, file) == size);
+			fclose(file);
+		}
+	}
+}
+
+// Whole files into buffers allocated by the read, plus one missing file at the end
+static void checkWholeFiles(FileIO* io, const char* label)
+{
+	FileRead reads[FILE_COUNT + 1] = {0};
+	for (uint32_t i = 0; i < FILE_COUNT; ++i)
+		reads[i].path = g_paths[i];
+	reads[FILE_COUNT].path = INPUT_DIR "/missing.bin";
+
+	CHECK_EQ_U64(fileioReadBatch(io, reads, FILE_COUNT + 1), 1);
+	uint32_t wrong = 0;
+	for (uint32_t i = 0; i < FILE_COUNT; ++i)
+	{
+		if (reads[i].error != 0 || reads[i].bytesRead != g_fileSizes[i] || !reads[i].dst ||
+		    memcmp(reads[i].dst, g_data[i], g_fileSizes[i]) != 0 || ((char*)reads[i].dst)[g_fileSizes[i]] != '\0')
+			wrong++;
+		free(reads[i].dst);
+	}
+	if (wrong)
+		fprintf(stderr, "fileio: %s: %u whole files differ\n", label, wrong);
+	CHECK_EQ_U64(wrong, 0);
+	CHECK_EQ_U64(reads[FILE_COUNT].error, ENOENT);
+	CHECK(reads[FILE_COUNT].dst == NULL);
+}
+
+// Ranges into the caller's buffers; asking past the end is EIO with what was there
+static void checkRanges(FileIO* io, const char* label)
+{
+	FileRead reads[FILE_COUNT] = {0};
+	uint8_t* buffers = calloc(FILE_COUNT, 4096);
+	uint64_t expected[FILE_COUNT];
+	for (uint32_t i = 0; i < FILE_COUNT; ++i)
+	{
+		uint64_t size = g_fileSizes[i];
+		reads[i].path = g_paths[i];
+		reads[i].dst = buffers + i * 4096;
+		reads[i].offset = size / 3;
+		uint64_t left = size - size / 3;
+		// A size of 0 would mean "to the end", which needs a buffer allocated by the read
+		reads[i].size = i % 5 == 4 ? 4096 : (left == 0 ? 1 : (left < 4096 ? left : 4096));
+		expected[i] = left < reads[i].size ? left : reads[i].size;
+	}
+
+	uint32_t failed = fileioReadBatch(io, reads, FILE_COUNT);
+	uint32_t wrong = 0, shortReads = 0;
+	for (uint32_t i = 0; i < FILE_COUNT; ++i)
+	{
+		bool isShort = expected[i] < reads[i].size;
+		shortReads += isShort;
+		if (reads[i].error != (isShort ? EIO : 0) || reads[i].bytesRead != expected[i] ||
+		    memcmp(reads[i].dst, g_data[i] + reads[i].offset, expected[i]) != 0)
+			wrong++;
+	}
+	if (wrong)
+		fprintf(stderr, "fileio: %s: %u ranges differ\n", label, wrong);
+	CHECK_EQ_U64(wrong, 0);
+	CHECK(shortReads > 0);
+	CHECK_EQ_U64(failed, shortReads);
+	free(buffers);
+}
+
+static void checkReader(FileIO* io, const char* label)
+{
+	checkWholeFiles(io, label);
+	checkRanges(io, label);
+
+	size_t size = 0;
+	char* data = fileioReadFile(io, g_paths[5], &size);
+	CHECK(data != NULL && size == g_fileSizes[5] && memcmp(data, g_data[5], size) == 0);
+	free(data);
+	errno = 0;
+	CHECK(fileioReadFile(io, INPUT_DIR "/missing.bin", &size) == NULL);
+	CHECK_EQ_U64(errno, ENOENT);
+}
+
+// A loose file edited after packing is read from disk instead of the stale archived copy
+static void testShadowed(Pak* pak)
+{
+	const char* path = g_paths[3];
+	FILE* file = fopen(path, "wb");
+	CHECK(file != NULL);
+	if (!file)
+		return;
+	fputs("edited", file);
+	fclose(file);
+	struct timespec later[2] = {{0, UTIME_OMIT}, {time(NULL) + 60, 0}};
+	CHECK(utimensat(AT_FDCWD, path, later, 0) == 0);
+
+	FileIO* io = fileioCreate(NULL, false);
+	fprintf(stderr, "fileio: expect one newer loose file\n");
+	fileioMount(io, pak);
+	FileRead reads[2] = {{.path = path}, {.path = g_paths[4]}};
+	CHECK_EQ_U64(fileioReadBatch(io, reads, 2), 0);
+	CHECK(reads[0].dst && strcmp(reads[0].dst, "edited") == 0);
+	CHECK(reads[1].dst && memcmp(reads[1].dst, g_data[4], g_fileSizes[4]) == 0);
+	CHECK_EQ_U64(fileioStats(io).pakReads, 1);
+	free(reads[0].dst);
+	free(reads[1].dst);
+	fileioDestroy(io);
+}
+
+int main(void)
+{
+	makeInputs();
+	int status = system("build/tests/pack --lz4 " ARCHIVE " " INPUT_DIR " > /dev/null");
+	CHECK_EQ_U64(status, 0);
+	Pak* pak = pakOpen(ARCHIVE);
+	CHECK(pak != NULL);
+
+	JobSystem* jobs = jobsCreate(4);
+	JobSystem* systems[] = {NULL, jobs};
+	for (int uring = 1; uring >= 0; --uring)
+	{
+		for (int s = 0; s < 2; ++s)
+		{
+			char label[64];
+			FileIO* io = fileioCreate(systems[s], uring);
+			snprintf(label, sizeof(label), "%s, %s", fileioUsesUring(io) ? "io_uring" : "pread", s ? "4 workers" : "inline");
+			if (uring && !fileioUsesUring(io))
+				printf("fileio: no io_uring here, testing the pread fallback only\n");
+			CHECK(uring || !fileioUsesUring(io));
+			checkReader(io, label);
+			FileIOStats stats = fileioStats(io);
+			CHECK_EQ_U64(stats.pakReads, 0);
+			CHECK_EQ_U64(stats.reads, FILE_COUNT * 2 + 3);
+
+			// Served from the archive, except the missing file that still goes to disk
+			if (pak)
+			{
+				fileioMount(io, pak);
+				snprintf(label + strlen(label), sizeof(label) - strlen(label), ", archive");
+				checkReader(io, label);
+				stats = fileioStats(io);
+				CHECK_EQ_U64(stats.pakReads, FILE_COUNT * 2 + 1);
+				fileioMount(io, NULL);
+			}
+			fileioDestroy(io);
+		}
+	}
+
+	if (pak)
+		testShadowed(pak);
+
+	jobsDestroy(jobs);
+	pakClose(pak);
+	for (uint32_t i = 0; i < FILE_COUNT; ++i)
+		free(g_data[i]);
+	return testReport("fileio");
+}
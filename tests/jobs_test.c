@@ -0,0 +1,166 @@
+// Runs batches, dependencies and nested parallel fors on a real worker pool and checks that
+// every job runs exactly once, that a batch held back with jobsRunAfter only starts once its
+// dependency is done, and that overflowing a deque or the job pool still runs everything.
+
+#include "../src/jobs.h"
+#include "test.h"
+
+#include <stdlib.h>
+
+#define WORKERS 4
+#define RANGE 100000
+
+typedef struct Hits
+{
+	atomic_uint* counts;
+	uint32_t count;
+} Hits;
+
+static void hitRange(void* data, uint32_t begin, uint32_t end)
+{
+	Hits* hits = data;
+	for (uint32_t i = begin; i < end; ++i)
+		atomic_fetch_add_explicit(&hits->counts[i], 1, memory_order_relaxed);
+}
+
+static uint32_t countNotOnce(const Hits* hits)
+{
+	uint32_t wrong = 0;
+	for (uint32_t i = 0; i < hits->count; ++i)
+		wrong += atomic_load(&hits->counts[i]) != 1;
+	return wrong;
+}
+
+static Hits newHits(uint32_t count)
+{
+	return (Hits){calloc(count, sizeof(atomic_uint)), count};
+}
+
+static void testParallelFor(JobSystem* js)
+{
+	// Even, uneven and single ranges, and the inline path with no system
+	uint32_t grains[] = {1000, 333, RANGE, RANGE * 2};
+	for (uint32_t g = 0; g < 4; ++g)
+	{
+		Hits hits = newHits(RANGE);
+		jobsParallelFor(js, RANGE, grains[g], hitRange, &hits);
+		CHECK_EQ_U64(countNotOnce(&hits), 0);
+		free(hits.counts);
+	}
+	Hits hits = newHits(RANGE);
+	jobsParallelFor(NULL, RANGE, 7, hitRange, &hits);
+	CHECK_EQ_U64(countNotOnce(&hits), 0);
+	jobsParallelFor(js, 0, 16, hitRange, &hits);
+	CHECK_EQ_U64(countNotOnce(&hits), 0);
+	free(hits.counts);
+}
+
+// Past both the deque and the job pool in one submission: the extra jobs run inline or wait
+// for slots, but none is lost
+static void testOverflow(JobSystem* js)
+{
+	uint32_t count = JOBS_POOL_CAPACITY * 2 + 17;
+	Hits hits = newHits(count);
+	JobCounter counter = {0};
+	jobsRun(js, hitRange, &hits, count, &counter);
+	jobsWait(js, &counter);
+	CHECK_EQ_U64(countNotOnce(&hits), 0);
+	CHECK_EQ_U64(atomic_load(&counter.pending), 0);
+	free(hits.counts);
+}
+
+typedef struct Stage
+{
+	atomic_uint firstDone;
+	atomic_uint early; // second-stage jobs that started before the first stage finished
+	uint32_t firstCount;
+	atomic_uint secondDone;
+} Stage;
+
+static void firstStage(void* data, uint32_t begin, uint32_t end)
+{
+	Stage* stage = data;
+	(void)begin;
+	(void)end;
+	for (volatile uint32_t spin = 0; spin < 20000; ++spin)
+		;
+	atomic_fetch_add(&stage->firstDone, 1);
+}
+
+static void secondStage(void* data, uint32_t begin, uint32_t end)
+{
+	Stage* stage = data;
+	(void)begin;
+	(void)end;
+	if (atomic_load(&stage->firstDone) != stage->firstCount)
+		atomic_fetch_add(&stage->early, 1);
+	atomic_fetch_add(&stage->secondDone, 1);
+}
+
+static void testDependency(JobSystem* js)
+{
+	for (int round = 0; round < 50; ++round)
+	{
+		Stage stage = {.firstCount = 64};
+		JobCounter first = {0}, second = {0};
+		jobsRun(js, firstStage, &stage, stage.firstCount, &first);
+		jobsRunAfter(js, &first, secondStage, &stage, 32, &second);
+		jobsWait(js, &second);
+		CHECK_EQ_U64(atomic_load(&stage.early), 0);
+		CHECK_EQ_U64(atomic_load(&stage.secondDone), 32);
+		jobsWait(js, &first);
+	}
+
+	// A dependency that has already finished releases the batch straight away
+	Stage stage = {.firstCount = 0};
+	JobCounter done = {0}, after = {0};
+	jobsRunAfter(js, &done, secondStage, &stage, 8, &after);
+	jobsWait(js, &after);
+	CHECK_EQ_U64(atomic_load(&stage.secondDone), 8);
+}
+
+typedef struct Nested
+{
+	JobSystem* js;
+	Hits* hits;
+	uint32_t width;
+} Nested;
+
+// Each outer job runs a parallel for of its own from inside a worker
+static void outerJob(void* data, uint32_t begin, uint32_t end)
+{
+	Nested* nested = data;
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		Hits inner = {nested->hits->counts + i * nested->width, nested->width};
+		jobsParallelFor(nested->js, nested->width, 64, hitRange, &inner);
+	}
+}
+
+static void testNested(JobSystem* js)
+{
+	Nested nested = {js, NULL, 1000};
+	Hits hits = newHits(64 * nested.width);
+	nested.hits = &hits;
+	jobsParallelFor(js, 64, 1, outerJob, &nested);
+	CHECK_EQ_U64(countNotOnce(&hits), 0);
+	free(hits.counts);
+}
+
+int main(void)
+{
+	JobSystem* js = jobsCreate(WORKERS);
+	CHECK_EQ_U64(jobsWorkerCount(js), WORKERS);
+	CHECK_EQ_U64(jobsWorkerCount(NULL), 1);
+
+	testParallelFor(js);
+	uint64_t before = jobsStats(js).executed;
+	testOverflow(js);
+	CHECK_EQ_U64(jobsStats(js).executed - before, JOBS_POOL_CAPACITY * 2 + 17);
+	testDependency(js);
+	testNested(js);
+	CHECK(!jobsRunOne(js));
+
+	jobsDestroy(js);
+	return testReport("jobs");
+}
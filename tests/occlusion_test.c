@@ -0,0 +1,151 @@
+// Cross-checks the AVX2 / threaded occlusion rasterizer against the scalar reference on
+// seeded random occluder sets, including triangles crossing the near plane and sub-pixel
+// ones. Both buffers are alive (and threaded) at the same time, so their workers must not
+// share state.
+
+#include "../src/occlusion.h"
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEED_COUNT 16
+#define TRIANGLES_PER_SET 600
+#define AABBS_PER_SET 2000
+#define NEAR_PLANE 0.1f
+#define FAR_PLANE 100.0f
+
+static uint32_t g_rng;
+
+static uint32_t nextRandom(void)
+{
+	// xorshift32
+	g_rng ^= g_rng << 13;
+	g_rng ^= g_rng >> 17;
+	g_rng ^= g_rng << 5;
+	return g_rng;
+}
+
+static float randomRange(float lo, float hi)
+{
+	return lo + (hi - lo) * (float)(nextRandom() & 0xffffff) / (float)0xffffff;
+}
+
+// Column-major perspective looking down -z from the origin, depth in [0, 1]
+static void perspective(float m[16], float fovY, float aspect)
+{
+	float f = 1.0f / tanf(fovY * 0.5f);
+	memset(m, 0, 16 * sizeof(float));
+	m[0] = f / aspect;
+	m[5] = f;
+	m[10] = FAR_PLANE / (NEAR_PLANE - FAR_PLANE);
+	m[11] = -1.0f;
+	m[14] = NEAR_PLANE * FAR_PLANE / (NEAR_PLANE - FAR_PLANE);
+}
+
+// One triangle's 3 vertices, appended to positions; kind picks the shape
+static void addTriangle(float* positions, uint32_t* vertexCount, int kind)
+{
+	float cx = randomRange(-20.0f, 20.0f);
+	float cy = randomRange(-12.0f, 12.0f);
+	float cz = randomRange(-60.0f, -2.0f);
+	float size = kind == 1 ? randomRange(0.001f, 0.05f) : randomRange(1.0f, 12.0f);
+
+	for (int v = 0; v < 3; ++v)
+	{
+		float* p = &positions[(*vertexCount)++ * 3];
+		p[0] = cx + randomRange(-size, size);
+		p[1] = cy + randomRange(-size, size);
+		p[2] = cz + randomRange(-size, size) * 0.5f;
+	}
+	// Crosses the near plane: one vertex behind the camera
+	if (kind == 2)
+		positions[(*vertexCount - 1) * 3 + 2] = randomRange(0.05f, 5.0f);
+}
+
+static void checkSeed(uint32_t seed, OcclusionBuffer* simd, OcclusionBuffer* reference, const float viewProj[16])
+{
+	g_rng = seed * 2654435761u + 1;
+
+	float positions[TRIANGLES_PER_SET * 9];
+	uint32_t indices[TRIANGLES_PER_SET * 3];
+	OccluderSource sources[TRIANGLES_PER_SET];
+	uint32_t vertexCount = 0;
+	for (uint32_t t = 0; t < TRIANGLES_PER_SET; ++t)
+	{
+		uint32_t roll = nextRandom() % 10;
+		int kind = roll < 2 ? 1 : (roll < 4 ? 2 : 0); // 20% sub-pixel, 20% near-crossing
+		addTriangle(positions, &vertexCount, kind);
+		for (int v = 0; v < 3; ++v)
+			indices[t * 3 + v] = t * 3 + v;
+		sources[t] = (OccluderSource){.firstIndex = t * 3, .indexCount = 3};
+	}
+
+	occlusionSelectOccluders(simd, positions, 3 * sizeof(float), indices, sources, TRIANGLES_PER_SET, TRIANGLES_PER_SET);
+	occlusionSelectOccluders(reference, positions, 3 * sizeof(float), indices, sources, TRIANGLES_PER_SET, TRIANGLES_PER_SET);
+	CHECK_EQ_U64(simd->occluderTriangleCount, TRIANGLES_PER_SET);
+
+	occlusionRasterize(simd, viewProj);
+	occlusionRasterizeReference(reference, viewProj);
+	CHECK_EQ_U64(simd->screenTriangleCount, reference->screenTriangleCount);
+	// Near-crossing triangles are dropped, so fewer reach the screen than were selected
+	CHECK(simd->screenTriangleCount < TRIANGLES_PER_SET);
+
+	uint32_t depthMismatches = 0, covered = 0;
+	for (int i = 0; i < simd->width * simd->height; ++i)
+	{
+		if (simd->depth[i] != reference->depth[i])
+			depthMismatches++;
+		if (reference->depth[i] < 1.0f)
+			covered++;
+	}
+	CHECK_EQ_U64(depthMismatches, 0);
+	CHECK(covered > 0);
+
+	uint32_t tileMismatches = 0;
+	for (int i = 0; i < simd->tilesX * simd->tilesY; ++i)
+	{
+		if (simd->tileMaxDepth[i] != reference->tileMaxDepth[i])
+			tileMismatches++;
+	}
+	CHECK_EQ_U64(tileMismatches, 0);
+
+	uint32_t testMismatches = 0, culled = 0;
+	for (uint32_t b = 0; b < AABBS_PER_SET; ++b)
+	{
+		float center[3] = {randomRange(-25.0f, 25.0f), randomRange(-15.0f, 15.0f), randomRange(-90.0f, 2.0f)};
+		float extent = randomRange(0.01f, 3.0f);
+		float aabbMin[3] = {center[0] - extent, center[1] - extent, center[2] - extent};
+		float aabbMax[3] = {center[0] + extent, center[1] + extent, center[2] + extent};
+		bool visibleSimd = occlusionTestAabb(simd, viewProj, aabbMin, aabbMax);
+		bool visibleReference = occlusionTestAabb(reference, viewProj, aabbMin, aabbMax);
+		if (visibleSimd != visibleReference)
+			testMismatches++;
+		if (!visibleReference)
+			culled++;
+	}
+	CHECK_EQ_U64(testMismatches, 0);
+	CHECK(culled > 0);
+	if (depthMismatches || tileMismatches || testMismatches)
+		fprintf(stderr, "  seed %u: %u depth, %u tile, %u test mismatches\n", seed, depthMismatches, tileMismatches, testMismatches);
+}
+
+int main(void)
+{
+	float viewProj[16];
+	perspective(viewProj, 1.0f, (float)OCCLUSION_WIDTH / (float)OCCLUSION_HEIGHT);
+
+	OcclusionBuffer simd, reference;
+	occlusionInit(&simd, OCCLUSION_WIDTH, OCCLUSION_HEIGHT, 4);
+	occlusionInit(&reference, OCCLUSION_WIDTH, OCCLUSION_HEIGHT, 4);
+	if (!simd.hasAvx2)
+		printf("occlusion: no AVX2 on this CPU, comparing the threaded scalar path only\n");
+
+	for (uint32_t seed = 1; seed <= SEED_COUNT; ++seed)
+		checkSeed(seed, &simd, &reference, viewProj);
+
+	occlusionDestroy(&simd);
+	occlusionDestroy(&reference);
+	return testReport("occlusion");
+}
@@ -0,0 +1,240 @@
+// Packs a small directory with the real pack tool (test.sh builds it into build/tests) and
+// reads it back: lookups through unnormalized paths, whole and partial reads of stored and
+// LZ4 entries, and archives that must be refused. The LZ4 codec is also checked on its own.
+
+#include "../src/pak.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define INPUT_DIR "build/tests/pak_input"
+#define ARCHIVE "build/tests/pak_test.pak"
+
+static uint32_t g_rng = 12345;
+
+static uint32_t nextRandom(void)
+{
+	// xorshift32
+	g_rng ^= g_rng << 13;
+	g_rng ^= g_rng >> 17;
+	g_rng ^= g_rng << 5;
+	return g_rng;
+}
+
+// Text that compresses well, or random bytes that don't
+static uint8_t* makeData(size_t size, bool compressible)
+{
+	static const char words[] = "albedo normal roughness metallic occlusion emissive ";
+	uint8_t* data = malloc(size + 1);
+	for (size_t i = 0; i < size; ++i)
+		data[i] = compressible ? (uint8_t)words[(i * 7 / 5) % (sizeof(words) - 1)] : (uint8_t)nextRandom();
+	return data;
+}
+
+static bool writeFile(const char* path, const void* data, size_t size)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+	bool ok = fwrite(data, 1, size, file) == size;
+	return fclose(file) == 0 && ok;
+}
+
+static void testCodec(void)
+{
+	size_t sizes[] = {1, 12, 100, 4096, 300000};
+	for (uint32_t s = 0; s < 5; ++s)
+	{
+		for (int compressible = 0; compressible < 2; ++compressible)
+		{
+			uint8_t* data = makeData(sizes[s], compressible);
+			size_t bound = pakCompressBound(sizes[s]);
+			uint8_t* packed = malloc(bound);
+			uint8_t* unpacked = malloc(sizes[s]);
+			size_t packedSize = pakCompress(data, sizes[s], packed, bound);
+			CHECK(packedSize > 0 && packedSize <= bound);
+			if (compressible && sizes[s] >= 4096)
+				CHECK(packedSize < sizes[s] / 4);
+			CHECK(pakDecompress(packed, packedSize, unpacked, sizes[s]));
+			CHECK(memcmp(data, unpacked, sizes[s]) == 0);
+
+			// Truncated streams and the wrong output size are refused, not overrun
+			if (packedSize > 1)
+				CHECK(!pakDecompress(packed, packedSize / 2, unpacked, sizes[s]));
+			CHECK(!pakDecompress(packed, packedSize, unpacked, sizes[s] - 1));
+			// No room for the output: compress gives up
+			if (packedSize > 1)
+				CHECK_EQ_U64(pakCompress(data, sizes[s], packed, packedSize / 2), 0);
+			free(unpacked);
+			free(packed);
+			free(data);
+		}
+	}
+}
+
+static void testNormalize(void)
+{
+	char out[64];
+	pakNormalizePath("./././shaders//vert.spv", out);
+	CHECK(strcmp(out, "shaders/vert.spv") == 0);
+	pakNormalizePath("data/scene.gltf", out);
+	CHECK(strcmp(out, "data/scene.gltf") == 0);
+	// The hash is over the normalized form; callers normalize first
+	pakNormalizePath("./data//scene.gltf", out);
+	CHECK(pakHash(out) == pakHash("data/scene.gltf"));
+	CHECK(pakHash("data/scene.gltf") != pakHash("data/scene.glb"));
+}
+
+typedef struct Input
+{
+	const char* path;
+	size_t size;
+	bool compressible;
+	uint8_t* data;
+} Input;
+
+static void testArchive(void)
+{
+	Input inputs[] = {
+	    {INPUT_DIR "/text.txt", 200000, true, NULL},
+	    {INPUT_DIR "/random.bin", 50000, false, NULL},
+	    {INPUT_DIR "/empty.txt", 0, false, NULL},
+	    {INPUT_DIR "/sub/small.txt", 9, true, NULL},
+	};
+	const uint32_t inputCount = sizeof(inputs) / sizeof(inputs[0]);
+	mkdir(INPUT_DIR, 0755);
+	mkdir(INPUT_DIR "/sub", 0755);
+	for (uint32_t i = 0; i < inputCount; ++i)
+	{
+		inputs[i].data = makeData(inputs[i].size, inputs[i].compressible);
+		CHECK(writeFile(inputs[i].path, inputs[i].data, inputs[i].size));
+	}
+	// The directory and one of its files again: packed once all the same
+	int status = system("build/tests/pack --lz4 " ARCHIVE " " INPUT_DIR " ./" INPUT_DIR "/sub/small.txt > /dev/null");
+	CHECK_EQ_U64(status, 0);
+
+	Pak* pak = pakOpen(ARCHIVE);
+	CHECK(pak != NULL);
+	if (!pak)
+		return;
+	CHECK_EQ_U64(pakEntryCount(pak), inputCount);
+	for (uint32_t i = 0; i < pakEntryCount(pak); ++i)
+	{
+		const PakEntry* entry = pakEntry(pak, i);
+		CHECK(pakFind(pak, pakEntryName(pak, entry)) == entry);
+		CHECK(entry->offset % PAK_ALIGNMENT == 0);
+	}
+
+	for (uint32_t i = 0; i < inputCount; ++i)
+	{
+		Input* input = &inputs[i];
+		char unnormalized[256];
+		snprintf(unnormalized, sizeof(unnormalized), "./%s", input->path);
+		*strrchr(unnormalized, '/') = '\0';
+		strcat(unnormalized, "//");
+		strcat(unnormalized, strrchr(input->path, '/') + 1);
+		const PakEntry* entry = pakFind(pak, unnormalized);
+		CHECK(entry != NULL);
+		if (!entry)
+			continue;
+		CHECK(strcmp(pakEntryName(pak, entry), input->path) == 0);
+		CHECK_EQ_U64(entry->size, input->size);
+		// Only what saves an eighth is compressed
+		CHECK(((entry->flags & PAK_ENTRY_LZ4) != 0) == (input->compressible && input->size >= 4096));
+
+		uint8_t* read = malloc(input->size + 1);
+		CHECK(pakRead(pak, entry, 0, input->size, read));
+		CHECK(memcmp(read, input->data, input->size) == 0);
+		if (input->size > 100)
+		{
+			memset(read, 0, input->size);
+			CHECK(pakRead(pak, entry, 33, 67, read));
+			CHECK(memcmp(read, input->data + 33, 67) == 0);
+		}
+		CHECK(!pakRead(pak, entry, input->size, 1, read));
+		CHECK(!pakRead(pak, entry, 1, input->size, read));
+		free(read);
+	}
+	CHECK(pakFind(pak, INPUT_DIR "/missing.txt") == NULL);
+	CHECK(pakFind(pak, INPUT_DIR "/sub") == NULL);
+	pakClose(pak);
+	for (uint32_t i = 0; i < inputCount; ++i)
+		free(inputs[i].data);
+}
+
+// Copies of the archive with a broken header, or cut short, are refused
+static void testRejects(void)
+{
+	FILE* file = fopen(ARCHIVE, "rb");
+	CHECK(file != NULL);
+	if (!file)
+		return;
+	fseek(file, 0, SEEK_END);
+	size_t size = (size_t)ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* bytes = malloc(size);
+	CHECK(fread(bytes, 1, size, file) == size);
+	fclose(file);
+
+	const char* path = "build/tests/pak_broken.pak";
+	PakHeader* header = (PakHeader*)bytes;
+	fprintf(stderr, "pak: expect six archives to be ignored\n");
+
+	header->magic ^= 1;
+	writeFile(path, bytes, size);
+	CHECK(pakOpen(path) == NULL);
+	header->magic ^= 1;
+
+	uint32_t bucketCount = header->bucketCount;
+	header->bucketCount = 3;
+	writeFile(path, bytes, size);
+	CHECK(pakOpen(path) == NULL);
+	header->bucketCount = bucketCount;
+
+	writeFile(path, bytes, 0);
+	CHECK(pakOpen(path) == NULL);
+	writeFile(path, bytes, (size_t)header->tocOffset + 8);
+	CHECK(pakOpen(path) == NULL);
+
+	// Every bucket filled, so a probe for a missing path would never reach an empty one
+	PakEntry* entries = (PakEntry*)(bytes + header->tocOffset);
+	uint32_t* buckets = (uint32_t*)(entries + header->entryCount);
+	uint32_t* savedBuckets = malloc(header->bucketCount * sizeof(uint32_t));
+	memcpy(savedBuckets, buckets, header->bucketCount * sizeof(uint32_t));
+	for (uint32_t i = 0; i < header->bucketCount; ++i)
+		buckets[i] = 1 + i % header->entryCount;
+	writeFile(path, bytes, size);
+	CHECK(pakOpen(path) == NULL);
+	memcpy(buckets, savedBuckets, header->bucketCount * sizeof(uint32_t));
+	free(savedBuckets);
+
+	// An LZ4 entry claiming more than its stored bytes could ever expand to
+	uint32_t lz4Entry = 0;
+	while (lz4Entry < header->entryCount && !(entries[lz4Entry].flags & PAK_ENTRY_LZ4))
+		lz4Entry++;
+	CHECK(lz4Entry < header->entryCount);
+	uint64_t entrySize = entries[lz4Entry].size;
+	entries[lz4Entry].size = entries[lz4Entry].storedSize * 1000;
+	writeFile(path, bytes, size);
+	CHECK(pakOpen(path) == NULL);
+	entries[lz4Entry].size = entrySize;
+
+	// Entry data that points past the table of contents
+	entries[0].offset = header->tocOffset + PAK_ALIGNMENT;
+	writeFile(path, bytes, size);
+	CHECK(pakOpen(path) == NULL);
+
+	CHECK(pakOpen("build/tests/missing.pak") == NULL);
+	free(bytes);
+}
+
+int main(void)
+{
+	testCodec();
+	testNormalize();
+	testArchive();
+	testRejects();
+	return testReport("pak");
+}
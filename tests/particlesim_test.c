@@ -0,0 +1,196 @@
+// Runs the CPU particle reference for many steps and checks what the GPU kernels rely on:
+// every index is on exactly one list, survivors keep their order, the same inputs give the
+// same lists, and particleSimCompare notices when a readback differs.
+
+#include "../src/particlesim.h"
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CAPACITY 4096 // several scan blocks, small enough to fill up
+#define STEPS 240
+
+static ParticleParams testParams(void)
+{
+	return (ParticleParams){
+	    .emitter = {0.0f, 0.0f, 0.0f, 0.5f},
+	    .gravityDrag = {0.0f, -9.8f, 0.0f, 0.2f},
+	    .speed = 6.0f,
+	    .spread = 0.25f,
+	    .lifeMin = 0.2f,
+	    .lifeMax = 1.5f,
+	    .groundY = 0.0f,
+	    .bounce = 0.4f,
+	    .dt = 1.0f / 60.0f,
+	    .capacity = CAPACITY,
+	};
+}
+
+// Bursts bigger than the dead list, quiet steps and everything between
+static uint32_t emitRequest(uint32_t step)
+{
+	if (step % 50 == 10)
+		return CAPACITY * 2;
+	if (step % 7 == 3)
+		return 0;
+	return 40 + (step * 37) % 300;
+}
+
+static void step(ParticleSim* sim, ParticleParams* params, uint32_t current, uint32_t index)
+{
+	params->emitRequest = emitRequest(index);
+	params->seed = particleHash(index);
+	params->current = current;
+	particleSimStep(sim, params);
+}
+
+// Survivors come out in the order they were simulated: the previous alive list, then the
+// particles emitted this step
+static bool keepsOrder(const ParticleSim* sim, const uint32_t* before, uint32_t beforeCount, uint32_t current)
+{
+	const uint32_t* live = sim->aliveList + (current ^ 1) * CAPACITY;
+	uint32_t cursor = 0;
+	for (uint32_t i = 0; i < sim->counters.aliveCount[current ^ 1]; ++i)
+	{
+		while (cursor < beforeCount && before[cursor] != live[i])
+			cursor++;
+		if (cursor == beforeCount)
+			return false;
+		cursor++;
+	}
+	return true;
+}
+
+static void testInvariants(void)
+{
+	ParticleSim sim;
+	CHECK(particleSimInit(&sim, CAPACITY));
+	ParticleParams params = testParams();
+	uint32_t* simulated = malloc(CAPACITY * sizeof(uint32_t));
+	uint32_t current = 0, deaths = 0, full = 0, orderErrors = 0, invalid = 0;
+
+	for (uint32_t s = 0; s < STEPS; ++s)
+	{
+		uint32_t aliveBefore = sim.counters.aliveCount[current];
+		step(&sim, &params, current, s);
+
+		// The alive list this step read, emitted particles appended, is still intact
+		memcpy(simulated, sim.aliveList + current * CAPACITY, sim.counters.simulateCount * sizeof(uint32_t));
+		if (!particleSimValidate(CAPACITY, &sim.counters, current, sim.deadList, sim.aliveList))
+			invalid++;
+		if (!keepsOrder(&sim, simulated, sim.counters.simulateCount, current))
+			orderErrors++;
+		CHECK(sim.counters.emitCount <= emitRequest(s));
+		deaths += sim.counters.simulateCount - sim.counters.aliveCount[current ^ 1];
+		if (aliveBefore + sim.counters.emitCount == CAPACITY)
+			full++;
+		current ^= 1;
+	}
+	CHECK_EQ_U64(invalid, 0);
+	CHECK_EQ_U64(orderErrors, 0);
+	CHECK(deaths > 0);
+	CHECK(full > 0); // the bursts emptied the dead list
+	free(simulated);
+	particleSimDestroy(&sim);
+}
+
+// Two runs from the same inputs agree entry by entry, and compare finds nothing
+static void testDeterminism(void)
+{
+	ParticleSim a, b;
+	CHECK(particleSimInit(&a, CAPACITY));
+	CHECK(particleSimInit(&b, CAPACITY));
+	ParticleParams params = testParams();
+	uint32_t current = 0, differences = 0;
+	for (uint32_t s = 0; s < STEPS; ++s)
+	{
+		step(&a, &params, current, s);
+		step(&b, &params, current, s);
+		if (memcmp(&a.counters, &b.counters, sizeof(a.counters)) != 0 ||
+		    memcmp(a.aliveList, b.aliveList, 2 * CAPACITY * sizeof(uint32_t)) != 0 ||
+		    memcmp(a.deadList, b.deadList, CAPACITY * sizeof(uint32_t)) != 0 ||
+		    particleSimCompare(&a, current, &b.counters, b.deadList, b.aliveList, b.position, 1e-4f, stderr) != 0)
+			differences++;
+		current ^= 1;
+	}
+	CHECK_EQ_U64(differences, 0);
+	particleSimDestroy(&a);
+	particleSimDestroy(&b);
+}
+
+// Corrupted copies of a reference state, as a bad readback would look
+static void testDetectsMismatches(void)
+{
+	ParticleSim sim;
+	CHECK(particleSimInit(&sim, CAPACITY));
+	ParticleParams params = testParams();
+	uint32_t current = 0;
+	for (uint32_t s = 0; s < 30; ++s, current ^= 1)
+		step(&sim, &params, current, s);
+	current ^= 1; // the last step's
+	uint32_t alive = sim.counters.aliveCount[current ^ 1];
+	CHECK(alive > 2 && sim.counters.deadCount > 0);
+
+	ParticleCounters counters = sim.counters;
+	uint32_t* deadList = malloc(CAPACITY * sizeof(uint32_t));
+	uint32_t* aliveList = malloc(2 * CAPACITY * sizeof(uint32_t));
+	float* positions = malloc(CAPACITY * 4 * sizeof(float));
+	uint32_t* live = aliveList + (current ^ 1) * CAPACITY;
+#define RESET()                                                                       \
+	do                                                                                \
+	{                                                                                 \
+		counters = sim.counters;                                                      \
+		memcpy(deadList, sim.deadList, CAPACITY * sizeof(uint32_t));                  \
+		memcpy(aliveList, sim.aliveList, 2 * CAPACITY * sizeof(uint32_t));            \
+		memcpy(positions, sim.position, CAPACITY * 4 * sizeof(float));                \
+	} while (0)
+
+	RESET();
+	CHECK(particleSimValidate(CAPACITY, &counters, current, deadList, aliveList));
+	CHECK_EQ_U64(particleSimCompare(&sim, current, &counters, deadList, aliveList, positions, 1e-4f, NULL), 0);
+
+	// Same set, different order: valid, but not what the reference produced
+	uint32_t swap = live[0];
+	live[0] = live[1];
+	live[1] = swap;
+	CHECK(particleSimValidate(CAPACITY, &counters, current, deadList, aliveList));
+	CHECK_EQ_U64(particleSimCompare(&sim, current, &counters, deadList, aliveList, positions, 1e-4f, NULL), 2);
+
+	// A particle on both lists
+	RESET();
+	deadList[0] = live[0];
+	fprintf(stderr, "particlesim: expect a duplicate index report\n");
+	CHECK(!particleSimValidate(CAPACITY, &counters, current, deadList, aliveList));
+	CHECK(particleSimCompare(&sim, current, &counters, deadList, aliveList, positions, 1e-4f, NULL) > 0);
+
+	// Counts that lose a particle
+	RESET();
+	counters.deadCount--;
+	fprintf(stderr, "particlesim: expect a count report\n");
+	CHECK(!particleSimValidate(CAPACITY, &counters, current, deadList, aliveList));
+	CHECK(particleSimCompare(&sim, current, &counters, deadList, aliveList, positions, 1e-4f, NULL) > 0);
+
+	// Positions: inside the tolerance passes, outside it and NaN don't
+	RESET();
+	positions[live[0] * 4 + 1] += 1e-6f;
+	CHECK_EQ_U64(particleSimCompare(&sim, current, &counters, deadList, aliveList, positions, 1e-4f, NULL), 0);
+	positions[live[0] * 4 + 1] += 0.5f;
+	positions[live[1] * 4 + 0] = NAN;
+	CHECK_EQ_U64(particleSimCompare(&sim, current, &counters, deadList, aliveList, positions, 1e-4f, NULL), 2);
+#undef RESET
+
+	free(positions);
+	free(aliveList);
+	free(deadList);
+	particleSimDestroy(&sim);
+}
+
+int main(void)
+{
+	testInvariants();
+	testDeterminism();
+	testDetectsMismatches();
+	return testReport("particlesim");
+}
@@ -0,0 +1,149 @@
+// Adds and removes items in a handle pool with two columns and checks what the resource
+// tables rely on: live items stay packed, handles survive other removals, and stale or
+// zeroed handles never find an item, even after their slot is reused or its generation wraps.
+
+#include "../src/pool.h"
+#include "test.h"
+
+#include <stdlib.h>
+
+#define ITEMS 1000 // several growth steps past the initial 64
+
+typedef struct Item
+{
+	uint32_t id;
+	float weight;
+} Item;
+
+typedef struct Table
+{
+	HandlePool pool;
+	uint32_t* ids;
+	Item* items;
+} Table;
+
+static uint32_t add(Table* table, uint32_t id)
+{
+	uint32_t index;
+	uint32_t handle = poolAdd(&table->pool, &index);
+	table->ids[index] = id;
+	table->items[index] = (Item){id, (float)id * 0.5f};
+	return handle;
+}
+
+// Every live handle maps to the item holding its id, in both columns
+static uint32_t countWrong(const Table* table, const uint32_t* handles, const bool* live, uint32_t count)
+{
+	uint32_t wrong = 0;
+	for (uint32_t id = 0; id < count; ++id)
+	{
+		uint32_t index = poolIndex(&table->pool, handles[id]);
+		if (!live[id])
+			wrong += index != POOL_INVALID;
+		else if (index >= table->pool.count || table->ids[index] != id || table->items[index].id != id ||
+		         poolHandleAt(&table->pool, index) != handles[id])
+			wrong++;
+	}
+	return wrong;
+}
+
+static void testAddRemove(void)
+{
+	Table table = {0};
+	poolAddColumn(&table.pool, &table.ids, sizeof(uint32_t));
+	poolAddColumn(&table.pool, &table.items, sizeof(Item));
+	CHECK(poolIndex(&table.pool, 0) == POOL_INVALID);
+
+	uint32_t* handles = malloc(ITEMS * sizeof(uint32_t));
+	bool* live = calloc(ITEMS, sizeof(bool));
+	for (uint32_t id = 0; id < ITEMS; ++id)
+	{
+		handles[id] = add(&table, id);
+		live[id] = true;
+		CHECK(handles[id] != 0);
+	}
+	CHECK_EQ_U64(table.pool.count, ITEMS);
+	CHECK_EQ_U64(countWrong(&table, handles, live, ITEMS), 0);
+
+	// Every third item, then again to see the stale handles refused
+	uint32_t removed = 0;
+	for (uint32_t id = 0; id < ITEMS; id += 3, ++removed)
+	{
+		CHECK(poolRemove(&table.pool, handles[id]));
+		live[id] = false;
+	}
+	for (uint32_t id = 0; id < ITEMS; id += 3)
+		CHECK(!poolRemove(&table.pool, handles[id]));
+	CHECK_EQ_U64(table.pool.count, ITEMS - removed);
+	CHECK_EQ_U64(countWrong(&table, handles, live, ITEMS), 0);
+
+	// Freed slots are reused, with a new generation, before the pool grows
+	uint32_t slotCount = table.pool.slotCount;
+	uint32_t* reused = malloc(removed * sizeof(uint32_t));
+	for (uint32_t i = 0; i < removed; ++i)
+		reused[i] = add(&table, ITEMS + i);
+	CHECK_EQ_U64(table.pool.slotCount, slotCount);
+	CHECK_EQ_U64(table.pool.count, ITEMS);
+	CHECK_EQ_U64(countWrong(&table, handles, live, ITEMS), 0);
+	for (uint32_t i = 0; i < removed; ++i)
+	{
+		uint32_t index = poolIndex(&table.pool, reused[i]);
+		CHECK(index != POOL_INVALID && table.ids[index] == ITEMS + i);
+	}
+
+	free(reused);
+	free(live);
+	free(handles);
+	poolDestroy(&table.pool);
+	CHECK(table.ids == NULL && table.items == NULL);
+}
+
+// New items come in zeroed even where a removed item's data was left behind
+static void testZeroed(void)
+{
+	Table table = {0};
+	poolAddColumn(&table.pool, &table.ids, sizeof(uint32_t));
+	poolAddColumn(&table.pool, &table.items, sizeof(Item));
+	uint32_t a = add(&table, 7);
+	add(&table, 8);
+	poolRemove(&table.pool, a);
+	uint32_t index;
+	poolAdd(&table.pool, &index);
+	CHECK_EQ_U64(index, 1);
+	CHECK_EQ_U64(table.ids[index], 0);
+	CHECK(table.items[index].id == 0 && table.items[index].weight == 0.0f);
+	poolDestroy(&table.pool);
+}
+
+// One slot removed and re-added until its generation wraps: no handle it ever had matches
+// anything but the current one, and generation 0 is skipped
+static void testGenerationWrap(void)
+{
+	Table table = {0};
+	poolAddColumn(&table.pool, &table.ids, sizeof(uint32_t));
+	poolAddColumn(&table.pool, &table.items, sizeof(Item));
+	uint32_t first = add(&table, 0);
+	uint32_t handle = first, stale = 0, zeroGeneration = 0;
+	for (uint32_t i = 1; i <= POOL_GENERATION_MASK + 1; ++i)
+	{
+		poolRemove(&table.pool, handle);
+		handle = add(&table, i);
+		if (handle >> POOL_INDEX_BITS == 0)
+			zeroGeneration++;
+		if (handle != first && poolIndex(&table.pool, first) != POOL_INVALID)
+			stale++;
+	}
+	CHECK_EQ_U64(table.pool.slotCount, 1);
+	CHECK_EQ_U64(zeroGeneration, 0);
+	CHECK_EQ_U64(stale, 0);
+	CHECK(poolIndex(&table.pool, handle) == 0);
+	poolDestroy(&table.pool);
+}
+
+int main(void)
+{
+	testAddRemove();
+	testZeroed();
+	testGenerationWrap();
+	return testReport("pool");
+}
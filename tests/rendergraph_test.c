@@ -0,0 +1,410 @@
+// Render graph compile/execute against a recording mock backend: culling, transient aliasing
+// and the exact barrier batches the Vulkan backend would be asked to record.
+
+#include "../src/rendergraph.h"
+#include "test.h"
+
+#include <string.h>
+
+#define BIT(access) (1u << (uint32_t)(access))
+
+#define MOCK_MAX_OBJECTS 64
+#define MOCK_MAX_BATCHES 32
+
+typedef struct MockImage
+{
+	RgImageDesc desc;
+	uint32_t memory; // allocation index + 1, 0 while unbound
+	uint64_t offset;
+	bool destroyed;
+} MockImage;
+
+typedef struct MockBatch
+{
+	uint32_t pass; // RG_INVALID for the final batch
+	RgBarrier barriers[RG_MAX_BARRIERS];
+	uint32_t count;
+} MockBatch;
+
+typedef struct MockBackend
+{
+	MockImage images[MOCK_MAX_OBJECTS];
+	uint32_t imageCount;
+	uint64_t allocations[MOCK_MAX_OBJECTS];
+	bool freed[MOCK_MAX_OBJECTS];
+	uint32_t allocationCount;
+	MockBatch batches[MOCK_MAX_BATCHES];
+	uint32_t batchCount;
+	uint32_t currentPass;
+	uint32_t executed[RG_MAX_PASSES];
+} MockBackend;
+
+// Handles are 1-based indices so that none of them is NULL
+static void* toHandle(uint32_t index)
+{
+	return (void*)(uintptr_t)(index + 1);
+}
+
+static uint32_t fromHandle(void* handle)
+{
+	return (uint32_t)(uintptr_t)handle - 1;
+}
+
+static void* mockCreateImage(void* user, const RgImageDesc* desc, RgMemoryRequirements* outRequirements)
+{
+	MockBackend* mock = user;
+	uint32_t index = mock->imageCount++;
+	mock->images[index] = (MockImage){.desc = *desc};
+	*outRequirements = (RgMemoryRequirements){
+	    .size = (uint64_t)desc->width * desc->height * 4,
+	    .alignment = 256,
+	    .typeBits = 0x3,
+	};
+	return toHandle(index);
+}
+
+static void* mockAllocateMemory(void* user, uint64_t size, uint32_t typeBits)
+{
+	(void)typeBits;
+	MockBackend* mock = user;
+	uint32_t index = mock->allocationCount++;
+	mock->allocations[index] = size;
+	return toHandle(index);
+}
+
+static void* mockBindImage(void* user, void* image, const RgImageDesc* desc, void* memory, uint64_t offset)
+{
+	(void)desc;
+	MockBackend* mock = user;
+	MockImage* mockImage = &mock->images[fromHandle(image)];
+	mockImage->memory = fromHandle(memory) + 1;
+	mockImage->offset = offset;
+	return image; // the view is never looked at
+}
+
+static void mockDestroyImage(void* user, void* image, void* view)
+{
+	(void)view;
+	MockBackend* mock = user;
+	mock->images[fromHandle(image)].destroyed = true;
+}
+
+static void mockFreeMemory(void* user, void* memory)
+{
+	MockBackend* mock = user;
+	mock->freed[fromHandle(memory)] = true;
+}
+
+static void mockCmdBarriers(void* user, void* cmd, const RenderGraph* graph, const RgBarrier* barriers, uint32_t count)
+{
+	(void)cmd;
+	(void)graph;
+	MockBackend* mock = user;
+	MockBatch* batch = &mock->batches[mock->batchCount++];
+	batch->pass = mock->currentPass;
+	batch->count = count;
+	memcpy(batch->barriers, barriers, count * sizeof(*barriers));
+}
+
+static void mockPassBegin(void* user, void* cmd, const RenderGraph* graph, uint32_t pass)
+{
+	(void)cmd;
+	(void)graph;
+	((MockBackend*)user)->currentPass = pass;
+}
+
+static void mockPassEnd(void* user, void* cmd, const RenderGraph* graph, uint32_t pass)
+{
+	(void)cmd;
+	(void)graph;
+	(void)pass;
+	((MockBackend*)user)->currentPass = RG_INVALID;
+}
+
+static void mockExecute(void* cmd, const RenderGraph* graph, void* userData)
+{
+	(void)graph;
+	MockBackend* mock = cmd;
+	mock->executed[(uint32_t)(uintptr_t)userData]++;
+}
+
+static void initMock(MockBackend* mock, RenderGraph* graph)
+{
+	memset(mock, 0, sizeof(*mock));
+	mock->currentPass = RG_INVALID;
+	RgBackend backend = {
+	    .user = mock,
+	    .createImage = mockCreateImage,
+	    .allocateMemory = mockAllocateMemory,
+	    .bindImage = mockBindImage,
+	    .destroyImage = mockDestroyImage,
+	    .freeMemory = mockFreeMemory,
+	    .cmdBarriers = mockCmdBarriers,
+	    .cmdPassBegin = mockPassBegin,
+	    .cmdPassEnd = mockPassEnd,
+	};
+	rgInit(graph, &backend);
+}
+
+static uint32_t addPass(RenderGraph* graph, const char* name)
+{
+	// The pass index doubles as the user data so the mock can count executions
+	return rgAddPass(graph, name, mockExecute, (void*)(uintptr_t)graph->passCount);
+}
+
+static void checkBarrier(const RgBarrier* actual, RgBarrier expected)
+{
+	CHECK_EQ_U64(actual->resource, expected.resource);
+	CHECK_EQ_U64(actual->srcAccessMask, expected.srcAccessMask);
+	CHECK_EQ_U64(actual->dstAccessMask, expected.dstAccessMask);
+	CHECK_EQ_U64(actual->oldLayout, expected.oldLayout);
+	CHECK_EQ_U64(actual->newLayout, expected.newLayout);
+}
+
+static const RgImageDesc g_colorDesc = {.width = 16, .height = 16, .mipLevels = 1, .arrayLayers = 1};
+
+// Passes whose outputs never reach an imported resource or a side effect are dropped,
+// together with producers only they consumed, and are never recorded.
+static void testCulling(void)
+{
+	MockBackend mock;
+	RenderGraph graph;
+	initMock(&mock, &graph);
+
+	RgState swapchainState = {0};
+	uint32_t swapchain = rgImportImage(&graph, "swapchain", &g_colorDesc, (void*)0x100, (void*)0x101, &swapchainState, RG_ACCESS_PRESENT);
+	uint32_t scene = rgCreateImage(&graph, "scene", &g_colorDesc);
+	uint32_t unused = rgCreateImage(&graph, "unused", &g_colorDesc);
+	uint32_t deadInput = rgCreateImage(&graph, "deadInput", &g_colorDesc);
+	uint32_t deadOutput = rgCreateImage(&graph, "deadOutput", &g_colorDesc);
+
+	uint32_t draw = addPass(&graph, "draw");
+	rgPassUse(&graph, draw, scene, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+	uint32_t orphan = addPass(&graph, "orphan");
+	rgPassUse(&graph, orphan, unused, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+	uint32_t deadProducer = addPass(&graph, "deadProducer");
+	rgPassUse(&graph, deadProducer, deadInput, RG_ACCESS_STORAGE_WRITE_COMPUTE);
+	uint32_t deadConsumer = addPass(&graph, "deadConsumer");
+	rgPassUse(&graph, deadConsumer, deadInput, RG_ACCESS_SAMPLED_FRAGMENT);
+	rgPassUse(&graph, deadConsumer, deadOutput, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+	uint32_t debug = addPass(&graph, "debug");
+	rgPassSideEffects(&graph, debug);
+	uint32_t composite = addPass(&graph, "composite");
+	rgPassUse(&graph, composite, scene, RG_ACCESS_SAMPLED_FRAGMENT);
+	rgPassUse(&graph, composite, swapchain, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+
+	CHECK(rgCompile(&graph));
+	CHECK(!graph.passes[draw].culled);
+	CHECK(graph.passes[orphan].culled);
+	CHECK(graph.passes[deadProducer].culled);
+	CHECK(graph.passes[deadConsumer].culled);
+	CHECK(!graph.passes[debug].culled);
+	CHECK(!graph.passes[composite].culled);
+	CHECK_EQ_U64(graph.stats.passes, 6);
+	CHECK_EQ_U64(graph.stats.culledPasses, 3);
+
+	// Only transients used by live passes get an image
+	CHECK_EQ_U64(mock.imageCount, 1);
+	CHECK(rgGetHandle(&graph, scene) != NULL);
+	CHECK(rgGetHandle(&graph, unused) == NULL);
+	CHECK(rgGetHandle(&graph, deadInput) == NULL);
+	CHECK(rgGetHandle(&graph, deadOutput) == NULL);
+
+	rgExecute(&graph, &mock);
+	CHECK_EQ_U64(mock.executed[draw], 1);
+	CHECK_EQ_U64(mock.executed[orphan], 0);
+	CHECK_EQ_U64(mock.executed[deadProducer], 0);
+	CHECK_EQ_U64(mock.executed[deadConsumer], 0);
+	CHECK_EQ_U64(mock.executed[debug], 1);
+	CHECK_EQ_U64(mock.executed[composite], 1);
+
+	rgDestroy(&graph);
+	CHECK(mock.images[0].destroyed);
+	CHECK(mock.freed[0]);
+}
+
+// A chain of transients where each one dies before the next-but-one is born: the first and
+// third share a memory slot, the second gets its own.
+static void testAliasing(void)
+{
+	MockBackend mock;
+	RenderGraph graph;
+	initMock(&mock, &graph);
+
+	RgState outputState = {0};
+	uint32_t output = rgImportImage(&graph, "output", &g_colorDesc, (void*)0x100, (void*)0x101, &outputState, RG_ACCESS_NONE);
+	uint32_t a = rgCreateImage(&graph, "a", &g_colorDesc);
+	uint32_t b = rgCreateImage(&graph, "b", &g_colorDesc);
+	RgImageDesc smallDesc = g_colorDesc;
+	smallDesc.width = 8;
+	uint32_t c = rgCreateImage(&graph, "c", &smallDesc);
+
+	uint32_t p0 = addPass(&graph, "p0");
+	rgPassUse(&graph, p0, a, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+	uint32_t p1 = addPass(&graph, "p1");
+	rgPassUse(&graph, p1, a, RG_ACCESS_SAMPLED_FRAGMENT);
+	rgPassUse(&graph, p1, b, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+	uint32_t p2 = addPass(&graph, "p2");
+	rgPassUse(&graph, p2, b, RG_ACCESS_SAMPLED_FRAGMENT);
+	rgPassUse(&graph, p2, c, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+	uint32_t p3 = addPass(&graph, "p3");
+	rgPassUse(&graph, p3, c, RG_ACCESS_SAMPLED_FRAGMENT);
+	rgPassUse(&graph, p3, output, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+
+	CHECK(rgCompile(&graph));
+	CHECK_EQ_U64(graph.resources[a].firstPass, p0);
+	CHECK_EQ_U64(graph.resources[a].lastPass, p1);
+	CHECK_EQ_U64(graph.resources[b].firstPass, p1);
+	CHECK_EQ_U64(graph.resources[b].lastPass, p2);
+	CHECK_EQ_U64(graph.resources[c].firstPass, p2);
+	CHECK_EQ_U64(graph.resources[c].lastPass, p3);
+
+	CHECK_EQ_U64(graph.slotCount, 2);
+	CHECK_EQ_U64(graph.resources[a].memorySlot, graph.resources[c].memorySlot);
+	CHECK(graph.resources[a].memorySlot != graph.resources[b].memorySlot);
+	CHECK_EQ_U64(graph.resources[a].aliasPrevious, RG_INVALID);
+	CHECK_EQ_U64(graph.resources[b].aliasPrevious, RG_INVALID);
+	CHECK_EQ_U64(graph.resources[c].aliasPrevious, a);
+
+	// The backend saw two allocations, each as large as its biggest tenant, with a and c
+	// bound to the same range
+	CHECK_EQ_U64(mock.allocationCount, 2);
+	CHECK_EQ_U64(mock.allocations[0], 16 * 16 * 4);
+	CHECK_EQ_U64(mock.allocations[1], 16 * 16 * 4);
+	const MockImage* imageA = &mock.images[fromHandle(rgGetHandle(&graph, a))];
+	const MockImage* imageB = &mock.images[fromHandle(rgGetHandle(&graph, b))];
+	const MockImage* imageC = &mock.images[fromHandle(rgGetHandle(&graph, c))];
+	CHECK(imageA->memory != 0);
+	CHECK_EQ_U64(imageA->memory, imageC->memory);
+	CHECK_EQ_U64(imageA->offset, imageC->offset);
+	CHECK(imageA->memory != imageB->memory);
+	CHECK_EQ_U64(graph.stats.transientBytes, 16 * 16 * 4 * 2 + 8 * 16 * 4);
+	CHECK_EQ_U64(graph.stats.allocatedBytes, 16 * 16 * 4 * 2);
+
+	// c's first use waits on a's last write and read before the memory is overwritten
+	rgExecute(&graph, &mock);
+	const RgPass* pass = &graph.passes[p2];
+	bool found = false;
+	for (uint32_t i = 0; i < pass->barrierCount; ++i)
+	{
+		const RgBarrier* barrier = &graph.barriers[pass->firstBarrier + i];
+		if (barrier->resource != c)
+			continue;
+		found = true;
+		checkBarrier(barrier, (RgBarrier){c, BIT(RG_ACCESS_COLOR_ATTACHMENT_WRITE) | BIT(RG_ACCESS_SAMPLED_FRAGMENT), BIT(RG_ACCESS_COLOR_ATTACHMENT_WRITE), RG_LAYOUT_UNDEFINED, RG_LAYOUT_COLOR_ATTACHMENT});
+	}
+	CHECK(found);
+
+	rgDestroy(&graph);
+}
+
+// Read-after-write and write-after-read on a transient and on an imported image whose state
+// persists between frames, checked batch by batch over two frames.
+static void testBarriers(void)
+{
+	MockBackend mock;
+	RenderGraph graph;
+	initMock(&mock, &graph);
+
+	// Last frame wrote history as an attachment, then sampled it and left it shader-readable
+	RgState historyState = {
+	    .lastWrite = RG_ACCESS_COLOR_ATTACHMENT_WRITE,
+	    .readMask = BIT(RG_ACCESS_SAMPLED_FRAGMENT),
+	    .layout = RG_LAYOUT_SHADER_READ_ONLY,
+	};
+	uint32_t history = rgImportImage(&graph, "history", &g_colorDesc, (void*)0x100, (void*)0x101, &historyState, RG_ACCESS_SAMPLED_FRAGMENT);
+	uint32_t color = rgCreateImage(&graph, "color", &g_colorDesc);
+
+	uint32_t draw = addPass(&graph, "draw");
+	rgPassUse(&graph, draw, color, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+	rgPassUse(&graph, draw, history, RG_ACCESS_SAMPLED_FRAGMENT);
+	uint32_t resolve = addPass(&graph, "resolve");
+	rgPassUse(&graph, resolve, color, RG_ACCESS_SAMPLED_COMPUTE);
+	rgPassUse(&graph, resolve, history, RG_ACCESS_STORAGE_WRITE_COMPUTE);
+
+	CHECK(rgCompile(&graph));
+
+	rgExecute(&graph, &mock);
+	CHECK_EQ_U64(mock.batchCount, 3);
+	CHECK_EQ_U64(graph.stats.barrierBatches, 3);
+	CHECK_EQ_U64(graph.stats.barriers, 4);
+
+	// draw: color is fresh; history is already readable with this access, so nothing for it
+	CHECK_EQ_U64(mock.batches[0].pass, draw);
+	CHECK_EQ_U64(mock.batches[0].count, 1);
+	checkBarrier(&mock.batches[0].barriers[0], (RgBarrier){color, 0, BIT(RG_ACCESS_COLOR_ATTACHMENT_WRITE), RG_LAYOUT_UNDEFINED, RG_LAYOUT_COLOR_ATTACHMENT});
+
+	// resolve: RAW on color, WAR on history against both last frame's write and this frame's read
+	CHECK_EQ_U64(mock.batches[1].pass, resolve);
+	CHECK_EQ_U64(mock.batches[1].count, 2);
+	checkBarrier(&mock.batches[1].barriers[0], (RgBarrier){color, BIT(RG_ACCESS_COLOR_ATTACHMENT_WRITE), BIT(RG_ACCESS_SAMPLED_COMPUTE), RG_LAYOUT_COLOR_ATTACHMENT, RG_LAYOUT_SHADER_READ_ONLY});
+	checkBarrier(&mock.batches[1].barriers[1], (RgBarrier){history, BIT(RG_ACCESS_COLOR_ATTACHMENT_WRITE) | BIT(RG_ACCESS_SAMPLED_FRAGMENT), BIT(RG_ACCESS_STORAGE_WRITE_COMPUTE), RG_LAYOUT_SHADER_READ_ONLY, RG_LAYOUT_GENERAL});
+
+	// Final batch returns history to the access it was imported for
+	CHECK_EQ_U64(mock.batches[2].pass, RG_INVALID);
+	CHECK_EQ_U64(mock.batches[2].count, 1);
+	checkBarrier(&mock.batches[2].barriers[0], (RgBarrier){history, BIT(RG_ACCESS_STORAGE_WRITE_COMPUTE), BIT(RG_ACCESS_SAMPLED_FRAGMENT), RG_LAYOUT_GENERAL, RG_LAYOUT_SHADER_READ_ONLY});
+
+	// The imported state now describes what the frame left behind
+	CHECK_EQ_U64(historyState.lastWrite, RG_ACCESS_STORAGE_WRITE_COMPUTE);
+	CHECK_EQ_U64(historyState.readMask, BIT(RG_ACCESS_SAMPLED_FRAGMENT));
+	CHECK_EQ_U64(historyState.layout, RG_LAYOUT_SHADER_READ_ONLY);
+
+	// Second frame: color's memory still has last frame's compute read in flight (WAR), and
+	// history starts from the state written back above
+	mock.batchCount = 0;
+	rgExecute(&graph, &mock);
+	CHECK_EQ_U64(mock.batchCount, 3);
+	CHECK_EQ_U64(mock.batches[0].count, 1);
+	checkBarrier(&mock.batches[0].barriers[0], (RgBarrier){color, BIT(RG_ACCESS_COLOR_ATTACHMENT_WRITE) | BIT(RG_ACCESS_SAMPLED_COMPUTE), BIT(RG_ACCESS_COLOR_ATTACHMENT_WRITE), RG_LAYOUT_UNDEFINED, RG_LAYOUT_COLOR_ATTACHMENT});
+	CHECK_EQ_U64(mock.batches[1].count, 2);
+	checkBarrier(&mock.batches[1].barriers[1], (RgBarrier){history, BIT(RG_ACCESS_STORAGE_WRITE_COMPUTE) | BIT(RG_ACCESS_SAMPLED_FRAGMENT), BIT(RG_ACCESS_STORAGE_WRITE_COMPUTE), RG_LAYOUT_SHADER_READ_ONLY, RG_LAYOUT_GENERAL});
+
+	rgDestroy(&graph);
+}
+
+// Buffers have no layout: a write needs no barrier of its own, the first read of each kind
+// after it does and repeated reads of the same kind don't.
+static void testBufferReads(void)
+{
+	MockBackend mock;
+	RenderGraph graph;
+	initMock(&mock, &graph);
+
+	RgState argsState = {0};
+	uint32_t args = rgImportBuffer(&graph, "args", (void*)0x200, &argsState);
+
+	uint32_t cull = addPass(&graph, "cull");
+	rgPassUse(&graph, cull, args, RG_ACCESS_STORAGE_WRITE_COMPUTE);
+	uint32_t drawA = addPass(&graph, "drawA");
+	rgPassUse(&graph, drawA, args, RG_ACCESS_INDIRECT_READ);
+	rgPassSideEffects(&graph, drawA);
+	uint32_t drawB = addPass(&graph, "drawB");
+	rgPassUse(&graph, drawB, args, RG_ACCESS_INDIRECT_READ);
+	rgPassSideEffects(&graph, drawB);
+	uint32_t debug = addPass(&graph, "debug");
+	rgPassUse(&graph, debug, args, RG_ACCESS_STORAGE_READ_FRAGMENT);
+	rgPassSideEffects(&graph, debug);
+
+	CHECK(rgCompile(&graph));
+	rgExecute(&graph, &mock);
+
+	CHECK_EQ_U64(graph.passes[cull].barrierCount, 0);
+	CHECK_EQ_U64(graph.passes[drawB].barrierCount, 0);
+	CHECK_EQ_U64(mock.batchCount, 2);
+	CHECK_EQ_U64(mock.batches[0].pass, drawA);
+	checkBarrier(&mock.batches[0].barriers[0], (RgBarrier){args, BIT(RG_ACCESS_STORAGE_WRITE_COMPUTE), BIT(RG_ACCESS_INDIRECT_READ), RG_LAYOUT_UNDEFINED, RG_LAYOUT_UNDEFINED});
+	CHECK_EQ_U64(mock.batches[1].pass, debug);
+	checkBarrier(&mock.batches[1].barriers[0], (RgBarrier){args, BIT(RG_ACCESS_STORAGE_WRITE_COMPUTE) | BIT(RG_ACCESS_INDIRECT_READ), BIT(RG_ACCESS_STORAGE_READ_FRAGMENT), RG_LAYOUT_UNDEFINED, RG_LAYOUT_UNDEFINED});
+
+	rgDestroy(&graph);
+}
+
+int main(void)
+{
+	testCulling();
+	testAliasing();
+	testBarriers();
+	testBufferReads();
+	return testReport("rendergraph");
+}
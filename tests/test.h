@@ -0,0 +1,38 @@
+#pragma once
+
+// Minimal check macros shared by the CPU tests in this directory (see test.sh). A failed
+// check is reported and counted but doesn't stop the test, so one run shows every mismatch.
+
+#include <stdio.h>
+
+static int g_testFailures;
+
+#define CHECK(cond)                                                                      \
+	do                                                                                   \
+	{                                                                                    \
+		if (!(cond))                                                                     \
+		{                                                                                \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+			g_testFailures++;                                                            \
+		}                                                                                \
+	} while (0)
+
+#define CHECK_EQ_U64(actual, expected)                                                                     \
+	do                                                                                                     \
+	{                                                                                                      \
+		unsigned long long a_ = (unsigned long long)(actual), e_ = (unsigned long long)(expected);        \
+		if (a_ != e_)                                                                                      \
+		{                                                                                                  \
+			fprintf(stderr, "%s:%d: %s is %llu, expected %llu\n", __FILE__, __LINE__, #actual, a_, e_); \
+			g_testFailures++;                                                                              \
+		}                                                                                                  \
+	} while (0)
+
+static inline int testReport(const char* name)
+{
+	if (g_testFailures)
+		fprintf(stderr, "%s: %d check(s) failed\n", name, g_testFailures);
+	else
+		printf("%s: ok\n", name);
+	return g_testFailures ? 1 : 0;
+}